@@ -19,6 +19,9 @@ void ControlISR(void);
 void LMotorInputCapture(void);
 void RMotorInputCapture(void);
 
+// For the cyclic executive (ES_CYCLIC)
+void DCMotorControlSlot(void);
+
 // Following functions are to be called by MasterSM
 void StartDrive(uint8_t Speed, uint8_t Direction);
 void InitialDrive(uint8_t Speed, uint8_t TargetDirection);
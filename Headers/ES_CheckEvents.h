@@ -9,6 +9,8 @@
  History
  When           Who     What/Why
  -------------- ---     --------
+ 10/19/26 16:37 jh       the checkers come from ES_EVENT_CHECK_LIST, each with
+                         a period & a priority, added the checker statistics
  08/05/13 15:19 jec      modifications to suit new portable type definitions
  01/15/12 12:00 jec      new header for local types
  10/16/11 17:17 jec      started coding
@@ -17,13 +19,36 @@
 #ifndef ES_CheckEvents_H
 #define ES_CheckEvents_H
 
+#include "ES_Configure.h"
 #include "ES_Types.h"
 
 typedef bool CheckFunc( void );
 
 typedef CheckFunc (*pCheckFunc);
 
+// the event checkers, ES_CHECK_<name> in the order of ES_EVENT_CHECK_LIST
+#define ES_EVENT_CHECK_ID(Name, Period, Priority) ES_CHECK_##Name,
+typedef enum {
+  ES_EVENT_CHECK_LIST(ES_EVENT_CHECK_ID)
+  ES_NUM_EVENT_CHECKERS
+} ES_CheckerId_t;
+
+// the time taken by one event checker, in _HW_GetCycles units
+// (ES_CYCLES_PER_US to the uS)
+typedef struct {
+  uint32_t NumChecks;    // number of times it was called
+  uint32_t NumEvents;    // number of those that found an event
+  uint32_t MaxCycles;    // longest call
+  uint64_t TotalCycles;  // all the calls, for the mean & the CPU load
+} ES_CheckerStats_t;
+
+void ES_InitEventCheckers( void );
 bool ES_CheckUserEvents( void );
+uint16_t ES_GetTicksToNextCheck( void );
+bool ES_GetCheckerStats( ES_CheckerId_t WhichChecker,
+                         ES_CheckerStats_t * pStats );
+void ES_ResetCheckerStats( void );
+void ES_DumpCheckerStats( void );
 
 
 #endif  // ES_CheckEvents_H
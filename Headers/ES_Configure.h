@@ -9,6 +9,35 @@
  History
  When           Who     What/Why
  -------------- ---     --------
+ 10/21/26 16:35 jh       stop an ES_PREEMPTIVE build under Keil or GCC here,
+                         not in ES_Port.c
+ 10/21/26 10:40 jh       ES_REPLAY_RECORDS can be given on the command line
+ 10/21/26 09:25 jh       ES_PAYLOAD_BLOCKS & ES_PAYLOAD_EVENTS can be given
+                         on the command line
+ 10/20/26 15:20 jh       ES_STARVATION_GUARD is off by default, the list can
+                         be given on the command line
+ 10/20/26 14:40 jh       ES_PREEMPTIVE notes the vector table, the NMI and
+                         that its handlers are for CCS only
+ 10/20/26 09:52 jh       added ES_MAILBOX_CHECK
+ 10/19/26 19:36 jh       added the starvation guard (ES_STARVATION_GUARD)
+ 10/19/26 16:37 jh       the event checkers are now ES_EVENT_CHECK_LIST, with
+                         a polling period & a priority for each
+ 10/19/26 14:05 jh       added the cyclic executive schedule (ES_CYCLIC)
+ 10/19/26 10:27 jh       added ES_THREADS for the multi-threaded host build
+ 10/18/26 17:11 jh       added ES_PREEMPTIVE switch
+ 10/18/26 14:29 jh       added the ISR statistics settings
+ 10/18/26 11:48 jh       added ES_RUN_PROFILE switch
+ 10/18/26 09:43 jh       added ES_NUM_INSTANCES for the multi-robot host build
+ 10/17/26 23:00 jh       added ES_REPLAY_RECORDS for the ISR record/replay
+ 10/17/26 22:00 jh       added the flight recorder settings
+ 10/17/26 20:10 jh       added the payload pool settings
+ 10/17/26 19:30 jh       added ES_COMPACT_EVENTS & ES_WIDE_EVENT_PARAM, and
+                         ES_NUM_EVENT_TYPES at the end of the events
+ 10/17/26 18:50 jh       the services are now one ES_SERVICE_LIST X-macro in
+                         place of the SERV_n_xxx blocks, with up to 64
+ 10/17/26 15:40 jh       added ES_MAX_TIMERS
+ 10/17/26 14:50 jh       added ES_LATENCY_STATS switch
+ 10/17/26 12:50 jh       added ES_MAILBOX_SIZE for the per service ISR mailboxes
  10/21/13 20:54 jec      lots of added entries to bring the number of timers
                          and services up to 16 each
  08/06/13 14:10 jec      removed PostKeyFunc stuff since we are moving that
@@ -21,229 +50,191 @@
 #define CONFIGURE_H
 
 /****************************************************************************/
-// The maximum number of services sets an upper bound on the number of 
-// services that the framework will handle. Reasonable values are 8 and 16
-// corresponding to an 8-bit(uint8_t) and 16-bit(uint16_t) Ready variable size
-#define MAX_NUM_SERVICES 16
+// The list of services, one ES_SERVICE_ENTRY per line. The first entry is
+// service 0, the lowest priority, with increasing priorities further down.
+// Every Events and Services application must have a Service 0.
+// Each entry gives the name of the service and how big its queue should be.
+// The framework expects Init<Name>, Run<Name> & Post<Name> functions, with
+// the usual signatures, and declares them for itself in ES_ServiceHeaders.h
+// Up to 64 services may be listed. The Ready word is 32 bits for up to 32
+// services and 64 bits beyond that.
+#define ES_SERVICE_LIST(ES_SERVICE_ENTRY) \
+  ES_SERVICE_ENTRY( SPIService,           3 ) \
+  ES_SERVICE_ENTRY( LEDService,           3 ) \
+  ES_SERVICE_ENTRY( HallEffectService,    3 ) \
+  ES_SERVICE_ENTRY( DCMotorService,       3 ) \
+  ES_SERVICE_ENTRY( UltrasonicTest,       3 ) \
+  ES_SERVICE_ENTRY( COWSupplementService, 3 ) \
+  ES_SERVICE_ENTRY( FlywheelTest,         3 ) \
+  ES_SERVICE_ENTRY( ServoGateService,     3 ) \
+  ES_SERVICE_ENTRY( MasterSM,             3 )
 
 /****************************************************************************/
-// This macro determines that nuber of services that are *actually* used in
-// a particular application. It will vary in value from 1 to MAX_NUM_SERVICES
-#define NUM_SERVICES 9
+// The number of services that are *actually* used in this application,
+// counted from ES_SERVICE_LIST so that it can be used in #if tests
+#define ES_COUNT_SERVICE(Name, QueueSize) +1
+#define NUM_SERVICES (0 ES_SERVICE_LIST(ES_COUNT_SERVICE))
 
-/****************************************************************************/
-// These are the definitions for Service 0, the lowest priority service.
-// Every Events and Services application must have a Service 0. Further 
-// services are added in numeric sequence (1,2,3,...) with increasing 
-// priorities
-// the header file with the public function prototypes
-#define SERV_0_HEADER "SPIService.h"
-// the name of the Init function
-#define SERV_0_INIT InitSPIService
-// the name of the run function
-#define SERV_0_RUN RunSPIService
-// How big should this services Queue be?
-#define SERV_0_QUEUE_SIZE 3
+// the most services that the framework will handle, set by the 64 bit Ready
+#define MAX_NUM_SERVICES 64
 
 /****************************************************************************/
-// The following sections are used to define the parameters for each of the
-// services. You only need to fill out as many as the number of services 
-// defined by NUM_SERVICES
-/****************************************************************************/
-// These are the definitions for Service 1
-#if NUM_SERVICES > 1
-// the header file with the public function prototypes
-#define SERV_1_HEADER "LEDService.h"
-// the name of the Init function
-#define SERV_1_INIT InitLEDService
-// the name of the run function
-#define SERV_1_RUN RunLEDService
-// How big should this services Queue be?
-#define SERV_1_QUEUE_SIZE 3
-#endif
+// Events posted from an interrupt response go into a lock-free mailbox for
+// the target service and are moved to its queue by ES_Run. This sets the
+// number of slots in each of those mailboxes. It must be a power of 2.
+#define ES_MAILBOX_SIZE 4
 
-/****************************************************************************/
-// These are the definitions for Service 2
-#if NUM_SERVICES > 2
-// the header file with the public function prototypes
-#define SERV_2_HEADER "HallEffectService.h"
-// the name of the Init function
-#define SERV_2_INIT InitHallEffectService
-// the name of the run function
-#define SERV_2_RUN RunHallEffectService
-// How big should this services Queue be?
-#define SERV_2_QUEUE_SIZE 3
-#endif
+// Each mailbox takes one producer, which holds as long as every ISR that
+// posts runs at the same NVIC priority. Uncomment this to have the posts
+// check that. A post from an ISR at another priority than the first one
+// that posted is dropped, so that it shows in ES_DumpQueueStats.
+//#define ES_MAILBOX_CHECK
 
 /****************************************************************************/
-// These are the definitions for Service 3
-#if NUM_SERVICES > 3
-// the header file with the public function prototypes
-#define SERV_3_HEADER "DCMotorService.h"
-// the name of the Init function
-#define SERV_3_INIT InitDCMotorService
-// the name of the run function
-#define SERV_3_RUN RunDCMotorService
-// How big should this services Queue be?
-#define SERV_3_QUEUE_SIZE 3
-#endif
+// Uncomment this to timestamp every post and keep histograms of how long
+// events wait in each service queue before the run function sees them.
+// It adds a uint32_t to every ES_Event, so it is off by default.
+//#define ES_LATENCY_STATS
 
 /****************************************************************************/
-// These are the definitions for Service 4
-#if NUM_SERVICES > 4
-// the header file with the public function prototypes
-#define SERV_4_HEADER "UltrasonicTest.h"
-// the name of the Init function
-#define SERV_4_INIT InitUltrasonicTest
-// the name of the run function
-#define SERV_4_RUN RunUltrasonicTest
-// How big should this services Queue be?
-#define SERV_4_QUEUE_SIZE 3
-#endif
+// Uncomment this to time every call to a run function with the cycle counter
+// and keep the min, mean & max per service and per event type, to find the
+// handlers that hold up the tick & the other services.
+//#define ES_RUN_PROFILE
 
 /****************************************************************************/
-// These are the definitions for Service 5
-#if NUM_SERVICES > 5
-// the header file with the public function prototypes
-#define SERV_5_HEADER "COWSupplementService.h"
-// the name of the Init function
-#define SERV_5_INIT InitCOWSupplementService
-// the name of the run function
-#define SERV_5_RUN RunCOWSupplementService
-// How big should this services Queue be?
-#define SERV_5_QUEUE_SIZE 3
+// Uncomment this to let a post to a higher priority service preempt the run
+// function of a lower priority one, in place of waiting for it to return.
+// Every event still runs to completion. On the Tiva, PendSVIntHandler &
+// NmiIntHandler from ES_Port.c must be put in the PendSV & NMI entries of
+// the vector table in the startup file. The NMI is taken over to return
+// from a preemption, so nothing else may use it. The two handlers are
+// written in CCS assembler only, so a Keil or GCC build of the Tiva stops
+// with the #error below. On the host it takes SIGRTMAX for the tick.
+//#define ES_PREEMPTIVE
+#if defined(ES_PREEMPTIVE) && !defined(ES_PORT_POSIX) && !defined(ccs)
+#error ES_PREEMPTIVE is only available with CCS on the Tiva, or ES_PORT_POSIX
 #endif
 
 /****************************************************************************/
-// These are the definitions for Service 6
-#if NUM_SERVICES > 6
-// the header file with the public function prototypes
-#define SERV_6_HEADER "FlywheelTest.h"
-// the name of the Init function
-#define SERV_6_INIT InitFlywheelTest
-// the name of the run function
-#define SERV_6_RUN RunFlywheelTest
-// How big should this services Queue be?
-#define SERV_6_QUEUE_SIZE 3
-#endif
+// ES_EventTyp_t is an enum, which is 4 bytes under the ARM EABI, so with the
+// 2 byte EventParam an ES_Event takes 8 bytes in every queue and mailbox slot.
+// Uncomment ES_COMPACT_EVENTS to hold the type in a uint16_t instead, making
+// an ES_Event 4 bytes. That halves the RAM used by the queues, or doubles
+// their depth for the same RAM.
+//#define ES_COMPACT_EVENTS
+// Uncomment ES_WIDE_EVENT_PARAM to make EventParam a uint32_t. Along with
+// ES_COMPACT_EVENTS this fits in the 8 bytes that an ES_Event takes today.
+//#define ES_WIDE_EVENT_PARAM
 
 /****************************************************************************/
-// These are the definitions for Service 7
-#if NUM_SERVICES > 7
-// the header file with the public function prototypes
-#define SERV_7_HEADER "ServoGateService.h"
-// the name of the Init function
-#define SERV_7_INIT InitServoGateService
-// the name of the run function
-#define SERV_7_RUN RunServoGateService
-// How big should this services Queue be?
-#define SERV_7_QUEUE_SIZE 3
+// The pool of payload blocks for events that need to carry more than will
+// fit in EventParam. Set ES_PAYLOAD_BLOCKS to 0 to leave the pool out, a
+// host build can set it with -DES_PAYLOAD_BLOCKS=<n>.
+// ES_PAYLOAD_SIZE is the number of bytes in each block.
+#ifndef ES_PAYLOAD_BLOCKS
+#define ES_PAYLOAD_BLOCKS 0
 #endif
-
-/*****************************************************************************/
-// These are the definitions for Service 8
-#if NUM_SERVICES > 8
-// the header file with the public function prototypes
-#define SERV_8_HEADER "MasterSM.h"
-// the name of the Init function
-#define SERV_8_INIT InitMasterSM
-// the name of the run function
-#define SERV_8_RUN RunMasterSM
-// How big should this services Queue be?
-#define SERV_8_QUEUE_SIZE 3
+#define ES_PAYLOAD_SIZE 16
+// The event types whose EventParam is a handle from ES_PayloadAlloc, one
+// ES_PAYLOAD_EVENT( Type ) per line, laid out like ES_SERVICE_LIST
+#ifndef ES_PAYLOAD_EVENTS
+#define ES_PAYLOAD_EVENTS(ES_PAYLOAD_EVENT)
 #endif
+
 /****************************************************************************/
-// These are the definitions for Service 9
-#if NUM_SERVICES > 9
-// the header file with the public function prototypes
-#define SERV_9_HEADER "MasterSM.h"
-// the name of the Init function
-#define SERV_9_INIT InitMasterSM
-// the name of the run function
-#define SERV_9_RUN RunMasterSM
-// How big should this services Queue be?
-#define SERV_9_QUEUE_SIZE 3
-#endif
+// The flight recorder keeps the last ES_TRACE_RECORDS posts, dispatches and
+// state transitions in RAM, 12 bytes each. It must be a power of 2, or 0 to
+// leave the recorder out.
+#define ES_TRACE_RECORDS 128
+// The state machines that record their transitions with ES_TraceTransition,
+// one ES_TRACE_MACHINE per line. Each gets an ES_TRACE_<name> id, and the
+// names are printed by the trace decoder.
+#define ES_TRACE_MACHINES(ES_TRACE_MACHINE) \
+  ES_TRACE_MACHINE( MasterSM ) \
+  ES_TRACE_MACHINE( DrivingSM ) \
+  ES_TRACE_MACHINE( MoveToDestination ) \
+  ES_TRACE_MACHINE( MoveToShootingSpot ) \
+  ES_TRACE_MACHINE( Shooting ) \
+  ES_TRACE_MACHINE( SPIService )
 
 /****************************************************************************/
-// These are the definitions for Service 10
-#if NUM_SERVICES > 10
-// the header file with the public function prototypes
-#define SERV_10_HEADER "TestHarnessService10.h"
-// the name of the Init function
-#define SERV_10_INIT InitTestHarnessService10
-// the name of the run function
-#define SERV_10_RUN RunTestHarnessService10
-// How big should this services Queue be?
-#define SERV_10_QUEUE_SIZE 3
-#endif
+// The interrupt responses that keep statistics, one ES_ISR_STATS_ENTRY per
+// line. Each brackets its body with ES_ISR_BEGIN/ES_ISR_END( <name> ) and
+// has its count, longest run and worst arrival jitter kept (ES_ISRStats.h).
+// Comment out ES_ISR_STATS to leave the statistics out.
+#define ES_ISR_STATS
+#define ES_ISR_STATS_LIST(ES_ISR_STATS_ENTRY) \
+  ES_ISR_STATS_ENTRY( FlywheelInputCaptureISR ) \
+  ES_ISR_STATS_ENTRY( PIControlISR ) \
+  ES_ISR_STATS_ENTRY( HallEffectCaptureISR ) \
+  ES_ISR_STATS_ENTRY( UltrasonicCaptureResponse ) \
+  ES_ISR_STATS_ENTRY( OneShotTriggerISR )
 
 /****************************************************************************/
-// These are the definitions for Service 11
-#if NUM_SERVICES > 11
-// the header file with the public function prototypes
-#define SERV_11_HEADER "TestHarnessService11.h"
-// the name of the Init function
-#define SERV_11_INIT InitTestHarnessService11
-// the name of the run function
-#define SERV_11_RUN RunTestHarnessService11
-// How big should this services Queue be?
-#define SERV_11_QUEUE_SIZE 3
+// The record/replay log keeps the first ES_REPLAY_RECORDS posts and timer
+// starts made by the interrupt responses, and the registers they read with
+// ES_ReplayCapture, 12 bytes each. Set it to 0 to leave the log out. The
+// encoder edges are captured too, so a whole match needs several thousand.
+// Tools/ES_ReplayRun.c builds with -DES_REPLAY_RECORDS=<n>.
+#ifndef ES_REPLAY_RECORDS
+#define ES_REPLAY_RECORDS 0
 #endif
 
 /****************************************************************************/
-// These are the definitions for Service 12
-#if NUM_SERVICES > 12
-// the header file with the public function prototypes
-#define SERV_12_HEADER "TestHarnessService12.h"
-// the name of the Init function
-#define SERV_12_INIT InitTestHarnessService12
-// the name of the run function
-#define SERV_12_RUN RunTestHarnessService12
-// How big should this services Queue be?
-#define SERV_12_QUEUE_SIZE 3
+// The number of robots in one program, each with its own copy of the
+// framework and service state (see ES_Instance.h). It is 1 on the Tiva,
+// where the state is reached at fixed addresses as it always was. A host
+// batch simulation builds with -DES_NUM_INSTANCES=<n> and the POSIX port.
+#ifndef ES_NUM_INSTANCES
+#define ES_NUM_INSTANCES 1
 #endif
 
 /****************************************************************************/
-// These are the definitions for Service 13
-#if NUM_SERVICES > 13
-// the header file with the public function prototypes
-#define SERV_13_HEADER "TestHarnessService13.h"
-// the name of the Init function
-#define SERV_13_INIT InitTestHarnessService13
-// the name of the run function
-#define SERV_13_RUN RunTestHarnessService13
-// How big should this services Queue be?
-#define SERV_13_QUEUE_SIZE 3
+// The number of worker threads that run the services on the host (see
+// ES_Run). It is 0 on the Tiva, and for the usual single threaded host
+// build. A host build for many cores sets it with -DES_THREADS=<n> and the
+// POSIX port. Each service then takes its posts through a lock-free queue
+// of ES_THREAD_QUEUE_SIZE events, which must be a power of 2.
+#ifndef ES_THREADS
+#define ES_THREADS 0
 #endif
+#define ES_THREAD_QUEUE_SIZE 16
 
 /****************************************************************************/
-// These are the definitions for Service 14
-#if NUM_SERVICES > 14
-// the header file with the public function prototypes
-#define SERV_14_HEADER "TestHarnessService14.h"
-// the name of the Init function
-#define SERV_14_INIT InitTestHarnessService14
-// the name of the run function
-#define SERV_14_RUN RunTestHarnessService14
-// How big should this services Queue be?
-#define SERV_14_QUEUE_SIZE 3
-#endif
+// Uncomment ES_CYCLIC to make ES_Run a cyclic executive with a fixed
+// schedule. A minor frame starts on every ES_CYCLIC_MINOR_TICKS'th tick and
+// runs the slots that are due in it, in the order of ES_CYCLIC_SCHEDULE,
+// then the service queues and the event checkers until ES_CYCLIC_BUDGET_US
+// into the frame. ES_CYCLIC_MINOR_FRAMES minor frames make a major frame.
+// Each ES_CYCLIC_SLOT gives a void function, its period in minor frames,
+// which must divide ES_CYCLIC_MINOR_FRAMES, and the frame within the period
+// that it runs in. The control loops run from their slots in place of their
+// timer interrupts. Not with ES_PREEMPTIVE, ES_THREADS or more than 1 robot.
+//#define ES_CYCLIC
+#define ES_CYCLIC_MINOR_TICKS 2 // 2mS at ES_Timer_RATE_1mS
+#define ES_CYCLIC_MINOR_FRAMES 75
+#define ES_CYCLIC_BUDGET_US 1500
+#define ES_CYCLIC_SCHEDULE(ES_CYCLIC_SLOT) \
+  ES_CYCLIC_SLOT( DCMotorControlSlot, 1, 0 ) \
+  ES_CYCLIC_SLOT( FlywheelControlSlot, 1, 0 ) \
+  ES_CYCLIC_SLOT( UltrasonicTriggerSlot, 75, 1 )
 
 /****************************************************************************/
-// These are the definitions for Service 15
-#if NUM_SERVICES > 15
-// the header file with the public function prototypes
-#define SERV_15_HEADER "TestHarnessService15.h"
-// the name of the Init function
-#define SERV_15_INIT InitTestHarnessService15
-// the name of the run function
-#define SERV_15_RUN RunTestHarnessService15
-// How big should this services Queue be?
-#define SERV_15_QUEUE_SIZE 3
+// Uncomment ES_STARVATION_GUARD to keep the services in
+// ES_STARVATION_GUARD_LIST from being starved by busier higher priority
+// ones. Each entry gives a service and the most dispatches of other
+// services that ES_Run may make while it has an event waiting. After that
+// many it runs next, ahead of its priority. A limit of 0 only counts the
+// waits. The services not listed run in plain priority order. The list
+// below is an example. Not with ES_PREEMPTIVE or ES_THREADS, which do not
+// dispatch one service at a time in priority order.
+//#define ES_STARVATION_GUARD
+#ifndef ES_STARVATION_GUARD_LIST
+#define ES_STARVATION_GUARD_LIST(ES_STARVATION_GUARD_ENTRY) \
+  ES_STARVATION_GUARD_ENTRY( SPIService, 16 )
 #endif
 
-
 /****************************************************************************/
 // Name/define the events of interest
 // Universal events occupy the lowest entries, followed by user-defined events
@@ -295,7 +286,9 @@ typedef enum {  ES_NO_EVENT = 0,
 								ES_GAME_OVER,
 								ES_ULTRASONIC_CAPTURE,
 								ES_DISTANCE_DETECTED,
-								ES_START_ULTRASONIC
+								ES_START_ULTRASONIC,
+                /* must stay last, it counts the events above */
+                ES_NUM_EVENT_TYPES
 								} ES_EventTyp_t ;
 
 /****************************************************************************/
@@ -333,8 +326,15 @@ typedef enum {  ES_NO_EVENT = 0,
 #define EVENT_CHECK_HEADER "EventCheckers.h"
 
 /****************************************************************************/
-// This is the list of event checking functions 
-#define EVENT_CHECK_LIST Check4Keystroke 
+// The list of event checking functions, one ES_EVENT_CHECKER per line. Each
+// entry gives the name of the checker, how often to call it in ticks, and
+// its priority. When the service queues are empty, the checkers that are
+// due are called highest priority first (in list order for the same
+// priority) until one of them finds an event. A period of 0 calls the
+// checker every time the queues are empty. The CPU time each checker takes
+// is kept, see ES_DumpCheckerStats.
+#define ES_EVENT_CHECK_LIST(ES_EVENT_CHECKER) \
+  ES_EVENT_CHECKER( Check4Keystroke, 10, 0 )
 
 /****************************************************************************/
 // These are the definitions for the post functions to be executed when the
@@ -360,6 +360,11 @@ typedef enum {  ES_NO_EVENT = 0,
 #define TIMER14_RESP_FUNC PostMasterSM
 #define TIMER15_RESP_FUNC PostUltrasonicTest
 
+/****************************************************************************/
+// The total number of timers, 16 to 255. The ones above 15 are not bound to
+// a post function here, services get them at run time from ES_Timer_Alloc
+#define ES_MAX_TIMERS 32
+
 /****************************************************************************/
 // Give the timer numbers symbolc names to make it easier to move them
 // to different timers if the need arises. Keep these definitions close to the
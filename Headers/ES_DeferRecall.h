@@ -18,7 +18,7 @@
  Notes
    you should pass it a block that is at least sizeof(ES_Queue_t) larger than 
    the number of entries that you want in the queue. Since the size of an 
-   ES_Event (at 4 bytes; 2 enum, 2 param) is greater than the 
+   ES_Event (8 bytes, or 4 with ES_COMPACT_EVENTS) is at least the
    sizeof(ES_Queue_t), you only need to declare an array of ES_Event
    with 1 more element than you need for the actual queue.
 ****************************************************************************/
@@ -26,17 +26,18 @@
 
 /****************************************************************************
  Function
-   ES_DeferEvent  (wrapper for ES_EnQueueLIFO)
-   this is a straight re-naming to aid readability
+   ES_DeferEvent
  Parameters
    ES_Event * pBlock : pointer to the block of memory in use as the Queue
    ES_Event Event2Add : event to be added to the Queue
  Returns
    bool : true if the add was successful, false if not
  Description
-   if it will fit, adds Event2Add to the Queue
+   if it will fit, adds Event2Add to the end of the Queue
+ Notes
+   the deferral queue keeps a reference to any payload until it is recalled
  ***************************************************************************/
-#define ES_DeferEvent( a,b ) ES_EnQueueLIFO( a, b )
+bool ES_DeferEvent( ES_Event * pBlock, ES_Event Event2Add );
 
 /****************************************************************************
  Function
@@ -48,11 +49,10 @@
  Returns
      bool true if an event was recalled, false if no event was left in queue
  Description
-     pulls an event off the deferral queue if one is available. It there was
-     something in the queue, then it posts it LIFO fashion to the queue 
-     indicated by WhichService
+     moves all the events on the deferral queue to the front of the queue
+     indicated by WhichService, in the order they were deferred
  Notes
-     None.
+     see ES_DeferRecall.c
  Author
      J. Edward Carryer, 11/20/13 16:49
 ****************************************************************************/
@@ -8,6 +8,8 @@
  History
  When           Who     What/Why
  -------------- ---     --------
+ 10/17/26 19:30 jh      EventType & EventParam widths set in ES_Configure.h
+ 10/17/26 14:50 jh      added PostTime when ES_LATENCY_STATS is defined
  08/05/13 15:19 jec      modifications to suit new portable type definitions
  01/15/12 11:46 jec      moved event enum to config file, changed prefixes to ES
  10/23/11 22:01 jec      customized for Remote Lock problem
@@ -19,11 +21,36 @@
 #define ES_Events_H
 
 #include "ES_Types.h"
+#include "ES_General.h"
+
+// the field that holds the ES_EventTyp_t, an enum takes 4 bytes on the ARM
+#ifdef ES_COMPACT_EVENTS
+typedef uint16_t ES_EventTypField_t;
+#else
+typedef ES_EventTyp_t ES_EventTypField_t;
+#endif
+
+#ifdef ES_WIDE_EVENT_PARAM
+typedef uint32_t ES_EventParam_t;
+#else
+typedef uint16_t ES_EventParam_t;
+#endif
 
 typedef struct ES_Event_t {
-    ES_EventTyp_t EventType;    // what kind of event?
-    uint16_t   EventParam;      // parameter value for use w/ this event
+    ES_EventTypField_t EventType;  // what kind of event?
+    ES_EventParam_t EventParam;    // parameter value for use w/ this event
+#ifdef ES_LATENCY_STATS
+    uint32_t   PostTime;        // set by the framework when posted, in uS
+#endif
 }ES_Event;
 
+#ifdef ES_COMPACT_EVENTS
+// every event type must fit in the narrow field
+ES_STATIC_ASSERT( ES_NUM_EVENT_TYPES <= UINT16_MAX + 1, EventTypesFitField );
+#if !defined(ES_WIDE_EVENT_PARAM) && !defined(ES_LATENCY_STATS)
+ES_STATIC_ASSERT( sizeof(ES_Event) == 4, CompactEventIs4Bytes );
+#endif
+#endif
+
 
 #endif /* ES_Events_H */
@@ -8,6 +8,21 @@
  History
  When           Who     What/Why
  -------------- ---     --------
+ 10/19/26 19:36 jh       added the starvation statistics (ES_STARVATION_GUARD)
+ 10/19/26 14:05 jh       added ES_RunCyclic & the frame statistics (ES_CYCLIC)
+ 10/18/26 17:11 jh       added ES_Preempt & ES_RequestPreempt (ES_PREEMPTIVE)
+ 10/18/26 14:29 jh       include ES_ISRStats.h for the ISR statistics
+ 10/18/26 11:48 jh       added the run function profile (ES_RUN_PROFILE)
+ 10/18/26 09:43 jh       include ES_Instance.h, added ES_RunUntilIdle and
+                         ES_RunInstances for the multi-robot host build
+ 10/17/26 23:00 jh       include ES_Replay.h for the ISR record/replay
+ 10/17/26 22:00 jh       include ES_Trace.h for the flight recorder
+ 10/17/26 21:40 jh       added ES_SpliceToService prototype
+ 10/17/26 21:00 jh       added ES_ServiceSet_t, shared by Ready & ES_Subscribe
+ 10/17/26 20:10 jh       include ES_Payload.h for the payload pool
+ 10/17/26 18:20 jh       added the idle statistics
+ 10/17/26 14:55 jh       added the post-to-dispatch latency histograms
+ 10/17/26 13:50 jh       added the per service queue statistics
  11/02/13 17:06 jec      added ES_PostToServiceLIFO prototype
  08/05/13 15:00 jec      added #include for ES_Port.h to get portability stuff
  10/17/06 07:41 jec      started coding
@@ -18,11 +33,17 @@
 
 #include "ES_Port.h"
 #include "ES_Types.h"
+#include "ES_Instance.h"
 #include "ES_General.h"
 #include "ES_CheckEvents.h"
 #include "ES_PostList.h"
 #include "ES_Events.h"
 #include "ES_Timers.h"
+#include "ES_Payload.h"
+#include "ES_Trace.h"
+#include "ES_Replay.h"
+#include "ES_ISRStats.h"
+#include "ES_LookupTables.h"
 
 typedef enum {
               Success = 0,
@@ -33,10 +54,131 @@ typedef enum {
               FailedInit
 } ES_Return_t;
 
+// a set of services, with a bit for each priority. Used for the Ready word
+// and for the subscriber lists of ES_Subscribe
+#if NUM_SERVICES <= 32
+typedef uint32_t ES_ServiceSet_t;
+#define ES_GetHighestService(Set) ES_GetMSBitSet32(Set)
+#elif NUM_SERVICES <= MAX_NUM_SERVICES
+typedef uint64_t ES_ServiceSet_t;
+#define ES_GetHighestService(Set) ES_GetMSBitSet64(Set)
+#else
+#error ES_SERVICE_LIST has more than MAX_NUM_SERVICES services
+#endif
+#define ES_ServiceBit(Priority) ((ES_ServiceSet_t)1 << (Priority))
+
+// statistics kept for each service queue, read with ES_GetQueueStats
+typedef struct {
+              uint8_t QueueSize;     // max number of entries in the queue
+              uint8_t PeakEntries;   // high-water mark of the queue
+              uint32_t NumPosts;     // every post to the service, incl. drops
+              uint32_t NumDropped;   // posts lost to a full queue or mailbox
+              ES_Event LastDropped;  // the most recent event lost to a full queue
+} ES_QueueStats_t;
+
+#ifdef ES_LATENCY_STATS
+// Bin 0 counts waits of 0uS, bin n (1-16) waits of 2^(n-1) to 2^n - 1 uS and
+// the last bin everything from 65.536mS up
+#define ES_LATENCY_BINS 18
+
+typedef struct {
+              uint32_t Bins[ES_LATENCY_BINS]; // log2 histogram of the waits
+              uint32_t MaxWait;   // longest wait seen, in uS
+              uint32_t MaxType;   // the EventType that waited longest
+} ES_LatencyStats_t;
+#endif
+
+#ifdef ES_RUN_PROFILE
+// time spent in the run functions by one service or for one event type, in
+// _HW_GetCycles units (ES_CYCLES_PER_US to the uS)
+typedef struct {
+              uint32_t NumRuns;      // number of run function calls timed
+              uint32_t MinCycles;    // shortest call
+              uint32_t MaxCycles;    // longest call
+              uint64_t TotalCycles;  // all the calls, for the mean
+              uint16_t MaxWith;      // for a service, the event type of the
+                                     // longest call, for an event type, the
+                                     // service that took longest with it
+} ES_RunProfile_t;
+#endif
+
+#ifdef ES_STARVATION_GUARD
+// how long a service in ES_STARVATION_GUARD_LIST has waited, in dispatches
+// of other services made while it had an event
+typedef struct {
+              uint16_t MaxWaits;     // the limit, 0 if it is only counted
+              uint32_t LongestWait;  // the most it has waited
+              uint32_t NumStarved;   // times it reached the limit and was
+                                     // run ahead of its priority
+} ES_StarvationStats_t;
+#endif
+
+#ifdef ES_CYCLIC
+// the slots of ES_CYCLIC_SCHEDULE, ES_SLOT_<function> in table order
+#define ES_CYCLIC_SLOT_ID(Func, Period, Phase) ES_SLOT_##Func,
+typedef enum {
+              ES_CYCLIC_SCHEDULE(ES_CYCLIC_SLOT_ID)
+              ES_NUM_CYCLIC_SLOTS
+} ES_CyclicSlot_t;
+
+// timing of the cyclic executive, in _HW_GetCycles units (ES_CYCLES_PER_US
+// to the uS). The intervals only count frames that started on time, the
+// rest are overruns.
+typedef struct {
+              uint32_t NumFrames;     // minor frames run
+              uint32_t NumOverruns;   // frames still running when the next
+                                      // one was due
+              uint32_t NumSkipped;    // frames left out after an overrun
+              uint32_t NumOverBudget; // frames that left events queued at
+                                      // ES_CYCLIC_BUDGET_US
+              uint32_t MinInterval;   // shortest & longest time between the
+              uint32_t MaxInterval;   // starts of two frames in a row
+              uint32_t MaxSlotCycles[ES_NUM_CYCLIC_SLOTS]; // longest run of
+                                                           // each slot
+} ES_CyclicStats_t;
+#endif
+
 ES_Return_t ES_Initialize( TimerRate_t NewRate  );
 ES_Return_t ES_Run( void );
+ES_Return_t ES_RunUntilIdle( void );
+#if ES_NUM_INSTANCES > 1
+ES_Return_t ES_RunInstances( uint16_t Ticks );
+#endif
+#ifdef ES_CYCLIC
+ES_Return_t ES_RunCyclic( void );
+void ES_GetCyclicStats( ES_CyclicStats_t * pStats );
+void ES_ResetCyclicStats( void );
+void ES_DumpCyclicStats( void );
+#endif
+#ifdef ES_PREEMPTIVE
+void ES_Preempt( void );
+void ES_RequestPreempt( void );
+#endif
 bool ES_PostAll( ES_Event ThisEvent );
 bool ES_PostToService( uint8_t WhichService, ES_Event ThisEvent);
 bool ES_PostToServiceLIFO( uint8_t WhichService, ES_Event TheEvent);
+uint8_t ES_SpliceToService( uint8_t WhichService, ES_Event * pBlock );
+bool ES_GetQueueStats( uint8_t WhichService, ES_QueueStats_t * pStats );
+void ES_ResetQueueStats( void );
+void ES_DumpQueueStats( void );
+uint8_t ES_GetIdlePercent( void );
+void ES_ResetIdleStats( void );
+#ifdef ES_LATENCY_STATS
+bool ES_GetLatencyStats( uint8_t WhichService, ES_LatencyStats_t * pStats );
+void ES_ResetLatencyStats( void );
+void ES_DumpLatencyStats( void );
+#endif
+#ifdef ES_STARVATION_GUARD
+bool ES_GetStarvationStats( uint8_t WhichService,
+                            ES_StarvationStats_t * pStats );
+void ES_ResetStarvationStats( void );
+void ES_DumpStarvationStats( void );
+#endif
+#ifdef ES_RUN_PROFILE
+bool ES_GetServiceProfile( uint8_t WhichService, ES_RunProfile_t * pProfile );
+bool ES_GetEventProfile( uint16_t EventType, ES_RunProfile_t * pProfile );
+void ES_ResetRunProfile( void );
+void ES_DumpRunProfile( void );
+#endif
 
 #endif   // ES_Framework_H
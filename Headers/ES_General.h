@@ -6,4 +6,9 @@
 #define BITS_PER_BYTE 8
 #define BITS_PER_NYBBLE 4
 
+// compile time check, a false Cond gives a negative array size error naming
+// the assert. Works at file scope on C99 compilers without _Static_assert
+#define ES_STATIC_ASSERT(Cond, Name) \
+  typedef char ES_Assert_##Name[(Cond) ? 1 : -1]
+
 #endif//ES_General_H
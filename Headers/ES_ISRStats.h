@@ -0,0 +1,78 @@
+/****************************************************************************
+ Module
+     ES_ISRStats.h
+ Description
+     header file for the interrupt response statistics, a count, the longest
+     run and the worst jitter between arrivals for each instrumented ISR
+ Notes
+     The ISRs are listed in ES_ISR_STATS_LIST in ES_Configure.h and each one
+     brackets its body with the macros:
+       void MyCaptureISR(void)
+       {
+         ES_ISR_BEGIN( MyCaptureISR );
+         ...
+         ES_ISR_END( MyCaptureISR );
+       }
+     Comment out ES_ISR_STATS to leave the statistics out, the macros then
+     cost nothing.
+
+ History
+ When           Who     What/Why
+ -------------- ---     --------
+ 10/21/26 15:30 jh      the jitter is in _HW_GetClock units
+ 10/18/26 14:29 jh      started coding
+*****************************************************************************/
+#ifndef ES_ISRStats_H
+#define ES_ISRStats_H
+
+#include "ES_Configure.h"
+#include "ES_Types.h"
+#include "ES_Port.h"
+
+// the instrumented ISRs, from ES_Configure.h
+#define ES_ISR_STATS_ID(Name) ES_ISR_##Name,
+typedef enum {
+  ES_ISR_STATS_LIST(ES_ISR_STATS_ID)
+  ES_NUM_ISR_STATS
+} ES_ISRId_t;
+
+// the run time is in _HW_GetCycles units (ES_CYCLES_PER_US to the uS), the
+// times between runs in _HW_GetClock units (ES_CLOCK_TICKS_PER_US to the uS)
+typedef struct {
+  uint32_t Count;        // number of times the ISR has run
+  uint32_t MaxCycles;    // longest run, from ES_ISR_BEGIN to ES_ISR_END
+  uint32_t MaxJitter;    // biggest change from one interval between runs
+                         // to the next
+  uint32_t LastArrival;  // when it last ran
+  uint32_t LastInterval; // the time between its last two runs
+} ES_ISRStats_t;
+
+#ifdef ES_ISR_STATS
+
+/* the instrumentation, for the ISRs */
+
+#define ES_ISR_BEGIN(Name) \
+  uint32_t ES_ISRStart_##Name = ES_ISRStatsBegin( ES_ISR_##Name )
+#define ES_ISR_END(Name) \
+  ES_ISRStatsEnd( ES_ISR_##Name, ES_ISRStart_##Name )
+
+uint32_t ES_ISRStatsBegin( ES_ISRId_t WhichISR );
+void ES_ISRStatsEnd( ES_ISRId_t WhichISR, uint32_t Start );
+
+/* prototypes for public functions */
+
+bool ES_GetISRStats( ES_ISRId_t WhichISR, ES_ISRStats_t * pStats );
+void ES_ResetISRStats( void );
+void ES_DumpISRStats( void );
+
+#else // no statistics, so the instrumentation costs nothing
+
+#define ES_ISR_BEGIN(Name)
+#define ES_ISR_END(Name)
+#define ES_GetISRStats(WhichISR, pStats)  false
+#define ES_ResetISRStats()
+#define ES_DumpISRStats()
+
+#endif
+
+#endif /* ES_ISRStats_H */
@@ -0,0 +1,66 @@
+/****************************************************************************
+ Module
+     ES_Instance.h
+ Description
+     header file for the per robot state of the framework and the services,
+     so that a host simulation can run many robots in one program
+ Notes
+     A module keeps the variables that belong to one robot in a struct,
+     ES_NUM_INSTANCES copies of it, and reaches the copy for the robot that
+     is running through the context pointer Me:
+       static MyServiceData_t Instances[ES_NUM_INSTANCES];
+       #define Me ES_THIS(Instances)
+       ...
+       Me->CurrentState = InitPState;
+     With ES_NUM_INSTANCES at 1, ES_INSTANCE is the constant 0 and Me is a
+     fixed address, so the code is the same as it was with plain statics.
+     With more, ES_SelectInstance picks the robot. ES_Initialize, ES_Run,
+     ES_RunUntilIdle and any interrupt, post or timer then act on that one,
+     and ES_RunInstances runs them all in turn on the shared clock. The
+     flight recorder and the replay log are not kept per robot.
+     With ES_THREADS the robots run on the worker threads side by side, so
+     each thread keeps its own ES_ThisInstance.
+     ES_INSTANCE_INIT gives every copy the same initial values. For more
+     than 1 copy it needs GCC, which the host build uses.
+
+ History
+ When           Who     What/Why
+ -------------- ---     --------
+ 10/19/26 10:27 jh      ES_ThisInstance is kept per thread for ES_THREADS
+ 10/18/26 09:43 jh      started coding
+*****************************************************************************/
+#ifndef ES_Instance_H
+#define ES_Instance_H
+
+#include "ES_Configure.h"
+#include "ES_Types.h"
+#include "ES_Port.h"
+
+#if ES_NUM_INSTANCES > 1
+
+#if !defined(ES_PORT_POSIX)
+#error ES_NUM_INSTANCES > 1 is only for a host simulation on the POSIX port
+#endif
+
+// the robot whose state Me points at, set by ES_SelectInstance
+extern ES_THREAD_LOCAL uint16_t ES_ThisInstance;
+#define ES_INSTANCE ES_ThisInstance
+
+#define ES_INSTANCE_INIT(...) { [0 ... ES_NUM_INSTANCES - 1] = __VA_ARGS__ }
+
+bool ES_SelectInstance( uint16_t Instance );
+
+#else // a single robot
+
+#define ES_INSTANCE 0
+
+#define ES_INSTANCE_INIT(...) { __VA_ARGS__ }
+
+#define ES_SelectInstance(Instance) ((Instance) == 0)
+
+#endif
+
+// the copy of a module's state for the robot that is running
+#define ES_THIS(Instances) (&(Instances)[ES_INSTANCE])
+
+#endif /* ES_Instance_H */
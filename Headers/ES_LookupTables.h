@@ -17,6 +17,8 @@
  History
  When           Who     What/Why
  -------------- ---     --------
+ 10/17/26 18:55 jh      added ES_GetMSBitSet32 & ES_GetMSBitSet64 for the
+                         wider Ready word
  10/20/13 21:19 jec      got rid of BitNum2ClrMask and replaced with #define
                          replaced Byte2MSBNum with function ES_GetMSBSet
                          replaced Byte2MSBNum array with Nybble2MSBNum
@@ -61,3 +63,20 @@ extern uint8_t const Nybble2MSBitNum[15];
    J. Edward Carryer, 10/20/13, 17:03
 ****************************************************************************/
 uint8_t ES_GetMSBitSet( uint16_t Val2Check);
+
+/****************************************************************************
+ Function
+   ES_GetMSBitSet32, ES_GetMSBitSet64
+ Parameters
+   uint32_t/uint64_t  Val2Check The number to find the MSB in
+ Returns
+   bit number of the MSB that is set in Val2Check, 128 if Val2Check = 0
+ Description
+   as ES_GetMSBitSet, for the 32 & 64 bit Ready words
+ Notes
+   
+ Author
+   J. He, 10/17/26, 18:55
+****************************************************************************/
+uint8_t ES_GetMSBitSet32( uint32_t Val2Check);
+uint8_t ES_GetMSBitSet64( uint64_t Val2Check);
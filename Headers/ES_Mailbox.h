@@ -0,0 +1,65 @@
+/****************************************************************************
+ Module
+     ES_Mailbox.h
+ Description
+     header file for the lock-free single-producer/single-consumer mailboxes
+     used to carry events from interrupt responses to the framework, and of
+     the multi-producer queues that the worker threads take events from
+ Notes
+
+ History
+ When           Who     What/Why
+ -------------- ---     --------
+ 10/19/26 10:27 jh      added ES_MPMailbox_t for ES_THREADS
+ 10/17/26 12:20 jh      started coding
+*****************************************************************************/
+#ifndef ES_Mailbox_H
+#define ES_Mailbox_H
+
+#include "ES_Configure.h"
+#include "ES_Types.h"
+#include "ES_Events.h"
+
+/*
+  Head is written only by the producer and Tail only by the consumer. Both are
+  free running and only masked when indexing pSlots, so the number of entries
+  is always (uint8_t)(Head - Tail) and no slot is wasted to tell full from
+  empty. This requires the number of slots to be a power of two, <= 128.
+*/
+typedef struct {
+    volatile uint8_t Head;   // next slot to write, owned by the producer
+    volatile uint8_t Tail;   // next slot to read, owned by the consumer
+    uint8_t Mask;            // number of slots - 1
+    ES_Event *pSlots;        // the storage for the events
+}ES_Mailbox_t;
+
+/* prototypes for public functions */
+
+bool ES_InitMailbox( ES_Mailbox_t * pBox, ES_Event * pSlots, uint8_t NumSlots );
+bool ES_MailboxPut( ES_Mailbox_t * pBox, ES_Event Event2Add );
+bool ES_MailboxGet( ES_Mailbox_t * pBox, ES_Event * pReturnEvent );
+bool ES_IsMailboxEmpty( ES_Mailbox_t * pBox );
+
+#if ES_THREADS > 0
+/*
+  The multi-producer version, for posts from any number of threads to the
+  one worker thread that runs a service. The producers claim a position by
+  moving Head on with a compare & swap, and each slot has a sequence number
+  that tells whether it is free for the producer of a position or holds the
+  event for the consumer. Head & Tail are free running 32 bit positions.
+*/
+typedef struct {
+    volatile uint32_t Head;   // next position to claim, shared by producers
+    volatile uint32_t Tail;   // next position to read, owned by the consumer
+    uint32_t Mask;            // number of slots - 1
+    volatile uint32_t *pSeqs; // the sequence number of each slot
+    ES_Event *pSlots;         // the storage for the events
+}ES_MPMailbox_t;
+
+bool ES_InitMPMailbox( ES_MPMailbox_t * pBox, ES_Event * pSlots,
+                       uint32_t * pSeqs, uint32_t NumSlots );
+bool ES_MPMailboxPut( ES_MPMailbox_t * pBox, ES_Event Event2Add );
+bool ES_MPMailboxGet( ES_MPMailbox_t * pBox, ES_Event * pReturnEvent );
+#endif
+
+#endif /* ES_Mailbox_H */
@@ -0,0 +1,57 @@
+/****************************************************************************
+ Module
+     ES_Payload.h
+ Description
+     header file for the pool of reference counted payload blocks that let an
+     event carry more data than will fit in its EventParam
+ Notes
+     The event types that carry a payload are listed in ES_PAYLOAD_EVENTS in
+     ES_Configure.h. For those types EventParam holds the handle returned by
+     ES_PayloadAlloc rather than a value. The framework counts a reference
+     for every queue that the event is posted to and drops it when the
+     service's run function returns, so the block goes back to the pool after
+     the last consumer has seen it.
+
+ History
+ When           Who     What/Why
+ -------------- ---     --------
+ 10/20/26 11:30 jh      the no-pool stubs are ((void)0), so they can be
+                        the whole body of an if or else
+ 10/17/26 20:10 jh      started coding
+*****************************************************************************/
+#ifndef ES_Payload_H
+#define ES_Payload_H
+
+#include "ES_Types.h"
+#include "ES_Events.h"
+
+// the handle value that never refers to a block
+#define ES_PAYLOAD_NONE 0
+
+#if ES_PAYLOAD_BLOCKS > 0
+
+/* prototypes for public functions */
+
+uint16_t ES_PayloadAlloc( void );
+void * ES_PayloadData( uint16_t Handle );
+uint8_t ES_GetPayloadsInUse( void );
+
+/* used by the framework to manage the reference counts */
+
+void ES_InitPayloads( void );
+bool ES_IsPayloadEvent( ES_Event ThisEvent );
+void ES_PayloadAddRef( ES_Event ThisEvent );
+void ES_PayloadRelease( ES_Event ThisEvent );
+void ES_CollectPayloads( void );
+
+#else // no pool, so there are never any references to keep
+
+#define ES_InitPayloads()  ((void)0)
+#define ES_IsPayloadEvent(e)  false
+#define ES_PayloadAddRef(e)  ((void)0)
+#define ES_PayloadRelease(e)  ((void)0)
+#define ES_CollectPayloads()  ((void)0)
+
+#endif
+
+#endif /* ES_Payload_H */
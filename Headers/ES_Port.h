@@ -9,6 +9,20 @@
  History
  When           Who     What/Why
  -------------- ---     --------
+ 10/20/26 09:52 jh      added _HW_GetISRPriority for ES_MAILBOX_CHECK
+ 10/19/26 10:27 jh      added the worker threads & ES_THREAD_LOCAL for
+                        ES_THREADS
+ 10/18/26 17:11 jh      added _HW_RequestPreempt for ES_PREEMPTIVE
+ 10/18/26 11:48 jh      added _HW_GetCycles for the run function profile
+ 10/17/26 23:50 jh      added _HW_ScheduleInterrupt for the virtual clock
+ 10/17/26 23:00 jh      added _HW_GetISRNumber for the ISR record/replay
+ 10/17/26 18:10 jh      added _HW_Idle
+ 10/17/26 17:10 jh      added the 64 bit clock, _HW_GetClock & _HW_GetMicros
+ 10/17/26 14:40 jh      added _HW_GetTimestamp
+ 10/17/26 12:10 jh      added _HW_IsInISR & ES_MemoryBarrier for the lock-free
+                        ISR mailboxes in ES_Mailbox.c
+ 10/17/26 09:40 jh      added the POSIX host port (ES_PORT_POSIX), selected
+                        with -DES_PORT_POSIX and implemented in ES_Port_POSIX.c
  01/18/15 13:24 jec     clean up and adapt to use TI driver lib functions
                         for implementing EnterCritical & ExitCritical
  03/13/14		joa		      Updated files to use with Cortex M4 processor core.
@@ -24,10 +38,18 @@
 
 #include <stdio.h>
 #include <stdint.h>
+#if defined(ES_PORT_POSIX)
+#include <signal.h>
+#else
 #include "termio.h"
-#include "bitdefs.h"       /* generic bit defs (BIT0HI, BIT0LO,...) */
+#endif
+#include "BITDEFS.H"       /* generic bit defs (BIT0HI, BIT0LO,...) */
 #include "Bin_Const.h"     /* macros to specify binary constants in C */
 #include "ES_Types.h"
+#if defined(ES_PORT_POSIX)
+#include <pthread.h>
+#include "ES_Configure.h"  /* for ES_THREADS */
+#endif
 
 // macro to control the use of C99 data types (or simulations in case you don't
 // have a C99 compiler).
@@ -52,10 +74,56 @@
 // allocation of temp var for saving interrupt enable status should be defined
 // in ES_Port.c
 
+#if defined(ES_PORT_POSIX)
+// POSIX host port
+// Simulated interrupts are delivered as signals (see _HW_AttachInterrupt), so
+// a critical region blocks the whole set of interrupt signals for the calling
+// thread and then restores the mask that was in place on entry.
+// With ES_THREADS the services run on worker threads as well, so a critical
+// region also holds _HW_CriticalLock, which keeps the other threads out.
+// The saved mask and the ISR state then belong to each thread.
+#if ES_THREADS > 0
+#define ES_THREAD_LOCAL __thread
+#else
+#define ES_THREAD_LOCAL
+#endif
+
+extern ES_THREAD_LOCAL sigset_t _SIGMASK_temp;
+extern sigset_t _HW_IntSigSet;
+
+#if ES_THREADS > 0
+extern pthread_mutex_t _HW_CriticalLock;
+
+#define EnterCritical() { pthread_sigmask(SIG_BLOCK, &_HW_IntSigSet, &_SIGMASK_temp); \
+                          pthread_mutex_lock(&_HW_CriticalLock); }
+#define ExitCritical() { pthread_mutex_unlock(&_HW_CriticalLock); \
+                         pthread_sigmask(SIG_SETMASK, &_SIGMASK_temp, NULL); }
+#else
+#define EnterCritical() { pthread_sigmask(SIG_BLOCK, &_HW_IntSigSet, &_SIGMASK_temp); }
+#define ExitCritical() { pthread_sigmask(SIG_SETMASK, &_SIGMASK_temp, NULL); }
+#endif
+
+// nesting count of simulated ISRs, maintained by the signal trampoline
+extern ES_THREAD_LOCAL volatile sig_atomic_t _HW_ISRNesting;
+#define _HW_IsInISR() ( _HW_ISRNesting != 0 )
+// the signal being handled by the simulated ISR, 0 outside of one
+extern ES_THREAD_LOCAL volatile sig_atomic_t _HW_ISRSignal;
+#define _HW_GetISRNumber() ( (uint8_t)_HW_ISRSignal )
+// every simulated ISR blocks all the others, as if at the same priority
+#define _HW_GetISRPriority() ( 0 )
+
+// full fence, orders the slot & index accesses of the lock-free mailboxes
+// between a producer thread/ISR and the framework thread
+#define ES_MemoryBarrier() __sync_synchronize()
+
+#else
 // Cortex M-series processors 
 // The Interrupt Program Status Register (IPSR) contains the exception type number
 // of the current interrupt service routine (ISR)
 // Using TivaWare, CPUcpsid() - IntMasterDisable() calls this. Equivalent to __diable_irq()?
+// there is one thread, so nothing is kept per thread
+#define ES_THREAD_LOCAL
+
 extern uint32_t _PRIMASK_temp;
 uint32_t CPUgetPRIMASK_cpsid(void);
 void CPUsetPRIMASK(uint32_t newPRIMASK);
@@ -64,7 +132,51 @@ void CPUsetPRIMASK(uint32_t newPRIMASK);
 #define EnterCritical()	{ _PRIMASK_temp = CPUgetPRIMASK_cpsid(); }
 #define ExitCritical() { CPUsetPRIMASK(_PRIMASK_temp); }
 
+// a non-zero IPSR means that we are executing in handler (interrupt) mode
+uint32_t CPUgetIPSR(void);
+#define _HW_IsInISR() ( CPUgetIPSR() != 0 )
+// the exception number of the running ISR, 0 outside of one
+#define _HW_GetISRNumber() ( (uint8_t)CPUgetIPSR() )
+// the NVIC priority of the running ISR
+uint8_t _HW_GetISRPriority(void);
+
+// data memory barrier, orders the slot & index accesses of the lock-free
+// mailboxes between an ISR and the framework
+#if defined(ccs)
+#define ES_MemoryBarrier() __asm("    dmb")
+#elif defined(rvmdk) || defined(__ARMCC_VERSION)
+#define ES_MemoryBarrier() __dmb(0xF)
+#else
+#define ES_MemoryBarrier() __asm volatile ("dmb" ::: "memory")
+#endif
+#endif
+
+
+#if defined(ES_PORT_POSIX)
+/* Rate constants for the POSIX host port. The virtual SysTick is a timerfd
+   on CLOCK_MONOTONIC, so these are simply the tick period in microseconds.
+ */
+typedef enum {	ES_Timer_RATE_OFF  	=   (0),
+				ES_Timer_RATE_100uS = 100,
+				ES_Timer_RATE_500uS = 500,
+				ES_Timer_RATE_1mS	= 1000,
+				ES_Timer_RATE_2mS	= 2000,
+				ES_Timer_RATE_4mS	= 4000,
+				ES_Timer_RATE_5mS	= 5000,
+				ES_Timer_RATE_8mS	= 8000,
+				ES_Timer_RATE_10mS	= 10000,
+				ES_Timer_RATE_16mS	= 16000,
+				ES_Timer_RATE_32mS	= 32000
+} TimerRate_t;
+
+// the 64 bit clock counts CLOCK_MONOTONIC nanoseconds
+#define ES_CLOCK_TICKS_PER_US 1000
 
+// the cycle counter is CLOCK_MONOTONIC in nanoseconds too, but it always
+// runs in real time, even under the virtual clock
+#define ES_CYCLES_PER_US 1000
+
+#else
 /* Rate constants for programming the SysTick Period to generate tick interrupts.
    These assume an 40MHz configuration, they are the values to be used to program
    the SysTick Reload Value (STRELOAD) register. STRELOAD is 24-bits wide and so
@@ -87,16 +199,75 @@ typedef enum {	ES_Timer_RATE_OFF  	=   (0),
 				ES_Timer_RATE_32mS	= 1280000-1
 } TimerRate_t;
 
+// the 64 bit clock counts 40MHz system clock cycles (25nS)
+#define ES_CLOCK_TICKS_PER_US 40
+
+// the cycle counter is the CYCCNT register of the Cortex-M4 DWT unit, which
+// _HW_Timer_Init starts. Reading it is a single load, so it can be used
+// around every run function call, unlike the 64 bit clock.
+#define ES_DWT_CYCCNT (*(volatile uint32_t *)0xE0001004)
+#define _HW_GetCycles() (ES_DWT_CYCCNT)
+#define ES_CYCLES_PER_US 40
+#endif
+
 // map the generic functions for testing the serial port to actual functions 
 // for this platform. If the C compiler does not provide functions to test
 // and retrieve serial characters, you should write them in ES_Port.c
 #define IsNewKeyReady()  ( kbhit() != 0 )
+#if defined(ES_PORT_POSIX)
+#define GetNewKey()      TERMIO_GetChar()
+#else
 #define GetNewKey()      getchar()
+#endif
+
+#if defined(ES_PORT_POSIX)
+// on the host these stand in for the termio.c routines, reading from stdin
+int kbhit(void);
+void TERMIO_Init(void);
+unsigned char TERMIO_GetChar(void);
+void TERMIO_PutChar(unsigned char ch);
+#endif
 
 // prototypes for the hardware specific routines
 void _HW_Timer_Init(TimerRate_t Rate);
 bool _HW_Process_Pending_Ints( void );
 uint16_t _HW_GetTickCount(void);
+uint32_t _HW_GetTimestamp(void);
+uint64_t _HW_GetClock(void);
+uint64_t _HW_GetMicros(void);
+void _HW_Idle(uint16_t MaxTicks);
 void ConsoleInit(void);
+#if defined(ES_PORT_POSIX)
+uint32_t _HW_GetCycles(void);
+#endif
+#if defined(ES_PREEMPTIVE)
+// has ES_Preempt called at task level once the ISRs are done
+void _HW_RequestPreempt(void);
+#endif
+
+#if defined(ES_PORT_POSIX)
+// connect a handler to one of the interrupt signals (SIGALRM, SIGIO, SIGUSR1,
+// SIGUSR2 or SIGRTMIN..SIGRTMAX) so that it behaves like an ISR
+bool _HW_AttachInterrupt(int SigNum, void (*pISR)(void));
+#if ES_THREADS > 0
+// the pool of ES_THREADS worker threads that runs the services. Once a
+// service is listed, a worker calls pRunWork for it, never on two workers
+// at once. The ISRs stay on the thread that started the pool.
+bool _HW_StartWorkers(void (*pRunWork)(uint16_t Instance, uint8_t Service));
+void _HW_ListWork(uint16_t Instance, uint8_t Service);
+void _HW_WaitWorkers(void);
+#endif
+#if defined(ES_VIRTUAL_CLOCK)
+// with the virtual clock, pISR runs as an ISR when the clock has moved on
+// Micros uS, in place of a hardware timer interrupt
+bool _HW_ScheduleInterrupt(void (*pISR)(void), uint32_t Micros);
+void _HW_CancelInterrupt(void (*pISR)(void));
+#endif
+#elif defined(ES_VIRTUAL_CLOCK)
+#error ES_VIRTUAL_CLOCK is only available with ES_PORT_POSIX
+#endif
+#if !defined(ES_PORT_POSIX) && defined(ES_THREADS) && (ES_THREADS > 0)
+#error ES_THREADS is only available with ES_PORT_POSIX
+#endif
 
 #endif
@@ -9,6 +9,7 @@
  History
  When           Who     What/Why
  -------------- ---     --------
+ 10/17/26 21:00 jh       added ES_Subscribe, ES_Unsubscribe & ES_Publish
  08/05/13 15:19 jec      modifications to suit new portable type definitions
  01/15/12 11:57 jec      modified includes to match Events & Services
  10/16/11 12:28 jec      started coding
@@ -32,4 +33,8 @@ bool ES_PostList05( ES_Event);
 bool ES_PostList06( ES_Event);
 bool ES_PostList07( ES_Event);
 
+bool ES_Subscribe( uint8_t WhichService, ES_EventTyp_t EventType );
+bool ES_Unsubscribe( uint8_t WhichService, ES_EventTyp_t EventType );
+bool ES_Publish( ES_Event ThisEvent );
+
 #endif // ES_PostList_H
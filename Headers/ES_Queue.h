@@ -9,6 +9,8 @@
  History
  When           Who     What/Why
  -------------- ---     --------
+ 10/17/26 21:30 jh       added ES_SpliceToFront
+ 10/17/26 13:40 jh       added ES_GetQueuePeak & ES_ResetQueuePeak
  08/05/13 15:19 jec      modifications to suit new portable type definitions
  01/15/12 09:36 jec      converted to use new types from ES_Types.h
  10/17/11 07:49 jec      new header to match the rest of the framework
@@ -28,6 +30,9 @@ bool ES_EnQueueLIFO( ES_Event * pBlock, ES_Event Event2Add );
 uint8_t ES_DeQueue( ES_Event * pBlock, ES_Event * pReturnEvent );
 //void EF_FlushQueue( unsigned char * pBlock );
 bool ES_IsQueueEmpty( ES_Event * pBlock );
+uint8_t ES_GetQueuePeak( ES_Event * pBlock );
+void ES_ResetQueuePeak( ES_Event * pBlock );
+uint8_t ES_SpliceToFront( ES_Event * pDest, ES_Event * pSource );
 
 #endif /*ES_Queue_H */
 
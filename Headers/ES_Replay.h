@@ -0,0 +1,80 @@
+/****************************************************************************
+ Module
+     ES_Replay.h
+ Description
+     header file for the record/replay of the events that come from
+     interrupt responses
+ Notes
+     ES_REPLAY_RECORDS in ES_Configure.h sets the size of the log, 0 leaves
+     the recorder out. On the Tiva the log is filled from ES_Initialize on
+     and printed with ES_ReplayDump. The POSIX port reads that console log
+     back with ES_ReplayLoad and feeds the events to the services at the
+     same tick that they came in on the Tiva. Tools/ES_ReplayRun.c checks
+     the whole round trip on the host.
+
+ History
+ When           Who     What/Why
+ -------------- ---     --------
+ 10/17/26 23:00 jh      started coding
+*****************************************************************************/
+#ifndef ES_Replay_H
+#define ES_Replay_H
+
+#include "ES_Types.h"
+#include "ES_Events.h"
+#include "ES_Port.h"
+
+// Target of a record that is not a post to a service
+#define ES_REPLAY_TIMER   0xFE  // ES_Timer_InitTimer(EventType, Value)
+#define ES_REPLAY_CAPTURE 0xFF  // a register read through ES_ReplayCapture
+
+typedef struct {
+  uint32_t Time;        // uS since ES_Initialize
+  uint32_t Value;       // the EventParam, the timer's time or the register
+  uint16_t EventType;   // the event type, or the timer number
+  uint8_t Source;       // the interrupt number, from _HW_GetISRNumber()
+  uint8_t Target;       // the service posted to, or one of the above
+} ES_ReplayRecord_t;
+
+#if ES_REPLAY_RECORDS > 0
+
+/* prototypes for public functions */
+
+uint32_t ES_ReplayCapture( uint32_t Value );
+void ES_ReplayDump( void );
+
+/* used by the framework to fill the log */
+
+void ES_InitReplay( TimerRate_t Rate );
+void ES_ReplayRecordPost( uint8_t WhichService, ES_Event ThisEvent );
+void ES_ReplayRecordTimer( uint8_t Num, uint16_t NewTime );
+
+#if defined(ES_PORT_POSIX)
+/* the replay driver on the host */
+
+bool ES_ReplayLoad( const char * pFileName );
+bool ES_ReplayIsDone( void );
+void ES_ReplayDeliver( void );
+void ES_ReplayTick( void );
+uint16_t ES_ReplayTicksToNext( void );
+#endif
+
+#else // no recorder, the register values pass straight through
+
+#define ES_ReplayCapture(Value)  (Value)
+#define ES_ReplayDump()
+#define ES_InitReplay(Rate)
+#define ES_ReplayRecordPost(WhichService, ThisEvent)
+#define ES_ReplayRecordTimer(Num, NewTime)
+
+#if defined(ES_PORT_POSIX)
+#define ES_ReplayLoad(pFileName)  false
+#define ES_ReplayIsDone()  true
+#define ES_ReplayDeliver()
+#define ES_ReplayTick()
+#define ES_ReplayTicksToNext()  0xFFFF
+#endif
+
+#endif
+
+#endif /* ES_Replay_H */
@@ -7,69 +7,26 @@
  History
  When           Who     What/Why
  -------------- ---     --------
+ 10/17/26 18:50 jh      declares the service functions from ES_SERVICE_LIST
+                        rather than including each SERV_n_HEADER
  01/15/12 10:35 jec      started coding
 *****************************************************************************/
 
-#include "ES_Configure.h"
-
-#include SERV_0_HEADER
-
-#if NUM_SERVICES > 1
-#include SERV_1_HEADER
-#endif
-
-#if NUM_SERVICES > 2
-#include SERV_2_HEADER
-#endif
-
-#if NUM_SERVICES > 3
-#include SERV_3_HEADER
-#endif
-
-#if NUM_SERVICES > 4
-#include SERV_4_HEADER
-#endif
-
-#if NUM_SERVICES > 5
-#include SERV_5_HEADER
-#endif
+#ifndef ES_ServiceHeaders_H
+#define ES_ServiceHeaders_H
 
-#if NUM_SERVICES > 6
-#include SERV_6_HEADER
-#endif
-
-#if NUM_SERVICES > 7
-#include SERV_7_HEADER
-#endif
-
-#if NUM_SERVICES > 8
-#include SERV_8_HEADER
-#endif
-
-#if NUM_SERVICES > 9
-#include SERV_9_HEADER
-#endif
-
-#if NUM_SERVICES > 10
-#include SERV_10_HEADER
-#endif
-
-#if NUM_SERVICES > 11
-#include SERV_11_HEADER
-#endif
-
-#if NUM_SERVICES > 12
-#include SERV_12_HEADER
-#endif
+#include "ES_Configure.h"
+#include "ES_Types.h"
+#include "ES_Events.h"
 
-#if NUM_SERVICES > 13
-#include SERV_13_HEADER
-#endif
+// the prototypes for the public functions of every service in 
+// ES_SERVICE_LIST. Anything else a service exports still comes from its
+// own header.
+#define ES_SERVICE_PROTOTYPES(Name, QueueSize) \
+  bool Init##Name( uint8_t Priority ); \
+  bool Post##Name( ES_Event ThisEvent ); \
+  ES_Event Run##Name( ES_Event ThisEvent );
 
-#if NUM_SERVICES > 14
-#include SERV_14_HEADER
-#endif
+ES_SERVICE_LIST(ES_SERVICE_PROTOTYPES)
 
-#if NUM_SERVICES > 15
-#include SERV_15_HEADER
-#endif
+#endif /* ES_ServiceHeaders_H */
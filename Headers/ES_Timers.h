@@ -14,6 +14,11 @@
  History
  When           Who	What/Why
  -------------- ---	--------
+ 10/17/26 18:00 jh   added ES_Timer_GetTicksToNextTimeout
+ 10/17/26 17:25 jh   added the 64 bit clock
+ 10/17/26 16:30 jh   added periodic timers
+ 10/17/26 15:40 jh   added ES_Timer_Alloc & ES_Timer_Free for the timers
+                     beyond the first 16
  08/13/13 12:03 jec  added prototype for ES_Timer_Tick_Resp as part of 
                      moving all of the hardware specific code to ES_Port.c
  01/15/12 16:43 jec  converted for Gen2 of the Events & Services Framework
@@ -31,6 +36,13 @@
 
 #include "ES_Port.h"
 #include "ES_Types.h"
+#include "ES_Configure.h"
+#include "ES_PostList.h"
+
+// returned by ES_Timer_Alloc when all of the timers are in use
+#define ES_Timer_NONE 0xFF
+// returned by ES_Timer_GetTicksToNextTimeout when no timer is running
+#define ES_Timer_NO_TIMEOUT 0xFFFF
 
 
 typedef enum { ES_Timer_ERR           = -1,
@@ -41,12 +53,20 @@ typedef enum { ES_Timer_ERR           = -1,
 
 void             ES_Timer_Init(TimerRate_t Rate);
 void             ES_Timer_Tick_Resp(void);
+uint8_t          ES_Timer_Alloc(pPostFunc Owner);
+ES_TimerReturn_t ES_Timer_Free(uint8_t Num);
 ES_TimerReturn_t ES_Timer_InitTimer(uint8_t Num, uint16_t NewTime);
 ES_TimerReturn_t ES_Timer_SetTimer(uint8_t Num, uint16_t NewTime);
 ES_TimerReturn_t ES_Timer_StartTimer(uint8_t Num);
 ES_TimerReturn_t ES_Timer_StopTimer(uint8_t Num);
 ES_TimerReturn_t ES_Timer_IsTimerActive(uint8_t Num);
+ES_TimerReturn_t ES_Timer_StartPeriodic(uint8_t Num, uint16_t Period);
+uint16_t         ES_Timer_GetMissed(uint8_t Num);
+void             ES_Timer_Dispatched(uint8_t Num);
+uint16_t         ES_Timer_GetTicksToNextTimeout(void);
 uint16_t         ES_Timer_GetTime(void);
+uint64_t         ES_Timer_GetClock(void);
+uint64_t         ES_Timer_GetMicros(void);
 
 #endif   /* ES_Timers_H */
 /*------------------------------ End of file ------------------------------*/
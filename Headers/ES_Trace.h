@@ -0,0 +1,70 @@
+/****************************************************************************
+ Module
+     ES_Trace.h
+ Description
+     header file for the flight recorder, a ring in RAM of compact binary
+     records of the posts, dispatches and state transitions
+ Notes
+     ES_TRACE_RECORDS in ES_Configure.h sets the size of the ring, 0 leaves
+     the recorder out. Tools/ES_TraceDecode.c turns a dump into a timeline.
+
+ History
+ When           Who     What/Why
+ -------------- ---     --------
+ 10/17/26 22:00 jh      started coding
+*****************************************************************************/
+#ifndef ES_Trace_H
+#define ES_Trace_H
+
+#include "ES_Types.h"
+#include "ES_Events.h"
+
+// what a record is of, and how to read its Source, Target & State
+typedef enum {
+  ES_TRACE_POST = 1,  // Source posted to service Target
+  ES_TRACE_DROP,      // as for a post, but the queue or mailbox was full
+  ES_TRACE_DISPATCH,  // service Target's run function was called
+  ES_TRACE_TRANSITION,// machine Source went from state Target to State
+  ES_TRACE_FAILED_RUN // service Target's run function returned an error
+} ES_TraceKind_t;
+
+// Source of a post that was not made by a service's run function
+#define ES_TRACE_ISR        0xFE
+#define ES_TRACE_NO_SERVICE 0xFF
+
+typedef struct {
+  uint32_t Time;        // _HW_GetTimestamp() when recorded, in uS
+  uint16_t EventType;
+  uint16_t EventParam;  // the low 16 bits with ES_WIDE_EVENT_PARAM
+  uint8_t Kind;         // an ES_TraceKind_t
+  uint8_t Source;
+  uint8_t Target;
+  uint8_t State;
+} ES_TraceRecord_t;
+
+// the state machines that record their transitions, from ES_Configure.h
+#define ES_TRACE_MACHINE_ID(Name) ES_TRACE_##Name,
+typedef enum {
+  ES_TRACE_MACHINES(ES_TRACE_MACHINE_ID)
+  ES_NUM_TRACE_MACHINES
+} ES_TraceMachine_t;
+
+#if ES_TRACE_RECORDS > 0
+
+/* prototypes for public functions */
+
+void ES_TraceRecord( ES_TraceKind_t Kind, uint8_t Source, uint8_t Target,
+                     uint8_t State, ES_Event ThisEvent );
+void ES_TraceTransition( ES_TraceMachine_t Machine, uint8_t FromState,
+                         uint8_t ToState, ES_Event ThisEvent );
+void ES_TraceDump( void );
+
+#else // no recorder, so the records cost nothing
+
+#define ES_TraceRecord(Kind, Source, Target, State, ThisEvent)
+#define ES_TraceTransition(Machine, FromState, ToState, ThisEvent)
+#define ES_TraceDump()
+
+#endif
+
+#endif /* ES_Trace_H */
@@ -15,4 +15,5 @@ bool PostFlywheelTest( ES_Event ThisEvent );
 ES_Event RunFlywheelTest( ES_Event ThisEvent );
 void FlywheelInputCaptureISR(void);
 void PIControlISR(void);
+void FlywheelControlSlot(void);
 #endif /* FlywheelTest_H */
@@ -1,8 +1,11 @@
 #ifndef GAME_TIMER_H
 #define GAME_TIMER_H
 
+#include <stdint.h>
+
 // Function declarations
 void InitGameTimer(void);
 void GameTimerISR(void);
+uint32_t QueryGameTimeMS(void);
 
 #endif
\ No newline at end of file
@@ -10,6 +10,7 @@ bool PostUltrasonicTest( ES_Event ThisEvent );
 ES_Event RunUltrasonicTest( ES_Event ThisEvent );
 void UltrasonicCaptureResponse(void);
 void OneShotTriggerISR(void);
+void UltrasonicTriggerSlot(void);
 
 typedef enum {	Waiting2Detect, Detecting } UltrasonicState_t;
 
@@ -10,18 +10,25 @@ It uses the interrupt timer associated with tiva input PD7 (left IR sensor) and
 #define PeriodMargin 20  // in uS
 #define CaptureMargin 10  // in uS
 /*---------------------------- Module Variables ---------------------------*/
-// with the introduction of Gen2, we need a module level Priority variable
-static uint8_t BeaconPriority;
-
 static const uint16_t PeriodArray[5] = {800, 690, 588, 513, 454}; // in uS
-// static const uint16_t FreqArray[5] = {1250, 1450, 1700, 1950, 2200} // in Hz
-static uint8_t Right_PeriodCount;
-static uint16_t Right_TargetIRPeriod;
-static uint32_t Right_LastCapture;
-static uint32_t Right_LastPeriod;
-static uint32_t Right_CapturedPeriod[32];
-static bool Right_ReadytoSendPeriod;
-static BeaconState_t BeaconState;
+// the state of one robot, see ES_Instance.h
+typedef struct {
+  // with the introduction of Gen2, we need a module level Priority variable
+  uint8_t BeaconPriority;
+
+  // static const uint16_t FreqArray[5] = {1250, 1450, 1700, 1950, 2200} // in Hz
+  uint8_t Right_PeriodCount;
+  uint16_t Right_TargetIRPeriod;
+  uint32_t Right_LastCapture;
+  uint32_t Right_LastPeriod;
+  uint32_t Right_CapturedPeriod[32];
+  bool Right_ReadytoSendPeriod;
+  BeaconState_t BeaconState;
+} BeaconServiceData_t;
+
+static BeaconServiceData_t Instances[ES_NUM_INSTANCES];
+
+#define Me ES_THIS(Instances)
 
 																	
 /*---------------------------- Module Functions ---------------------------*/
@@ -40,13 +47,13 @@ Initialize state machine
 **************************/
 
 bool InitBeaconService(uint8_t Priority) {
-	BeaconPriority = Priority;
+	Me->BeaconPriority = Priority;
 	Right_InitBeaconCapture(); 
-	BeaconState = B_Waiting4Capture;
+	Me->BeaconState = B_Waiting4Capture;
 	puts("Init Beacon Service\r\n");
 	ES_Event ThisEvent;
 	ThisEvent.EventType = ES_INIT;
-  if (ES_PostToService( BeaconPriority, ThisEvent) == true)
+  if (ES_PostToService( Me->BeaconPriority, ThisEvent) == true)
   {
       return true;
   }else
@@ -61,7 +68,7 @@ Posts events to service. Returns true if successful
 */
 
 bool PostBeaconService(ES_Event ThisEvent) {
-  return ES_PostToService(BeaconPriority, ThisEvent); 
+  return ES_PostToService(Me->BeaconPriority, ThisEvent); 
 }
 
 /******************************************************************
@@ -75,18 +82,18 @@ ES_Event RunBeaconService(ES_Event ThisEvent) {
 	ES_Event ReturnEvent;
   ReturnEvent.EventType = ES_NO_EVENT; // assume no errors
 	
-		switch(BeaconState) {
+		switch(Me->BeaconState) {
 			case B_Waiting4Capture :
 				if (ThisEvent.EventType == ES_INIT){
 				puts("Beacon running\r\n");
 				}
 				if(ThisEvent.EventType == ES_START_IR_CAPTURE) {
-					Right_TargetIRPeriod= PeriodArray[1]; //1450 Hz
-					BeaconState = B_PeriodCapturing;
+					Me->Right_TargetIRPeriod= PeriodArray[1]; //1450 Hz
+					Me->BeaconState = B_PeriodCapturing;
 					// clear all module vars of the right sensor for a new-round capturing
-					Right_LastCapture = 0;
-					Right_LastPeriod = 0;
-					Right_ReadytoSendPeriod = false;
+					Me->Right_LastCapture = 0;
+					Me->Right_LastPeriod = 0;
+					Me->Right_ReadytoSendPeriod = false;
 					
 					// Enable WTimer2B for right IR input capture
 					HWREG(WTIMER2_BASE+TIMER_O_IMR) |= TIMER_IMR_CBEIM;
@@ -102,25 +109,25 @@ ES_Event RunBeaconService(ES_Event ThisEvent) {
 					// disable input capture (already captured an averaged period, don't want to be interrupted any more)
 					HWREG(WTIMER2_BASE+TIMER_O_IMR) &= ~TIMER_IMR_CBEIM;
 					// Note that EventParam is 16 bit
-						printf("Right_TargetIRPeriod = %d\r\n",Right_TargetIRPeriod);
-						if (ThisEvent.EventParam >= (Right_TargetIRPeriod - CaptureMargin) &&
-						ThisEvent.EventParam <= (Right_TargetIRPeriod + CaptureMargin))
+						printf("Right_TargetIRPeriod = %d\r\n",Me->Right_TargetIRPeriod);
+						if (ThisEvent.EventParam >= (Me->Right_TargetIRPeriod - CaptureMargin) &&
+						ThisEvent.EventParam <= (Me->Right_TargetIRPeriod + CaptureMargin))
 						{
 							printf("Valid IR period %d on the IR sensor\r\n",ThisEvent.EventParam);
-							Right_ReadytoSendPeriod = true;
+							Me->Right_ReadytoSendPeriod = true;
 						}
 				}
-				if (Right_ReadytoSendPeriod)  // If the IR sensor captures valid pulses
+				if (Me->Right_ReadytoSendPeriod)  // If the IR sensor captures valid pulses
 				{
 					// Post event to MasterSM
 					ES_Event Event2Post;
 					Event2Post.EventType = ES_BEACON_ALIGNED;
-					Event2Post.EventParam = Right_TargetIRPeriod;
+					Event2Post.EventParam = Me->Right_TargetIRPeriod;
 					PostMasterSM(Event2Post);
 					puts("IR task complete. Event posted back to MasterSM\r\n");
 				}
 				// return to Waiting4Capture state regardless of whether (Left_ReadytoSendPeriod || Right_ReadytoSendPeriod) == true
-				BeaconState = B_Waiting4Capture;
+				Me->BeaconState = B_Waiting4Capture;
 			break;
 		}
 	return ReturnEvent;
@@ -133,37 +140,37 @@ void RightIRCaptureISR(void) {
 	HWREG(WTIMER2_BASE+TIMER_O_ICR) = TIMER_ICR_CBECINT;
 // now grab the captured value and calculate the period
 	Right_ThisCapture = HWREG(WTIMER2_BASE+TIMER_O_TBR); // ticks
-	Right_ThisPeriod = (Right_ThisCapture - Right_LastCapture) * 25 / 1000; // convert ns to uS, tick interval = 25 ns
-	Right_LastCapture = Right_ThisCapture;
+	Right_ThisPeriod = (Right_ThisCapture - Me->Right_LastCapture) * 25 / 1000; // convert ns to uS, tick interval = 25 ns
+	Me->Right_LastCapture = Right_ThisCapture;
 	
-	if (Right_PeriodCount == 0) {
-		Right_CapturedPeriod[Right_PeriodCount] = Right_ThisPeriod;
-		Right_PeriodCount++;
-		Right_LastPeriod = Right_ThisPeriod;
+	if (Me->Right_PeriodCount == 0) {
+		Me->Right_CapturedPeriod[Me->Right_PeriodCount] = Right_ThisPeriod;
+		Me->Right_PeriodCount++;
+		Me->Right_LastPeriod = Right_ThisPeriod;
 	} else {
 		
-		if (Right_ThisPeriod > (Right_LastPeriod + CaptureMargin) || Right_ThisPeriod < (Right_LastPeriod - CaptureMargin)) {
+		if (Right_ThisPeriod > (Me->Right_LastPeriod + CaptureMargin) || Right_ThisPeriod < (Me->Right_LastPeriod - CaptureMargin)) {
 			// clear all measured periods
-			for (int i = 0; i < Right_PeriodCount; i++) {
-				Right_CapturedPeriod[i] = 0;
+			for (int i = 0; i < Me->Right_PeriodCount; i++) {
+				Me->Right_CapturedPeriod[i] = 0;
 			}
 			// re-count from 0
-			Right_PeriodCount = 0;
+			Me->Right_PeriodCount = 0;
 		} else {
-			Right_CapturedPeriod[Right_PeriodCount] = Right_ThisPeriod;
-			Right_LastPeriod = Right_ThisPeriod;
-			Right_PeriodCount++;
+			Me->Right_CapturedPeriod[Me->Right_PeriodCount] = Right_ThisPeriod;
+			Me->Right_LastPeriod = Right_ThisPeriod;
+			Me->Right_PeriodCount++;
 			
-		if (Right_PeriodCount == 32) {
+		if (Me->Right_PeriodCount == 32) {
 			uint32_t Right_Sum = 0;
-			for (int i = 0; i < Right_PeriodCount; i++) {
-				Right_Sum += Right_CapturedPeriod[i];
+			for (int i = 0; i < Me->Right_PeriodCount; i++) {
+				Right_Sum += Me->Right_CapturedPeriod[i];
 			}
-			Right_LastPeriod = Right_Sum >> 5; // faster way of calculating sum/32
-			printf("Right average IR period = %d\r\n",Right_LastPeriod);
+			Me->Right_LastPeriod = Right_Sum >> 5; // faster way of calculating sum/32
+			printf("Right average IR period = %d\r\n",Me->Right_LastPeriod);
 			ES_Event IRPeriodEvent;
 			IRPeriodEvent.EventType = ES_IR_PULSE;
-			IRPeriodEvent.EventParam = Right_LastPeriod;
+			IRPeriodEvent.EventParam = Me->Right_LastPeriod;
 			PostBeaconService(IRPeriodEvent);
 		}
 		}
@@ -62,12 +62,19 @@ cannot request COWs anymore
 static void InitCOWPulse(void);
 
 /*---------------------------- Module Variables ---------------------------*/
-// everybody needs a state variable, you may need others as well.
-// type of state variable should match htat of enum in header file
-static COWSupplementState_t CurrentState;
-static uint8_t MyPriority;
-static uint8_t PulseCount;
-static uint8_t RequestCount;
+// the state of one robot, see ES_Instance.h
+typedef struct {
+  // everybody needs a state variable, you may need others as well.
+  // type of state variable should match htat of enum in header file
+  COWSupplementState_t CurrentState;
+  uint8_t MyPriority;
+  uint8_t PulseCount;
+  uint8_t RequestCount;
+} COWSupplementServiceData_t;
+
+static COWSupplementServiceData_t Instances[ES_NUM_INSTANCES];
+
+#define Me ES_THIS(Instances)
 
 /*------------------------------ Module Code ------------------------------*/
 /****************************************************************************
@@ -91,7 +98,7 @@ static uint8_t RequestCount;
 bool InitCOWSupplementService ( uint8_t Priority )
 {
   ES_Event ThisEvent;
-  MyPriority = Priority;
+  Me->MyPriority = Priority;
 	// COW request IR emitter: PF4
 	
 	// Initialize the port line PF4 
@@ -111,13 +118,13 @@ bool InitCOWSupplementService ( uint8_t Priority )
 	ES_Timer_Init(ES_Timer_RATE_1mS);
 	
 	// Initialize all module vars
-  CurrentState = Waiting4Reload;
-	PulseCount = 0; 
-	RequestCount = 0;
+  Me->CurrentState = Waiting4Reload;
+	Me->PulseCount = 0; 
+	Me->RequestCount = 0;
 	
   // post the initial transition event
   ThisEvent.EventType = ES_INIT;
-  if (ES_PostToService( MyPriority, ThisEvent) == true)
+  if (ES_PostToService( Me->MyPriority, ThisEvent) == true)
   {
 		puts("Init COW\r\n");
       return true;
@@ -146,7 +153,7 @@ bool InitCOWSupplementService ( uint8_t Priority )
 ****************************************************************************/
 bool PostCOWSupplementService( ES_Event ThisEvent )
 {
-  return ES_PostToService( MyPriority, ThisEvent);
+  return ES_PostToService( Me->MyPriority, ThisEvent);
 }
 
 /****************************************************************************
@@ -171,7 +178,7 @@ ES_Event RunCOWSupplementService( ES_Event ThisEvent )
   ES_Event ReturnEvent;
   ReturnEvent.EventType = ES_NO_EVENT; // assume no errors
 
-  switch ( CurrentState )
+  switch ( Me->CurrentState )
   {
     case Waiting4Reload:       
 		  if (ThisEvent.EventType == ES_RELOAD ){
@@ -180,7 +187,7 @@ ES_Event RunCOWSupplementService( ES_Event ThisEvent )
 					ThisEvent.EventType = ES_QUERYBALL;
 				  PostLEDService(ThisEvent);
 				
-					CurrentState = Waiting4FullLoad;
+					Me->CurrentState = Waiting4FullLoad;
 				  // set PF4 to low and start pulsing
 				  HWREG(GPIO_PORTF_BASE+(GPIO_O_DATA+ALL_BITS)) &= ~GPIO_PIN_4;
 				  // load IRPulseONTime to timer (10mS)
@@ -193,14 +200,14 @@ ES_Event RunCOWSupplementService( ES_Event ThisEvent )
 			
 		case Waiting4FullLoad:      
 				if (ThisEvent.EventType == ES_PULSE_DONE) {
-					RequestCount++;
-					PulseCount = 0;
+					Me->RequestCount++;
+					Me->PulseCount = 0;
 					// start the query interval timer
 					ES_Timer_InitTimer(COW_INTERVAL_TIMER, COWRequestInterval);
 				}
 				
 				if (ThisEvent.EventType == ES_TIMEOUT && ThisEvent.EventParam == COW_INTERVAL_TIMER) {
-					if (RequestCount < 5) {
+					if (Me->RequestCount < 5) {
 						ES_Event ThisEvent;
 				  	ThisEvent.EventType = ES_QUERYBALL;
 				    PostLEDService(ThisEvent);
@@ -212,9 +219,9 @@ ES_Event RunCOWSupplementService( ES_Event ThisEvent )
 						// kick off timer to control ON time
 						HWREG(WTIMER5_BASE+TIMER_O_CTL) |= (TIMER_CTL_TBEN | TIMER_CTL_TBSTALL);
 					} else {
-						PulseCount = 0;
-						RequestCount = 0;
-						CurrentState = Waiting4Reload;
+						Me->PulseCount = 0;
+						Me->RequestCount = 0;
+						Me->CurrentState = Waiting4Reload;
 						
 						// Post ES_FULL_LOAD event back to MasterSM
 						ES_Event ThisEvent;
@@ -235,7 +242,8 @@ void PulseISR(void){
 	// start by clearing the source of the interrupt
 	HWREG(WTIMER5_BASE+TIMER_O_ICR) = TIMER_ICR_TBTOCINT;
 	
-	if ( (HWREG(GPIO_PORTF_BASE+(GPIO_O_DATA+ALL_BITS)) & BIT4HI) == BIT4HI ) {
+	if ( (ES_ReplayCapture(HWREG(GPIO_PORTF_BASE+(GPIO_O_DATA+ALL_BITS))) &
+	      BIT4HI) == BIT4HI ) {
 		// set GPIO to low
 		HWREG(GPIO_PORTF_BASE+(GPIO_O_DATA+ALL_BITS)) &= ~GPIO_PIN_4;		
 		// reload timer value to IRPulseONTime (10mS) and kick off the timer
@@ -245,8 +253,8 @@ void PulseISR(void){
 	} else if ( (HWREG(GPIO_PORTF_BASE+(GPIO_O_DATA+ALL_BITS)) & BIT4HI) == 0 ) {
 		 // set GPIO to high
 		 HWREG(GPIO_PORTF_BASE+(GPIO_O_DATA+ALL_BITS)) |= GPIO_PIN_4;
-		 PulseCount++;
-		 if (PulseCount < 10) {
+		 Me->PulseCount++;
+		 if (Me->PulseCount < 10) {
 		// reload timer value to IRPulseOFFTime (30mS) and kick off the timer;
 			 HWREG(WTIMER5_BASE+TIMER_O_TBILR) = IRPulseOFFTime;
 			 HWREG(WTIMER5_BASE+TIMER_O_TBV) = HWREG(WTIMER5_BASE+TIMER_O_TBILR);
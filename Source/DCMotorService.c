@@ -7,7 +7,8 @@ sent from the MasterSM. Public functions are:
 void Drive(uint_8 Speed, uint_8 Direction);
 void Stop(void);
 
-The service uses a PI controller on velocity.
+The service uses a PI controller on velocity, run every 2mS by the WTIMER2
+interrupt, or with ES_CYCLIC from its slot in the cyclic executive.
 
 ****************************************************************************/
 
@@ -91,31 +92,42 @@ static void VelocityControl(void);
 static void ClearModuleVariables(void);
 
 /*---------------------------- Module Variables ---------------------------*/
-// with the introduction of Gen2, we need a module level Priority variable
-static uint8_t MyPriority;
-static DCMotorServiceState_t CurrentState;
-static uint8_t MovingDirection;
-
-// Velocity measurement variables
-static uint32_t MotorPeriod[2];
-static uint32_t LMotorLastCapture;
-static uint32_t RMotorLastCapture;
-
-static int16_t TargetRPM[2] = {0, 0};
-static int16_t CurrentRPM[2] = {0, 0};
-static double RPMError[2] = {0, 0};
-static double SumRPMError[2] = {0, 0};
-static double DutyCycle[2] = {0, 0};
-
-// Velocity control function constants. Indexing = [LMOTOR, RMOTOR]
-static double K_p_Velocity_FWD[2] = {1.5, 1.5};
-static double K_i_Velocity_FWD[2]= {0, 0};
-
-static double K_p_Velocity_BWD[2] = {1.5, 1.5};
-static double K_i_Velocity_BWD[2]= {0, 0};
-
-// Clamps.
-static uint8_t DutyCycleClamp = 65;
+// the state of one robot, see ES_Instance.h
+typedef struct {
+  // with the introduction of Gen2, we need a module level Priority variable
+  uint8_t MyPriority;
+  DCMotorServiceState_t CurrentState;
+  uint8_t MovingDirection;
+
+  // Velocity measurement variables
+  uint32_t MotorPeriod[2];
+  uint32_t LMotorLastCapture;
+  uint32_t RMotorLastCapture;
+
+  int16_t TargetRPM[2];
+  int16_t CurrentRPM[2];
+  double RPMError[2];
+  double SumRPMError[2];
+  double DutyCycle[2];
+
+  // Velocity control function constants. Indexing = [LMOTOR, RMOTOR]
+  double K_p_Velocity_FWD[2];
+  double K_i_Velocity_FWD[2];
+
+  double K_p_Velocity_BWD[2];
+  double K_i_Velocity_BWD[2];
+
+  // Clamps.
+  uint8_t DutyCycleClamp;
+} DCMotorServiceData_t;
+
+static DCMotorServiceData_t Instances[ES_NUM_INSTANCES] = ES_INSTANCE_INIT({
+  .K_p_Velocity_FWD = {1.5, 1.5},
+  .K_p_Velocity_BWD = {1.5, 1.5},
+  .DutyCycleClamp = 65
+});
+
+#define Me ES_THIS(Instances)
 
 /*------------------------------ Module Code ------------------------------*/
 /*
@@ -126,7 +138,7 @@ Initialize service
 bool InitDCMotorService ( uint8_t Priority )
 {
   ES_Event ThisEvent;
-  MyPriority = Priority;
+  Me->MyPriority = Priority;
 	
 	// Initialize PWM (PWMModule)
 	InitDCMotorPWMModule();
@@ -138,11 +150,11 @@ bool InitDCMotorService ( uint8_t Priority )
 	
 	// Init Timer
 	ES_Timer_Init(ES_Timer_RATE_1mS);
-	CurrentState = Idle;
+	Me->CurrentState = Idle;
 	
   // post the initial transition event
   ThisEvent.EventType = ES_INIT;
-  if (ES_PostToService( MyPriority, ThisEvent) == true)
+  if (ES_PostToService( Me->MyPriority, ThisEvent) == true)
   {
       return true;
   }else
@@ -158,7 +170,7 @@ Post to service
 */
 bool PostDCMotorService( ES_Event ThisEvent )
 {
-  return ES_PostToService( MyPriority, ThisEvent);
+  return ES_PostToService( Me->MyPriority, ThisEvent);
 }
 
 /*
@@ -171,7 +183,7 @@ ES_Event RunDCMotorService( ES_Event ThisEvent )
 {
   ES_Event ReturnEvent;
   ReturnEvent.EventType = ES_NO_EVENT; // assume no errors
-	switch (CurrentState)
+	switch (Me->CurrentState)
 	{
 		case Running:
 				if (ThisEvent.EventType == ES_TIMEOUT && ThisEvent.EventParam == DC_STALL_TIMER) {
@@ -196,15 +208,17 @@ InitialDrive
 Driving before arm expansion
 */
 void InitialDrive(uint8_t Speed, uint8_t TargetDirection) {
-	MovingDirection = TargetDirection;
-	TargetRPM[RMOTOR] = 62;
-	TargetRPM[LMOTOR] = 60;
+	Me->MovingDirection = TargetDirection;
+	Me->TargetRPM[RMOTOR] = 62;
+	Me->TargetRPM[LMOTOR] = 60;
 	for (int i = 0; i < 2; i++) {
-		SetDirection(i, MovingDirection);	
+		SetDirection(i, Me->MovingDirection);	
 	}
+#ifndef ES_CYCLIC
 	// Enable the VControl interrupt
 	HWREG(WTIMER2_BASE+TIMER_O_IMR) |= TIMER_IMR_TATOIM;
-	CurrentState = Running;
+#endif
+	Me->CurrentState = Running;
 }
 
 /*
@@ -213,31 +227,35 @@ Drive
 Set the direction and target RPM
 */
 void Drive(uint8_t Speed, uint8_t TargetDirection) {
-	MovingDirection = TargetDirection;
-	if(MovingDirection == FWD) {
-		TargetRPM[RMOTOR] = 80;
-		TargetRPM[LMOTOR] = 67;
+	Me->MovingDirection = TargetDirection;
+	if(Me->MovingDirection == FWD) {
+		Me->TargetRPM[RMOTOR] = 80;
+		Me->TargetRPM[LMOTOR] = 67;
 	} else {
-		TargetRPM[RMOTOR] = 80;
-		TargetRPM[LMOTOR] = 63;	
+		Me->TargetRPM[RMOTOR] = 80;
+		Me->TargetRPM[LMOTOR] = 63;	
 	}
 	for (int i = 0; i < 2; i++) {
-		SetDirection(i, MovingDirection);	
+		SetDirection(i, Me->MovingDirection);	
 	}
+#ifndef ES_CYCLIC
 	// Enable the VControl interrupt
 	HWREG(WTIMER2_BASE+TIMER_O_IMR) |= TIMER_IMR_TATOIM;
-	CurrentState = Running;
+#endif
+	Me->CurrentState = Running;
 }
 
 void Stop(void) {
+#ifndef ES_CYCLIC
 	// disable the VControl interrupt
 	HWREG(WTIMER2_BASE+TIMER_O_IMR) &= ~TIMER_IMR_TATOIM;
+#endif
 	// set duty cycle to 0 to make sure motors stop
 	SetDuty(LMOTOR, 0);
 	SetDuty(RMOTOR, 0);
 	// clear all module variables and 
 	ClearModuleVariables();
-	CurrentState = Idle;
+	Me->CurrentState = Idle;
 }
 
 /*
@@ -251,6 +269,19 @@ void ControlISR(void)
 	VelocityControl();
 }
 
+/*
+DCMotorControlSlot
+
+The motor control loop with ES_CYCLIC, run in every minor frame by the
+cyclic executive in place of ControlISR. Only runs while driving.
+*/
+void DCMotorControlSlot(void)
+{
+	if (Me->CurrentState == Running) {
+		VelocityControl();
+	}
+}
+
 /*
 LMotorInputCapture
 
@@ -262,10 +293,10 @@ void LMotorInputCapture(void)
 	// start by clearing the source of the interrupt, the input capture event
 	HWREG(WTIMER1_BASE+TIMER_O_ICR) = TIMER_ICR_CAECINT;
 	// now grab the captured value and calculate the period
-	LMotorThisCapture = HWREG(WTIMER1_BASE+TIMER_O_TAR);
-	MotorPeriod[LMOTOR] = LMotorThisCapture - LMotorLastCapture;
+	LMotorThisCapture = ES_ReplayCapture(HWREG(WTIMER1_BASE+TIMER_O_TAR));
+	Me->MotorPeriod[LMOTOR] = LMotorThisCapture - Me->LMotorLastCapture;
 	// update LastCapture to prepare for the next edge
-	LMotorLastCapture = LMotorThisCapture;	
+	Me->LMotorLastCapture = LMotorThisCapture;	
 	// restart Distance OneShot Timer for determining whether LM has stopped
 	ES_Timer_InitTimer(DC_STALL_TIMER, StallTimeout);
 }
@@ -281,10 +312,10 @@ void RMotorInputCapture(void)
 	// start by clearing the source of the interrupt, the input capture event
 	HWREG(WTIMER1_BASE+TIMER_O_ICR) = TIMER_ICR_CBECINT;
 	// now grab the captured value and calculate the period
-	RMotorThisCapture = HWREG(WTIMER1_BASE+TIMER_O_TBR);
-	MotorPeriod[RMOTOR] = RMotorThisCapture - RMotorLastCapture;
+	RMotorThisCapture = ES_ReplayCapture(HWREG(WTIMER1_BASE+TIMER_O_TBR));
+	Me->MotorPeriod[RMOTOR] = RMotorThisCapture - Me->RMotorLastCapture;
 	// update LastCapture to prepare for the next edge
-	RMotorLastCapture = RMotorThisCapture;
+	Me->RMotorLastCapture = RMotorThisCapture;
 	// restart Distance OneShot Timer for determining whether RM has stopped
 	ES_Timer_InitTimer(DC_STALL_TIMER, StallTimeout);
 }
@@ -301,29 +332,29 @@ Determines motor duty-cycle based on velocity error for translating
 static void VelocityControl(void) {
 	for (int i = 0; i < 2; i++) {
 		// Stop the robot and prevent oscillations	
-		if(TargetRPM[i] == 0) {
-			DutyCycle[i] = 0;
+		if(Me->TargetRPM[i] == 0) {
+			Me->DutyCycle[i] = 0;
 		} else {
 			// Calculate current RPM
-			CurrentRPM[i] = (60.0*SysClkFreq)/(GearRatio*MotorPeriod[i]*TicksPerRev);
+			Me->CurrentRPM[i] = (60.0*SysClkFreq)/(GearRatio*Me->MotorPeriod[i]*TicksPerRev);
 			// If targetRPM is negative, set the currentRPM negative, and take the negative of the error
-				RPMError[i] = ((double)TargetRPM[i] - (double)CurrentRPM[i]);
-				SumRPMError[i] += RPMError[i];
-			if(MovingDirection == FWD) {
-				DutyCycle[i] = (int)(K_p_Velocity_FWD[i] * RPMError[i] +  K_i_Velocity_FWD[i]* SumRPMError[i]);
+				Me->RPMError[i] = ((double)Me->TargetRPM[i] - (double)Me->CurrentRPM[i]);
+				Me->SumRPMError[i] += Me->RPMError[i];
+			if(Me->MovingDirection == FWD) {
+				Me->DutyCycle[i] = (int)(Me->K_p_Velocity_FWD[i] * Me->RPMError[i] +  Me->K_i_Velocity_FWD[i]* Me->SumRPMError[i]);
 			} else {
-				DutyCycle[i] = (int)(K_p_Velocity_BWD[i] * RPMError[i] +  K_i_Velocity_BWD[i]* SumRPMError[i]);
+				Me->DutyCycle[i] = (int)(Me->K_p_Velocity_BWD[i] * Me->RPMError[i] +  Me->K_i_Velocity_BWD[i]* Me->SumRPMError[i]);
 			}
 			
-			if (DutyCycle[i] > DutyCycleClamp)  {
-				DutyCycle[i] = DutyCycleClamp;
-				SumRPMError[i] -= RPMError[i];
-			} else if (DutyCycle[i] < 0) {
-				DutyCycle[i] = 0;
-				SumRPMError[i] -= RPMError[i];
+			if (Me->DutyCycle[i] > Me->DutyCycleClamp)  {
+				Me->DutyCycle[i] = Me->DutyCycleClamp;
+				Me->SumRPMError[i] -= Me->RPMError[i];
+			} else if (Me->DutyCycle[i] < 0) {
+				Me->DutyCycle[i] = 0;
+				Me->SumRPMError[i] -= Me->RPMError[i];
 			}
 		}
-		SetDuty(i, DutyCycle[i]);
+		SetDuty(i, Me->DutyCycle[i]);
 	}
 }
 
@@ -334,10 +365,10 @@ Clears all driving related variables
 static void ClearModuleVariables(void){
 	// Clear all module variables except Distance[ROBOT] and TargetDistance[ROBOT]
 	for (int i = 0; i < 2; i++){
-		RPMError[i] = 0;
-		SumRPMError[i] = 0;
-		CurrentRPM[i] = 0;
-		TargetRPM[i] = 0;
+		Me->RPMError[i] = 0;
+		Me->SumRPMError[i] = 0;
+		Me->CurrentRPM[i] = 0;
+		Me->TargetRPM[i] = 0;
   }
 }
 
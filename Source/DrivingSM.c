@@ -14,6 +14,8 @@
  History
  When           Who     What/Why
  -------------- ---     --------
+ 10/18/26 09:43 jh      keep the state in one struct for each robot
+ 10/17/26 22:20 jh      record state transitions in the flight recorder
  02/28/17 18:49 ZS      
 ****************************************************************************/
 /*----------------------------- Include Files -----------------------------*/
@@ -67,13 +69,22 @@ static ES_Event DuringWaitToMove(ES_Event Event);
 static ES_Event DuringMoveToDestination(ES_Event Event);
 
 /*---------------------------- Module Variables ---------------------------*/
-// Every SM needs a "CurrentState"
-static DrivingSMState_t CurrentDrState;
-static bool DestinationType;
-static uint8_t StartingStage;
-static bool CurrentColor; // 0-Green, 1-Red
-static bool isFirstCycle = true;
-static bool CurrentDirection;
+// the state of one robot, see ES_Instance.h
+typedef struct {
+  // Every SM needs a "CurrentState"
+  DrivingSMState_t CurrentDrState;
+  bool DestinationType;
+  uint8_t StartingStage;
+  bool CurrentColor; // 0-Green, 1-Red
+  bool isFirstCycle;
+  bool CurrentDirection;
+} DrivingSMData_t;
+
+static DrivingSMData_t Instances[ES_NUM_INSTANCES] = ES_INSTANCE_INIT({
+  .isFirstCycle = true
+});
+
+#define Me ES_THIS(Instances)
 // For now just manually set the color
 /*------------------------------ Module Code ------------------------------*/
 
@@ -98,11 +109,11 @@ static bool CurrentDirection;
 ES_Event RunDrivingSM( ES_Event CurrentEvent )
 {
    bool MakeTransition = false;/* are we making a state transition? */
-   DrivingSMState_t NextDrState = CurrentDrState;
+   DrivingSMState_t NextDrState = Me->CurrentDrState;
    ES_Event EntryEventKind = { ES_ENTRY, 0 };// default to normal entry to new state
    ES_Event ReturnEvent = CurrentEvent; // assume no consumption of passed in event
 
-   switch ( CurrentDrState )
+   switch ( Me->CurrentDrState )
    {
        case WaitToMove :  // default starting state in DrivingSM
 				 puts("Current Driving State = WaitToMove\r\n");
@@ -125,7 +136,7 @@ ES_Event RunDrivingSM( ES_Event CurrentEvent )
 						 ExpandSensorArmEvent.EventType = ES_EXPAND_SENSORARM;
 						 PostServoGateService(ExpandSensorArmEvent);
 						 
-						 isFirstCycle = false;  // To avoid expanding arms when not necessary
+						 Me->isFirstCycle = false;  // To avoid expanding arms when not necessary
 						 // Start a 10 ms ByteTransferTimer before querying LOC for target stage
 						 ES_Timer_InitTimer(ByteTransferIntervalTimer,ByteTransferInterval);
 						 ReturnEvent.EventType = ES_NO_EVENT;  // Wants MasterSM to see NO_EVENT
@@ -143,12 +154,12 @@ ES_Event RunDrivingSM( ES_Event CurrentEvent )
 					 }
 					 else if (CurrentEvent.EventType == ES_LOC_STATUS) // If LOC posts an event about status byte 1 ( byte in its param) 
 					 {
-						  printf("CurrentColor = %d (0-Green,1-Red)\r\n",CurrentColor);
-						  DestinationType = DecipherDestinationType(CurrentEvent.EventParam,CurrentColor);
-							if (DestinationType == 0)// 0 -> staging area
+						  printf("CurrentColor = %d (0-Green,1-Red)\r\n",Me->CurrentColor);
+						  Me->DestinationType = DecipherDestinationType(CurrentEvent.EventParam,Me->CurrentColor);
+							if (Me->DestinationType == 0)// 0 -> staging area
 							{
-								StartingStage = DecipherDestination(CurrentEvent.EventParam,CurrentColor);
-								if (StartingStage == 0)  // if none is active, don't drive the motors, re-enter WaitToMove state to keep querying LOC for non-zero active stage
+								Me->StartingStage = DecipherDestination(CurrentEvent.EventParam,Me->CurrentColor);
+								if (Me->StartingStage == 0)  // if none is active, don't drive the motors, re-enter WaitToMove state to keep querying LOC for non-zero active stage
 								{
 									// Make transition, but stay in WaitToMove state
 									MakeTransition = true;
@@ -158,7 +169,7 @@ ES_Event RunDrivingSM( ES_Event CurrentEvent )
 									NextDrState = MoveToDestination;
 									MakeTransition = true;
 								}
-								printf("StartingStage = %d\r\n",StartingStage);
+								printf("StartingStage = %d\r\n",Me->StartingStage);
 							}
 							else{
 							  // if this time of query LOC doesn't return anything (probably go into some exceptional cases), simply request again
@@ -196,11 +207,13 @@ ES_Event RunDrivingSM( ES_Event CurrentEvent )
     //   If we are making a state transition
     if (MakeTransition == true)
     {
+       // leave a record of it in the flight recorder
+       ES_TraceTransition( ES_TRACE_DrivingSM, Me->CurrentDrState, NextDrState, CurrentEvent );
        //   Execute exit function for current state
        CurrentEvent.EventType = ES_EXIT;
        RunDrivingSM(CurrentEvent);
 
-       CurrentDrState = NextDrState; //Modify state variable
+       Me->CurrentDrState = NextDrState; //Modify state variable
 
        //   Execute entry function for new state
        // this defaults to ES_ENTRY
@@ -233,10 +246,10 @@ void StartDrivingSM ( ES_Event CurrentEvent )
    // is started
 	 
 	 // Initialize the color for this game
-	 CurrentColor = QueryColor();
+	 Me->CurrentColor = QueryColor();
    if ( ES_ENTRY_HISTORY != CurrentEvent.EventType )
    {
-        CurrentDrState = ENTRY_STATE;
+        Me->CurrentDrState = ENTRY_STATE;
    }
    // call the entry function (if any) for the ENTRY_STATE
    RunDrivingSM(CurrentEvent);
@@ -261,7 +274,7 @@ void StartDrivingSM ( ES_Event CurrentEvent )
 ****************************************************************************/
 DrivingSMState_t QueryDrivingSM ( void )
 {
-   return(CurrentDrState);
+   return(Me->CurrentDrState);
 }
 
 /***************************************************************************
@@ -277,18 +290,18 @@ ES_Event DuringWaitToMove( ES_Event Event)
          (Event.EventType == ES_ENTRY_HISTORY) )
     {
       // No Start functions of lower level SM need to run
-			if (isFirstCycle)
+			if (Me->isFirstCycle)
 			{
 				//Call drive function in DCMotorService
 				uint8_t Speed = 60;
-				if (CurrentColor == RED)
+				if (Me->CurrentColor == RED)
 				{
-					CurrentDirection = FWD;
+					Me->CurrentDirection = FWD;
 					InitialDrive(Speed,FWD);
 				}
 				else
 				{
-					CurrentDirection = BWD;
+					Me->CurrentDirection = BWD;
 					InitialDrive(Speed,BWD);
 				}
 				// Start a 1 s timer to move forward and expand the 3 arms
@@ -353,6 +366,6 @@ static ES_Event DuringMoveToDestination( ES_Event Event)
 /******** Function to pass module level static variable to sub machines *****/
 uint8_t QueryStartingStage(void)
 {
-	return StartingStage;
+	return Me->StartingStage;
 }
 
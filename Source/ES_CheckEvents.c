@@ -5,9 +5,21 @@
      source file for the module to call the User event checking routines
  Notes
      Users should not modify the contents of this file.
+     Each checker is called when it is due, every Period ticks of the
+     framework timer, so a checker that polls hardware no longer runs on
+     every pass of ES_Run. The time a checker takes is measured with the
+     cycle counter. With ES_PREEMPTIVE that includes any service that
+     preempts it. The time that the load is taken over is counted with the
+     cycle counter too, a pass at a time, so it runs on with the virtual
+     clock stopped and the 32 bit counter may wrap between dumps, as long
+     as ES_Run calls the checkers once a wrap (107 S on the Tiva).
  History
  When           Who     What/Why
  -------------- ---     --------
+ 10/21/26 14:50 jh       count the time for the load in cycles, not with
+                         _HW_GetClock, which stands still on the host
+ 10/19/26 16:37 jh       call each checker every Period ticks, highest
+                         priority first, and keep the time each one takes
                 jec     out all user modifications into ES_Configure
  10/16/11 12:32 jec      started coding
 *****************************************************************************/
@@ -16,19 +28,88 @@
 #include "ES_Events.h"
 #include "ES_General.h"
 #include "ES_CheckEvents.h"
+#include "ES_Instance.h"
+#include "ES_Port.h"
+#include "ES_Timers.h"
+#include <stdio.h>
 
-// Include the header files for the module(s) with your event checkers. 
+// Include the header files for the module(s) with your event checkers.
 // This gets you the prototypes for the event checking functions.
 
 #include EVENT_CHECK_HEADER
 
-// Fill in this array with the names of your event checking functions
+// the checkers, with their periods & priorities, filled in from
+// ES_EVENT_CHECK_LIST in ES_Configure.h
 
-static CheckFunc * const ES_EventList[]={EVENT_CHECK_LIST };
+typedef struct {
+  CheckFunc *CheckerFunc;
+  uint16_t Period;    // ticks between calls, 0 for every pass
+  uint8_t Priority;   // higher is called first
+} ES_CheckerDesc_t;
 
+#define ES_EVENT_CHECK_DESC(Name, Period, Priority) \
+  { Name, Period, Priority },
+
+static ES_CheckerDesc_t const ES_EventList[ES_NUM_EVENT_CHECKERS] = {
+  ES_EVENT_CHECK_LIST(ES_EVENT_CHECK_DESC)
+};
+
+// the names of the checkers, for ES_DumpCheckerStats
+#define ES_EVENT_CHECK_NAME(Name, Period, Priority) #Name,
+static const char * const CheckerNames[ES_NUM_EVENT_CHECKERS] = {
+  ES_EVENT_CHECK_LIST(ES_EVENT_CHECK_NAME)
+};
+
+// the checkers in the order they are called, set up by ES_InitEventCheckers
+static uint8_t CheckOrder[ES_NUM_EVENT_CHECKERS];
+
+// the schedule & the statistics are kept for each robot, see ES_Instance.h
+typedef struct {
+  uint16_t NextDue[ES_NUM_EVENT_CHECKERS];  // the tick each one is due on
+  ES_CheckerStats_t Stats[ES_NUM_EVENT_CHECKERS];
+  uint64_t StatsCycles; // cycles since the stats were reset
+  uint32_t LastCycles;  // _HW_GetCycles() when StatsCycles was brought up
+} CheckEventsData_t;
+
+static CheckEventsData_t Instances[ES_NUM_INSTANCES];
+
+#define Me ES_THIS(Instances)
+
+static void CountCycles( void );
 
 // Implementation for public functions
 
+/****************************************************************************
+ Function
+   ES_InitEventCheckers
+ Parameters
+   None
+ Returns
+   nothing
+ Description
+   puts the checkers in priority order and makes them all due now
+ Notes
+   called from ES_Initialize, after the timers are started
+ Author
+   J. He, 10/19/26, 16:15
+****************************************************************************/
+void ES_InitEventCheckers( void )
+{
+  uint8_t i;
+  uint8_t j;
+  uint16_t Now = ES_Timer_GetTime();
+
+  // an insertion sort keeps list order for the same priority
+  for ( i=0; i< ARRAY_SIZE(ES_EventList); i++) {
+    for ( j=i; (j > 0) && (ES_EventList[CheckOrder[j-1]].Priority <
+                           ES_EventList[i].Priority); j--)
+      CheckOrder[j] = CheckOrder[j-1];
+    CheckOrder[j] = i;
+    Me->NextDue[i] = Now;
+  }
+  ES_ResetCheckerStats();
+}
+
 /****************************************************************************
  Function
    ES_CheckUserEvents
@@ -37,24 +118,184 @@ static CheckFunc * const ES_EventList[]={EVENT_CHECK_LIST };
  Returns
    bool: true if any of the user event checkers returned true, false otherwise
  Description
-   loop through the EF_EventList array executing the event checking functions
+   loop through the EF_EventList array executing the event checking
+   functions that are due, highest priority first
  Notes
-   
+   a checker that finds an event is due again a Period from now, the ones
+   after it that were not called stay due for the next pass
  Author
    J. Edward Carryer, 10/25/11, 08:55
 ****************************************************************************/
-bool ES_CheckUserEvents( void ) 
+bool ES_CheckUserEvents( void )
 {
   uint8_t i;
+  uint8_t Which;
+  uint16_t Now = ES_Timer_GetTime();
+  uint32_t Start;
+  uint32_t Cycles;
+  bool Found;
+  ES_CheckerStats_t *pStats;
+
+  CountCycles();
   // loop through the array executing the event checking functions
   for ( i=0; i< ARRAY_SIZE(ES_EventList); i++) {
-    if ( ES_EventList[i]() == true )
-      break; // found a new event, so process it first
+    Which = CheckOrder[i];
+    if ( (int16_t)(Now - Me->NextDue[Which]) < 0 )
+      continue; // not due yet
+    Me->NextDue[Which] = Now + ES_EventList[Which].Period;
+    Start = _HW_GetCycles();
+    Found = ES_EventList[Which].CheckerFunc();
+    Cycles = _HW_GetCycles() - Start;
+    pStats = &Me->Stats[Which];
+    pStats->NumChecks++;
+    pStats->TotalCycles += Cycles;
+    if ( Cycles > pStats->MaxCycles )
+      pStats->MaxCycles = Cycles;
+    if ( Found == true ) {
+      pStats->NumEvents++;
+      return true; // found a new event, so process it first
+    }
+  }
+  return false; // no new events
+}
+
+/****************************************************************************
+ Function
+   ES_GetTicksToNextCheck
+ Parameters
+   None
+ Returns
+   uint16_t : the ticks until the next checker with a period is due, at
+              least 1, or ES_Timer_NO_TIMEOUT if none of them has one
+ Description
+   tells ES_Run how long it may sleep before it has to call the checkers
+ Notes
+   a checker with a period of 0 is called whenever ES_Run wakes up, as it
+   always was, so it does not cut the sleep short
+ Author
+   J. He, 10/19/26, 16:18
+****************************************************************************/
+uint16_t ES_GetTicksToNextCheck( void )
+{
+  uint8_t i;
+  uint16_t Now = ES_Timer_GetTime();
+  uint16_t TicksToNext = ES_Timer_NO_TIMEOUT;
+  int16_t Ahead;
+
+  for ( i=0; i< ARRAY_SIZE(ES_EventList); i++) {
+    if ( ES_EventList[i].Period == 0 )
+      continue;
+    Ahead = (int16_t)(Me->NextDue[i] - Now);
+    if ( Ahead < 1 )
+      Ahead = 1; // due now, so in the next tick at the latest
+    if ( (uint16_t)Ahead < TicksToNext )
+      TicksToNext = (uint16_t)Ahead;
+  }
+  return TicksToNext;
+}
+
+/****************************************************************************
+ Function
+   ES_GetCheckerStats
+ Parameters
+   ES_CheckerId_t WhichChecker : the ES_CHECK_<name> of the checker
+   ES_CheckerStats_t * pStats : where to put the statistics
+ Returns
+   boolean : False if there is no such checker
+ Description
+   copies out the call counts & the time taken by one checker
+ Notes
+   the checkers are only called from ES_Run, so called from a service the
+   statistics are consistent
+ Author
+   J. He, 10/19/26, 16:21
+****************************************************************************/
+bool ES_GetCheckerStats( ES_CheckerId_t WhichChecker,
+                         ES_CheckerStats_t * pStats )
+{
+  if ( (unsigned)WhichChecker >= ES_NUM_EVENT_CHECKERS )
+    return false;
+  *pStats = Me->Stats[WhichChecker];
+  return true;
+}
+
+/****************************************************************************
+ Function
+   ES_ResetCheckerStats
+ Parameters
+   None
+ Returns
+   nothing
+ Description
+   clears the statistics for all the checkers and starts a new period for
+   the CPU load
+ Notes
+
+ Author
+   J. He, 10/19/26, 16:24
+****************************************************************************/
+void ES_ResetCheckerStats( void )
+{
+  uint8_t i;
+  static const ES_CheckerStats_t Empty = { 0 };
+
+  for ( i=0; i< ARRAY_SIZE(ES_EventList); i++)
+    Me->Stats[i] = Empty;
+  Me->StatsCycles = 0;
+  Me->LastCycles = _HW_GetCycles();
+}
+
+/****************************************************************************
+ Function
+   ES_DumpCheckerStats
+ Parameters
+   None
+ Returns
+   nothing
+ Description
+   prints the calls, the events found, the mean & longest call and the
+   share of the CPU of every checker on the console, the times in uS
+ Notes
+   the load is in tenths of a percent of the time since the last reset
+ Author
+   J. He, 10/19/26, 16:27
+****************************************************************************/
+void ES_DumpCheckerStats( void )
+{
+  uint8_t i;
+  uint64_t Elapsed;
+  uint32_t Load;
+  ES_CheckerStats_t *pStats;
+
+  CountCycles();
+  Elapsed = Me->StatsCycles;
+  printf("event checker stats (uS)\r\n");
+  printf("    checks     events       mean        max   load  checker\r\n");
+  for ( i=0; i< ARRAY_SIZE(ES_EventList); i++) {
+    pStats = &Me->Stats[i];
+    Load = (Elapsed == 0) ? 0 :
+             (uint32_t)((pStats->TotalCycles * 1000) / Elapsed);
+    printf("%10lu %10lu %10lu %10lu %3lu.%lu%%  %s\r\n",
+           (unsigned long)pStats->NumChecks,
+           (unsigned long)pStats->NumEvents,
+           (unsigned long)((pStats->NumChecks == 0) ? 0 :
+             pStats->TotalCycles / pStats->NumChecks / ES_CYCLES_PER_US),
+           (unsigned long)(pStats->MaxCycles / ES_CYCLES_PER_US),
+           (unsigned long)(Load / 10), (unsigned long)(Load % 10),
+           CheckerNames[i]);
   }
-  if ( i == ARRAY_SIZE(ES_EventList) ) // if no new events
-    return (false);
-  else
-    return(true);
+}
+
+//*********************************
+// private functions
+//*********************************
+// adds the cycles since the last call to StatsCycles
+static void CountCycles( void )
+{
+  uint32_t Now = _HW_GetCycles();
+
+  Me->StatsCycles += (uint32_t)(Now - Me->LastCycles);
+  Me->LastCycles = Now;
 }
 /*------------------------------- Footnotes -------------------------------*/
 /*------------------------------ End of file ------------------------------*/
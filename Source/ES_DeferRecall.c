@@ -11,7 +11,11 @@
  History
  When           Who     What/Why
  -------------- ---     --------
- 
+ 10/17/26 21:40 jh      events are deferred FIFO and recalled by splicing the
+                        whole deferral queue onto the front of the service's
+                        queue in one go
+ 10/17/26 20:10 jh      ES_DeferEvent is now a function that holds a reference
+                        to any payload while the event is deferred
  10/11/14 14:58 jec     converted RecallEvent to RecallEvents to pull all
                         deferred events off the deferral queue
  11/02/13 16:38 jec      Began Coding
@@ -35,6 +39,30 @@
 /*---------------------------- Module Variables ---------------------------*/
 
 /*------------------------------ Module Code ------------------------------*/
+/****************************************************************************
+ Function
+     ES_DeferEvent
+ Parameters
+      ES_Event * pBlock, pointer to the block of memory that implements the
+        Defer/Recall queue
+      ES_Event Event2Add, the event to be deferred
+ Returns
+     bool true if the event fit in the queue, false if not
+ Description
+     adds Event2Add to the end of the deferral queue
+ Notes
+     the framework drops its reference to a payload when the run function
+     that deferred the event returns, so the deferral queue takes its own
+ Author
+     J. He, 10/17/26 20:48
+****************************************************************************/
+bool ES_DeferEvent( ES_Event * pBlock, ES_Event Event2Add ){
+  if ( ES_EnQueueFIFO( pBlock, Event2Add ) != true )
+    return false;
+  ES_PayloadAddRef( Event2Add );
+  return true;
+}
+
 /****************************************************************************
  Function
      ES_RecallEvents
@@ -45,28 +73,18 @@
  Returns
      bool true if an event was recalled, false if no event was left in queue
  Description
-     pulls all events off the deferral queue if any are available. If there was
-     something in the queue, then it posts it LIFO fashion to the queue 
-     indicated by WhichService
+     moves all the events on the deferral queue to the front of the queue
+     indicated by WhichService, in the order they were deferred, so they are
+     handled before anything posted since
  Notes
-     None.
+     the move is one splice in a single critical section. If the service's
+     queue can not take them all, the newest are left on the deferral queue.
  Author
      J. Edward Carryer, 11/20/13 16:49
 ****************************************************************************/
 bool ES_RecallEvents( uint8_t WhichService, ES_Event * pBlock ){
-  ES_Event RecalledEvent;
-	bool WereEventsPulled = false;
-  // recall any events from the queue
-  do
-	{	
-		ES_DeQueue( pBlock, &RecalledEvent );
-		if (RecalledEvent.EventType != ES_NO_EVENT){
-			ES_PostToServiceLIFO( WhichService, RecalledEvent);
-			WereEventsPulled = true;
-		}
-  }while(RecalledEvent.EventType != ES_NO_EVENT);
-  return WereEventsPulled;
-  
+  // the deferral queue's payload references go with the events
+  return ( ES_SpliceToService( WhichService, pBlock ) > 0 );
 }
   
 /*------------------------------- Footnotes -------------------------------*/
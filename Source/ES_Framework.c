@@ -8,6 +8,47 @@
  History
  When           Who     What/Why
  -------------- ---     --------
+ 10/21/26 13:10 jh       zero the stats in ES_DumpStarvationStats, for gcc
+ 10/20/26 10:20 jh       the ISR post count is 32 bits, 256 posts between
+                         drains no longer hide them
+ 10/19/26 19:36 jh       with ES_STARVATION_GUARD, a listed service that has
+                         waited too many dispatches runs ahead of its priority
+ 10/19/26 16:37 jh       start the event checker schedule in ES_Initialize and
+                         sleep no longer than the next checker is due
+ 10/19/26 14:05 jh       with ES_CYCLIC, ES_Run is a cyclic executive that runs
+                         the slots of a fixed schedule on the tick and the
+                         services in what is left of each frame
+ 10/19/26 10:27 jh       with ES_THREADS, the services run on a pool of worker
+                         threads on the host, posted through lock-free queues
+ 10/18/26 17:11 jh       with ES_PREEMPTIVE, a post to a higher priority
+                         service preempts the running one, through ES_Preempt
+ 10/18/26 11:48 jh       with ES_RUN_PROFILE, ES_Run times each run function
+                         call and keeps the min, mean & max per service and
+                         per event type
+ 10/18/26 09:43 jh       the queues & the rest of the state are kept for each
+                         robot (ES_NUM_INSTANCES), added ES_RunUntilIdle, and
+                         ES_SelectInstance & ES_RunInstances for the host
+ 10/17/26 23:00 jh       log the posts made from ISRs for replay on the host
+ 10/17/26 22:00 jh       record posts, drops & dispatches in the flight recorder
+                         and dump it when a run function fails
+ 10/17/26 21:40 jh       added ES_SpliceToService for the batch recall
+ 10/17/26 21:00 jh       the Ready word type moved to ES_Framework.h
+ 10/17/26 20:10 jh       keep the payload reference counts as events are
+                         queued and dispatched
+ 10/17/26 18:50 jh       ServDescList & the queues are generated from
+                         ES_SERVICE_LIST, Ready is 32 or 64 bits to match
+ 10/17/26 18:20 jh       ES_Run sleeps in _HW_Idle until the next timeout or
+                         interrupt when there is nothing to do, and keeps
+                         track of the idle time
+ 10/17/26 16:45 jh       ES_Run tells the timers when an ES_TIMEOUT is
+                         dispatched so periodic timers can post again
+ 10/17/26 14:55 jh       with ES_LATENCY_STATS, posts are timestamped and
+                         ES_Run keeps a log2 histogram per priority of how
+                         long each event waited before dispatch
+ 10/17/26 13:50 jh       count posts & dropped posts per service and added the
+                         functions to read, reset and dump the queue stats
+ 10/17/26 12:55 jh       posts made from an ISR now go through a lock-free
+                         mailbox per service that ES_Run drains into the queues
  11/02/13 17:05 jec      added PostToServiceLIFO function
  10/21/13 17:50 jec      added entries to expand number of possible services to 
                          16
@@ -26,8 +67,10 @@
 #include "ES_Configure.h"
 #include "ES_Framework.h"
 #include "ES_Queue.h"
+#include "ES_Mailbox.h"
 #include "ES_LookupTables.h"
 #include <stdio.h>
+#include <stddef.h>
 
 // Include the header files for the Service modules.
 // This gets you the prototypes for the public service functions.
@@ -50,178 +93,330 @@ typedef struct {
 }ES_ServDesc_t;
 
 typedef struct {
-    ES_Event *pMem;       // pointer to the memory
+    uint16_t Offset;   // where the memory is in FrameworkData_t
     uint8_t Size;      // how big is it
 }ES_QueueDesc_t;
 
-/*---------------------------- Module Functions ---------------------------*/
-//static bool CheckSystemEvents( void );
+// the Ready word has a bit for each service
+typedef ES_ServiceSet_t ES_Ready_t;
+#define GetHighestReady(x) ES_GetHighestService(x)
+#define ReadyMask(Priority) ES_ServiceBit(Priority)
 
-/*---------------------------- Module Variables ---------------------------*/
-/****************************************************************************/
-// You fill in this array with the names of the service init & run functions
-// for each service that you use.
-// The order is: InitFunction, RunFunction
-// The first entry, at index 0, is the lowest priority, with increasing
-// priority with higher indices
+#ifdef ES_PREEMPTIVE
+#if ES_NUM_INSTANCES > 1
+#error ES_PREEMPTIVE is for a single robot
+#endif
+// ActivePriority is 0 at the level of ES_Run, the priority + 1 of the
+// service whose run function is running, or this while the queues are
+// being worked on and nothing may preempt
+#define PREEMPT_LOCKED 0xFF
 
-static ES_ServDesc_t const ServDescList[] =
-{ {SERV_0_INIT, SERV_0_RUN } /* lowest priority  always present */
-#if NUM_SERVICES > 1
-  ,{SERV_1_INIT, SERV_1_RUN }
+// the task level code that works on the queues & Ready holds off
+// preemption, then lets in anything that was posted in the meantime
+#define LockPreempt(Saved) \
+  { (Saved) = Me->ActivePriority; Me->ActivePriority = PREEMPT_LOCKED; }
+#define UnlockPreempt(Saved) \
+  { Me->ActivePriority = (Saved); ES_Preempt(); }
+#else
+#define LockPreempt(Saved)
+#define UnlockPreempt(Saved)
 #endif
-#if NUM_SERVICES > 2
-  ,{SERV_2_INIT, SERV_2_RUN }
+
+#if ES_THREADS > 0
+#ifdef ES_PREEMPTIVE
+#error ES_PREEMPTIVE and ES_THREADS can not be used together
 #endif
-#if NUM_SERVICES > 3
-  ,{SERV_3_INIT, SERV_3_RUN }
+// each worker thread runs one service at a time, the counts it keeps for
+// the statistics are shared with the other threads so they are locked
+#define CurrentService ThreadService
+#define MarkReady(Service, NumAdded) ListService( (Service), (NumAdded) )
+#define LockStats() EnterCritical()
+#define UnlockStats() ExitCritical()
+#else
+// the service whose run function is running, the source of its posts
+#define CurrentService (Me->RunningService)
+#define MarkReady(Service, NumAdded) (Me->Ready |= ReadyMask(Service))
+#define LockStats()
+#define UnlockStats()
 #endif
-#if NUM_SERVICES > 4
-  ,{SERV_4_INIT, SERV_4_RUN }
+
+#ifdef ES_STARVATION_GUARD
+#if defined(ES_PREEMPTIVE) || (ES_THREADS > 0)
+#error ES_STARVATION_GUARD can not be used with ES_PREEMPTIVE or ES_THREADS
 #endif
-#if NUM_SERVICES > 5
-  ,{SERV_5_INIT, SERV_5_RUN }
+// the services are picked by PickService, which keeps the guard's counts
+#define NextService() PickService()
+#define ES_COUNT_GUARD(Name, MaxWaits) +1
+#define NUM_GUARDS (0 ES_STARVATION_GUARD_LIST(ES_COUNT_GUARD))
+#else
+#define NextService() GetHighestReady(Me->Ready)
 #endif
-#if NUM_SERVICES > 6
-  ,{SERV_6_INIT, SERV_6_RUN }
+
+#ifdef ES_CYCLIC
+#if defined(ES_PREEMPTIVE) || (ES_THREADS > 0)
+#error ES_CYCLIC can not be used with ES_PREEMPTIVE or ES_THREADS
 #endif
-#if NUM_SERVICES > 7
-  ,{SERV_7_INIT, SERV_7_RUN }
+#if ES_NUM_INSTANCES > 1
+#error ES_CYCLIC is for a single robot
 #endif
-#if NUM_SERVICES > 8
-  ,{SERV_8_INIT, SERV_8_RUN }
+// each slot must come round the same way in every major frame
+#define ES_CYCLIC_SLOT_CHECK(Func, Period, Phase) \
+  ES_STATIC_ASSERT( ((ES_CYCLIC_MINOR_FRAMES % (Period)) == 0) && \
+                    ((Phase) < (Period)), Func##_FitsMajorFrame );
+ES_CYCLIC_SCHEDULE(ES_CYCLIC_SLOT_CHECK)
+
+// the frames are timed with the clock and the slots with the cycle counter
+ES_STATIC_ASSERT( ES_CLOCK_TICKS_PER_US == ES_CYCLES_PER_US,
+                  CyclicClockMatchesCycles );
+#define CYCLIC_BUDGET ((uint32_t)ES_CYCLIC_BUDGET_US * ES_CLOCK_TICKS_PER_US)
 #endif
-#if NUM_SERVICES > 9
-  ,{SERV_9_INIT, SERV_9_RUN }
+
+/*---------------------------- Module Functions ---------------------------*/
+//static bool CheckSystemEvents( void );
+static bool PostFromISR( uint8_t WhichService, ES_Event ThisEvent );
+static bool DrainMailboxes( void );
+#ifdef ES_STARVATION_GUARD
+static uint8_t PickService( void );
 #endif
-#if NUM_SERVICES > 10
-  ,{SERV_10_INIT, SERV_10_RUN }
+#ifdef ES_CYCLIC
+static ES_Return_t RunLeftover( uint32_t FrameStart );
+static void WaitForFrame( uint16_t FrameTick );
+#else
+static uint16_t TicksToWake( void );
+static void IdleSleep( void );
 #endif
-#if NUM_SERVICES > 11
-  ,{SERV_11_INIT, SERV_11_RUN }
+#if ES_THREADS == 0
+static ES_Return_t Dispatch( uint8_t WhichService );
 #endif
-#if NUM_SERVICES > 12
-  ,{SERV_12_INIT, SERV_12_RUN }
+static ES_Return_t RunEvent( uint8_t WhichService, ES_Event ThisEvent );
+#if ES_THREADS > 0
+static bool PostToThread( uint8_t WhichService, ES_Event ThisEvent,
+                          uint8_t Source );
+static void ListService( uint8_t WhichService, uint8_t NumAdded );
+static void RunThreadWork( uint16_t Instance, uint8_t WhichService );
+static ES_Return_t RunThreads( uint16_t First, uint16_t Count );
 #endif
-#if NUM_SERVICES > 13
-  ,{SERV_13_INIT, SERV_13_RUN }
+static void CountPost( uint8_t WhichService, ES_Event ThisEvent, bool WasPosted,
+                       uint8_t Source );
+#ifdef ES_LATENCY_STATS
+static void RecordLatency( uint8_t WhichService, ES_Event ThisEvent );
 #endif
-#if NUM_SERVICES > 14
-  ,{SERV_14_INIT, SERV_14_RUN }
+#ifdef ES_RUN_PROFILE
+static void RecordRunTime( uint8_t WhichService, ES_Event ThisEvent,
+                           uint32_t Cycles );
+static void AddToProfile( ES_RunProfile_t * pProfile, uint32_t Cycles,
+                          uint16_t With );
+static void PrintProfile( ES_RunProfile_t * pProfile );
 #endif
-#if NUM_SERVICES > 15
-  ,{SERV_15_INIT, SERV_15_RUN }
+
+/*---------------------------- Module Variables ---------------------------*/
+/****************************************************************************/
+// This array is filled in from ES_SERVICE_LIST in ES_Configure.h with the
+// names of the service init & run functions for each service that you use.
+// The order is: InitFunction, RunFunction
+// The first entry, at index 0, is the lowest priority, with increasing
+// priority with higher indices
+
+#define ES_SERVICE_DESC(Name, QueueSize) { Init##Name, Run##Name },
+
+static ES_ServDesc_t const ServDescList[] =
+{ 
+  ES_SERVICE_LIST(ES_SERVICE_DESC)
+};
+
+#ifdef ES_STARVATION_GUARD
+/****************************************************************************/
+// The services kept from starving, filled in from ES_STARVATION_GUARD_LIST
+// in ES_Configure.h, with the priority of each found from ES_SERVICE_LIST
+
+#define ES_SERVICE_PRIORITY(Name, QueueSize) PRIORITY_##Name,
+enum { ES_SERVICE_LIST(ES_SERVICE_PRIORITY) };
+
+typedef struct {
+    uint8_t Service;    // the priority of the service
+    uint16_t MaxWaits;  // the dispatches it may wait for, 0 for no limit
+} ES_GuardDesc_t;
+
+#define ES_STARVATION_GUARD_DESC(Name, MaxWaits) \
+  { PRIORITY_##Name, MaxWaits },
+
+static ES_GuardDesc_t const Guards[NUM_GUARDS] =
+{
+  ES_STARVATION_GUARD_LIST(ES_STARVATION_GUARD_DESC)
+};
+
+// the names of the services, for ES_DumpStarvationStats
+#define ES_STARVATION_GUARD_NAME(Name, MaxWaits) #Name,
+static const char * const GuardNames[NUM_GUARDS] = {
+  ES_STARVATION_GUARD_LIST(ES_STARVATION_GUARD_NAME)
+};
 #endif
 
+#ifdef ES_CYCLIC
+/****************************************************************************/
+// The schedule of the cyclic executive, filled in from ES_CYCLIC_SCHEDULE in
+// ES_Configure.h. A slot runs in the minor frames whose number, counted
+// from the start of the major frame, is Phase more than a multiple of
+// Period.
+
+#define ES_CYCLIC_SLOT_PROTO(Func, Period, Phase) void Func( void );
+ES_CYCLIC_SCHEDULE(ES_CYCLIC_SLOT_PROTO)
+
+typedef struct {
+    void (*SlotFunc)( void );
+    uint16_t Period;
+    uint16_t Phase;
+} CyclicSlotDesc_t;
+
+#define ES_CYCLIC_SLOT_DESC(Func, Period, Phase) { Func, Period, Phase },
+
+static CyclicSlotDesc_t const CyclicSchedule[ES_NUM_CYCLIC_SLOTS] =
+{
+  ES_CYCLIC_SCHEDULE(ES_CYCLIC_SLOT_DESC)
+};
+
+// the names of the slots, for ES_DumpCyclicStats
+#define ES_CYCLIC_SLOT_NAME(Func, Period, Phase) #Func,
+static const char * const CyclicSlotNames[ES_NUM_CYCLIC_SLOTS] = {
+  ES_CYCLIC_SCHEDULE(ES_CYCLIC_SLOT_NAME)
 };
+#endif
 
 
 /****************************************************************************/
+// Everything from here on is kept for each robot, see ES_Instance.h
+
 // The queues for the services
 
-static ES_Event Queue0[SERV_0_QUEUE_SIZE+1];
-#if NUM_SERVICES > 1
-static ES_Event Queue1[SERV_1_QUEUE_SIZE+1];
-#endif
-#if NUM_SERVICES > 2
-static ES_Event Queue2[SERV_2_QUEUE_SIZE+1];
-#endif
-#if NUM_SERVICES > 3
-static ES_Event Queue3[SERV_3_QUEUE_SIZE+1];
-#endif
-#if NUM_SERVICES > 4
-static ES_Event Queue4[SERV_4_QUEUE_SIZE+1];
-#endif
-#if NUM_SERVICES > 5
-static ES_Event Queue5[SERV_5_QUEUE_SIZE+1];
-#endif
-#if NUM_SERVICES > 6
-static ES_Event Queue6[SERV_6_QUEUE_SIZE+1];
-#endif
-#if NUM_SERVICES > 7
-static ES_Event Queue7[SERV_7_QUEUE_SIZE+1];
-#endif
-#if NUM_SERVICES > 8
-static ES_Event Queue8[SERV_8_QUEUE_SIZE+1];
+#define ES_SERVICE_QUEUE(Name, QueueSize) \
+  ES_Event Queue##Name[QueueSize+1];
+
+typedef struct {
+  ES_SERVICE_LIST(ES_SERVICE_QUEUE)
+
+  // the mailboxes that carry events posted from ISRs, one per service
+  ES_Event MailboxSlots[NUM_SERVICES][ES_MAILBOX_SIZE];
+  ES_Mailbox_t Mailboxes[NUM_SERVICES];
+
+  // bumped by every post from an ISR. Only ISRs write it and only ES_Run
+  // reads it, so ES_Run can tell that there is something to drain without a
+  // lock. 32 bits, so that it can not come round to the same value
+  // between two drains, whatever the number & size of the mailboxes
+  volatile uint32_t ISRPostCount;
+  // the value of ISRPostCount when the mailboxes were last drained
+  uint32_t DrainedPostCount;
+
+  // the service whose run function is running, the source of its posts
+  uint8_t RunningService;
+
+#if ES_THREADS > 0
+  // the queues that the worker threads take the events for each service
+  // from, and how many events each service has waiting to run, including
+  // any on its ES_Queue. The service is listed for a worker when that
+  // count goes up from 0, and the worker runs it until it is back to 0.
+  ES_Event ThreadSlots[NUM_SERVICES][ES_THREAD_QUEUE_SIZE];
+  uint32_t ThreadSeqs[NUM_SERVICES][ES_THREAD_QUEUE_SIZE];
+  ES_MPMailbox_t ThreadBoxes[NUM_SERVICES];
+  volatile uint32_t NumWaiting[NUM_SERVICES];
+  // FailedRun once a run function has failed on one of the workers
+  volatile ES_Return_t ThreadResult;
 #endif
-#if NUM_SERVICES > 9
-static ES_Event Queue9[SERV_9_QUEUE_SIZE+1];
+
+#ifdef ES_PREEMPTIVE
+  // the level that is running, see PREEMPT_LOCKED, and set by an ISR that
+  // posted or ticked so that ES_Preempt looks at the queues again
+  volatile uint8_t ActivePriority;
+  volatile bool PreemptRequested;
+  // FailedRun once a run function has failed, for ES_Run to return
+  ES_Return_t RunResult;
+  // true while the event checkers run, they may hold unposted payloads
+  bool CheckingEvents;
 #endif
-#if NUM_SERVICES > 10
-static ES_Event Queue10[SERV_10_QUEUE_SIZE+1];
+
+  // time spent asleep in _HW_Idle, and when the count was started, in
+  // ES_Timer_GetClock units
+  uint64_t IdleClocks;
+  uint64_t IdleStatsStart;
+
+  // post & drop counts for each service queue. The ISR mailbox drops are
+  // counted by the ISRs and so are kept apart from the counts made by
+  // ES_Run; a reset only moves the baseline for them.
+  uint32_t NumPosts[NUM_SERVICES];
+  uint32_t NumDropped[NUM_SERVICES];
+  ES_Event LastDropped[NUM_SERVICES];
+  volatile uint16_t NumMailboxDropped[NUM_SERVICES];
+  uint16_t MailboxDroppedBase[NUM_SERVICES];
+
+#ifdef ES_MAILBOX_CHECK
+  // the NVIC priority of the first ISR that posted, the others must match
+  bool ISRPrioritySet;
+  uint8_t ISRPriority;
 #endif
-#if NUM_SERVICES > 11
-static ES_Event Queue11[SERV_11_QUEUE_SIZE+1];
+
+#ifdef ES_LATENCY_STATS
+  // post-to-dispatch latency histograms, one per priority level
+  ES_LatencyStats_t LatencyStats[NUM_SERVICES];
 #endif
-#if NUM_SERVICES > 12
-static ES_Event Queue12[SERV_12_QUEUE_SIZE+1];
+
+#ifdef ES_RUN_PROFILE
+  // time spent in the run functions, by service and by event type
+  ES_RunProfile_t ServiceProfile[NUM_SERVICES];
+  ES_RunProfile_t EventProfile[ES_NUM_EVENT_TYPES];
 #endif
-#if NUM_SERVICES > 13
-static ES_Event Queue13[SERV_13_QUEUE_SIZE+1];
+
+#ifdef ES_STARVATION_GUARD
+  // the dispatches each guarded service has waited through since it last
+  // ran or had nothing to do, and the longest & the number of limits hit
+  uint16_t GuardWaits[NUM_GUARDS];
+  uint32_t LongestWait[NUM_GUARDS];
+  uint32_t NumStarved[NUM_GUARDS];
 #endif
-#if NUM_SERVICES > 14
-static ES_Event Queue14[SERV_14_QUEUE_SIZE+1];
+
+#ifdef ES_CYCLIC
+  // timing of the frames & the slots of the cyclic executive
+  ES_CyclicStats_t CyclicStats;
 #endif
-#if NUM_SERVICES > 15
-static ES_Event Queue15[SERV_15_QUEUE_SIZE+1];
+
+  // Variable used to keep track of which queues have events in them
+  ES_Ready_t Ready;
+} FrameworkData_t;
+
+#ifdef ES_PREEMPTIVE
+// nothing may run until ES_Initialize is done
+static FrameworkData_t Instances[ES_NUM_INSTANCES] =
+  ES_INSTANCE_INIT({ .RunningService = ES_TRACE_NO_SERVICE,
+                     .ActivePriority = PREEMPT_LOCKED });
+#else
+static FrameworkData_t Instances[ES_NUM_INSTANCES] =
+  ES_INSTANCE_INIT({ .RunningService = ES_TRACE_NO_SERVICE });
 #endif
 
+#define Me ES_THIS(Instances)
+
 /****************************************************************************/
-// array of queue descriptors for posting by priority level
+// array of queue descriptors for posting by priority level, the queues are
+// found at the same offset in each robot's FrameworkData_t
+
+#define ES_SERVICE_QUEUE_DESC(Name, QueueSize) \
+  { offsetof(FrameworkData_t, Queue##Name), QueueSize+1 },
 
 static ES_QueueDesc_t const EventQueues[NUM_SERVICES] = { 
-  { Queue0, ARRAY_SIZE(Queue0) } 
-#if NUM_SERVICES > 1
-, { Queue1, ARRAY_SIZE(Queue1) }
-#endif
-#if NUM_SERVICES > 2
-, { Queue2, ARRAY_SIZE(Queue2) }
-#endif
-#if NUM_SERVICES > 3
-, { Queue3, ARRAY_SIZE(Queue3) }
-#endif
-#if NUM_SERVICES > 4
-, { Queue4, ARRAY_SIZE(Queue4) }
-#endif
-#if NUM_SERVICES > 5
-, { Queue5, ARRAY_SIZE(Queue5) }
-#endif
-#if NUM_SERVICES > 6
-, { Queue6, ARRAY_SIZE(Queue6) }
-#endif
-#if NUM_SERVICES > 7
-, { Queue7, ARRAY_SIZE(Queue7) }
-#endif
-#if NUM_SERVICES > 8
-, { Queue8, ARRAY_SIZE(Queue8) }
-#endif
-#if NUM_SERVICES > 9
-, { Queue9, ARRAY_SIZE(Queue9) }
-#endif
-#if NUM_SERVICES > 10
-, { Queue10, ARRAY_SIZE(Queue10) }
-#endif
-#if NUM_SERVICES > 11
-, { Queue11, ARRAY_SIZE(Queue11) }
-#endif
-#if NUM_SERVICES > 12
-, { Queue12, ARRAY_SIZE(Queue12) }
-#endif
-#if NUM_SERVICES > 13
-, { Queue13, ARRAY_SIZE(Queue13) }
-#endif
-#if NUM_SERVICES > 14
-, { Queue14, ARRAY_SIZE(Queue14) }
-#endif
-#if NUM_SERVICES > 15
-, { Queue15, ARRAY_SIZE(Queue15) }
-#endif
+  ES_SERVICE_LIST(ES_SERVICE_QUEUE_DESC)
 };
 
-/****************************************************************************/
-// Variable used to keep track of which queues have events in them
+// the queue of one service in the running robot's copy
+#define QueueMem(Service) \
+  ((ES_Event *)((uint8_t *)Me + EventQueues[Service].Offset))
+
+#if ES_NUM_INSTANCES > 1
+// the robot that is running, on each thread
+ES_THREAD_LOCAL uint16_t ES_ThisInstance;
+#endif
 
-uint16_t Ready;
+#if ES_THREADS > 0
+// the service that a worker thread is running
+static ES_THREAD_LOCAL uint8_t ThreadService = ES_TRACE_NO_SERVICE;
+#endif
 
 /*------------------------------ Module Code ------------------------------*/
 /****************************************************************************
@@ -242,17 +437,33 @@ uint16_t Ready;
 ES_Return_t ES_Initialize( TimerRate_t NewRate ){
   uint8_t i;
   ES_Timer_Init( NewRate); // start up the timer subsystem
+  ES_ResetIdleStats(); // and count idle time from here
+  ES_InitEventCheckers(); // the checkers are all due from here
+  ES_InitReplay( NewRate ); // and log the ISR posts from here
+  ES_InitPayloads(); // empty the payload pool
   // loop through the list testing for NULL pointers and
   for ( i=0; i< ARRAY_SIZE(ServDescList); i++) {
     if ( (ServDescList[i].InitFunc == (pInitFunc)0) ||
          (ServDescList[i].RunFunc == (pRunFunc)0) )
       return FailedPointer; // protect against NULL pointers
     // and initializing the event queues (must happen before running inits)  
-    ES_InitQueue( EventQueues[i].pMem, EventQueues[i].Size );
+    ES_InitQueue( QueueMem(i), EventQueues[i].Size );
+    if ( ES_InitMailbox( &Me->Mailboxes[i], Me->MailboxSlots[i], 
+                         ARRAY_SIZE(Me->MailboxSlots[i]) ) != true )
+      return FailedInit; // ES_MAILBOX_SIZE is not a power of 2
+#if ES_THREADS > 0
+    if ( ES_InitMPMailbox( &Me->ThreadBoxes[i], Me->ThreadSlots[i],
+                           Me->ThreadSeqs[i], ES_THREAD_QUEUE_SIZE ) != true )
+      return FailedInit; // ES_THREAD_QUEUE_SIZE is not a power of 2
+#endif
    // executing the init functions
     if ( ServDescList[i].InitFunc(i) != true )
       return FailedInit; // this is a failed initialization
   }
+#ifdef ES_PREEMPTIVE
+  // the events posted by the inits wait for ES_Run
+  Me->ActivePriority = 0;
+#endif
   return Success;
 }
 
@@ -271,34 +482,427 @@ ES_Return_t ES_Initialize( TimerRate_t NewRate ){
    user generated events.
  Notes
    this function only returns in case of an error
+   with ES_CYCLIC the fixed schedule of ES_RunCyclic runs in its place
  Author
    J. Edward Carryer, 10/23/11,
 ****************************************************************************/
 ES_Return_t ES_Run( void ){
-  // make these static to improve speed
+#ifdef ES_CYCLIC
+  return ES_RunCyclic();
+#else
+  ES_Return_t Result;
+
+  while(1){ // stay here unless we detect an error condition
+    Result = ES_RunUntilIdle();
+    if ( Result != Success )
+      return Result;
+    // nothing found, sleep until the next timeout or interrupt
+    IdleSleep();
+    ES_CollectPayloads();
+  }
+#endif
+}
+
+/****************************************************************************
+ Function
+   ES_RunUntilIdle
+ Parameters
+   None
+ Returns
+   ES_Return_t : FailedRun if any of the run functions failed, otherwise
+                 Success once there is nothing left to do
+ Description
+   the body of ES_Run. Runs the services with a non-empty queue until all
+   the queues are empty and none of the event checkers find anything.
+ Notes
+   returns where ES_Run would go to sleep, so that a host simulation can
+   step several robots in turn.
+   With ES_PREEMPTIVE the services are run by ES_Preempt, here and after
+   every post, so the event checkers may be preempted too. The payloads
+   that were never posted are only collected where nothing is part way
+   through a run function or the event checkers.
+   With ES_THREADS the services run on the worker threads, see RunThreads.
+ Author
+   J. He, 10/18/26, 09:30
+****************************************************************************/
+ES_Return_t ES_RunUntilIdle( void ){
+#ifdef ES_PREEMPTIVE
+  while(1){
+    ES_Preempt(); // everything that is ready, highest priority first
+    if ( Me->RunResult != Success )
+      return Me->RunResult;
+    ES_CollectPayloads();
+
+    // all the queues are empty, so look for new user detected events
+    Me->CheckingEvents = true;
+    if ( ES_CheckUserEvents() == false ){
+      Me->CheckingEvents = false;
+      return Me->RunResult; // nothing found either
+    }
+    Me->CheckingEvents = false;
+    ES_CollectPayloads();
+  }
+#elif ES_THREADS > 0
+  return RunThreads( ES_INSTANCE, 1 );
+#else
   uint8_t HighestPrior;
-  static ES_Event ThisEvent;
   
-  while(1){ // stay here unless we detect an error condition
+  while(1){
 
     // loop through the list executing the run functions for services
-    // with a non-empty queue. Process any pending ints before testing
-    // Ready
-    while( (_HW_Process_Pending_Ints()) && (Ready != 0)){
-      HighestPrior =  ES_GetMSBitSet(Ready);
-      if ( ES_DeQueue( EventQueues[HighestPrior].pMem, &ThisEvent ) == 0 ){
-        Ready &= BitNum2ClrMask[HighestPrior]; // mark queue as now empty
+    // with a non-empty queue. Process any pending ints and move any events
+    // posted from ISRs onto the queues before testing Ready
+    while( (_HW_Process_Pending_Ints()) && (DrainMailboxes()) && 
+           (Me->Ready != 0)){
+      HighestPrior = NextService();
+      if ( Dispatch( HighestPrior ) != Success )
+        return FailedRun;
+      ES_CollectPayloads();
+    }
+
+    // all the queues are empty, so look for new user detected events
+    if ( ES_CheckUserEvents() == false ){
+      return Success; // nothing found either
+    }
+    ES_CollectPayloads();
+  }
+#endif
+}
+
+#ifdef ES_CYCLIC
+/****************************************************************************
+ Function
+   ES_RunCyclic
+ Parameters
+   None
+ Returns
+   ES_Return_t : FailedRun if any of the run functions failed
+ Description
+   the cyclic executive that ES_Run becomes with ES_CYCLIC. Each minor
+   frame starts on a tick and runs the slots of ES_CYCLIC_SCHEDULE that are
+   due in it, then the services and the event checkers in what is left of
+   ES_CYCLIC_BUDGET_US, then sleeps until the tick for the next frame.
+ Notes
+   this function only returns in case of an error.
+   The events still run to completion, so one that starts just inside the
+   budget holds up the next frame for as long as its run function takes.
+   With the budget no more than the frame less the longest run function
+   (see ES_RUN_PROFILE) no frame overruns, and each slot starts within the
+   wake-up time after its tick plus the longest runs of the slots ahead of
+   it in the table, which ES_DumpCyclicStats shows.
+   After an overrun the frames whose ticks have gone by are skipped, so the
+   slots keep their period in place of running back to back.
+ Author
+   J. He, 10/19/26, 13:40
+****************************************************************************/
+ES_Return_t ES_RunCyclic( void ){
+  uint16_t FrameTick;   // the tick the frame is due on
+  uint16_t Frame = 0;   // the minor frame within the major frame
+  uint16_t Late;
+  uint16_t Skipped;
+  uint32_t FrameStart;
+  uint32_t LastStart = 0;
+  uint32_t Interval;
+  uint32_t SlotStart;
+  uint32_t Cycles;
+  bool OnTime;          // the frame started from a wait for its tick
+  bool LastOnTime = false;
+  uint8_t i;
+
+  // line the first frame up with a tick
+  FrameTick = ES_Timer_GetTime() + 1;
+  WaitForFrame( FrameTick );
+  OnTime = true;
+
+  while(1){ // stay here unless we detect an error condition
+    FrameStart = (uint32_t)_HW_GetClock();
+    if ( (OnTime == true) && (LastOnTime == true) ){
+      Interval = FrameStart - LastStart;
+      if ( (Me->CyclicStats.MinInterval == 0) ||
+           (Interval < Me->CyclicStats.MinInterval) )
+        Me->CyclicStats.MinInterval = Interval;
+      if ( Interval > Me->CyclicStats.MaxInterval )
+        Me->CyclicStats.MaxInterval = Interval;
+    }
+    LastStart = FrameStart;
+    LastOnTime = OnTime;
+
+    // the fixed slots first, in the order of the table
+    for ( i = 0; i < ES_NUM_CYCLIC_SLOTS; i++ ){
+      if ( (Frame % CyclicSchedule[i].Period) == CyclicSchedule[i].Phase ){
+        SlotStart = _HW_GetCycles();
+        CyclicSchedule[i].SlotFunc();
+        Cycles = _HW_GetCycles() - SlotStart;
+        if ( Cycles > Me->CyclicStats.MaxSlotCycles[i] )
+          Me->CyclicStats.MaxSlotCycles[i] = Cycles;
+      }
+    }
+
+    // then the services, with whatever time is left
+    if ( RunLeftover( FrameStart ) != Success )
+      return FailedRun;
+    Me->CyclicStats.NumFrames++;
+
+    // on to the next frame, skipping any whose tick has gone by
+    FrameTick += ES_CYCLIC_MINOR_TICKS;
+    Frame++;
+    Late = (uint16_t)(ES_Timer_GetTime() - FrameTick);
+    if ( (int16_t)Late >= 0 ){
+      Me->CyclicStats.NumOverruns++;
+      Skipped = Late / ES_CYCLIC_MINOR_TICKS;
+      Me->CyclicStats.NumSkipped += Skipped;
+      FrameTick += Skipped * ES_CYCLIC_MINOR_TICKS;
+      Frame += Skipped;
+      OnTime = false;
+    }else{
+      WaitForFrame( FrameTick );
+      OnTime = true;
+    }
+    Frame %= ES_CYCLIC_MINOR_FRAMES;
+  }
+}
+
+/****************************************************************************
+ Function
+   ES_GetCyclicStats
+ Parameters
+   ES_CyclicStats_t * pStats : where to put the statistics
+ Returns
+   nothing
+ Description
+   copies out the frame & slot timing of the cyclic executive
+ Notes
+   only ES_RunCyclic writes them, so called from a service they are
+   consistent without turning ints off
+ Author
+   J. He, 10/19/26, 13:43
+****************************************************************************/
+void ES_GetCyclicStats( ES_CyclicStats_t * pStats ){
+  *pStats = Me->CyclicStats;
+}
+
+/****************************************************************************
+ Function
+   ES_ResetCyclicStats
+ Parameters
+   None
+ Returns
+   nothing
+ Description
+   clears the frame & slot timing of the cyclic executive
+ Notes
+
+ Author
+   J. He, 10/19/26, 13:46
+****************************************************************************/
+void ES_ResetCyclicStats( void ){
+  static const ES_CyclicStats_t Empty = { 0 };
+
+  Me->CyclicStats = Empty;
+}
+
+/****************************************************************************
+ Function
+   ES_DumpCyclicStats
+ Parameters
+   None
+ Returns
+   nothing
+ Description
+   prints the frame counts, the spread of the frame start intervals and
+   the longest run and latest start in the frame of each slot on the
+   console, the times in uS
+ Notes
+   the latest start of a slot adds up the longest runs of the slots ahead
+   of it, as in a frame where they are all due
+ Author
+   J. He, 10/19/26, 13:49
+****************************************************************************/
+void ES_DumpCyclicStats( void ){
+  ES_CyclicStats_t Stats;
+  uint32_t LatestStart = 0;
+  uint8_t i;
+
+  ES_GetCyclicStats( &Stats );
+  printf("cyclic executive, %lu frames, %lu overruns, %lu skipped, "
+         "%lu over budget\r\n", (unsigned long)Stats.NumFrames,
+         (unsigned long)Stats.NumOverruns, (unsigned long)Stats.NumSkipped,
+         (unsigned long)Stats.NumOverBudget);
+  printf("frame interval (uS) min %lu max %lu jitter %lu\r\n",
+         (unsigned long)(Stats.MinInterval / ES_CYCLES_PER_US),
+         (unsigned long)(Stats.MaxInterval / ES_CYCLES_PER_US),
+         (unsigned long)((Stats.MaxInterval - Stats.MinInterval) /
+                         ES_CYCLES_PER_US));
+  printf("   max run latest start  slot\r\n");
+  for ( i = 0; i < ES_NUM_CYCLIC_SLOTS; i++ ) {
+    printf("%10lu %12lu  %s\r\n",
+           (unsigned long)(Stats.MaxSlotCycles[i] / ES_CYCLES_PER_US),
+           (unsigned long)(LatestStart / ES_CYCLES_PER_US),
+           CyclicSlotNames[i]);
+    LatestStart += Stats.MaxSlotCycles[i];
+  }
+}
+#endif
+
+#ifdef ES_PREEMPTIVE
+/****************************************************************************
+ Function
+   ES_Preempt
+ Parameters
+   None
+ Returns
+   nothing
+ Description
+   runs the tick responses, moves the events posted from ISRs to the
+   queues and then runs every service that has an event and a higher
+   priority than the one it preempted, highest first, until there are no
+   more of them
+ Notes
+   called at task level, never from an ISR: at the end of every post, by
+   ES_RunUntilIdle, and by the port once the last ISR that posted (or the
+   tick) is done, through PendSV on the Tiva. Each event runs to
+   completion, but its run function can in turn be preempted by a higher
+   priority service. Does nothing while the queues are locked, the holder
+   of the lock calls it again when it lets go.
+ Author
+   J. He, 10/18/26, 16:40
+****************************************************************************/
+void ES_Preempt( void ){
+  uint8_t Preempted;
+  uint8_t HighestPrior;
+
+  Preempted = Me->ActivePriority;
+  if ( (Preempted == PREEMPT_LOCKED) || (Me->RunResult != Success) )
+    return;
+  Me->ActivePriority = PREEMPT_LOCKED;
+  while(1){
+    Me->PreemptRequested = false;
+    _HW_Process_Pending_Ints();
+    DrainMailboxes();
+    // service HighestPrior runs at ActivePriority HighestPrior + 1
+    if ( (Me->Ready != 0) && 
+         ((HighestPrior = GetHighestReady(Me->Ready)) >= Preempted) ){
+      if ( Dispatch( HighestPrior ) != Success ){
+        Me->RunResult = FailedRun;
+        break;
       }
-      if( ServDescList[HighestPrior].RunFunc(ThisEvent).EventType != 
-                                                              ES_NO_EVENT) {
-              return FailedRun;
+      // with nothing part way through below, the blocks that the run
+      // function left unposted can go back
+      if ( (Preempted == 0) && (Me->CheckingEvents == false) )
+        ES_CollectPayloads();
+    }else{
+      // an ISR that posts after this sees the level we preempted, and
+      // preempts it in turn
+      EnterCritical();   // save interrupt state, turn ints off
+      if ( Me->PreemptRequested == false ){
+        Me->ActivePriority = Preempted;
+        ExitCritical();  // restore saved interrupt state
+        return;
       }
+      ExitCritical();  // restore saved interrupt state
     }
+  }
+  Me->ActivePriority = Preempted;
+}
 
-    // all the queues are empty, so look for new user detected events
-    ES_CheckUserEvents();
+/****************************************************************************
+ Function
+   ES_RequestPreempt
+ Parameters
+   None
+ Returns
+   nothing
+ Description
+   asks the port to call ES_Preempt once the ISRs are done
+ Notes
+   called from ISRs, by the posts from them and by the tick
+ Author
+   J. He, 10/18/26, 16:43
+****************************************************************************/
+void ES_RequestPreempt( void ){
+  Me->PreemptRequested = true;
+  _HW_RequestPreempt();
+}
+#endif
+
+#if ES_NUM_INSTANCES > 1
+/****************************************************************************
+ Function
+   ES_SelectInstance
+ Parameters
+   uint16_t : the robot, 0 to ES_NUM_INSTANCES-1
+ Returns
+   boolean : False if there is no such robot
+ Description
+   makes Instance the robot whose state the framework and the services use
+   from here on
+ Notes
+   only call it between calls to ES_Initialize or ES_RunUntilIdle, with
+   no interrupt running
+ Author
+   J. He, 10/18/26, 09:33
+****************************************************************************/
+bool ES_SelectInstance( uint16_t Instance ){
+  if ( Instance >= ES_NUM_INSTANCES )
+    return false;
+  ES_ThisInstance = Instance;
+  return true;
+}
+
+/****************************************************************************
+ Function
+   ES_RunInstances
+ Parameters
+   uint16_t : how many ticks of the shared clock to run for
+ Returns
+   ES_Return_t : FailedRun if a run function failed, with that robot left
+                 selected, otherwise Success once the time is up
+ Description
+   runs every robot in turn until it is idle, then sleeps until the first
+   timeout of any of them, over and over until Ticks have gone by
+ Notes
+   each robot must have been through ES_Initialize. With ES_VIRTUAL_CLOCK
+   the sleep is a jump of the clock, so the run goes as fast as the
+   services do. With ES_THREADS the robots all run at once, spread over
+   the worker threads.
+ Author
+   J. He, 10/18/26, 09:36
+****************************************************************************/
+ES_Return_t ES_RunInstances( uint16_t Ticks ){
+  uint16_t StartTime;
+  uint16_t Elapsed;
+  uint16_t TicksToTimeout;
+  uint16_t TicksToNext;
+  uint16_t Instance;
+
+  StartTime = ES_Timer_GetTime();
+  while(1){
+    TicksToTimeout = ES_Timer_NO_TIMEOUT;
+#if ES_THREADS > 0
+    if ( RunThreads( 0, ES_NUM_INSTANCES ) != Success )
+      return FailedRun;
+#endif
+    for ( Instance=0; Instance< ES_NUM_INSTANCES; Instance++) {
+      ES_ThisInstance = Instance;
+#if ES_THREADS == 0
+      if ( ES_RunUntilIdle() != Success )
+        return FailedRun;
+#endif
+      TicksToNext = TicksToWake();
+      if ( TicksToNext < TicksToTimeout )
+        TicksToTimeout = TicksToNext;
+    }
+    Elapsed = ES_Timer_GetTime() - StartTime;
+    if ( Elapsed >= Ticks )
+      return Success;
+    if ( TicksToTimeout > Ticks - Elapsed )
+      TicksToTimeout = Ticks - Elapsed;
+    EnterCritical();   // save interrupt state, turn ints off
+    _HW_Idle( TicksToTimeout );
+    ExitCritical();  // restore saved interrupt state
   }
 }
+#endif
 
 /****************************************************************************
  Function
@@ -317,14 +921,39 @@ ES_Return_t ES_Run( void ){
 bool ES_PostAll( ES_Event ThisEvent){
 
   uint8_t i;
+#ifdef ES_PREEMPTIVE
+  uint8_t Preempted = PREEMPT_LOCKED; // only used outside of an ISR
+#endif
+#ifdef ES_LATENCY_STATS
+  ThisEvent.PostTime = _HW_GetTimestamp();
+#endif
+#ifdef ES_PREEMPTIVE
+  if ( _HW_IsInISR() == false )
+    LockPreempt( Preempted );
+#endif
   // loop through the list executing the post functions
   for ( i=0; i< ARRAY_SIZE(EventQueues); i++) {
-    if ( ES_EnQueueFIFO( EventQueues[i].pMem, ThisEvent ) != true ){
+    if ( _HW_IsInISR() ){
+      if ( PostFromISR( i, ThisEvent ) != true )
+        break; // this is a failed post
+#if ES_THREADS > 0
+    }else if ( PostToThread( i, ThisEvent, CurrentService ) != true ){
+      break; // this is a failed post
+#else
+    }else if ( ES_EnQueueFIFO( QueueMem(i), ThisEvent ) != true ){
+      CountPost( i, ThisEvent, false, CurrentService );
       break; // this is a failed post
     }else{
-      Ready |= BitNum2SetMask[i]; // show queue as non-empty
+      Me->Ready |= ReadyMask(i); // show queue as non-empty
+      CountPost( i, ThisEvent, true, CurrentService );
+      ES_PayloadAddRef( ThisEvent );
+#endif
     }
   }
+#ifdef ES_PREEMPTIVE
+  if ( _HW_IsInISR() == false )
+    UnlockPreempt( Preempted );
+#endif
   if ( i == ARRAY_SIZE(EventQueues) ){ // if no failures
     return (true);
   }else{
@@ -344,17 +973,44 @@ bool ES_PostAll( ES_Event ThisEvent){
    posts to one of the services' queues
  Notes
    used by the timer library to associate a timer with a state machine
+   when called from an ISR, the event goes into the service's mailbox and
+   ES_Run moves it to the queue, so the ISR never turns interrupts off
+   with ES_PREEMPTIVE, a service of higher priority than the caller runs
+   before this returns
+   with ES_THREADS, the event goes into the service's lock-free queue and a
+   worker thread may be running it before this returns
  Author
    J. Edward Carryer, 01/16/12,
 ****************************************************************************/
 bool ES_PostToService( uint8_t WhichService, ES_Event TheEvent){
+  bool WasPosted;
+#ifdef ES_PREEMPTIVE
+  uint8_t Preempted;
+#endif
+#ifdef ES_LATENCY_STATS
+  TheEvent.PostTime = _HW_GetTimestamp();
+#endif
+  if ( _HW_IsInISR() ){
+    return PostFromISR( WhichService, TheEvent );
+  }
+#if ES_THREADS > 0
+  WasPosted = PostToThread( WhichService, TheEvent, CurrentService );
+#else
+  LockPreempt( Preempted );
   if ((WhichService < ARRAY_SIZE(EventQueues)) &&
-      (ES_EnQueueFIFO( EventQueues[WhichService].pMem, TheEvent) == 
+      (ES_EnQueueFIFO( QueueMem(WhichService), TheEvent) == 
                                                                 true )){
-    Ready |= BitNum2SetMask[WhichService]; // show queue as non-empty
-    return true;
-  } else
-    return false;
+    Me->Ready |= ReadyMask(WhichService); // show queue as non-empty
+    CountPost( WhichService, TheEvent, true, CurrentService );
+    ES_PayloadAddRef( TheEvent );
+    WasPosted = true;
+  } else {
+    CountPost( WhichService, TheEvent, false, CurrentService );
+    WasPosted = false;
+  }
+  UnlockPreempt( Preempted );
+#endif
+  return WasPosted;
 }
 
 /****************************************************************************
@@ -369,22 +1025,1184 @@ bool ES_PostToService( uint8_t WhichService, ES_Event TheEvent){
    Posts, using LIFO strategy, to one of the services' queues
  Notes
    used by the Defer/Recall event capability
+   with ES_THREADS, only the service itself may post this way, as
+   ES_RecallEvents does, since the queue is not safe for other threads
  Author
    J. Edward Carryer, 11/02/13
 ****************************************************************************/
 bool ES_PostToServiceLIFO( uint8_t WhichService, ES_Event TheEvent){
+  bool WasPosted;
+#ifdef ES_PREEMPTIVE
+  uint8_t Preempted;
+#endif
+#ifdef ES_LATENCY_STATS
+  TheEvent.PostTime = _HW_GetTimestamp();
+#endif
+  LockPreempt( Preempted );
   if ((WhichService < ARRAY_SIZE(EventQueues)) &&
-      (ES_EnQueueLIFO( EventQueues[WhichService].pMem, TheEvent) == 
+      (ES_EnQueueLIFO( QueueMem(WhichService), TheEvent) == 
                                                                 true )){
-    Ready |= BitNum2SetMask[WhichService]; // show queue as non-empty
-    return true;
-  } else
-    return false;
+    MarkReady( WhichService, 1 ); // show queue as non-empty
+    CountPost( WhichService, TheEvent, true, CurrentService );
+    ES_PayloadAddRef( TheEvent );
+    WasPosted = true;
+  } else {
+    CountPost( WhichService, TheEvent, false, CurrentService );
+    WasPosted = false;
+  }
+  UnlockPreempt( Preempted );
+  return WasPosted;
 }
 
-//*********************************
-// private functions
-//*********************************
+/****************************************************************************
+ Function
+   ES_SpliceToService
+ Parameters
+   uint8_t : Which service to post to (index into ServDescList)
+   ES_Event * : the block of memory of the Queue holding the events
+ Returns
+   uint8_t : the number of events moved to the service's queue
+ Description
+   moves the events in the Queue to the front of the service's queue, in
+   the same order, so the oldest of them is the next one the service sees
+ Notes
+   used by ES_RecallEvents. Events that do not fit stay in the Queue.
+   Any payload references move with the events.
+   Recalled events keep the PostTime from when they were first posted.
+   With ES_THREADS, only the service itself may splice to its queue.
+ Author
+   J. He, 10/17/26, 21:42
+****************************************************************************/
+uint8_t ES_SpliceToService( uint8_t WhichService, ES_Event * pBlock ){
+  uint8_t NumMoved;
+#ifdef ES_PREEMPTIVE
+  uint8_t Preempted;
+#endif
+
+  if ( WhichService >= ARRAY_SIZE(EventQueues) )
+    return 0;
+  LockPreempt( Preempted );
+  NumMoved = ES_SpliceToFront( QueueMem(WhichService), pBlock );
+  if ( NumMoved > 0 ){
+    MarkReady( WhichService, NumMoved ); // show queue as non-empty
+    LockStats();
+    Me->NumPosts[WhichService] += NumMoved;
+    UnlockStats();
+  }
+  UnlockPreempt( Preempted );
+  return NumMoved;
+}
+
+/****************************************************************************
+ Function
+   ES_GetQueueStats
+ Parameters
+   uint8_t : Which service's queue to report on (index into ServDescList)
+   ES_QueueStats_t * : where to put the statistics
+ Returns
+   boolean : False if WhichService does not exist
+ Description
+   fills in the size, high-water mark, post & drop counts and the last
+   dropped event for the queue of one service
+ Notes
+   posts from ISRs are counted when ES_Run moves them to the queue, or by
+   the ISR if the mailbox was full. LastDropped only reflects the queue.
+   With ES_THREADS the size & peak are those of the queue for LIFO posts,
+   the others go through a queue of ES_THREAD_QUEUE_SIZE.
+ Author
+   J. He, 10/17/26, 13:58
+****************************************************************************/
+bool ES_GetQueueStats( uint8_t WhichService, ES_QueueStats_t * pStats ){
+  uint16_t MailboxDrops;
+
+  if ( WhichService >= ARRAY_SIZE(EventQueues) )
+    return false;
+  MailboxDrops = (uint16_t)(Me->NumMailboxDropped[WhichService] - 
+                            Me->MailboxDroppedBase[WhichService]);
+  pStats->QueueSize = EventQueues[WhichService].Size - 1;
+  pStats->PeakEntries = ES_GetQueuePeak( QueueMem(WhichService) );
+  pStats->NumPosts = Me->NumPosts[WhichService] + MailboxDrops;
+  pStats->NumDropped = Me->NumDropped[WhichService] + MailboxDrops;
+  pStats->LastDropped = Me->LastDropped[WhichService];
+  return true;
+}
+
+/****************************************************************************
+ Function
+   ES_ResetQueueStats
+ Parameters
+   None
+ Returns
+   nothing
+ Description
+   clears the counts and restarts the high-water marks for all the queues
+ Notes
+
+ Author
+   J. He, 10/17/26, 14:02
+****************************************************************************/
+void ES_ResetQueueStats( void ){
+  uint8_t i;
+
+  for ( i=0; i< ARRAY_SIZE(EventQueues); i++) {
+    ES_ResetQueuePeak( QueueMem(i) );
+    Me->NumPosts[i] = 0;
+    Me->NumDropped[i] = 0;
+    Me->LastDropped[i].EventType = ES_NO_EVENT;
+    Me->LastDropped[i].EventParam = 0;
+    Me->MailboxDroppedBase[i] = Me->NumMailboxDropped[i];
+  }
+}
+
+/****************************************************************************
+ Function
+   ES_DumpQueueStats
+ Parameters
+   None
+ Returns
+   nothing
+ Description
+   prints the statistics for every service queue to the console
+ Notes
+   event types are printed as numbers, look them up in ES_Configure.h
+ Author
+   J. He, 10/17/26, 14:05
+****************************************************************************/
+void ES_DumpQueueStats( void ){
+  uint8_t i;
+  ES_QueueStats_t Stats;
+
+  printf("Queue stats\r\n");
+  printf("serv size peak      posts    dropped  last dropped\r\n");
+  for ( i=0; i< ARRAY_SIZE(EventQueues); i++) {
+    ES_GetQueueStats( i, &Stats );
+    printf("%4u %4u %4u %10lu %10lu", i, Stats.QueueSize, Stats.PeakEntries,
+           (unsigned long)Stats.NumPosts, (unsigned long)Stats.NumDropped);
+    if ( Stats.LastDropped.EventType != ES_NO_EVENT ){
+      printf("  type %u, param %u", Stats.LastDropped.EventType,
+             Stats.LastDropped.EventParam);
+    }
+    printf("\r\n");
+  }
+}
+
+/****************************************************************************
+ Function
+   ES_GetIdlePercent
+ Parameters
+   None
+ Returns
+   uint8_t : percentage of the time since ES_ResetIdleStats (or since the
+   clock started) that ES_Run spent asleep with nothing to do
+ Description
+   100 minus this is the CPU load
+ Notes
+
+ Author
+   J. He, 10/17/26, 18:28
+****************************************************************************/
+uint8_t ES_GetIdlePercent( void ){
+  uint64_t Elapsed = _HW_GetClock() - Me->IdleStatsStart;
+
+  if ( Elapsed == 0 )
+    return 0;
+  return (uint8_t)((Me->IdleClocks * 100) / Elapsed);
+}
+
+/****************************************************************************
+ Function
+   ES_ResetIdleStats
+ Parameters
+   None
+ Returns
+   nothing
+ Description
+   starts a new measurement period for ES_GetIdlePercent
+ Notes
+
+ Author
+   J. He, 10/17/26, 18:30
+****************************************************************************/
+void ES_ResetIdleStats( void ){
+  Me->IdleClocks = 0;
+  Me->IdleStatsStart = _HW_GetClock();
+}
+
+#ifdef ES_STARVATION_GUARD
+/****************************************************************************
+ Function
+   ES_GetStarvationStats
+ Parameters
+   uint8_t : the priority of the service to report on
+   ES_StarvationStats_t * pStats : where to put the statistics
+ Returns
+   boolean : False if the service is not in ES_STARVATION_GUARD_LIST
+ Description
+   copies out how long the service has waited to be dispatched
+ Notes
+   only ES_Run writes them, so called from a service they are consistent
+ Author
+   J. He, 10/19/26, 19:20
+****************************************************************************/
+bool ES_GetStarvationStats( uint8_t WhichService,
+                            ES_StarvationStats_t * pStats ){
+  uint8_t i;
+
+  for ( i=0; i< NUM_GUARDS; i++) {
+    if ( Guards[i].Service == WhichService ){
+      pStats->MaxWaits = Guards[i].MaxWaits;
+      pStats->LongestWait = Me->LongestWait[i];
+      pStats->NumStarved = Me->NumStarved[i];
+      return true;
+    }
+  }
+  return false;
+}
+
+/****************************************************************************
+ Function
+   ES_ResetStarvationStats
+ Parameters
+   None
+ Returns
+   nothing
+ Description
+   clears the longest waits & the starved counts of the guarded services
+ Notes
+   the waits that are under way carry on counting
+ Author
+   J. He, 10/19/26, 19:23
+****************************************************************************/
+void ES_ResetStarvationStats( void ){
+  uint8_t i;
+
+  for ( i=0; i< NUM_GUARDS; i++) {
+    Me->LongestWait[i] = 0;
+    Me->NumStarved[i] = 0;
+  }
+}
+
+/****************************************************************************
+ Function
+   ES_DumpStarvationStats
+ Parameters
+   None
+ Returns
+   nothing
+ Description
+   prints the limit, the longest wait and the starved count of every
+   guarded service on the console
+ Notes
+
+ Author
+   J. He, 10/19/26, 19:26
+****************************************************************************/
+void ES_DumpStarvationStats( void ){
+  uint8_t i;
+  ES_StarvationStats_t Stats = { 0 };
+
+  printf("Starvation stats (dispatches)\r\n");
+  printf("serv  limit    longest    starved  service\r\n");
+  for ( i=0; i< NUM_GUARDS; i++) {
+    ES_GetStarvationStats( Guards[i].Service, &Stats );
+    printf("%4u %6u %10lu %10lu  %s\r\n", Guards[i].Service, Stats.MaxWaits,
+           (unsigned long)Stats.LongestWait, (unsigned long)Stats.NumStarved,
+           GuardNames[i]);
+  }
+}
+#endif
+
+#ifdef ES_LATENCY_STATS
+/****************************************************************************
+ Function
+   ES_GetLatencyStats
+ Parameters
+   uint8_t : Which service to report on (index into ServDescList)
+   ES_LatencyStats_t * : where to put the histogram
+ Returns
+   boolean : False if WhichService does not exist
+ Description
+   copies out the post-to-dispatch latency histogram for one priority level
+ Notes
+
+ Author
+   J. He, 10/17/26, 15:02
+****************************************************************************/
+bool ES_GetLatencyStats( uint8_t WhichService, ES_LatencyStats_t * pStats ){
+  if ( WhichService >= ARRAY_SIZE(Me->LatencyStats) )
+    return false;
+  *pStats = Me->LatencyStats[WhichService];
+  return true;
+}
+
+/****************************************************************************
+ Function
+   ES_ResetLatencyStats
+ Parameters
+   None
+ Returns
+   nothing
+ Description
+   clears the latency histograms for all the services
+ Notes
+
+ Author
+   J. He, 10/17/26, 15:04
+****************************************************************************/
+void ES_ResetLatencyStats( void ){
+  uint8_t i;
+  uint8_t Bin;
+
+  for ( i=0; i< ARRAY_SIZE(Me->LatencyStats); i++) {
+    for ( Bin=0; Bin< ES_LATENCY_BINS; Bin++)
+      Me->LatencyStats[i].Bins[Bin] = 0;
+    Me->LatencyStats[i].MaxWait = 0;
+    Me->LatencyStats[i].MaxType = ES_NO_EVENT;
+  }
+}
+
+/****************************************************************************
+ Function
+   ES_DumpLatencyStats
+ Parameters
+   None
+ Returns
+   nothing
+ Description
+   prints the non-empty bins of each service's latency histogram to the
+   console, labelled with the upper bound of each bin in uS
+ Notes
+
+ Author
+   J. He, 10/17/26, 15:07
+****************************************************************************/
+void ES_DumpLatencyStats( void ){
+  uint8_t i;
+  uint8_t Bin;
+
+  printf("Post to dispatch latency (uS)\r\n");
+  for ( i=0; i< ARRAY_SIZE(Me->LatencyStats); i++) {
+    printf("serv %u, max %lu (type %lu):", i, 
+           (unsigned long)Me->LatencyStats[i].MaxWait,
+           (unsigned long)Me->LatencyStats[i].MaxType);
+    for ( Bin=0; Bin< ES_LATENCY_BINS; Bin++) {
+      if ( Me->LatencyStats[i].Bins[Bin] != 0 ){
+        if ( Bin == ES_LATENCY_BINS - 1 )
+          printf(" >=%lu:%lu", 1UL << (Bin - 1), 
+                 (unsigned long)Me->LatencyStats[i].Bins[Bin]);
+        else
+          printf(" <%lu:%lu", 1UL << Bin, 
+                 (unsigned long)Me->LatencyStats[i].Bins[Bin]);
+      }
+    }
+    printf("\r\n");
+  }
+}
+#endif
+
+#ifdef ES_RUN_PROFILE
+/****************************************************************************
+ Function
+   ES_GetServiceProfile
+ Parameters
+   uint8_t : Which service to report on (index into ServDescList)
+   ES_RunProfile_t * : where to put the profile
+ Returns
+   boolean : False if WhichService does not exist
+ Description
+   copies out the run function times for one service
+ Notes
+   MinCycles is only meaningful once NumRuns is not 0
+ Author
+   J. He, 10/18/26, 11:20
+****************************************************************************/
+bool ES_GetServiceProfile( uint8_t WhichService, ES_RunProfile_t * pProfile ){
+  if ( WhichService >= ARRAY_SIZE(Me->ServiceProfile) )
+    return false;
+  *pProfile = Me->ServiceProfile[WhichService];
+  return true;
+}
+
+/****************************************************************************
+ Function
+   ES_GetEventProfile
+ Parameters
+   uint16_t : the event type to report on
+   ES_RunProfile_t * : where to put the profile
+ Returns
+   boolean : False if there is no such event type
+ Description
+   copies out the run function times for the calls made with one event type,
+   whichever service they went to
+ Notes
+
+ Author
+   J. He, 10/18/26, 11:23
+****************************************************************************/
+bool ES_GetEventProfile( uint16_t EventType, ES_RunProfile_t * pProfile ){
+  if ( EventType >= ARRAY_SIZE(Me->EventProfile) )
+    return false;
+  *pProfile = Me->EventProfile[EventType];
+  return true;
+}
+
+/****************************************************************************
+ Function
+   ES_ResetRunProfile
+ Parameters
+   None
+ Returns
+   nothing
+ Description
+   clears the run function times for all the services and event types
+ Notes
+
+ Author
+   J. He, 10/18/26, 11:26
+****************************************************************************/
+void ES_ResetRunProfile( void ){
+  uint16_t i;
+  static const ES_RunProfile_t Empty = { 0 };
+
+  for ( i=0; i< ARRAY_SIZE(Me->ServiceProfile); i++)
+    Me->ServiceProfile[i] = Empty;
+  for ( i=0; i< ARRAY_SIZE(Me->EventProfile); i++)
+    Me->EventProfile[i] = Empty;
+}
+
+/****************************************************************************
+ Function
+   ES_DumpRunProfile
+ Parameters
+   None
+ Returns
+   nothing
+ Description
+   prints the run function times in uS for every service, then for every
+   event type that has been dispatched, to the console
+ Notes
+   event types are printed as numbers, look them up in ES_Configure.h.
+   The times include any interrupt responses that ran during the call.
+ Author
+   J. He, 10/18/26, 11:29
+****************************************************************************/
+void ES_DumpRunProfile( void ){
+  uint16_t i;
+
+  printf("Run function times (uS)\r\n");
+  printf("serv       runs    min   mean    max  total mS  max with type\r\n");
+  for ( i=0; i< ARRAY_SIZE(Me->ServiceProfile); i++) {
+    printf("%4u ", i);
+    PrintProfile( &Me->ServiceProfile[i] );
+  }
+  printf("type       runs    min   mean    max  total mS  max in serv\r\n");
+  for ( i=0; i< ARRAY_SIZE(Me->EventProfile); i++) {
+    if ( Me->EventProfile[i].NumRuns != 0 ){
+      printf("%4u ", i);
+      PrintProfile( &Me->EventProfile[i] );
+    }
+  }
+}
+#endif
+
+//*********************************
+// private functions
+//*********************************
+/****************************************************************************
+ Function
+   PostFromISR
+ Parameters
+   uint8_t : Which service to post to (index into ServDescList)
+   ES_Event : The Event to be posted
+ Returns
+   boolean : False if the service does not exist or its mailbox is full
+ Description
+   interrupt side of a post, puts the event in the service's mailbox
+ Notes
+   the mailbox holds a reference to any payload until the event is moved
+   Ready is not touched here, DrainMailboxes sets it when the event is moved
+   every post is logged for replay, the replay meets the same full mailbox
+   with ES_MAILBOX_CHECK a post from an ISR at another priority than the
+   first one is dropped, it would be a second producer for the mailbox
+ Author
+   J. He, 10/17/26, 13:02
+****************************************************************************/
+static bool PostFromISR( uint8_t WhichService, ES_Event ThisEvent ){
+#ifdef ES_MAILBOX_CHECK
+  bool SamePriority = true;
+
+  if ( Me->ISRPrioritySet == false ){
+    Me->ISRPriority = _HW_GetISRPriority();
+    Me->ISRPrioritySet = true;
+  }else if ( _HW_GetISRPriority() != Me->ISRPriority ){
+    SamePriority = false;
+  }
+#else
+  const bool SamePriority = true;
+#endif
+
+  ES_ReplayRecordPost( WhichService, ThisEvent );
+  if ((WhichService < ARRAY_SIZE(Me->Mailboxes)) && (SamePriority == true) &&
+      (ES_MailboxPut( &Me->Mailboxes[WhichService], ThisEvent ) == true )){
+    ES_PayloadAddRef( ThisEvent );
+    ES_TraceRecord( ES_TRACE_POST, ES_TRACE_ISR, WhichService, 0, ThisEvent );
+    Me->ISRPostCount++;
+#ifdef ES_PREEMPTIVE
+    ES_RequestPreempt();
+#endif
+    return true;
+  } else {
+    if ( WhichService < ARRAY_SIZE(Me->Mailboxes) )
+      Me->NumMailboxDropped[WhichService]++;
+    ES_TraceRecord( ES_TRACE_DROP, ES_TRACE_ISR, WhichService, 0, ThisEvent );
+    return false;
+  }
+}
+
+#ifdef ES_STARVATION_GUARD
+/****************************************************************************
+ Function
+   PickService
+ Parameters
+   None
+ Returns
+   uint8_t : the priority of the service to dispatch next, which has an
+             event
+ Description
+   picks the highest priority service with an event, unless a guarded
+   service has waited its limit, then that one goes first. Counts a wait
+   for every other guarded service that has an event.
+ Notes
+   called with Ready non-zero. When more than one guarded service is at
+   its limit, the highest priority of them goes first.
+ Author
+   J. He, 10/19/26, 19:29
+****************************************************************************/
+static uint8_t PickService( void ){
+  uint8_t Highest;
+  uint8_t Chosen;
+  bool FoundStarved = false;
+  uint8_t i;
+
+  Highest = GetHighestReady(Me->Ready);
+  Chosen = Highest;
+  for ( i=0; i< NUM_GUARDS; i++) {
+    if ( ((Me->Ready & ReadyMask(Guards[i].Service)) != 0) &&
+         (Guards[i].MaxWaits != 0) &&
+         (Me->GuardWaits[i] >= Guards[i].MaxWaits) &&
+         ((FoundStarved == false) || (Guards[i].Service > Chosen)) ){
+      Chosen = Guards[i].Service;
+      FoundStarved = true;
+    }
+  }
+
+  for ( i=0; i< NUM_GUARDS; i++) {
+    if ( Guards[i].Service == Chosen ){
+      if ( Chosen != Highest )
+        Me->NumStarved[i]++; // run ahead of its priority
+      Me->GuardWaits[i] = 0;
+    }else if ( (Me->Ready & ReadyMask(Guards[i].Service)) != 0 ){
+      if ( Me->GuardWaits[i] < UINT16_MAX )
+        Me->GuardWaits[i]++;
+      if ( Me->GuardWaits[i] > Me->LongestWait[i] )
+        Me->LongestWait[i] = Me->GuardWaits[i];
+    }else{
+      Me->GuardWaits[i] = 0; // nothing to wait with
+    }
+  }
+  return Chosen;
+}
+#endif
+
+/****************************************************************************
+ Function
+   DrainMailboxes
+ Parameters
+   None
+ Returns
+   always true, so that it can be used in the loop test in ES_Run
+ Description
+   moves any events posted from ISRs out of the mailboxes and onto the
+   corresponding service queues, marking those queues as non-empty
+ Notes
+   the count is sampled before draining, so a post that lands while we are
+   draining is either picked up now or seen on the next pass
+   with ES_THREADS the events go to the worker threads' queues instead
+ Author
+   J. He, 10/17/26, 13:06
+****************************************************************************/
+static bool DrainMailboxes( void ){
+  uint32_t CurrentPostCount;
+  uint8_t i;
+  ES_Event ThisEvent;
+
+  CurrentPostCount = Me->ISRPostCount;
+  if ( CurrentPostCount != Me->DrainedPostCount ){
+    Me->DrainedPostCount = CurrentPostCount;
+    for ( i=0; i< ARRAY_SIZE(Me->Mailboxes); i++) {
+      while ( ES_MailboxGet( &Me->Mailboxes[i], &ThisEvent ) == true ){
+#if ES_THREADS > 0
+        PostToThread( i, ThisEvent, ES_TRACE_ISR );
+#else
+        if ( ES_EnQueueFIFO( QueueMem(i), ThisEvent ) == true ){
+          Me->Ready |= ReadyMask(i); // show queue as non-empty
+          CountPost( i, ThisEvent, true, ES_TRACE_ISR );
+        }else{
+          CountPost( i, ThisEvent, false, ES_TRACE_ISR );
+          ES_PayloadRelease( ThisEvent ); // the mailbox's reference
+        }
+#endif
+      }
+    }
+  }
+  return true;
+}
+
+#if ES_THREADS == 0
+/****************************************************************************
+ Function
+   Dispatch
+ Parameters
+   uint8_t : the priority of the service to run, which has an event
+ Returns
+   ES_Return_t : FailedRun if the run function failed, otherwise Success
+ Description
+   takes the next event off the service's queue and passes it to the
+   service's run function
+ Notes
+   the event is a local so that, with ES_PREEMPTIVE, a dispatch can run
+   inside another
+ Author
+   J. He, 10/18/26, 16:46
+****************************************************************************/
+static ES_Return_t Dispatch( uint8_t WhichService ){
+  ES_Event ThisEvent;
+
+  if ( ES_DeQueue( QueueMem(WhichService), &ThisEvent ) == 0 ){
+    Me->Ready &= ~ReadyMask(WhichService); // mark queue as now empty
+  }
+  return RunEvent( WhichService, ThisEvent );
+}
+#endif
+
+/****************************************************************************
+ Function
+   RunEvent
+ Parameters
+   uint8_t : the priority of the service to run
+   ES_Event : the event that was taken off its queue
+ Returns
+   ES_Return_t : FailedRun if the run function failed, otherwise Success
+ Description
+   passes the event to the service's run function, with the statistics &
+   the flight recorder kept up to date around it
+ Notes
+   with ES_PREEMPTIVE the queues are locked except while the run function
+   runs, when the service's own level is active. With ES_THREADS it is
+   called on a worker thread by RunThreadWork.
+ Author
+   J. He, 10/19/26, 09:50
+****************************************************************************/
+static ES_Return_t RunEvent( uint8_t WhichService, ES_Event ThisEvent ){
+  ES_Event ReturnEvent;
+  uint8_t Caller;
+#ifdef ES_RUN_PROFILE
+  uint32_t RunStart;
+#endif
+
+#ifdef ES_LATENCY_STATS
+  RecordLatency( WhichService, ThisEvent );
+#endif
+  if ( ThisEvent.EventType == ES_TIMEOUT )
+    ES_Timer_Dispatched( (uint8_t)ThisEvent.EventParam );
+  ES_TraceRecord( ES_TRACE_DISPATCH, ES_TRACE_NO_SERVICE, WhichService, 0,
+                  ThisEvent );
+  Caller = CurrentService;
+  CurrentService = WhichService;
+#ifdef ES_PREEMPTIVE
+  Me->ActivePriority = WhichService + 1;
+  ES_Preempt(); // anything higher that came in while the queues were locked
+#endif
+#ifdef ES_RUN_PROFILE
+  RunStart = _HW_GetCycles();
+#endif
+  ReturnEvent = ServDescList[WhichService].RunFunc(ThisEvent);
+#ifdef ES_RUN_PROFILE
+  RecordRunTime( WhichService, ThisEvent, _HW_GetCycles() - RunStart );
+#endif
+#ifdef ES_PREEMPTIVE
+  Me->ActivePriority = PREEMPT_LOCKED;
+#endif
+  CurrentService = Caller;
+  if( ReturnEvent.EventType != ES_NO_EVENT) {
+          // leave a record of how we got here
+          ES_TraceRecord( ES_TRACE_FAILED_RUN, ES_TRACE_NO_SERVICE,
+                          WhichService, 0, ReturnEvent );
+          ES_TraceDump();
+          return FailedRun;
+  }
+  // this service is done with any payload
+  ES_PayloadRelease( ThisEvent );
+  return Success;
+}
+
+#if ES_THREADS > 0
+/****************************************************************************
+ Function
+   PostToThread
+ Parameters
+   uint8_t : Which service to post to (index into ServDescList)
+   ES_Event : The Event to be posted
+   uint8_t : the service that posted it, or ES_TRACE_ISR when it is being
+             moved from a mailbox
+ Returns
+   boolean : False if the service does not exist or its queue is full
+ Description
+   puts the event in the service's lock-free queue and lists the service
+   for a worker thread if it was not waiting already
+ Notes
+   the queue's reference to a payload is taken before the put, since a
+   worker may be done with the event by the time the put returns. A
+   payload that made it nowhere goes back to the pool at once. An event
+   from a mailbox already holds the mailbox's reference.
+ Author
+   J. He, 10/19/26, 09:53
+****************************************************************************/
+static bool PostToThread( uint8_t WhichService, ES_Event ThisEvent,
+                          uint8_t Source ){
+  bool WasPosted = false;
+
+  if ( Source != ES_TRACE_ISR )
+    ES_PayloadAddRef( ThisEvent );
+  if ( WhichService < ARRAY_SIZE(Me->ThreadBoxes) )
+    WasPosted = ES_MPMailboxPut( &Me->ThreadBoxes[WhichService], ThisEvent );
+  CountPost( WhichService, ThisEvent, WasPosted, Source );
+  if ( WasPosted == true )
+    ListService( WhichService, 1 );
+  else
+    ES_PayloadRelease( ThisEvent );
+  return WasPosted;
+}
+
+/****************************************************************************
+ Function
+   ListService
+ Parameters
+   uint8_t : the service that has been posted to
+   uint8_t : how many events were added to its queues
+ Returns
+   nothing
+ Description
+   adds to the count of events the service has waiting, and hands it to the
+   worker threads if that count was 0
+ Notes
+   the events are counted once they are on the queue, so the count is
+   never more than the events there for a worker to take
+ Author
+   J. He, 10/19/26, 09:56
+****************************************************************************/
+static void ListService( uint8_t WhichService, uint8_t NumAdded ){
+  if ( __atomic_fetch_add( &Me->NumWaiting[WhichService], NumAdded,
+                           __ATOMIC_ACQ_REL ) == 0 )
+    _HW_ListWork( ES_INSTANCE, WhichService );
+}
+
+/****************************************************************************
+ Function
+   RunThreadWork
+ Parameters
+   uint16_t : the robot whose service is to run
+   uint8_t : the service to run
+ Returns
+   nothing
+ Description
+   called on a worker thread for a listed service. Runs its events, those
+   on its ES_Queue (the LIFO & recalled ones) first, until it has none
+   waiting.
+ Notes
+   a service is only ever listed once, so it never runs on two threads at
+   once and sees its events in the order they were posted. It only runs
+   as many events as have been counted, an event that is taken before its
+   poster counts it stands in for one that was counted and is still on the
+   queue. The queue reads empty while an earlier put to it is part way
+   through, so this spins until that put is done.
+   Once a run function has failed, the robot's events are thrown away
+   unrun so that the workers go idle and RunThreads can return FailedRun.
+ Author
+   J. He, 10/19/26, 09:59
+****************************************************************************/
+static void RunThreadWork( uint16_t Instance, uint8_t WhichService ){
+  ES_Event ThisEvent;
+  uint32_t NumToRun;
+  uint32_t NumRun;
+
+  (void)ES_SelectInstance( Instance );
+  NumToRun = __atomic_load_n( &Me->NumWaiting[WhichService],
+                              __ATOMIC_ACQUIRE );
+  do {
+    for ( NumRun = 0; NumRun < NumToRun; NumRun++ ){
+      if ( ES_IsQueueEmpty( QueueMem(WhichService) ) == false )
+        ES_DeQueue( QueueMem(WhichService), &ThisEvent );
+      else
+        while ( ES_MPMailboxGet( &Me->ThreadBoxes[WhichService],
+                                 &ThisEvent ) != true )
+          ; // a put is part way through
+      if ( Me->ThreadResult != Success )
+        ES_PayloadRelease( ThisEvent );
+      else if ( RunEvent( WhichService, ThisEvent ) != Success )
+        Me->ThreadResult = FailedRun;
+    }
+    // the events counted since, if any
+    NumToRun = __atomic_sub_fetch( &Me->NumWaiting[WhichService], NumRun,
+                                   __ATOMIC_ACQ_REL );
+  } while ( NumToRun != 0 );
+}
+
+/****************************************************************************
+ Function
+   RunThreads
+ Parameters
+   uint16_t : the first robot to run
+   uint16_t : how many robots to run, from First on
+ Returns
+   ES_Return_t : FailedRun if a run function failed, with that robot left
+                 selected, or if no worker thread could be started,
+                 otherwise Success once they are all idle
+ Description
+   ES_RunUntilIdle for ES_THREADS. Runs the tick responses and moves the
+   ISR posts on for each robot, which sets the worker threads going on the
+   services that were posted to, waits for the workers to finish, then
+   runs the event checkers of each robot. Over and over until there is
+   nothing left to do.
+ Notes
+   the ISRs, the tick responses and the event checkers run here, on the
+   thread that called ES_Run, and may overlap the services of any robot
+   just as an ISR would. The payloads that were never posted are only
+   collected while the workers are idle.
+ Author
+   J. He, 10/19/26, 10:02
+****************************************************************************/
+static ES_Return_t RunThreads( uint16_t First, uint16_t Count ){
+  uint16_t Instance;
+  bool MoreToDo;
+
+  if ( _HW_StartWorkers( RunThreadWork ) != true )
+    return FailedRun; // there is nothing to run the services on
+  do {
+    MoreToDo = false;
+    for ( Instance = First; Instance < First + Count; Instance++ ){
+      (void)ES_SelectInstance( Instance );
+      _HW_Process_Pending_Ints();
+      DrainMailboxes();
+    }
+    _HW_WaitWorkers();
+    for ( Instance = First; Instance < First + Count; Instance++ ){
+      (void)ES_SelectInstance( Instance );
+      if ( Me->ThreadResult != Success )
+        return FailedRun;
+      ES_CollectPayloads();
+      // look for new user detected events, and ISR posts made since
+      if ( (ES_CheckUserEvents() == true) ||
+           (Me->ISRPostCount != Me->DrainedPostCount) )
+        MoreToDo = true;
+    }
+  } while ( MoreToDo == true );
+  (void)ES_SelectInstance( First );
+  return Success;
+}
+#endif
+
+#ifdef ES_CYCLIC
+/****************************************************************************
+ Function
+   RunLeftover
+ Parameters
+   uint32_t : the clock at the start of the frame
+ Returns
+   ES_Return_t : FailedRun if a run function failed, otherwise Success
+ Description
+   the rest of a cyclic executive frame, runs the services with an event
+   and the event checkers as ES_RunUntilIdle does, until there is nothing
+   left to do or ES_CYCLIC_BUDGET_US into the frame
+ Notes
+   the budget is checked before each event, which then runs to completion.
+   Events left on the queues wait for the next frame.
+ Author
+   J. He, 10/19/26, 13:52
+****************************************************************************/
+static ES_Return_t RunLeftover( uint32_t FrameStart ){
+  while(1){
+    while( (_HW_Process_Pending_Ints()) && (DrainMailboxes()) &&
+           (Me->Ready != 0)){
+      if ( ((uint32_t)_HW_GetClock() - FrameStart) >= CYCLIC_BUDGET ){
+        Me->CyclicStats.NumOverBudget++;
+        return Success;
+      }
+      if ( Dispatch( NextService() ) != Success )
+        return FailedRun;
+      ES_CollectPayloads();
+    }
+
+    // all the queues are empty, so look for new user detected events
+    if ( (((uint32_t)_HW_GetClock() - FrameStart) >= CYCLIC_BUDGET) ||
+         (ES_CheckUserEvents() == false) )
+      return Success;
+    ES_CollectPayloads();
+  }
+}
+
+/****************************************************************************
+ Function
+   WaitForFrame
+ Parameters
+   uint16_t : the tick that the next frame is due on
+ Returns
+   nothing
+ Description
+   sleeps in _HW_Idle until the tick count gets to FrameTick, and adds the
+   time asleep to IdleClocks
+ Notes
+   the tick responses are run while waiting, so that _HW_Idle can sleep,
+   but the events they and the ISRs post wait for the frame
+ Author
+   J. He, 10/19/26, 13:55
+****************************************************************************/
+static void WaitForFrame( uint16_t FrameTick ){
+  uint16_t TicksLeft;
+  uint64_t SleepStart;
+
+  while(1){
+    _HW_Process_Pending_Ints();
+    TicksLeft = (uint16_t)(FrameTick - ES_Timer_GetTime());
+    if ( (TicksLeft == 0) || ((int16_t)TicksLeft < 0) )
+      return;
+    SleepStart = _HW_GetClock();
+    EnterCritical();   // save interrupt state, turn ints off
+    _HW_Idle( TicksLeft );
+    ExitCritical();  // restore saved interrupt state
+    Me->IdleClocks += _HW_GetClock() - SleepStart;
+  }
+}
+
+#else
+/****************************************************************************
+ Function
+   TicksToWake
+ Parameters
+   None
+ Returns
+   uint16_t : the ticks until the next timeout or the next event checker
+              that is due, ES_Timer_NO_TIMEOUT if there are neither
+ Description
+   how long ES_Run may sleep with nothing to do
+ Notes
+
+ Author
+   J. He, 10/19/26, 16:30
+****************************************************************************/
+static uint16_t TicksToWake( void ){
+  uint16_t TicksToTimeout;
+  uint16_t TicksToCheck;
+
+  TicksToTimeout = ES_Timer_GetTicksToNextTimeout();
+  TicksToCheck = ES_GetTicksToNextCheck();
+  return ( TicksToCheck < TicksToTimeout ) ? TicksToCheck : TicksToTimeout;
+}
+
+/****************************************************************************
+ Function
+   IdleSleep
+ Parameters
+   None
+ Returns
+   nothing
+ Description
+   sleeps in _HW_Idle until the next timer needs to be serviced, an event
+   checker is due or an interrupt comes in, and adds the time asleep to
+   IdleClocks
+ Notes
+   ints are turned off before the last check for ISR posts, _HW_Idle
+   wakes on any interrupt that comes in after that
+ Author
+   J. He, 10/17/26, 18:24
+****************************************************************************/
+static void IdleSleep( void ){
+  uint16_t TicksToTimeout;
+  uint64_t SleepStart;
+
+  TicksToTimeout = TicksToWake();
+  SleepStart = _HW_GetClock();
+  EnterCritical();   // save interrupt state, turn ints off
+  if ( Me->ISRPostCount == Me->DrainedPostCount )
+    _HW_Idle( TicksToTimeout );
+  ExitCritical();  // restore saved interrupt state
+  Me->IdleClocks += _HW_GetClock() - SleepStart;
+}
+#endif
+
+/****************************************************************************
+ Function
+   CountPost
+ Parameters
+   uint8_t : Which service was posted to (index into ServDescList)
+   ES_Event : The Event that was posted
+   bool : true if it made it onto the queue, false if it was dropped
+   uint8_t : the service that posted it, or ES_TRACE_ISR when it is being
+             moved from a mailbox
+ Returns
+   nothing
+ Description
+   updates the post & drop counts for the queue statistics and records the
+   post in the flight recorder
+ Notes
+   only called from the framework side, never from an ISR. Posts from ISRs
+   were recorded when they went in the mailbox, so only drops are recorded
+   for them here. The flight recorder has a lock of its own, so it is left
+   out of the one for the counts.
+ Author
+   J. He, 10/17/26, 14:10
+****************************************************************************/
+static void CountPost( uint8_t WhichService, ES_Event ThisEvent, bool WasPosted,
+                       uint8_t Source ){
+  if ( (Source != ES_TRACE_ISR) || (WasPosted != true) )
+    ES_TraceRecord( (WasPosted == true) ? ES_TRACE_POST : ES_TRACE_DROP,
+                    Source, WhichService, 0, ThisEvent );
+  if ( WhichService < ARRAY_SIZE(EventQueues) ){
+    LockStats();
+    Me->NumPosts[WhichService]++;
+    if ( WasPosted != true ){
+      Me->NumDropped[WhichService]++;
+      Me->LastDropped[WhichService] = ThisEvent;
+    }
+    UnlockStats();
+  }
+}
+
+#ifdef ES_LATENCY_STATS
+/****************************************************************************
+ Function
+   RecordLatency
+ Parameters
+   uint8_t : the priority of the service about to run
+   ES_Event : the event about to be passed to its run function
+ Returns
+   nothing
+ Description
+   adds the time since ThisEvent was posted to the service's histogram
+ Notes
+   the bin is the number of the MSB set in the wait, plus 1, which uses
+   the same CLZ based lookup as the scheduler. With ES_THREADS only the
+   worker running the service writes its histogram, so there is no lock.
+ Author
+   J. He, 10/17/26, 15:10
+****************************************************************************/
+static void RecordLatency( uint8_t WhichService, ES_Event ThisEvent ){
+  uint32_t Wait;
+  uint8_t Bin;
+
+  Wait = _HW_GetTimestamp() - ThisEvent.PostTime;
+  if ( Wait == 0 )
+    Bin = 0;
+  else if ( Wait > UINT16_MAX )
+    Bin = ES_LATENCY_BINS - 1;
+  else
+    Bin = ES_GetMSBitSet( (uint16_t)Wait ) + 1;
+  Me->LatencyStats[WhichService].Bins[Bin]++;
+  if ( Wait > Me->LatencyStats[WhichService].MaxWait ){
+    Me->LatencyStats[WhichService].MaxWait = Wait;
+    Me->LatencyStats[WhichService].MaxType = ThisEvent.EventType;
+  }
+}
+#endif
+
+#ifdef ES_RUN_PROFILE
+/****************************************************************************
+ Function
+   RecordRunTime
+ Parameters
+   uint8_t : the priority of the service that just ran
+   ES_Event : the event that was passed to its run function
+   uint32_t : how long the run function took, in _HW_GetCycles units
+ Returns
+   nothing
+ Description
+   adds one run function call to the profiles of the service and of the
+   event type
+ Notes
+   the cycle count is taken modulo 2^32, so a call must finish within one
+   wrap of the counter, 107S on the Tiva and 4.3S on the host
+ Author
+   J. He, 10/18/26, 11:32
+****************************************************************************/
+static void RecordRunTime( uint8_t WhichService, ES_Event ThisEvent,
+                           uint32_t Cycles ){
+  LockStats(); // the event profiles are shared by the worker threads
+  AddToProfile( &Me->ServiceProfile[WhichService], Cycles,
+                (uint16_t)ThisEvent.EventType );
+  if ( (uint16_t)ThisEvent.EventType < ARRAY_SIZE(Me->EventProfile) )
+    AddToProfile( &Me->EventProfile[(uint16_t)ThisEvent.EventType], Cycles,
+                  WhichService );
+  UnlockStats();
+}
+
+/****************************************************************************
+ Function
+   AddToProfile
+ Parameters
+   ES_RunProfile_t * : the profile to add to
+   uint32_t : how long the call took, in _HW_GetCycles units
+   uint16_t : the event type or service to blame if this is the new max
+ Returns
+   nothing
+ Description
+   updates the count, min, max and total of one profile
+ Notes
+
+ Author
+   J. He, 10/18/26, 11:35
+****************************************************************************/
+static void AddToProfile( ES_RunProfile_t * pProfile, uint32_t Cycles,
+                          uint16_t With ){
+  if ( (pProfile->NumRuns == 0) || (Cycles < pProfile->MinCycles) )
+    pProfile->MinCycles = Cycles;
+  if ( Cycles > pProfile->MaxCycles ){
+    pProfile->MaxCycles = Cycles;
+    pProfile->MaxWith = With;
+  }
+  pProfile->TotalCycles += Cycles;
+  pProfile->NumRuns++;
+}
+
+/****************************************************************************
+ Function
+   PrintProfile
+ Parameters
+   ES_RunProfile_t * : the profile to print
+ Returns
+   nothing
+ Description
+   prints the rest of a line of ES_DumpRunProfile, with the times in uS
+ Notes
+
+ Author
+   J. He, 10/18/26, 11:38
+****************************************************************************/
+static void PrintProfile( ES_RunProfile_t * pProfile ){
+  uint32_t Mean = 0;
+
+  if ( pProfile->NumRuns != 0 )
+    Mean = (uint32_t)(pProfile->TotalCycles / pProfile->NumRuns);
+  printf("%10lu %6lu %6lu %6lu %9lu  %u\r\n",
+         (unsigned long)pProfile->NumRuns,
+         (unsigned long)(pProfile->MinCycles / ES_CYCLES_PER_US),
+         (unsigned long)(Mean / ES_CYCLES_PER_US),
+         (unsigned long)(pProfile->MaxCycles / ES_CYCLES_PER_US),
+         (unsigned long)(pProfile->TotalCycles / 
+                         (ES_CYCLES_PER_US * 1000UL)),
+         pProfile->MaxWith);
+}
+#endif
+
 #if 0
 /****************************************************************************
  Function
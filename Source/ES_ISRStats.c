@@ -0,0 +1,200 @@
+/****************************************************************************
+ Module
+     ES_ISRStats.c
+ Description
+     Keeps the interrupt response statistics, for each ISR listed in
+     ES_ISR_STATS_LIST: how many times it ran, its longest run and the
+     worst jitter between its arrivals.
+ Notes
+     The run time is measured with the cycle counter, _HW_GetCycles. The
+     arrivals are timed with the low 32 bits of the 64 bit clock, so that
+     they follow the virtual clock on the host, and the jitter is kept in
+     its units, ES_CLOCK_TICKS_PER_US to the uS. Jitter is the change in the interval between runs from
+     one run to the next, so a steady periodic interrupt shows close to 0
+     and a capture interrupt shows how fast its input changes.
+     An ISR only touches its own entry and does not preempt itself, so the
+     entries are updated without turning ints off.
+
+ History
+ When           Who     What/Why
+ -------------- ---     --------
+ 10/21/26 15:30 jh      the jitter is in clock ticks, scale it by
+                        ES_CLOCK_TICKS_PER_US
+ 10/18/26 14:29 jh      started coding
+*****************************************************************************/
+/*----------------------------- Include Files -----------------------------*/
+#include "ES_Configure.h"
+#include "ES_ISRStats.h"
+#include "ES_General.h"
+#include "ES_Instance.h"
+#include "ES_Port.h"
+#include <stdio.h>
+
+#ifdef ES_ISR_STATS
+
+/*----------------------------- Module Defines ----------------------------*/
+
+/*---------------------------- Module Functions ---------------------------*/
+
+/*---------------------------- Module Variables ---------------------------*/
+// the statistics are kept for each robot, see ES_Instance.h
+typedef struct {
+  ES_ISRStats_t Stats[ES_NUM_ISR_STATS];
+} ISRStatsData_t;
+
+static ISRStatsData_t Instances[ES_NUM_INSTANCES];
+
+#define Me ES_THIS(Instances)
+
+// the names of the ISRs, for ES_DumpISRStats
+#define ES_ISR_STATS_NAME(Name) #Name,
+static const char * const ISRNames[ES_NUM_ISR_STATS] = {
+  ES_ISR_STATS_LIST(ES_ISR_STATS_NAME)
+};
+
+/*------------------------------ Module Code ------------------------------*/
+/****************************************************************************
+ Function
+   ES_ISRStatsBegin
+ Parameters
+   ES_ISRId_t WhichISR : the ES_ISR_<name> of the ISR that is starting
+ Returns
+   uint32_t : the cycle count at the start, for ES_ISRStatsEnd
+ Description
+   counts a run of the ISR and updates its jitter
+ Notes
+   called through ES_ISR_BEGIN at the top of the ISR
+ Author
+   J. He, 10/18/26, 14:10
+****************************************************************************/
+uint32_t ES_ISRStatsBegin( ES_ISRId_t WhichISR )
+{
+  ES_ISRStats_t *pStats = &Me->Stats[WhichISR];
+  uint32_t Arrival;
+  uint32_t Interval;
+  uint32_t Jitter;
+
+  Arrival = (uint32_t)_HW_GetClock();
+  if ( pStats->Count > 0 ) {
+    Interval = Arrival - pStats->LastArrival;
+    if ( pStats->Count > 1 ) {
+      Jitter = ( Interval > pStats->LastInterval ) ?
+                 Interval - pStats->LastInterval :
+                 pStats->LastInterval - Interval;
+      if ( Jitter > pStats->MaxJitter )
+        pStats->MaxJitter = Jitter;
+    }
+    pStats->LastInterval = Interval;
+  }
+  pStats->LastArrival = Arrival;
+  pStats->Count++;
+  return _HW_GetCycles();
+}
+
+/****************************************************************************
+ Function
+   ES_ISRStatsEnd
+ Parameters
+   ES_ISRId_t WhichISR : the ES_ISR_<name> of the ISR that is finishing
+   uint32_t Start : what ES_ISRStatsBegin returned
+ Returns
+   nothing
+ Description
+   updates the longest run of the ISR
+ Notes
+   called through ES_ISR_END at the bottom of the ISR
+ Author
+   J. He, 10/18/26, 14:13
+****************************************************************************/
+void ES_ISRStatsEnd( ES_ISRId_t WhichISR, uint32_t Start )
+{
+  uint32_t Cycles = _HW_GetCycles() - Start;
+
+  if ( Cycles > Me->Stats[WhichISR].MaxCycles )
+    Me->Stats[WhichISR].MaxCycles = Cycles;
+}
+
+/****************************************************************************
+ Function
+   ES_GetISRStats
+ Parameters
+   ES_ISRId_t WhichISR : the ES_ISR_<name> of the ISR to report on
+   ES_ISRStats_t * pStats : where to put the statistics
+ Returns
+   boolean : False if there is no such ISR
+ Description
+   copies out the statistics for one ISR
+ Notes
+   ints are off for the copy, so it is consistent
+ Author
+   J. He, 10/18/26, 14:16
+****************************************************************************/
+bool ES_GetISRStats( ES_ISRId_t WhichISR, ES_ISRStats_t * pStats )
+{
+  if ( (unsigned)WhichISR >= ES_NUM_ISR_STATS )
+    return false;
+  EnterCritical();   // save interrupt state, turn ints off
+  *pStats = Me->Stats[WhichISR];
+  ExitCritical();  // restore saved interrupt state
+  return true;
+}
+
+/****************************************************************************
+ Function
+   ES_ResetISRStats
+ Parameters
+   None
+ Returns
+   nothing
+ Description
+   clears the statistics for all the ISRs
+ Notes
+   the first interval after a reset is not counted toward the jitter
+ Author
+   J. He, 10/18/26, 14:19
+****************************************************************************/
+void ES_ResetISRStats( void )
+{
+  uint8_t i;
+  static const ES_ISRStats_t Empty = { 0 };
+
+  EnterCritical();   // save interrupt state, turn ints off
+  for ( i = 0; i < ES_NUM_ISR_STATS; i++ )
+    Me->Stats[i] = Empty;
+  ExitCritical();  // restore saved interrupt state
+}
+
+/****************************************************************************
+ Function
+   ES_DumpISRStats
+ Parameters
+   None
+ Returns
+   nothing
+ Description
+   prints the count, longest run and worst jitter of every ISR on the
+   console, the times in uS
+ Notes
+
+ Author
+   J. He, 10/18/26, 14:22
+****************************************************************************/
+void ES_DumpISRStats( void )
+{
+  uint8_t i;
+  ES_ISRStats_t Stats;
+
+  printf("ISR stats (uS)\r\n");
+  printf("     count    max run max jitter  isr\r\n");
+  for ( i = 0; i < ES_NUM_ISR_STATS; i++ ) {
+    ES_GetISRStats( (ES_ISRId_t)i, &Stats );
+    printf("%10lu %10lu %10lu  %s\r\n", (unsigned long)Stats.Count,
+           (unsigned long)(Stats.MaxCycles / ES_CYCLES_PER_US),
+           (unsigned long)(Stats.MaxJitter / ES_CLOCK_TICKS_PER_US),
+           ISRNames[i]);
+  }
+}
+
+#endif /* ES_ISR_STATS */
+/*------------------------------- Footnotes -------------------------------*/
+/*------------------------------ End of file ------------------------------*/
@@ -18,6 +18,13 @@
  History
  When           Who     What/Why
  -------------- ---     --------
+ 10/20/26 09:10 jh       TEST times both versions through a pointer, over
+                         shuffled inputs with as many for each MSB
+ 10/17/26 18:55 jh       added ES_GetMSBitSet32 & ES_GetMSBitSet64
+ 10/17/26 11:02 jh       ES_GetMSBitSet now uses the count leading zeros
+                         instruction when the compiler exposes it, the nybble
+                         walk is kept as the portable fallback. TEST harness
+                         checks & times both versions.
  10/20/13 17:03 jec      converted Byte2MSBitNum array to a Nybble sized array
                          (15 entries) and made function GetMSBitSet() to figure 
                          out the MSB set. This was done to facilitate moving to
@@ -33,12 +40,25 @@
 #include "ES_Types.h"
 #include "ES_General.h"
 #include "ES_Timers.h"
-#include "bitdefs.h"
+#include "BITDEFS.H"
 
 /*----------------------------- Module Defines ----------------------------*/
 #define ISOLATE_LS_NYBBLE 0x0F
 
+// ES_CLZ32 counts the leading zeros in a non-zero 32 bit value. On the
+// Cortex-M4 both of these compile to the single cycle CLZ instruction, on x86
+// to BSR/LZCNT. If neither is available, we fall back to the nybble table.
+#if defined(__ARMCC_VERSION) && (__ARMCC_VERSION < 6000000)
+#define ES_CLZ32(x) __clz(x)
+#elif defined(__GNUC__) || defined(__clang__)
+#define ES_CLZ32(x) __builtin_clz(x)
+#endif
+#define ES_MSBIT_ERROR 128
+
 /*---------------------------- Module Functions ---------------------------*/
+#if !defined(ES_CLZ32) || defined(TEST)
+static uint8_t GetMSBitSetByNybble( uint16_t Val2Check);
+#endif
 
 /*---------------------------- Module Variables ---------------------------*/
 
@@ -76,11 +96,104 @@ uint8_t const Nybble2MSBitNum[15] = {
 };
 
 /*------------------------------ Module Code ------------------------------*/
+/****************************************************************************
+ Function
+   ES_GetMSBitSet
+ Parameters
+   uint16_t  Val2Check The number to find the MSB in
+ Returns
+   bit number of the MSB that is set in Val2Check, 128 if Val2Check = 0
+ Description
+   find the MSB that is set in Val2Check and returns that bit number
+ Notes
+   with CLZ this takes the same time for every value, so the cost of the
+   dispatch in ES_Run no longer depends on which services are ready
+ Author
+   J. Edward Carryer, 10/20/13, 17:03
+****************************************************************************/
 uint8_t ES_GetMSBitSet( uint16_t Val2Check) {
+#if defined(ES_CLZ32)
+  if ( Val2Check == 0 )
+    return ES_MSBIT_ERROR;
+  // 31 - leading zeros is the bit number of the MSB in a 32 bit word
+  return (uint8_t)((sizeof(uint32_t) * BITS_PER_BYTE - 1) - 
+                   ES_CLZ32( (uint32_t)Val2Check ));
+#else
+  return GetMSBitSetByNybble( Val2Check);
+#endif
+}
+
+/****************************************************************************
+ Function
+   ES_GetMSBitSet32
+ Parameters
+   uint32_t  Val2Check The number to find the MSB in
+ Returns
+   bit number of the MSB that is set in Val2Check, 128 if Val2Check = 0
+ Description
+   find the MSB that is set in Val2Check and returns that bit number
+ Notes
+   used by ES_Run when there are more than 16 services
+ Author
+   J. He, 10/17/26, 18:57
+****************************************************************************/
+uint8_t ES_GetMSBitSet32( uint32_t Val2Check) {
+#if defined(ES_CLZ32)
+  if ( Val2Check == 0 )
+    return ES_MSBIT_ERROR;
+  return (uint8_t)((sizeof(uint32_t) * BITS_PER_BYTE - 1) - 
+                   ES_CLZ32( Val2Check ));
+#else
+  if ( (Val2Check >> 16) != 0 )
+    return GetMSBitSetByNybble( (uint16_t)(Val2Check >> 16)) + 16;
+  return GetMSBitSetByNybble( (uint16_t)Val2Check);
+#endif
+}
+
+/****************************************************************************
+ Function
+   ES_GetMSBitSet64
+ Parameters
+   uint64_t  Val2Check The number to find the MSB in
+ Returns
+   bit number of the MSB that is set in Val2Check, 128 if Val2Check = 0
+ Description
+   find the MSB that is set in Val2Check and returns that bit number
+ Notes
+   used by ES_Run when there are more than 32 services
+ Author
+   J. He, 10/17/26, 18:59
+****************************************************************************/
+uint8_t ES_GetMSBitSet64( uint64_t Val2Check) {
+  if ( (Val2Check >> 32) != 0 )
+    return ES_GetMSBitSet32( (uint32_t)(Val2Check >> 32)) + 32;
+  return ES_GetMSBitSet32( (uint32_t)Val2Check);
+}
+
+/***************************************************************************
+ private functions
+ ***************************************************************************/
+#if !defined(ES_CLZ32) || defined(TEST)
+/****************************************************************************
+ Function
+   GetMSBitSetByNybble
+ Parameters
+   uint16_t  Val2Check The number to find the MSB in
+ Returns
+   bit number of the MSB that is set in Val2Check, 128 if Val2Check = 0
+ Description
+   the original table driven version, walks the nybbles from the top down
+   looking each one up in Nybble2MSBitNum
+ Notes
+   used on compilers that do not give us access to CLZ
+ Author
+   J. Edward Carryer, 10/20/13, 17:03
+****************************************************************************/
+static uint8_t GetMSBitSetByNybble( uint16_t Val2Check) {
 
   int8_t LoopCntr;
   uint8_t Nybble2Test; 
-  uint8_t ReturnVal = 128; // this is the error return value
+  uint8_t ReturnVal = ES_MSBIT_ERROR; // this is the error return value
 
   // loop through the parameter, nybble by nybble
   for( LoopCntr = sizeof(Val2Check) * (BITS_PER_BYTE/BITS_PER_NYBBLE)-1;
@@ -98,28 +211,114 @@ uint8_t ES_GetMSBitSet( uint16_t Val2Check) {
   }
   return ReturnVal;  
 }
+#endif
 
-/***************************************************************************
- private functions
- ***************************************************************************/
 #ifdef TEST
 #include <stdio.h>
+#include <time.h>
 
-void main(void) {
+#define BENCH_PASSES 3200
+#define BENCH_INPUTS 4096
+
+// summing the results keeps the optimizer from discarding the calls
+static volatile uint32_t Sink;
+
+// both versions are called through a pointer, so neither one is inlined
+// into the timing loop
+typedef uint8_t MSBitFunc_t( uint16_t Val2Check);
+static MSBitFunc_t * volatile NybbleFunc = GetMSBitSetByNybble;
+static MSBitFunc_t * volatile CLZFunc = ES_GetMSBitSet;
 
-  uint16_t Counter=0;
+// the same number of inputs with each MSB, in a shuffled order, so the
+// nybble walk does not mostly stop at the top nybble & the branches do
+// not follow a pattern
+static uint16_t BenchInputs[BENCH_INPUTS];
+
+static uint32_t Random( void ) {
+  static uint32_t Seed = 12345;
+
+  Seed = Seed * 1103515245 + 12345;
+  return Seed >> 8;
+}
+
+static void MakeBenchInputs( void ) {
+  uint16_t Index;
+  uint16_t Other;
+  uint16_t Temp;
   uint8_t MSBit;
 
+  for (Index = 0; Index < BENCH_INPUTS; Index++){
+    MSBit = Index % 16;
+    BenchInputs[Index] = (uint16_t)(BitNum2SetMask[MSBit] |
+                                    (Random() & (BitNum2SetMask[MSBit] - 1)));
+  }
+  for (Index = BENCH_INPUTS - 1; Index > 0; Index--){
+    Other = (uint16_t)(Random() % (Index + 1));
+    Temp = BenchInputs[Index];
+    BenchInputs[Index] = BenchInputs[Other];
+    BenchInputs[Other] = Temp;
+  }
+}
+
+static double TimeMSBitFunc( MSBitFunc_t * volatile *ppFunc ) {
+  uint16_t Pass;
+  uint16_t Index;
+  uint32_t Sum = 0;
+  MSBitFunc_t *pFunc = *ppFunc;
+  clock_t Start = clock();
+
+  for (Pass = 0; Pass < BENCH_PASSES; Pass++){
+    for (Index = 0; Index < BENCH_INPUTS; Index++)
+      Sum += pFunc( BenchInputs[Index]);
+  }
+  Sink = Sum;
+  return (double)(clock() - Start) / CLOCKS_PER_SEC;
+}
+
+void main(void) {
+
+  uint32_t Counter;
+  uint32_t Errors = 0;
+  double NybbleTime, CLZTime;
+
   puts("Testing the MSB Look-up function\n\r");
   puts(__TIME__ " " __DATE__);
   puts("\n\r");
-  MSBit = ES_GetMSBitSet( Counter);
-  printf("the MSB set in %u is bit %d\n\r",Counter,MSBit);
+  // check the version in use against the nybble walk for every input
+  for (Counter = 0; Counter <= UINT16_MAX; Counter++){
+    if ( ES_GetMSBitSet( (uint16_t)Counter) != 
+         GetMSBitSetByNybble( (uint16_t)Counter) ){
+      printf("mismatch at %u: %d vs %d\n\r", (unsigned)Counter,
+             ES_GetMSBitSet( (uint16_t)Counter),
+             GetMSBitSetByNybble( (uint16_t)Counter));
+      Errors++;
+    }
+  }
+  printf("%u mismatches over all 65536 inputs\n\r", (unsigned)Errors);
 
-  for (Counter = 1; Counter !=0; Counter++){
-    MSBit = ES_GetMSBitSet( Counter);
-    printf("the MSB set in %u is bit %d\n\r",Counter,MSBit);
+  // the wide versions, with the top bit set alone and with lower bits set
+  Errors = 0;
+  for (Counter = 0; Counter < 64; Counter++){
+    if ( (ES_GetMSBitSet64( (uint64_t)1 << Counter) != Counter) ||
+         (ES_GetMSBitSet64( ((uint64_t)1 << Counter) | 1) != Counter) ||
+         ((Counter < 32) && 
+          (ES_GetMSBitSet32( ((uint32_t)1 << Counter) | 1) != Counter)) )
+      Errors++;
   }
+  if ( (ES_GetMSBitSet32(0) != ES_MSBIT_ERROR) || 
+       (ES_GetMSBitSet64(0) != ES_MSBIT_ERROR) )
+    Errors++;
+  printf("%u mismatches in the 32 & 64 bit versions\n\r", (unsigned)Errors);
+
+  // then time both of them over the same inputs
+  MakeBenchInputs();
+  NybbleTime = TimeMSBitFunc( &NybbleFunc);
+  CLZTime = TimeMSBitFunc( &CLZFunc);
+
+  printf("nybble walk : %.2f ns/call\n\r",
+         NybbleTime * 1e9 / ((double)BENCH_PASSES * BENCH_INPUTS));
+  printf("ES_GetMSBitSet: %.2f ns/call\n\r",
+         CLZTime * 1e9 / ((double)BENCH_PASSES * BENCH_INPUTS));
 }
 #endif
 /*------------------------------ End of File ------------------------------*/
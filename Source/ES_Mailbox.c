@@ -0,0 +1,397 @@
+/****************************************************************************
+ Module
+     ES_Mailbox.c
+ Description
+     Implements a lock-free single-producer/single-consumer ring of ES_Event.
+     The framework keeps one of these per service so that interrupt
+     responses can post events without turning interrupts off.
+ Notes
+     Only one context may put and only one context may get. On the Tiva
+     every ISR that posts runs at the same NVIC priority, so they cannot
+     preempt each other and together act as a single producer. The motor
+     control ISRs run at a lower priority, which is safe only because they
+     never post. ES_MAILBOX_CHECK checks it. ES_Run is the consumer.
+     With ES_THREADS there is also a multi-producer ring (ES_MPMailbox_t),
+     after D. Vyukov's bounded MPMC queue with a single consumer. It uses
+     the GCC __atomic builtins and is only built for the host.
+
+ History
+ When           Who     What/Why
+ -------------- ---     --------
+ 10/20/26 09:52 jh      the single producer is every ISR that posts, not
+                        every ISR
+ 10/19/26 10:27 jh      added the multi-producer ring for ES_THREADS
+ 10/17/26 12:20 jh      started coding
+*****************************************************************************/
+/*----------------------------- Include Files -----------------------------*/
+#include "ES_Configure.h"
+#include "ES_Mailbox.h"
+#include "ES_Port.h"
+
+/*----------------------------- Module Defines ----------------------------*/
+// the largest ring whose entry count still fits in the uint8_t indices
+#define MAX_MAILBOX_SLOTS 128
+
+/*---------------------------- Module Functions ---------------------------*/
+
+/*---------------------------- Module Variables ---------------------------*/
+
+/*------------------------------ Module Code ------------------------------*/
+/****************************************************************************
+ Function
+   ES_InitMailbox
+ Parameters
+   ES_Mailbox_t * pBox : the mailbox to initialize
+   ES_Event * pSlots : the block of memory to hold the events
+   uint8_t NumSlots : number of events in pSlots, must be a power of 2
+ Returns
+   bool : false if NumSlots is not a power of 2 between 1 & 128
+ Description
+   sets up an empty mailbox using pSlots as its storage
+ Notes
+   unlike ES_InitQueue, no extra element is needed for a header
+ Author
+   J. He, 10/17/26, 12:24
+****************************************************************************/
+bool ES_InitMailbox( ES_Mailbox_t * pBox, ES_Event * pSlots, uint8_t NumSlots )
+{
+  if ( (NumSlots == 0) || (NumSlots > MAX_MAILBOX_SLOTS) ||
+       ((NumSlots & (NumSlots - 1)) != 0) )
+    return false;
+  pBox->pSlots = pSlots;
+  pBox->Mask = NumSlots - 1;
+  pBox->Head = 0;
+  pBox->Tail = 0;
+  return true;
+}
+
+/****************************************************************************
+ Function
+   ES_MailboxPut
+ Parameters
+   ES_Mailbox_t * pBox : the mailbox to post to
+   ES_Event Event2Add : event to be added to the mailbox
+ Returns
+   bool : true if the add was successful, false if the mailbox was full
+ Description
+   producer side. Writes the slot, then publishes it by advancing Head.
+ Notes
+   never masks interrupts, safe to call from an ISR
+ Author
+   J. He, 10/17/26, 12:31
+****************************************************************************/
+bool ES_MailboxPut( ES_Mailbox_t * pBox, ES_Event Event2Add )
+{
+  uint8_t Head = pBox->Head;
+
+  if ( (uint8_t)(Head - pBox->Tail) > pBox->Mask )
+    return false; // full
+  pBox->pSlots[Head & pBox->Mask] = Event2Add;
+  // the event must be in the slot before the consumer can see the new Head
+  ES_MemoryBarrier();
+  pBox->Head = Head + 1;
+  return true;
+}
+
+/****************************************************************************
+ Function
+   ES_MailboxGet
+ Parameters
+   ES_Mailbox_t * pBox : the mailbox to pull from
+   ES_Event * pReturnEvent : used to return the event pulled from the mailbox
+ Returns
+   bool : true if an event was returned, false if the mailbox was empty
+ Description
+   consumer side. Reads the oldest slot, then frees it by advancing Tail.
+ Notes
+
+ Author
+   J. He, 10/17/26, 12:36
+****************************************************************************/
+bool ES_MailboxGet( ES_Mailbox_t * pBox, ES_Event * pReturnEvent )
+{
+  uint8_t Tail = pBox->Tail;
+
+  if ( Tail == pBox->Head )
+    return false; // empty
+  // don't read the slot until we have seen the Head that published it
+  ES_MemoryBarrier();
+  *pReturnEvent = pBox->pSlots[Tail & pBox->Mask];
+  // and finish reading it before the producer is allowed to reuse it
+  ES_MemoryBarrier();
+  pBox->Tail = Tail + 1;
+  return true;
+}
+
+/****************************************************************************
+ Function
+   ES_IsMailboxEmpty
+ Parameters
+   ES_Mailbox_t * pBox : the mailbox to test
+ Returns
+   bool : true if the mailbox is empty
+ Description
+   see above
+ Notes
+   only a snapshot if called while the producer may be running
+ Author
+   J. He, 10/17/26, 12:38
+****************************************************************************/
+bool ES_IsMailboxEmpty( ES_Mailbox_t * pBox )
+{
+  return (pBox->Head == pBox->Tail);
+}
+
+#if ES_THREADS > 0
+/****************************************************************************
+ Function
+   ES_InitMPMailbox
+ Parameters
+   ES_MPMailbox_t * pBox : the mailbox to initialize
+   ES_Event * pSlots : the block of memory to hold the events
+   uint32_t * pSeqs : a sequence number for each of the slots
+   uint32_t NumSlots : number of events in pSlots, must be a power of 2
+ Returns
+   bool : false if NumSlots is not a power of 2
+ Description
+   sets up an empty multi-producer mailbox using pSlots as its storage
+ Notes
+   slot i starts out free for the producer of position i
+ Author
+   J. He, 10/19/26, 10:05
+****************************************************************************/
+bool ES_InitMPMailbox( ES_MPMailbox_t * pBox, ES_Event * pSlots,
+                       uint32_t * pSeqs, uint32_t NumSlots )
+{
+  uint32_t i;
+
+  if ( (NumSlots == 0) || ((NumSlots & (NumSlots - 1)) != 0) )
+    return false;
+  for ( i = 0; i < NumSlots; i++ )
+    pSeqs[i] = i;
+  pBox->pSlots = pSlots;
+  pBox->pSeqs = pSeqs;
+  pBox->Mask = NumSlots - 1;
+  pBox->Head = 0;
+  pBox->Tail = 0;
+  __atomic_thread_fence( __ATOMIC_RELEASE );
+  return true;
+}
+
+/****************************************************************************
+ Function
+   ES_MPMailboxPut
+ Parameters
+   ES_MPMailbox_t * pBox : the mailbox to post to
+   ES_Event Event2Add : event to be added to the mailbox
+ Returns
+   bool : true if the add was successful, false if the mailbox was full
+ Description
+   producer side, from any thread. Claims the next position, writes its
+   slot, then hands the slot to the consumer through its sequence number.
+ Notes
+   lock-free: a producer only retries when another one claimed the
+   position first
+ Author
+   J. He, 10/19/26, 10:08
+****************************************************************************/
+bool ES_MPMailboxPut( ES_MPMailbox_t * pBox, ES_Event Event2Add )
+{
+  uint32_t Pos = __atomic_load_n( &pBox->Head, __ATOMIC_RELAXED );
+  uint32_t Seq;
+  int32_t Diff;
+
+  while (1) {
+    Seq = __atomic_load_n( &pBox->pSeqs[Pos & pBox->Mask], __ATOMIC_ACQUIRE );
+    Diff = (int32_t)(Seq - Pos);
+    if ( Diff == 0 ) {
+      // the slot is free, try to claim it. On failure Pos is reloaded.
+      if ( __atomic_compare_exchange_n( &pBox->Head, &Pos, Pos + 1, true,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED ) )
+        break;
+    } else if ( Diff < 0 ) {
+      return false; // full, the consumer has not freed this slot yet
+    } else {
+      Pos = __atomic_load_n( &pBox->Head, __ATOMIC_RELAXED );
+    }
+  }
+  pBox->pSlots[Pos & pBox->Mask] = Event2Add;
+  // the event must be in the slot before the consumer sees it is there
+  __atomic_store_n( &pBox->pSeqs[Pos & pBox->Mask], Pos + 1, __ATOMIC_RELEASE );
+  return true;
+}
+
+/****************************************************************************
+ Function
+   ES_MPMailboxGet
+ Parameters
+   ES_MPMailbox_t * pBox : the mailbox to pull from
+   ES_Event * pReturnEvent : used to return the event pulled from the mailbox
+ Returns
+   bool : true if an event was returned, false if the mailbox was empty
+ Description
+   consumer side. Reads the oldest slot, then frees it for the producer of
+   the position one lap on.
+ Notes
+   only one thread may get at a time. It reads as empty while the producer
+   of the oldest position is part way through its put, even if later ones
+   are done.
+ Author
+   J. He, 10/19/26, 10:11
+****************************************************************************/
+bool ES_MPMailboxGet( ES_MPMailbox_t * pBox, ES_Event * pReturnEvent )
+{
+  uint32_t Pos = pBox->Tail;
+
+  if ( __atomic_load_n( &pBox->pSeqs[Pos & pBox->Mask], __ATOMIC_ACQUIRE ) !=
+       Pos + 1 )
+    return false; // empty
+  *pReturnEvent = pBox->pSlots[Pos & pBox->Mask];
+  // finish reading the slot before a producer is allowed to reuse it
+  __atomic_store_n( &pBox->pSeqs[Pos & pBox->Mask], Pos + pBox->Mask + 1,
+                    __ATOMIC_RELEASE );
+  pBox->Tail = Pos + 1;
+  return true;
+}
+#endif
+
+/***************************************************************************
+ private functions
+ ***************************************************************************/
+#if defined(TEST) && defined(ES_PORT_POSIX)
+/*
+  Host stress test: a producer thread stuffs NUM_TEST_EVENTS numbered events
+  through a small mailbox as fast as it can while main() drains it, checking
+  that every event arrives exactly once and in order.
+  Built with -DES_THREADS=<n> as well, NUM_MP_PRODUCERS threads then do the
+  same through a multi-producer mailbox, each with its own EventType, and
+  the events of each one must arrive in the order it put them.
+*/
+#include <stdio.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+
+#define NUM_TEST_EVENTS 20000000UL
+#define TEST_SLOTS 8
+
+static ES_Event TestSlots[TEST_SLOTS];
+static ES_Mailbox_t TestBox;
+static volatile unsigned long FullCount;
+
+#if ES_THREADS > 0
+#define NUM_MP_PRODUCERS 4
+#define NUM_MP_EVENTS 2000000UL
+
+static ES_Event MPTestSlots[TEST_SLOTS];
+static uint32_t MPTestSeqs[TEST_SLOTS];
+static ES_MPMailbox_t MPTestBox;
+
+static void *MPProducer( void *pArg )
+{
+  unsigned long i;
+  ES_Event MyEvent;
+
+  MyEvent.EventType = (ES_EventTyp_t)(uintptr_t)pArg;
+  for ( i = 0; i < NUM_MP_EVENTS; i++ ) {
+    MyEvent.EventParam = (uint16_t)i;
+    while ( ES_MPMailboxPut( &MPTestBox, MyEvent ) == false )
+      sched_yield(); // wait for the consumer to make room
+  }
+  return NULL;
+}
+
+static unsigned long TestMPMailbox( void )
+{
+  pthread_t Producers[NUM_MP_PRODUCERS];
+  unsigned long NextParam[NUM_MP_PRODUCERS] = { 0 };
+  unsigned long Received = 0;
+  unsigned long Errors = 0;
+  ES_Event MyEvent;
+  uintptr_t i;
+
+  if ( ES_InitMPMailbox( &MPTestBox, MPTestSlots, MPTestSeqs, 6 ) != false )
+    Errors++; // not a power of 2, must be refused
+  ES_InitMPMailbox( &MPTestBox, MPTestSlots, MPTestSeqs, TEST_SLOTS );
+  for ( i = 0; i < NUM_MP_PRODUCERS; i++ )
+    pthread_create( &Producers[i], NULL, MPProducer, (void *)i );
+  while ( Received < NUM_MP_PRODUCERS * NUM_MP_EVENTS ) {
+    if ( ES_MPMailboxGet( &MPTestBox, &MyEvent ) == true ) {
+      if ( ((uintptr_t)MyEvent.EventType >= NUM_MP_PRODUCERS) ||
+           (MyEvent.EventParam !=
+                (uint16_t)NextParam[MyEvent.EventType]++) )
+        Errors++;
+      Received++;
+    } else {
+      sched_yield();
+    }
+  }
+  for ( i = 0; i < NUM_MP_PRODUCERS; i++ )
+    pthread_join( Producers[i], NULL );
+  if ( ES_MPMailboxGet( &MPTestBox, &MyEvent ) != false )
+    Errors++;
+  printf( "%lu events from %d producers, %lu errors\n", Received,
+          NUM_MP_PRODUCERS, Errors );
+  return Errors;
+}
+#endif
+
+static void *Producer( void *pArg )
+{
+  unsigned long i;
+  ES_Event MyEvent;
+
+  (void)pArg;
+  for ( i = 0; i < NUM_TEST_EVENTS; i++ ) {
+    MyEvent.EventType = (ES_EventTyp_t)(i % (ES_TIMEOUT + 1));
+    MyEvent.EventParam = (uint16_t)i;
+    while ( ES_MailboxPut( &TestBox, MyEvent ) == false ) {
+      FullCount++; // wait for the consumer to make room
+      sched_yield();
+    }
+  }
+  return NULL;
+}
+
+int main(void)
+{
+  pthread_t ProducerThread;
+  unsigned long Received = 0;
+  unsigned long Errors = 0;
+  ES_Event MyEvent;
+  struct timespec Start, End;
+  double Seconds;
+
+  if ( ES_InitMailbox( &TestBox, TestSlots, 3 ) != false )
+    Errors++; // not a power of 2, must be refused
+  ES_InitMailbox( &TestBox, TestSlots, TEST_SLOTS );
+
+  clock_gettime( CLOCK_MONOTONIC, &Start );
+  pthread_create( &ProducerThread, NULL, Producer, NULL );
+  while ( Received < NUM_TEST_EVENTS ) {
+    if ( ES_MailboxGet( &TestBox, &MyEvent ) == true ) {
+      if ( (MyEvent.EventParam != (uint16_t)Received) ||
+           (MyEvent.EventType != (ES_EventTyp_t)(Received % (ES_TIMEOUT + 1))) )
+        Errors++;
+      Received++;
+    } else {
+      sched_yield(); // let the producer run on a single core host
+    }
+  }
+  pthread_join( ProducerThread, NULL );
+  clock_gettime( CLOCK_MONOTONIC, &End );
+  if ( ES_IsMailboxEmpty( &TestBox ) != true )
+    Errors++;
+
+  Seconds = (End.tv_sec - Start.tv_sec) + (End.tv_nsec - Start.tv_nsec) / 1e9;
+  printf( "%lu events, %lu errors, producer found it full %lu times\n",
+          Received, Errors, (unsigned long)FullCount );
+  printf( "%.1f ns per event\n", Seconds * 1e9 / Received );
+#if ES_THREADS > 0
+  Errors += TestMPMailbox();
+#endif
+  return (Errors == 0) ? 0 : 1;
+}
+#endif
+/*------------------------------- Footnotes -------------------------------*/
+/*------------------------------ End of file ------------------------------*/
@@ -0,0 +1,315 @@
+/****************************************************************************
+ Module
+     ES_Payload.c
+ Description
+     Implements a pool of fixed size, reference counted payload blocks. An
+     event whose type is in ES_PAYLOAD_EVENTS carries the handle of one of
+     these blocks in its EventParam.
+ Notes
+     A block is Fresh from ES_PayloadAlloc until the first successful post
+     of an event carrying it. Every queue that the event lands on holds a
+     reference, which the framework drops when the service's run function
+     returns. A block that is still Fresh when the run function (or event
+     checker) that allocated it is done was never posted, and goes straight
+     back to the pool. An ISR must post a payload before it returns.
+
+ History
+ When           Who     What/Why
+ -------------- ---     --------
+ 10/18/26 09:43 jh      the pool is kept for each robot
+ 10/17/26 20:10 jh      started coding
+*****************************************************************************/
+/*----------------------------- Include Files -----------------------------*/
+#include "ES_Configure.h"
+#include "ES_Payload.h"
+#include "ES_General.h"
+#include "ES_Port.h"
+#include "ES_Instance.h"
+
+#if ES_PAYLOAD_BLOCKS > 0
+
+/*----------------------------- Module Defines ----------------------------*/
+// handles are the block number + 1, so that ES_PAYLOAD_NONE is never valid
+#define Handle2Block(h) ((uint8_t)((h) - 1))
+#define Block2Handle(b) ((uint16_t)((b) + 1))
+// marks the end of the free list
+#define NO_BLOCK 0xFF
+// the blocks are made of words so that every one of them is word aligned
+#define BLOCK_WORDS \
+  ((ES_PAYLOAD_SIZE + sizeof(uint32_t) - 1) / sizeof(uint32_t))
+
+ES_STATIC_ASSERT( ES_PAYLOAD_BLOCKS < NO_BLOCK, PayloadBlockFitsIndex );
+
+typedef enum { BlockFree, BlockFresh, BlockPosted } BlockState_t;
+
+/*---------------------------- Module Functions ---------------------------*/
+static bool IsValidHandle( uint16_t Handle );
+static void FreeBlock( uint8_t Block );
+
+/*---------------------------- Module Variables ---------------------------*/
+// the pool of one robot, see ES_Instance.h
+typedef struct {
+  uint32_t Blocks[ES_PAYLOAD_BLOCKS][BLOCK_WORDS];
+  uint8_t RefCount[ES_PAYLOAD_BLOCKS];
+  uint8_t BlockState[ES_PAYLOAD_BLOCKS];
+  uint8_t NextFree[ES_PAYLOAD_BLOCKS];
+  uint8_t FreeList;
+  uint8_t NumFresh;
+  uint8_t NumInUse;
+} PayloadData_t;
+
+static PayloadData_t Instances[ES_NUM_INSTANCES];
+
+#define Me ES_THIS(Instances)
+
+// a bit for each event type, set if the type is in ES_PAYLOAD_EVENTS
+static uint8_t PayloadTypes[(ES_NUM_EVENT_TYPES + BITS_PER_BYTE - 1) /
+                            BITS_PER_BYTE];
+
+/*------------------------------ Module Code ------------------------------*/
+/****************************************************************************
+ Function
+   ES_InitPayloads
+ Parameters
+   None
+ Returns
+   nothing
+ Description
+   returns every block to the pool and builds the table of the event types
+   that carry a payload
+ Notes
+   called by ES_Initialize before the service init functions run
+ Author
+   J. He, 10/17/26, 20:16
+****************************************************************************/
+void ES_InitPayloads( void )
+{
+  uint8_t i;
+
+  for ( i = 0; i < ES_PAYLOAD_BLOCKS; i++ ) {
+    Me->RefCount[i] = 0;
+    Me->BlockState[i] = BlockFree;
+    Me->NextFree[i] = (i + 1 < ES_PAYLOAD_BLOCKS) ? i + 1 : NO_BLOCK;
+  }
+  Me->FreeList = 0;
+  Me->NumFresh = 0;
+  Me->NumInUse = 0;
+
+  for ( i = 0; i < ARRAY_SIZE(PayloadTypes); i++ )
+    PayloadTypes[i] = 0;
+#define ES_MARK_PAYLOAD_EVENT(Type) \
+  PayloadTypes[(Type) / BITS_PER_BYTE] |= \
+    (uint8_t)(1 << ((Type) % BITS_PER_BYTE));
+  ES_PAYLOAD_EVENTS(ES_MARK_PAYLOAD_EVENT)
+}
+
+/****************************************************************************
+ Function
+   ES_PayloadAlloc
+ Parameters
+   None
+ Returns
+   uint16_t : handle of the block, to go in EventParam, or ES_PAYLOAD_NONE
+   if the pool is empty
+ Description
+   takes a block of ES_PAYLOAD_SIZE bytes from the pool
+ Notes
+   the block must be posted before the run function or ISR that allocated
+   it returns, otherwise it is reclaimed
+ Author
+   J. He, 10/17/26, 20:22
+****************************************************************************/
+uint16_t ES_PayloadAlloc( void )
+{
+  uint8_t Block;
+
+  EnterCritical();   // save interrupt state, turn ints off
+  Block = Me->FreeList;
+  if ( Block != NO_BLOCK ) {
+    Me->FreeList = Me->NextFree[Block];
+    Me->RefCount[Block] = 0;
+    Me->BlockState[Block] = BlockFresh;
+    Me->NumFresh++;
+    Me->NumInUse++;
+  }
+  ExitCritical();  // restore saved interrupt state
+  return (Block == NO_BLOCK) ? ES_PAYLOAD_NONE : Block2Handle(Block);
+}
+
+/****************************************************************************
+ Function
+   ES_PayloadData
+ Parameters
+   uint16_t Handle : the handle from ES_PayloadAlloc, or from the EventParam
+   of an event carrying a payload
+ Returns
+   void * : the ES_PAYLOAD_SIZE bytes of the block, word aligned, or NULL if
+   Handle does not refer to an allocated block
+ Description
+   see above
+ Notes
+   a consumer may only use the data until its run function returns
+ Author
+   J. He, 10/17/26, 20:25
+****************************************************************************/
+void * ES_PayloadData( uint16_t Handle )
+{
+  if ( IsValidHandle( Handle ) != true )
+    return 0;
+  return Me->Blocks[Handle2Block(Handle)];
+}
+
+/****************************************************************************
+ Function
+   ES_GetPayloadsInUse
+ Parameters
+   None
+ Returns
+   uint8_t : number of blocks out of the pool
+ Description
+   see above
+ Notes
+   useful for spotting a payload that is never released
+ Author
+   J. He, 10/17/26, 20:27
+****************************************************************************/
+uint8_t ES_GetPayloadsInUse( void )
+{
+  return Me->NumInUse;
+}
+
+/****************************************************************************
+ Function
+   ES_IsPayloadEvent
+ Parameters
+   ES_Event ThisEvent : the event to test
+ Returns
+   bool : true if the type of ThisEvent is one of ES_PAYLOAD_EVENTS
+ Description
+   see above
+ Notes
+
+ Author
+   J. He, 10/17/26, 20:29
+****************************************************************************/
+bool ES_IsPayloadEvent( ES_Event ThisEvent )
+{
+  return (ThisEvent.EventType < ES_NUM_EVENT_TYPES) &&
+         ((PayloadTypes[ThisEvent.EventType / BITS_PER_BYTE] &
+           (1 << (ThisEvent.EventType % BITS_PER_BYTE))) != 0);
+}
+
+/****************************************************************************
+ Function
+   ES_PayloadAddRef
+ Parameters
+   ES_Event ThisEvent : an event that has just been queued
+ Returns
+   nothing
+ Description
+   counts the new reference if ThisEvent carries a payload
+ Notes
+   called by the post functions for every queue, mailbox or deferral queue
+   that the event is successfully put on. Safe to call from an ISR.
+ Author
+   J. He, 10/17/26, 20:32
+****************************************************************************/
+void ES_PayloadAddRef( ES_Event ThisEvent )
+{
+  uint8_t Block;
+
+  if ( (ES_IsPayloadEvent( ThisEvent ) != true) ||
+       (IsValidHandle( ThisEvent.EventParam ) != true) )
+    return;
+  Block = Handle2Block(ThisEvent.EventParam);
+  EnterCritical();   // save interrupt state, turn ints off
+  Me->RefCount[Block]++;
+  if ( Me->BlockState[Block] == BlockFresh ) {
+    Me->BlockState[Block] = BlockPosted;
+    Me->NumFresh--;
+  }
+  ExitCritical();  // restore saved interrupt state
+}
+
+/****************************************************************************
+ Function
+   ES_PayloadRelease
+ Parameters
+   ES_Event ThisEvent : an event that has been dispatched or discarded
+ Returns
+   nothing
+ Description
+   drops one reference if ThisEvent carries a payload, returning the block
+   to the pool when that was the last one
+ Notes
+   called by ES_Run when the run function returns
+ Author
+   J. He, 10/17/26, 20:36
+****************************************************************************/
+void ES_PayloadRelease( ES_Event ThisEvent )
+{
+  uint8_t Block;
+
+  if ( (ES_IsPayloadEvent( ThisEvent ) != true) ||
+       (IsValidHandle( ThisEvent.EventParam ) != true) )
+    return;
+  Block = Handle2Block(ThisEvent.EventParam);
+  EnterCritical();   // save interrupt state, turn ints off
+  if ( (Me->BlockState[Block] == BlockPosted) && (Me->RefCount[Block] > 0) ) {
+    if ( --Me->RefCount[Block] == 0 )
+      FreeBlock( Block );
+  }
+  ExitCritical();  // restore saved interrupt state
+}
+
+/****************************************************************************
+ Function
+   ES_CollectPayloads
+ Parameters
+   None
+ Returns
+   nothing
+ Description
+   returns any block that was allocated but never posted to the pool
+ Notes
+   called by ES_Run after each run function and after the event checkers,
+   costs next to nothing unless there is such a block
+ Author
+   J. He, 10/17/26, 20:40
+****************************************************************************/
+void ES_CollectPayloads( void )
+{
+  uint8_t i;
+
+  if ( Me->NumFresh == 0 )
+    return;
+  EnterCritical();   // save interrupt state, turn ints off
+  for ( i = 0; i < ES_PAYLOAD_BLOCKS; i++ ) {
+    if ( Me->BlockState[i] == BlockFresh )
+      FreeBlock( i );
+  }
+  Me->NumFresh = 0;
+  ExitCritical();  // restore saved interrupt state
+}
+
+/***************************************************************************
+ private functions
+ ***************************************************************************/
+static bool IsValidHandle( uint16_t Handle )
+{
+  return (Handle != ES_PAYLOAD_NONE) && (Handle <= ES_PAYLOAD_BLOCKS) &&
+         (Me->BlockState[Handle2Block(Handle)] != BlockFree);
+}
+
+// only called with interrupts off
+static void FreeBlock( uint8_t Block )
+{
+  Me->BlockState[Block] = BlockFree;
+  Me->NextFree[Block] = Me->FreeList;
+  Me->FreeList = Block;
+  Me->NumInUse--;
+}
+
+#endif /* ES_PAYLOAD_BLOCKS > 0 */
+/*------------------------------- Footnotes -------------------------------*/
+/*------------------------------ End of file ------------------------------*/
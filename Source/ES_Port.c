@@ -15,11 +15,21 @@
  History
  When           Who     What/Why
  -------------- ---     --------
- 08/13/13 12:42 jec     moved the hardware specific aspects of the timer here
- 08/06/13 13:17 jec     Began moving the stuff from the V2 framework files
- 03/05/14 13:20	joa		Began port for TM4C123G
+ 10/20/26 09:52 jh      added _HW_GetISRPriority for ES_MAILBOX_CHECK
+ 10/18/26 17:11 jh      added the PendSV activator for ES_PREEMPTIVE
+ 10/18/26 11:48 jh      start the DWT cycle counter for _HW_GetCycles
+ 10/17/26 18:10 jh      added _HW_Idle, sleeps in WFI until the next interrupt
+ 10/17/26 17:10 jh      added the 64 bit clock on Timer 5, extended in the
+                        SysTick handler. _HW_GetTimestamp now reads it, so
+                        SysTickCounter is back to 16 bits
+ 10/17/26 14:40 jh      added _HW_GetTimestamp, SysTickCounter is now 32 bits
+                        internally so that the timestamp wraps cleanly
+ 10/17/26 12:10 jh      added CPUgetIPSR to support _HW_IsInISR
  03/13/14 10:30	joa		Updated files to use with Cortex M4 processor core.
  	 	 	 	 	 	Specifically, this was tested on a TI TM4C123G mcu.
+ 03/05/14 13:20	joa		Began port for TM4C123G
+ 08/13/13 12:42 jec     moved the hardware specific aspects of the timer here
+ 08/06/13 13:17 jec     Began moving the stuff from the V2 framework files
 ****************************************************************************/
 #include <stdint.h>
 #include <stdbool.h>
@@ -29,17 +39,46 @@
 #include "driverlib/uart.h"
 #include "driverlib/pin_map.h"	// Define PART_TM4C123GH6PM in project
 #include "driverlib/systick.h"
+#include "driverlib/timer.h"
+#include "driverlib/cpu.h"
 #include "driverlib/gpio.h"
 #include "utils/uartstdio.h"
 #include "ES_Port.h"
 #include "ES_Types.h"
 #include "ES_Timers.h"
+#ifdef ES_PREEMPTIVE
+#include "inc/hw_types.h"
+#include "inc/hw_nvic.h"
+#include "inc/hw_ints.h"
+#include "ES_Framework.h"
+#endif
 
 #define UART_PORT 		0
 #define UART_BAUD		115200UL
 #define SRC_CLK_FREQ	16000000UL
 #define CLK_FREQ		40000000UL
 
+// the 16/32 bit timer used as the free running 32 bit count for the 64 bit 
+// clock. All of the wide timers are taken by the application.
+#define CLOCK_TIMER_PERIPH	SYSCTL_PERIPH_TIMER5
+#define CLOCK_TIMER_BASE	TIMER5_BASE
+
+// the debug registers that turn on the DWT cycle counter behind
+// _HW_GetCycles. TRCENA in DEMCR powers the DWT, CYCCNTENA starts the count
+#define ES_DEMCR			(*(volatile uint32_t *)0xE000EDFC)
+#define ES_DEMCR_TRCENA		0x01000000
+#define ES_DWT_CTRL			(*(volatile uint32_t *)0xE0001000)
+#define ES_DWT_CTRL_CYCCNTENA	0x00000001
+
+#ifdef ES_PREEMPTIVE
+// PendSV gets the lowest priority, so it comes in only once every other
+// interrupt has returned
+#define PENDSV_PRIORITY		0xE0
+
+void _HW_PreemptThread(void);
+void _HW_PreemptReturn(void);
+#endif
+
 // TickCount is used to track the number of timer ints that have occurred
 // since the last check. It should really never be more than 1, but just to
 // be sure, we increment it in the interrupt response rather than simply 
@@ -54,6 +93,12 @@ static volatile uint8_t TickCount;
 // 8 and 16 bit processors
 static volatile uint16_t SysTickCounter = 0;
 
+// upper 32 bits of the 64 bit clock, and the value of the free running timer
+// when the SysTick handler last looked at it, used to spot the wrap
+static volatile uint32_t ClockEpoch = 0;
+static volatile uint32_t ClockLast = 0;
+static bool ClockRunning = false;
+
 /****************************************************************************
  Function
      _HW_Timer_Init
@@ -73,6 +118,25 @@ static volatile uint16_t SysTickCounter = 0;
 ****************************************************************************/
 void _HW_Timer_Init(TimerRate_t Rate)
 {
+	if (ClockRunning == false)
+	{
+		/* start the free running up counter for the 64 bit clock */
+		SysCtlPeripheralEnable(CLOCK_TIMER_PERIPH);
+		while (SysCtlPeripheralReady(CLOCK_TIMER_PERIPH) == false)
+		{
+		}
+		TimerConfigure(CLOCK_TIMER_BASE, TIMER_CFG_PERIODIC_UP);
+		TimerLoadSet(CLOCK_TIMER_BASE, TIMER_A, 0xFFFFFFFF);
+		TimerEnable(CLOCK_TIMER_BASE, TIMER_A);
+		/* and the cycle counter */
+		ES_DEMCR |= ES_DEMCR_TRCENA;
+		ES_DWT_CYCCNT = 0;
+		ES_DWT_CTRL |= ES_DWT_CTRL_CYCCNTENA;
+#ifdef ES_PREEMPTIVE
+		IntPrioritySet(FAULT_PENDSV, PENDSV_PRIORITY);
+#endif
+		ClockRunning = true;
+	}
 	SysTickPeriodSet(Rate);			/* Set the SysTick Interrupt Rate */
 	SysTickIntEnable();				/* Enable the SysTick Interrupt */
 	SysTickEnable();				/* Enable SysTick */
@@ -99,12 +163,23 @@ void _HW_Timer_Init(TimerRate_t Rate)
 ****************************************************************************/
 void SysTickIntHandler(void)
 {
+	uint32_t ClockNow;
+
 	/* Interrupt automatically cleared by hardware */
   ++TickCount;          /* flag that it occurred and needs a response */
 	++SysTickCounter;     // keep the free running time going
+	// extend the 32 bit clock timer, it wraps every 107S so the SysTick
+	// is sure to see every wrap
+	ClockNow = TimerValueGet(CLOCK_TIMER_BASE, TIMER_A);
+	if (ClockNow < ClockLast)
+		++ClockEpoch;
+	ClockLast = ClockNow;
 #ifdef LED_DEBUG
 	BlinkLED();
 #endif
+#ifdef ES_PREEMPTIVE
+	ES_RequestPreempt();  // so the timers run without waiting for ES_Run
+#endif
 }
 
 /****************************************************************************
@@ -127,6 +202,80 @@ uint16_t _HW_GetTickCount(void)
    return (SysTickCounter);
 }
 
+/****************************************************************************
+ Function
+    _HW_GetTimestamp()
+ Parameters
+    none
+ Returns
+    uint32_t   free running time in microseconds
+ Description
+    the low 32 bits of _HW_GetMicros, for measuring latencies
+ Notes
+    safe to call from an ISR
+ Author
+    J. He, 10/17/26 14:40
+****************************************************************************/
+uint32_t _HW_GetTimestamp(void)
+{
+   return ((uint32_t)_HW_GetMicros());
+}
+
+/****************************************************************************
+ Function
+    _HW_GetClock()
+ Parameters
+    none
+ Returns
+    uint64_t   free running time in ES_CLOCK_TICKS_PER_US units (25nS)
+ Description
+    the 32 bit count of the clock timer, extended to 64 bits by the number of
+    times the SysTick handler has seen it wrap
+ Notes
+    safe to call from an ISR, it turns ints off locally rather than using
+    EnterCritical so it may also be called inside a critical region.
+    Returns 0 until _HW_Timer_Init has started the clock timer. A wrap that 
+    the SysTick handler has not seen yet is caught by comparing with 
+    ClockLast, which holds as long as the SysTick is running.
+ Author
+    J. He, 10/17/26 17:15
+****************************************************************************/
+uint64_t _HW_GetClock(void)
+{
+   uint32_t SavedPRIMASK;
+   uint32_t Now;
+   uint32_t Epoch;
+
+   if (ClockRunning == false)
+      return 0;
+   SavedPRIMASK = CPUgetPRIMASK_cpsid();
+   Now = TimerValueGet(CLOCK_TIMER_BASE, TIMER_A);
+   Epoch = ClockEpoch;
+   if (Now < ClockLast)
+      Epoch++;    // wrapped since the last SysTick
+   CPUsetPRIMASK(SavedPRIMASK);
+   return (((uint64_t)Epoch << 32) | Now);
+}
+
+/****************************************************************************
+ Function
+    _HW_GetMicros()
+ Parameters
+    none
+ Returns
+    uint64_t   free running time in microseconds
+ Description
+    _HW_GetClock scaled to uS
+ Notes
+    safe to call from an ISR
+ Author
+    J. He, 10/17/26 17:18
+****************************************************************************/
+uint64_t _HW_GetMicros(void)
+{
+   return (_HW_GetClock() / ES_CLOCK_TICKS_PER_US);
+}
+
 /****************************************************************************
  Function
      _HW_Process_Pending_Ints
@@ -159,6 +308,33 @@ bool _HW_Process_Pending_Ints( void )
    return true; // always return true to allow loop test in ES_Run to proceed
 }
 
+/****************************************************************************
+ Function
+     _HW_Idle
+ Parameters
+     uint16_t MaxTicks, the number of ticks until the next framework timeout
+ Returns
+     None.
+ Description
+     puts the processor to sleep until the next interrupt. Called by ES_Run
+     when there is nothing to do.
+ Notes
+     must be called with interrupts off (inside EnterCritical). WFI still
+     wakes on a pending interrupt, which then runs once ints are restored,
+     so an interrupt that comes after ES_Run decided to idle is not missed.
+     The SysTick keeps running because it also keeps ES_Timer_GetTime and
+     the 64 bit clock going, so the sleep is never more than 1 tick and
+     MaxTicks is not needed here.
+ Author
+     J. He, 10/17/26 18:12
+****************************************************************************/
+void _HW_Idle(uint16_t MaxTicks)
+{
+   (void)MaxTicks;
+   if (TickCount == 0)
+      CPUwfi();
+}
+
 /****************************************************************************
  Function
      ConsoleInit
@@ -194,6 +370,168 @@ void ConsoleInit(void)
 
 }
 
+/****************************************************************************
+ Function
+     _HW_GetISRPriority
+ Parameters
+     none
+ Returns
+     uint8_t the NVIC priority of the running ISR, 0xFF for the exceptions
+     with a fixed priority
+ Description
+     looks up the priority of the exception in IPSR
+ Notes
+     called from the ISR posts with ES_MAILBOX_CHECK
+ Author
+     J. He, 10/20/26 09:45
+****************************************************************************/
+uint8_t _HW_GetISRPriority(void)
+{
+	int32_t Priority = IntPriorityGet(_HW_GetISRNumber());
+
+	return (Priority < 0) ? 0xFF : (uint8_t)Priority;
+}
+
+#ifdef ES_PREEMPTIVE
+/****************************************************************************
+ Function
+     _HW_RequestPreempt
+ Parameters
+     none
+ Returns
+     None.
+ Description
+     pends the PendSV exception, which runs ES_Preempt as soon as the ISRs
+     that are running or waiting have returned
+ Notes
+     called from the ISRs through ES_RequestPreempt
+ Author
+     J. He, 10/18/26 16:49
+****************************************************************************/
+void _HW_RequestPreempt(void)
+{
+	HWREG(NVIC_INT_CTRL) = NVIC_INT_CTRL_PEND_SV;
+}
+
+/****************************************************************************
+ Function
+     _HW_PreemptThread
+ Parameters
+     none
+ Returns
+     None.
+ Description
+     runs the preempting services in thread mode, entered from
+     PendSVIntHandler, leaves through _HW_PreemptReturn
+ Notes
+     ints are on while the services run so that an ISR can preempt them in
+     turn, and off from the return until NmiIntHandler is done
+ Author
+     J. He, 10/18/26 16:52
+****************************************************************************/
+void _HW_PreemptThread(void)
+{
+	CPUcpsie();
+	ES_Preempt();
+	CPUcpsid();
+}
+
+/****************************************************************************
+ Function
+     PendSVIntHandler
+ Parameters
+     none
+ Returns
+     None.
+ Description
+     interrupt response for PendSV. The run functions can not run in the
+     handler itself, a higher priority service could then never preempt
+     them. So this builds an exception frame on the stack and returns
+     through it into _HW_PreemptThread in thread mode, leaving the frame of
+     the code that was preempted underneath.
+ Notes
+     put this and NmiIntHandler in the vector table of the startup file.
+     The EXC_RETURN is pushed for NmiIntHandler, it says if the preempted
+     code has an FPU frame. This is the same trick as the QK kernel uses.
+ Author
+     J. He, 10/18/26 16:55
+****************************************************************************/
+#if defined(ccs)
+void PendSVIntHandler(void)
+{
+	__asm("    ldr     r3, =0xE000ED04	;	NVIC_INT_CTRL\n"
+		  "    mov     r1, #1\n"
+		  "    lsl     r1, r1, #27		;	r1 = NVIC_INT_CTRL_UNPEND_SV\n"
+		  "    cpsid   i				;	Disable interrupts\n"
+		  "    str     r1, [r3]			;	drop a PendSV that came since\n"
+		  "    push    {r0, lr}			;	EXC_RETURN, r0 keeps sp aligned\n"
+		  "    lsr     r3, r1, #3		;	r3 = the Thumb bit for xPSR\n"
+		  "    ldr     r2, =_HW_PreemptThread\n"
+		  "    sub     r2, r2, #1		;	PC of the frame, bit 0 clear\n"
+		  "    ldr     r1, =_HW_PreemptReturn	;	LR of the frame\n"
+		  "    sub     sp, sp, #32		;	make the frame\n"
+		  "    add     r0, sp, #20\n"
+		  "    stm     r0!, {r1-r3}		;	store its LR, PC & xPSR\n"
+		  "    mov     r0, #6\n"
+		  "    mvn     r0, r0			;	r0 = 0xFFFFFFF9, thread mode\n"
+		  "    dsb\n"
+		  "    bx      r0				;	Return into _HW_PreemptThread\n");
+}
+
+/****************************************************************************
+ Function
+     _HW_PreemptReturn
+ Parameters
+     none
+ Returns
+     None.
+ Description
+     where _HW_PreemptThread returns to, pends the NMI to get back into
+     handler mode
+ Notes
+     clears CONTROL.FPCA first so that the NMI frame has no FPU part
+ Author
+     J. He, 10/18/26 16:58
+****************************************************************************/
+void _HW_PreemptReturn(void)
+{
+	__asm("    mrs     r0, CONTROL\n"
+		  "    bic     r0, r0, #4		;	clear FPCA\n"
+		  "    msr     CONTROL, r0\n"
+		  "    isb\n"
+		  "    ldr     r0, =0xE000ED04	;	NVIC_INT_CTRL\n"
+		  "    mov     r1, #1\n"
+		  "    lsl     r1, r1, #31		;	r1 = NVIC_INT_CTRL_NMI_SET\n"
+		  "    str     r1, [r0]\n"
+		  "    b       $				;	the NMI never returns here\n");
+}
+
+/****************************************************************************
+ Function
+     NmiIntHandler
+ Parameters
+     none
+ Returns
+     None.
+ Description
+     interrupt response for the NMI pended by _HW_PreemptReturn. Drops its
+     own frame and returns through the frame of the preempted code.
+ Notes
+     the NMI is not free for anything else with ES_PREEMPTIVE
+ Author
+     J. He, 10/18/26 17:01
+****************************************************************************/
+void NmiIntHandler(void)
+{
+	__asm("    add     sp, sp, #32		;	drop the NMI frame\n"
+		  "    cpsie   i				;	Enable interrupts\n"
+		  "    pop     {r0, pc}			;	Return with the saved EXC_RETURN\n");
+}
+#else
+#error ES_PREEMPTIVE has the PendSV activator for CCS only
+#endif
+#endif /* ES_PREEMPTIVE */
+
 
 
 #if defined(ccs)
@@ -232,6 +570,16 @@ void CPUsetFAULTMASK(uint32_t newFAULTMASK)
 	__asm("    msr    faultmask, r0	;	Store newFAULTMASK in FAULTMASK\n");
 	//	  "    bx     lr			;	Return from function\n");
 }
+
+uint32_t CPUgetIPSR(void)
+{
+    __asm("    mrs     r0, IPSR		;	Store IPSR in r0\n"
+          "    bx      lr			;	Return from function\n"
+    	  "							;	Return IPSR in r0\n");
+
+    /* Used to satisfy compiler. Actual return in r0 */
+	return 0;
+}
 #endif
 
 #if defined(rvmdk) || defined(__ARMCC_VERSION)
@@ -272,4 +620,10 @@ inline void CPUsetFAULTMASK(uint32_t newFAULTMASK)
     msr     FAULTMASK, newFAULTMASK	  // Store newFAULTMASK in FAULTMASK
   }
 }
+
+inline uint32_t CPUgetIPSR(void)
+{
+  register uint32_t regIPSR __asm("ipsr");  // named register for IPSR
+  return regIPSR;
+}
 #endif
@@ -0,0 +1,1017 @@
+/****************************************************************************
+ Module
+   ES_Port_POSIX.c
+
+ Revision
+   1.0.1
+
+ Description
+   This is the POSIX host port of the hardware specific functions of the
+   Events & Services Framework. It replaces ES_Port.c (and termio.c) when
+   the framework is built on a Linux box to be run, profiled or benchmarked
+   without the Tiva.
+
+ Notes
+   Build with -DES_PORT_POSIX -std=gnu99 -pthread and leave ES_Port.c,
+   termio.c, uartstdio.c and retarget.c out of the build.
+   The SysTick is replaced by a timerfd on CLOCK_MONOTONIC. Expirations are
+   collected whenever the framework asks for them, so the tick count keeps
+   running while the application is blocked, just as it does on the Tiva.
+   Interrupts are simulated with signals, and EnterCritical/ExitCritical
+   block that set of signals for the calling thread.
+   Add -DES_VIRTUAL_CLOCK for a simulation that runs faster than real time.
+   The clock then only moves when ES_Run idles, and it jumps straight to
+   the next timer tick that matters or the next interrupt scheduled with
+   _HW_ScheduleInterrupt, which stand in for the hardware timers. Time
+   stands still while the services run, so a run is repeatable.
+   With ES_NUM_INSTANCES > 1 every robot sees the same clock and ticks, and
+   has interrupts of its own scheduled. They run when that robot is
+   selected, signals go to whichever robot is selected.
+   With ES_PREEMPTIVE, the last simulated ISR out calls ES_Preempt from the
+   signal handler, with the interrupt signals let through again, as PendSV
+   does on the Tiva. The tick then also comes as SIGRTMAX, from a POSIX
+   timer (link with -lrt on an old glibc), so that it can preempt. The run
+   functions that this calls use stdio, which is not safe in a signal
+   handler, so a run that preempts main() in the middle of a printf may
+   garble the output. With ES_VIRTUAL_CLOCK there is no tick signal and the
+   scheduled interrupts preempt only at the points where ES_Run looks for
+   them.
+   With ES_THREADS, ES_Run hands the services to a pool of that many
+   worker threads. The workers block the interrupt signals, so the
+   simulated ISRs all run on the thread that called ES_Run. A critical
+   region holds _HW_CriticalLock as well as blocking the signals, one lock
+   for all of the threads, just as there is one interrupt enable on the
+   Tiva.
+
+ History
+ When           Who     What/Why
+ -------------- ---     --------
+ 10/21/26 10:40 jh      run the scheduled interrupts after the ticks before
+                        them, a replay of them came a tick later
+ 10/19/26 10:27 jh      added the worker threads for ES_THREADS, and the lock
+                        that makes EnterCritical work across them
+ 10/18/26 17:11 jh      run ES_Preempt at the end of the simulated ISRs for
+                        ES_PREEMPTIVE, and send the tick as SIGRTMAX
+ 10/18/26 11:48 jh      added _HW_GetCycles for the run function profile
+ 10/18/26 09:43 jh      keep the tick count & the scheduled interrupts for
+                        each robot when ES_NUM_INSTANCES > 1
+ 10/17/26 23:50 jh      added the virtual clock (ES_VIRTUAL_CLOCK) and
+                        _HW_ScheduleInterrupt
+ 10/17/26 23:00 jh      run the ISR replay with the tick responses, track the
+                        signal being handled for _HW_GetISRNumber, keep the
+                        saved mask safe from ISRs that wake _HW_Idle
+ 10/17/26 18:15 jh      added _HW_Idle, sleeps in ppoll until the timeout
+ 10/17/26 17:10 jh      added _HW_GetClock & _HW_GetMicros
+ 10/17/26 14:40 jh      added _HW_GetTimestamp
+ 10/17/26 12:10 jh      count ISR nesting in the trampoline for _HW_IsInISR
+ 10/17/26 09:40 jh      Began coding, based on the TM4C123G port in ES_Port.c
+****************************************************************************/
+#if defined(ES_PORT_POSIX)
+
+#define _GNU_SOURCE  // for ppoll
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <pthread.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/timerfd.h>
+#include "ES_Port.h"
+#include "ES_Types.h"
+#include "ES_Timers.h"
+#include "ES_Replay.h"
+#include "ES_Instance.h"
+#if defined(ES_PREEMPTIVE)
+#include "ES_Framework.h"
+#endif
+
+#define NSEC_PER_USEC 1000L
+#define USEC_PER_SEC  1000000L
+#define NSEC_PER_SEC  1000000000LL
+
+// storage for the signal mask saved by EnterCritical
+ES_THREAD_LOCAL sigset_t _SIGMASK_temp;
+// the set of signals that are treated as interrupts, blocked by EnterCritical
+sigset_t _HW_IntSigSet;
+// non-zero while a simulated ISR is running, tested by _HW_IsInISR
+ES_THREAD_LOCAL volatile sig_atomic_t _HW_ISRNesting = 0;
+// the signal whose simulated ISR is running, read by _HW_GetISRNumber
+ES_THREAD_LOCAL volatile sig_atomic_t _HW_ISRSignal = 0;
+
+#if ES_THREADS > 0
+// held by EnterCritical, so that only one thread is in a critical region
+pthread_mutex_t _HW_CriticalLock = PTHREAD_MUTEX_INITIALIZER;
+
+// the services listed for the worker threads, by priority, with the robots
+// listed for each in the order they were listed. WorkLock guards them and
+// the counts, WorkToDo wakes the workers and WorkDone _HW_WaitWorkers.
+static pthread_mutex_t WorkLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t WorkToDo = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t WorkDone = PTHREAD_COND_INITIALIZER;
+static struct {
+  uint16_t Instances[ES_NUM_INSTANCES];
+  uint16_t First;
+  uint16_t Count;
+} WorkList[NUM_SERVICES];
+static uint32_t NumListed = 0;
+static uint32_t NumBusy = 0;
+static void (*pRunWorkFunc)(uint16_t Instance, uint8_t Service);
+#endif
+
+#if !defined(ES_VIRTUAL_CLOCK)
+// the timerfd that stands in for SysTick, -1 until _HW_Timer_Init is called
+static int TickTimerFd = -1;
+#if defined(ES_PREEMPTIVE)
+// the POSIX timer that sends the tick as SIGRTMAX, so that it can preempt
+static timer_t TickSignalTimer;
+static bool TickSignalMade = false;
+#endif
+#endif
+
+#if defined(ES_PREEMPTIVE)
+// set by _HW_RequestPreempt, the last ISR out then calls ES_Preempt
+static volatile sig_atomic_t PreemptPending = 0;
+#endif
+
+// Global tick count to monitor number of virtual SysTick Interrupts
+// make uint16_t to maintain backwards compatibility with ES_Port.c
+static volatile uint16_t SysTickCounter = 0;
+
+// the handler connected to each of the interrupt signals
+static void (*ISRTable[NSIG])(void);
+
+// terminal settings in place before ConsoleInit, restored at exit
+static struct termios SavedTermios;
+static bool TermiosSaved = false;
+
+// keystroke read by kbhit and not yet retrieved, -1 if none
+static int PendingKey = -1;
+static bool StdinClosed = false;
+
+#if defined(ES_VIRTUAL_CLOCK)
+// the number of interrupts that can be scheduled at once
+#define MAX_SCHEDULED 8
+
+// virtual time in nS, and when the next tick is due. A period of 0 means
+// that the tick is off.
+static uint64_t VirtualNow;
+static uint64_t NextTickDue;
+static uint64_t TickPeriod;
+#endif
+
+// the clock is shared, the rest is kept for each robot, see ES_Instance.h
+typedef struct {
+  // TickCount is used to track the number of timer ticks that have occurred
+  // since the last check. On the host it can be more than 1 if the process
+  // was not scheduled for a while, so it is wider than on the Tiva.
+  volatile uint32_t TickCount;
+#if defined(ES_VIRTUAL_CLOCK)
+  // the interrupts scheduled by _HW_ScheduleInterrupt, a NULL pISR is free
+  struct {
+    uint64_t Due;
+    void (*pISR)(void);
+  } Scheduled[MAX_SCHEDULED];
+#endif
+} PortData_t;
+
+static PortData_t Instances[ES_NUM_INSTANCES];
+
+#define Me ES_THIS(Instances)
+
+static void InitIntSigSet(void);
+static void CollectTicks(void);
+static void AddTicks(uint32_t NumTicks);
+static void SignalTrampoline(int SigNum);
+static void RestoreTerminal(void);
+#if defined(ES_VIRTUAL_CLOCK)
+static uint64_t NextScheduledDue(void);
+static void RunScheduled(void);
+#endif
+#if defined(ES_PREEMPTIVE) && !defined(ES_VIRTUAL_CLOCK)
+static void TickISR(void);
+#endif
+#if ES_THREADS > 0
+static void *WorkerThread(void *pArg);
+#endif
+
+/****************************************************************************
+ Function
+     _HW_Timer_Init
+ Parameters
+     TimerRate_t Rate set to one of the ES_Timer_RATE_XX values to set the
+     Tick rate
+ Returns
+     None.
+ Description
+     Creates (on the first call) the timerfd used as the virtual SysTick and
+     programs it with the requested period.
+ Notes
+     Several services call ES_Timer_Init from their init functions, so the
+     timer is only created once and simply re-programmed after that.
+     With ES_VIRTUAL_CLOCK the first tick is due a period from now.
+     With ES_PREEMPTIVE the tick signal timer is set right after the
+     timerfd, with the same period, so each signal follows an expiration.
+ Author
+     J. He, 10/17/26 09:52
+****************************************************************************/
+void _HW_Timer_Init(TimerRate_t Rate)
+{
+#if defined(ES_VIRTUAL_CLOCK)
+  InitIntSigSet();
+  TickPeriod = (uint64_t)Rate * NSEC_PER_USEC;
+  NextTickDue = VirtualNow + TickPeriod;
+#else
+  struct itimerspec NewValue;
+
+  InitIntSigSet();
+  if (TickTimerFd < 0)
+  {
+    TickTimerFd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (TickTimerFd < 0)
+    {
+      perror("_HW_Timer_Init: timerfd_create");
+      exit(EXIT_FAILURE);
+    }
+  }
+  // a zero period disarms the timer, matching ES_Timer_RATE_OFF
+  NewValue.it_interval.tv_sec = (long)Rate / USEC_PER_SEC;
+  NewValue.it_interval.tv_nsec = ((long)Rate % USEC_PER_SEC) * NSEC_PER_USEC;
+  NewValue.it_value = NewValue.it_interval;
+  timerfd_settime(TickTimerFd, 0, &NewValue, NULL);
+#if defined(ES_PREEMPTIVE)
+  if (TickSignalMade == false)
+  {
+    struct sigevent TickEvent;
+
+    memset(&TickEvent, 0, sizeof(TickEvent));
+    TickEvent.sigev_notify = SIGEV_SIGNAL;
+    TickEvent.sigev_signo = SIGRTMAX;
+    if ((_HW_AttachInterrupt(SIGRTMAX, TickISR) == false) ||
+        (timer_create(CLOCK_MONOTONIC, &TickEvent, &TickSignalTimer) != 0))
+    {
+      perror("_HW_Timer_Init: timer_create");
+      exit(EXIT_FAILURE);
+    }
+    TickSignalMade = true;
+  }
+  timer_settime(TickSignalTimer, 0, &NewValue, NULL);
+#endif
+#endif
+}
+
+/****************************************************************************
+ Function
+    _HW_GetTickCount()
+ Parameters
+    none
+ Returns
+    uint16_t   count of number of system ticks that have occurred.
+ Description
+    wrapper for access to SysTickCounter. Collects any ticks that expired
+    since the last call first, so the count is current even while blocking.
+ Notes
+    safe to call from a simulated ISR
+ Author
+    J. He, 10/17/26 10:05
+****************************************************************************/
+uint16_t _HW_GetTickCount(void)
+{
+   CollectTicks();
+   return (SysTickCounter);
+}
+
+/****************************************************************************
+ Function
+    _HW_GetTimestamp()
+ Parameters
+    none
+ Returns
+    uint32_t   free running time in microseconds
+ Description
+    the low 32 bits of _HW_GetMicros, for measuring latencies
+ Notes
+    safe to call from a simulated ISR
+ Author
+    J. He, 10/17/26 14:44
+****************************************************************************/
+uint32_t _HW_GetTimestamp(void)
+{
+   return ((uint32_t)_HW_GetMicros());
+}
+
+/****************************************************************************
+ Function
+    _HW_GetClock()
+ Parameters
+    none
+ Returns
+    uint64_t   free running time in ES_CLOCK_TICKS_PER_US units (1nS)
+ Description
+    CLOCK_MONOTONIC in nanoseconds, or the virtual clock
+ Notes
+    safe to call from a simulated ISR
+ Author
+    J. He, 10/17/26 17:20
+****************************************************************************/
+uint64_t _HW_GetClock(void)
+{
+#if defined(ES_VIRTUAL_CLOCK)
+   return (VirtualNow);
+#else
+   struct timespec Now;
+
+   clock_gettime(CLOCK_MONOTONIC, &Now);
+   return ((uint64_t)Now.tv_sec * NSEC_PER_SEC + (uint64_t)Now.tv_nsec);
+#endif
+}
+
+/****************************************************************************
+ Function
+    _HW_GetMicros()
+ Parameters
+    none
+ Returns
+    uint64_t   free running time in microseconds
+ Description
+    _HW_GetClock scaled to uS
+ Notes
+    safe to call from a simulated ISR
+ Author
+    J. He, 10/17/26 17:21
+****************************************************************************/
+uint64_t _HW_GetMicros(void)
+{
+   return (_HW_GetClock() / ES_CLOCK_TICKS_PER_US);
+}
+
+/****************************************************************************
+ Function
+    _HW_GetCycles()
+ Parameters
+    none
+ Returns
+    uint32_t   free running time in ES_CYCLES_PER_US units (1nS), wraps
+               every 4.3S
+ Description
+    the low 32 bits of CLOCK_MONOTONIC in nanoseconds, the host's stand in
+    for the DWT cycle counter
+ Notes
+    reads the real clock even with ES_VIRTUAL_CLOCK, which stands still
+    while a run function is running
+ Author
+    J. He, 10/18/26 11:41
+****************************************************************************/
+uint32_t _HW_GetCycles(void)
+{
+   struct timespec Now;
+
+   clock_gettime(CLOCK_MONOTONIC, &Now);
+   return ((uint32_t)((uint64_t)Now.tv_sec * NSEC_PER_SEC + 
+                      (uint64_t)Now.tv_nsec));
+}
+
+/****************************************************************************
+ Function
+     _HW_Process_Pending_Ints
+ Parameters
+     none
+ Returns
+     always true.
+ Description
+     collects the expirations of the virtual SysTick and runs the framework
+     tick response once for each of them. With a replay loaded by
+     ES_ReplayLoad, the interrupts recorded during each tick are replayed
+     after its response. With ES_VIRTUAL_CLOCK, any scheduled interrupts
+     that have come due are run after the ticks. _HW_Idle stops the clock
+     at the first interrupt due, so those ticks all came before it, and a
+     timer that the ISR starts counts from the tick before it as on the
+     Tiva.
+ Notes
+     returns true for the same reason as the Tiva version, so that it can be
+     used in the conditional while() loop in ES_Run.
+ Author
+     J. He, 10/17/26 10:08
+****************************************************************************/
+bool _HW_Process_Pending_Ints( void )
+{
+   CollectTicks();
+   ES_ReplayDeliver(); // anything still due in the tick we are in
+   while (Me->TickCount > 0)
+   {
+      /* call the framework tick response to actually run the timers */
+      ES_Timer_Tick_Resp();
+      ES_ReplayTick();
+      Me->TickCount--;
+   }
+#if defined(ES_VIRTUAL_CLOCK)
+   RunScheduled();
+#endif
+   return true; // always return true to allow loop test in ES_Run to proceed
+}
+
+/****************************************************************************
+ Function
+     _HW_Idle
+ Parameters
+     uint16_t MaxTicks, the number of ticks until the next framework timeout
+     or ES_Timer_NO_TIMEOUT
+ Returns
+     None.
+ Description
+     sleeps until MaxTicks ticks have expired, a key arrives on stdin or a
+     simulated interrupt comes in. Called by ES_Run when there is nothing
+     to do. A replay wakes it for the next recorded interrupt too.
+     With ES_VIRTUAL_CLOCK it moves the clock on to the first of those
+     ticks and the scheduled interrupts instead of sleeping, and only waits
+     for a key or a signal if neither will ever come.
+ Notes
+     must be called inside EnterCritical. ppoll puts back the signal mask
+     saved there for just as long as it waits, so a simulated interrupt that
+     comes after ES_Run decided to idle stays pending and ends the wait.
+     That ISR may use EnterCritical itself, which overwrites _SIGMASK_temp,
+     so the mask is put back for the ExitCritical in ES_Run. With
+     ES_THREADS, _HW_CriticalLock is let go for the wait too, for the ISR
+     to take.
+ Author
+     J. He, 10/17/26 18:18
+****************************************************************************/
+void _HW_Idle(uint16_t MaxTicks)
+{
+  struct pollfd StdinPoll = { STDIN_FILENO, POLLIN, 0 };
+  struct timespec *pTimeout = NULL;
+  uint16_t ReplayTicks;
+  sigset_t SavedMask;
+#if defined(ES_VIRTUAL_CLOCK)
+  uint64_t Wake;
+#else
+  struct itimerspec TickTimer;
+  struct timespec Timeout;
+  int64_t Sleep;
+#endif
+
+  CollectTicks();
+  ReplayTicks = ES_ReplayTicksToNext();
+  if ((Me->TickCount > 0) || (PendingKey >= 0) || (ReplayTicks == 0))
+    return;
+  if (ReplayTicks < MaxTicks)
+    MaxTicks = ReplayTicks;
+#if defined(ES_VIRTUAL_CLOCK)
+  Wake = NextScheduledDue();
+  if ((MaxTicks != ES_Timer_NO_TIMEOUT) && (TickPeriod != 0) &&
+      (NextTickDue + (MaxTicks - 1) * TickPeriod < Wake))
+    Wake = NextTickDue + (MaxTicks - 1) * TickPeriod;
+  if (Wake != UINT64_MAX)
+  {
+    if (Wake > VirtualNow)
+      VirtualNow = Wake;
+    return;
+  }
+#else
+  if ((MaxTicks != ES_Timer_NO_TIMEOUT) && (TickTimerFd >= 0) &&
+      (timerfd_gettime(TickTimerFd, &TickTimer) == 0) &&
+      (TickTimer.it_interval.tv_nsec | TickTimer.it_interval.tv_sec))
+  {
+    // the rest of this tick and then MaxTicks-1 more
+    Sleep = (int64_t)TickTimer.it_value.tv_sec * NSEC_PER_SEC +
+            TickTimer.it_value.tv_nsec + (int64_t)(MaxTicks - 1) *
+            ((int64_t)TickTimer.it_interval.tv_sec * NSEC_PER_SEC +
+             TickTimer.it_interval.tv_nsec);
+    Timeout.tv_sec = Sleep / NSEC_PER_SEC;
+    Timeout.tv_nsec = Sleep % NSEC_PER_SEC;
+    pTimeout = &Timeout;
+  }
+#endif
+  // when stdin has closed, only the timeout or an interrupt can wake us
+  SavedMask = _SIGMASK_temp;
+#if ES_THREADS > 0
+  pthread_mutex_unlock(&_HW_CriticalLock);
+#endif
+  ppoll(&StdinPoll, (StdinClosed == false) ? 1 : 0, pTimeout, &SavedMask);
+#if ES_THREADS > 0
+  pthread_mutex_lock(&_HW_CriticalLock);
+#endif
+  _SIGMASK_temp = SavedMask;
+}
+
+/****************************************************************************
+ Function
+     ConsoleInit
+ Parameters
+     none
+ Returns
+     none.
+ Description
+     puts stdin into non-canonical, no-echo mode so that kbhit and
+     TERMIO_GetChar behave like the UART on the Tiva
+ Notes
+     the original terminal settings are restored when the process exits
+ Author
+     J. He, 10/17/26 10:14
+ ****************************************************************************/
+void ConsoleInit(void)
+{
+  struct termios RawTermios;
+
+  setvbuf(stdout, NULL, _IONBF, 0);
+  if (isatty(STDIN_FILENO) && (TermiosSaved == false) &&
+      (tcgetattr(STDIN_FILENO, &SavedTermios) == 0))
+  {
+    TermiosSaved = true;
+    atexit(RestoreTerminal);
+    RawTermios = SavedTermios;
+    RawTermios.c_lflag &= ~(ICANON | ECHO);
+    RawTermios.c_cc[VMIN] = 1;
+    RawTermios.c_cc[VTIME] = 0;
+    tcsetattr(STDIN_FILENO, TCSANOW, &RawTermios);
+  }
+}
+
+#if defined(ES_PREEMPTIVE)
+/****************************************************************************
+ Function
+     _HW_RequestPreempt
+ Parameters
+     none
+ Returns
+     None.
+ Description
+     marks that ES_Preempt is to be called once the last simulated ISR
+     returns
+ Notes
+     called from the ISRs through ES_RequestPreempt. The scheduled
+     interrupts of the virtual clock run inside ES_Preempt already, so for
+     them the mark is simply left for the next signal.
+ Author
+     J. He, 10/18/26 17:04
+****************************************************************************/
+void _HW_RequestPreempt(void)
+{
+  PreemptPending = 1;
+}
+#endif
+
+#if ES_THREADS > 0
+/****************************************************************************
+ Function
+     _HW_StartWorkers
+ Parameters
+     void (*pRunWork)(uint16_t Instance, uint8_t Service) : what the
+     workers call for each service that is listed
+ Returns
+     bool : false if no worker thread could be started
+ Description
+     starts the ES_THREADS worker threads, on the first call only
+ Notes
+     the workers inherit the signal mask, so the interrupt signals are
+     blocked while they are made and are only ever handled by this thread
+ Author
+     J. He, 10/19/26 10:14
+****************************************************************************/
+bool _HW_StartWorkers(void (*pRunWork)(uint16_t Instance, uint8_t Service))
+{
+  static bool Started = false;
+  pthread_t Worker;
+  sigset_t SavedMask;
+  int i;
+
+  if (Started == true)
+    return true;
+  pRunWorkFunc = pRunWork;
+  InitIntSigSet();
+  pthread_sigmask(SIG_BLOCK, &_HW_IntSigSet, &SavedMask);
+  for (i = 0; i < ES_THREADS; i++)
+  {
+    if (pthread_create(&Worker, NULL, WorkerThread, NULL) != 0)
+      break;
+    pthread_detach(Worker);
+  }
+  pthread_sigmask(SIG_SETMASK, &SavedMask, NULL);
+  Started = (i > 0);
+  return Started;
+}
+
+/****************************************************************************
+ Function
+     _HW_ListWork
+ Parameters
+     uint16_t Instance : the robot
+     uint8_t Service : the service of that robot that has events to run
+ Returns
+     None.
+ Description
+     lists the service for the next free worker thread
+ Notes
+     the framework lists a service only when it is not listed or running
+     already, so each list has room for every robot. Services listed before
+     _HW_StartWorkers wait for the workers.
+ Author
+     J. He, 10/19/26 10:17
+****************************************************************************/
+void _HW_ListWork(uint16_t Instance, uint8_t Service)
+{
+  pthread_mutex_lock(&WorkLock);
+  WorkList[Service].Instances[(WorkList[Service].First +
+                               WorkList[Service].Count) % ES_NUM_INSTANCES] =
+                                                                      Instance;
+  WorkList[Service].Count++;
+  NumListed++;
+  pthread_cond_signal(&WorkToDo);
+  pthread_mutex_unlock(&WorkLock);
+}
+
+/****************************************************************************
+ Function
+     _HW_WaitWorkers
+ Parameters
+     none
+ Returns
+     None.
+ Description
+     waits until no service is listed and every worker thread is idle
+ Notes
+     the simulated ISRs can still run on this thread while it waits
+ Author
+     J. He, 10/19/26 10:20
+****************************************************************************/
+void _HW_WaitWorkers(void)
+{
+  pthread_mutex_lock(&WorkLock);
+  while ((NumListed != 0) || (NumBusy != 0))
+    pthread_cond_wait(&WorkDone, &WorkLock);
+  pthread_mutex_unlock(&WorkLock);
+}
+#endif
+
+/****************************************************************************
+ Function
+     _HW_AttachInterrupt
+ Parameters
+     int SigNum : the signal that will act as the interrupt source
+     void (*pISR)(void) : the interrupt response routine
+ Returns
+     bool : false if SigNum is not one of the interrupt signals
+ Description
+     installs pISR as the response to SigNum. While the response runs, all
+     of the interrupt signals are blocked, so simulated ISRs do not nest.
+ Notes
+     SigNum must be SIGALRM, SIGIO, SIGUSR1, SIGUSR2 or a real time signal.
+     With ES_PREEMPTIVE, SIGRTMAX is taken by the tick.
+ Author
+     J. He, 10/17/26 10:20
+****************************************************************************/
+bool _HW_AttachInterrupt(int SigNum, void (*pISR)(void))
+{
+  struct sigaction Action;
+
+  InitIntSigSet();
+  if ((SigNum <= 0) || (SigNum >= NSIG) ||
+      (sigismember(&_HW_IntSigSet, SigNum) != 1) || (pISR == NULL))
+    return false;
+#if defined(ES_PREEMPTIVE) && !defined(ES_VIRTUAL_CLOCK)
+  if ((SigNum == SIGRTMAX) && (pISR != TickISR))
+    return false;
+#endif
+  ISRTable[SigNum] = pISR;
+  memset(&Action, 0, sizeof(Action));
+  Action.sa_handler = SignalTrampoline;
+  Action.sa_mask = _HW_IntSigSet;
+  Action.sa_flags = SA_RESTART;
+  return (sigaction(SigNum, &Action, NULL) == 0);
+}
+
+#if defined(ES_VIRTUAL_CLOCK)
+/****************************************************************************
+ Function
+     _HW_ScheduleInterrupt
+ Parameters
+     void (*pISR)(void) : the interrupt response routine
+     uint32_t Micros : how long from now it should run, in uS
+ Returns
+     bool : false if pISR is NULL or MAX_SCHEDULED are already waiting
+ Description
+     runs pISR once, as a simulated ISR, when the virtual clock reaches
+     Micros from now. This is what stands in for a one shot hardware timer,
+     scheduling a pISR that is already waiting just moves it.
+ Notes
+     a periodic timer is an ISR that schedules itself again. Interrupts that
+     come due together run in the order they are due. The interrupt belongs
+     to the robot that is selected when it is scheduled.
+ Author
+     J. He, 10/17/26 23:56
+****************************************************************************/
+bool _HW_ScheduleInterrupt(void (*pISR)(void), uint32_t Micros)
+{
+  uint8_t i;
+  uint8_t Slot = MAX_SCHEDULED;
+
+  if (pISR == NULL)
+    return false;
+  for (i = 0; i < MAX_SCHEDULED; i++)
+  {
+    if (Me->Scheduled[i].pISR == pISR)
+    {
+      Slot = i;
+      break;
+    }
+    if ((Me->Scheduled[i].pISR == NULL) && (Slot == MAX_SCHEDULED))
+      Slot = i;
+  }
+  if (Slot == MAX_SCHEDULED)
+    return false;
+  Me->Scheduled[Slot].Due = VirtualNow + (uint64_t)Micros * NSEC_PER_USEC;
+  Me->Scheduled[Slot].pISR = pISR;
+  return true;
+}
+
+/****************************************************************************
+ Function
+     _HW_CancelInterrupt
+ Parameters
+     void (*pISR)(void) : the interrupt response routine
+ Returns
+     None.
+ Description
+     takes pISR off the schedule, like disabling a hardware timer
+ Notes
+
+ Author
+     J. He, 10/17/26 23:58
+****************************************************************************/
+void _HW_CancelInterrupt(void (*pISR)(void))
+{
+  uint8_t i;
+
+  for (i = 0; i < MAX_SCHEDULED; i++)
+  {
+    if (Me->Scheduled[i].pISR == pISR)
+      Me->Scheduled[i].pISR = NULL;
+  }
+}
+#endif
+
+/****************************************************************************
+ Function
+     kbhit
+ Parameters
+     none
+ Returns
+     int : 1 if a character is waiting on stdin, 0 otherwise
+ Description
+     host replacement for the UART receive FIFO test in termio.c
+ Notes
+     the character is read here and held for TERMIO_GetChar, so that end of
+     file on stdin (a pipe or /dev/null) is never reported as a keystroke
+ Author
+     J. He, 10/17/26 10:26
+****************************************************************************/
+int kbhit(void)
+{
+  struct pollfd StdinPoll = { STDIN_FILENO, POLLIN, 0 };
+  unsigned char NewChar;
+
+  if (PendingKey >= 0)
+    return 1;
+  if ((StdinClosed == false) && (poll(&StdinPoll, 1, 0) > 0))
+  {
+    if (read(STDIN_FILENO, &NewChar, 1) == 1)
+    {
+      PendingKey = NewChar;
+      return 1;
+    }
+    StdinClosed = true; // end of file, stop polling
+  }
+  return 0;
+}
+
+/****************************************************************************
+ Function
+     TERMIO_Init, TERMIO_GetChar, TERMIO_PutChar
+ Description
+     host versions of the termio.c routines used by the main() files, all
+     of them simply map onto stdin/stdout. TERMIO_GetChar returns the key
+     found by kbhit if there is one, otherwise it blocks on stdin.
+ Author
+     J. He, 10/17/26 10:28
+****************************************************************************/
+void TERMIO_Init(void)
+{
+  ConsoleInit();
+}
+
+unsigned char TERMIO_GetChar(void)
+{
+  unsigned char NewChar = 0xFF;
+
+  if (PendingKey >= 0)
+  {
+    NewChar = (unsigned char)PendingKey;
+    PendingKey = -1;
+  }
+  else if ((StdinClosed == false) && (read(STDIN_FILENO, &NewChar, 1) != 1))
+  {
+    StdinClosed = true;
+  }
+  return NewChar;
+}
+
+void TERMIO_PutChar(unsigned char ch)
+{
+  putchar(ch);
+}
+
+/***************************************************************************
+ private functions
+ ***************************************************************************/
+/* builds the set of signals treated as interrupts, done once */
+static void InitIntSigSet(void)
+{
+  static bool IsInitialized = false;
+  int SigNum;
+
+  if (IsInitialized == false)
+  {
+    sigemptyset(&_HW_IntSigSet);
+    sigaddset(&_HW_IntSigSet, SIGALRM);
+    sigaddset(&_HW_IntSigSet, SIGIO);
+    sigaddset(&_HW_IntSigSet, SIGUSR1);
+    sigaddset(&_HW_IntSigSet, SIGUSR2);
+    for (SigNum = SIGRTMIN; SigNum <= SIGRTMAX; SigNum++)
+      sigaddset(&_HW_IntSigSet, SigNum);
+    IsInitialized = true;
+  }
+}
+
+/* moves any expirations of the timerfd into TickCount & SysTickCounter */
+static void CollectTicks(void)
+{
+#if defined(ES_VIRTUAL_CLOCK)
+  // the ticks that the virtual clock has moved past
+  while ((TickPeriod != 0) && (NextTickDue <= VirtualNow))
+  {
+    AddTicks(1);
+    SysTickCounter++;
+    NextTickDue += TickPeriod;
+  }
+#else
+  uint64_t Expirations;
+  sigset_t SavedMask;
+
+  if (TickTimerFd < 0)
+    return;
+  // use a local mask so that we can be called from inside a critical region
+  pthread_sigmask(SIG_BLOCK, &_HW_IntSigSet, &SavedMask);
+  if (read(TickTimerFd, &Expirations, sizeof(Expirations)) ==
+                                                  (ssize_t)sizeof(Expirations))
+  {
+    AddTicks((uint32_t)Expirations);
+    SysTickCounter += (uint16_t)Expirations; // keep the free running time going
+  }
+  pthread_sigmask(SIG_SETMASK, &SavedMask, NULL);
+#endif
+}
+
+/* every robot sees each tick of the shared clock */
+static void AddTicks(uint32_t NumTicks)
+{
+  uint16_t Instance;
+
+  for (Instance = 0; Instance < ES_NUM_INSTANCES; Instance++)
+    Instances[Instance].TickCount += NumTicks;
+}
+
+/* common signal handler that dispatches to the attached ISR. With
+   ES_PREEMPTIVE, the services that the ISR made ready then run here, with
+   the interrupt signals unblocked so that they can be preempted in turn */
+static void SignalTrampoline(int SigNum)
+{
+  if (ISRTable[SigNum] != NULL)
+  {
+    _HW_ISRNesting++;
+    _HW_ISRSignal = SigNum;
+    ISRTable[SigNum]();
+    _HW_ISRSignal = 0;
+    _HW_ISRNesting--;
+  }
+#if defined(ES_PREEMPTIVE)
+  if ((_HW_ISRNesting == 0) && (PreemptPending != 0))
+  {
+    int SavedErrno = errno;
+
+    PreemptPending = 0;
+    pthread_sigmask(SIG_UNBLOCK, &_HW_IntSigSet, NULL);
+    ES_Preempt();
+    pthread_sigmask(SIG_BLOCK, &_HW_IntSigSet, NULL);
+    errno = SavedErrno;
+  }
+#endif
+}
+
+#if ES_THREADS > 0
+/* a worker thread, runs the highest priority service that is listed */
+static void *WorkerThread(void *pArg)
+{
+  int Service;
+  uint16_t Instance;
+
+  (void)pArg;
+  pthread_mutex_lock(&WorkLock);
+  while (1)
+  {
+    while (NumListed == 0)
+      pthread_cond_wait(&WorkToDo, &WorkLock);
+    for (Service = NUM_SERVICES - 1; WorkList[Service].Count == 0; Service--)
+      ;
+    Instance = WorkList[Service].Instances[WorkList[Service].First];
+    WorkList[Service].First = (WorkList[Service].First + 1) % ES_NUM_INSTANCES;
+    WorkList[Service].Count--;
+    NumListed--;
+    NumBusy++;
+    pthread_mutex_unlock(&WorkLock);
+    pRunWorkFunc(Instance, (uint8_t)Service);
+    pthread_mutex_lock(&WorkLock);
+    NumBusy--;
+    if ((NumListed == 0) && (NumBusy == 0))
+      pthread_cond_broadcast(&WorkDone);
+  }
+  return NULL;
+}
+#endif
+
+#if defined(ES_PREEMPTIVE) && !defined(ES_VIRTUAL_CLOCK)
+/* the tick signal, the timerfd still counts the ticks */
+static void TickISR(void)
+{
+  ES_RequestPreempt();
+}
+#endif
+
+static void RestoreTerminal(void)
+{
+  tcsetattr(STDIN_FILENO, TCSANOW, &SavedTermios);
+}
+
+#if defined(ES_VIRTUAL_CLOCK)
+/* when the first scheduled interrupt of any robot is due, UINT64_MAX if
+   there is none */
+static uint64_t NextScheduledDue(void)
+{
+  uint64_t Due = UINT64_MAX;
+  uint16_t Instance;
+  uint8_t i;
+
+  for (Instance = 0; Instance < ES_NUM_INSTANCES; Instance++)
+  {
+    for (i = 0; i < MAX_SCHEDULED; i++)
+    {
+      if ((Instances[Instance].Scheduled[i].pISR != NULL) &&
+          (Instances[Instance].Scheduled[i].Due < Due))
+        Due = Instances[Instance].Scheduled[i].Due;
+    }
+  }
+  return Due;
+}
+
+/* runs the scheduled interrupts of the running robot that have come due, in
+   the order they were due. Each slot runs at most once a pass, so an ISR
+   that schedules itself 0 uS ahead can not lock us up. */
+static void RunScheduled(void)
+{
+  void (*pISR)(void);
+  sigset_t SavedMask;
+  uint8_t Pass;
+  uint8_t First;
+  uint8_t i;
+
+  for (Pass = 0; Pass < MAX_SCHEDULED; Pass++)
+  {
+    First = MAX_SCHEDULED;
+    for (i = 0; i < MAX_SCHEDULED; i++)
+    {
+      if ((Me->Scheduled[i].pISR != NULL) &&
+          (Me->Scheduled[i].Due <= VirtualNow) &&
+          ((First == MAX_SCHEDULED) ||
+           (Me->Scheduled[i].Due < Me->Scheduled[First].Due)))
+        First = i;
+    }
+    if (First == MAX_SCHEDULED)
+      return;
+    pISR = Me->Scheduled[First].pISR;
+    Me->Scheduled[First].pISR = NULL;
+    // run it just as SignalTrampoline would
+    pthread_sigmask(SIG_BLOCK, &_HW_IntSigSet, &SavedMask);
+    _HW_ISRNesting++;
+    pISR();
+    _HW_ISRNesting--;
+    pthread_sigmask(SIG_SETMASK, &SavedMask, NULL);
+  }
+}
+#endif
+
+#endif /* ES_PORT_POSIX */
+/*------------------------------ End of file ------------------------------*/
@@ -9,6 +9,9 @@
  History
  When           Who     What/Why
  -------------- ---     --------
+ 10/18/26 09:43 jh       the subscriber lists are kept for each robot
+ 10/17/26 21:00 jh       added runtime subscriptions by event type, with
+                         ES_Publish posting to every subscriber
  08/05/13 15:04 jec      added #includes for ES_Port & ES_Types and converted
                          types to match portable types
  01/15/12 15:55 jec      re-coded for Gen2 with conditional declarations
@@ -21,12 +24,23 @@
 #include "ES_Configure.h"
 #include "ES_General.h"
 #include "ES_PostList.h"
+#include "ES_Framework.h"
 #include "ES_ServiceHeaders.h"
 
 /*---------------------------- Module Functions ---------------------------*/
 static bool PostToList(  PostFunc_t *const*FuncList, uint8_t ListSize, ES_Event NewEvent);
 
 /*---------------------------- Module Variables ---------------------------*/
+// the services subscribed to each event type, filled in by ES_Subscribe.
+// Each robot has its own, see ES_Instance.h
+typedef struct {
+  ES_ServiceSet_t Subscribers[ES_NUM_EVENT_TYPES];
+} PostListData_t;
+
+static PostListData_t Instances[ES_NUM_INSTANCES];
+
+#define Me ES_THIS(Instances)
+
 // Fill in these arrays with the lists of posting funcitons for the state
 // machines that will have common events delivered to them.
 
@@ -153,5 +167,91 @@ static bool PostToList( PostFunc_t *const*List, uint8_t ListSize, ES_Event NewEv
 }
 #endif /* NUM_DIST_LISTS > 0*/
 
+/****************************************************************************
+ Function
+   ES_Subscribe
+ Parameters
+   uint8_t WhichService : the service (index into ServDescList) to subscribe
+   ES_EventTyp_t EventType : the event type that it wants to receive
+ Returns
+   bool: false if either the service or the event type does not exist
+ Description
+   adds the service to the subscribers for EventType, so that it receives
+   every event of that type passed to ES_Publish
+ Notes
+   usually called from the service's init function, with its own priority
+ Author
+   J. He, 10/17/26, 21:06
+****************************************************************************/
+bool ES_Subscribe( uint8_t WhichService, ES_EventTyp_t EventType ){
+  if ( (WhichService >= NUM_SERVICES) || (EventType >= ES_NUM_EVENT_TYPES) )
+    return false;
+  EnterCritical();   // save interrupt state, turn ints off
+  Me->Subscribers[EventType] |= ES_ServiceBit(WhichService);
+  ExitCritical();  // restore saved interrupt state
+  return true;
+}
+
+/****************************************************************************
+ Function
+   ES_Unsubscribe
+ Parameters
+   uint8_t WhichService : the service (index into ServDescList)
+   ES_EventTyp_t EventType : the event type that it no longer wants
+ Returns
+   bool: false if either the service or the event type does not exist
+ Description
+   removes the service from the subscribers for EventType
+ Notes
+   events that were already published stay in its queue
+ Author
+   J. He, 10/17/26, 21:09
+****************************************************************************/
+bool ES_Unsubscribe( uint8_t WhichService, ES_EventTyp_t EventType ){
+  if ( (WhichService >= NUM_SERVICES) || (EventType >= ES_NUM_EVENT_TYPES) )
+    return false;
+  EnterCritical();   // save interrupt state, turn ints off
+  Me->Subscribers[EventType] &= ~ES_ServiceBit(WhichService);
+  ExitCritical();  // restore saved interrupt state
+  return true;
+}
+
+/****************************************************************************
+ Function
+   ES_Publish
+ Parameters
+   ES_Event ThisEvent : the event to be posted to the subscribers
+ Returns
+   bool: true if every subscriber got the event, false if any post failed
+   or the event type does not exist
+ Description
+   posts ThisEvent to every service subscribed to its type, walking the set
+   bits of the subscriber word from the highest priority down
+ Notes
+   unlike PostToList, a failed post does not stop the others
+   may be called from an ISR, like ES_PostToService
+ Author
+   J. He, 10/17/26, 21:12
+****************************************************************************/
+bool ES_Publish( ES_Event ThisEvent ){
+  ES_ServiceSet_t ToPost;
+  uint8_t WhichService;
+  bool ReturnVal = true;
+
+  if ( ThisEvent.EventType >= ES_NUM_EVENT_TYPES )
+    return false;
+  // take a copy, as a 64 bit set can not be read in one go
+  EnterCritical();   // save interrupt state, turn ints off
+  ToPost = Me->Subscribers[ThisEvent.EventType];
+  ExitCritical();  // restore saved interrupt state
+  while ( ToPost != 0 ) {
+    WhichService = ES_GetHighestService( ToPost );
+    ToPost &= ~ES_ServiceBit(WhichService);
+    if ( ES_PostToService( WhichService, ThisEvent ) != true )
+      ReturnVal = false;
+  }
+  return ReturnVal;
+}
+
 /*------------------------------- Footnotes -------------------------------*/
 /*------------------------------ End of file ------------------------------*/
@@ -9,6 +9,10 @@
  History
  When           Who     What/Why
  -------------- ---     --------
+ 10/17/26 21:30 jh       added ES_SpliceToFront to move a whole queue at once,
+                         TEST has a host version that checks it
+ 10/17/26 19:30 jh       compile time check that ES_Queue_t fits in a slot
+ 10/17/26 13:40 jh       track the peak number of entries (high-water mark)
  01/15/12 09:34 jec      converted to use the new C99 types from types.h
  08/09/11 18:16 jec      started coding
 *****************************************************************************/
@@ -24,13 +28,19 @@ unsigned int _PRIMASK_temp;
 // CurrentIndex is the 'read-from' index,
 // actually CurrentIndex + sizeof(EF_Queue_t)
 // entries are made to CurrentIndex + NumEntries + sizeof(ES_Queue_t)
+// PeakEntries is the most entries that the queue has held since it was
+// initialized or the peak was last reset. The struct must still fit in the
+// single ES_Event at the start of the block, 4 bytes with ES_COMPACT_EVENTS
 typedef struct {  uint8_t QueueSize;
                   uint8_t CurrentIndex;
                   uint8_t NumEntries;
+                  uint8_t PeakEntries;
 } ES_Queue_t;
 
 typedef ES_Queue_t * pQueue_t;
 
+ES_STATIC_ASSERT( sizeof(ES_Queue_t) <= sizeof(ES_Event), QueueHeaderFitsSlot );
+
 /*---------------------------- Module Functions ---------------------------*/
 
 /*---------------------------- Module Variables ---------------------------*/
@@ -49,7 +59,7 @@ typedef ES_Queue_t * pQueue_t;
  Notes
    you should pass it a block that is at least sizeof(ES_Queue_t) larger than 
    the number of entries that you want in the queue. Since the size of an 
-   ES_Event (at 4 bytes; 2 enum, 2 param) is greater than the 
+   ES_Event (8 bytes, or 4 with ES_COMPACT_EVENTS) is at least the
    sizeof(ES_Queue_t), you only need to declare an array of ES_Event
    with 1 more element than you need for the actual queue.
  Author
@@ -64,6 +74,7 @@ uint8_t ES_InitQueue( ES_Event * pBlock, uint8_t BlockSize )
    pThisQueue->QueueSize = BlockSize - 1;
    pThisQueue->CurrentIndex = 0;
    pThisQueue->NumEntries = 0;
+   pThisQueue->PeakEntries = 0;
    return(pThisQueue->QueueSize);
 }
 
@@ -95,6 +106,8 @@ bool ES_EnQueueFIFO( ES_Event * pBlock, ES_Event Event2Add )
       pBlock[ 1 + ((pThisQueue->CurrentIndex + pThisQueue->NumEntries)
                % pThisQueue->QueueSize)] = Event2Add;
       pThisQueue->NumEntries++;          // inc number of entries
+      if (pThisQueue->NumEntries > pThisQueue->PeakEntries)
+         pThisQueue->PeakEntries = pThisQueue->NumEntries;
       ExitCritical();  // restore saved interrupt state
       
       return(true);
@@ -128,6 +141,8 @@ bool ES_EnQueueLIFO( ES_Event * pBlock, ES_Event Event2Add )
       EnterCritical();   // save interrupt state, turn ints off
     // OK, there is space note that the queue now has 1 more entry
       pThisQueue->NumEntries++;
+      if (pThisQueue->NumEntries > pThisQueue->PeakEntries)
+        pThisQueue->PeakEntries = pThisQueue->NumEntries;
     // Check to see if we need to wrap around as we back up index
       if (pThisQueue->CurrentIndex == 0){
        pThisQueue->CurrentIndex = pThisQueue->QueueSize -1;
@@ -207,6 +222,105 @@ bool ES_IsQueueEmpty( ES_Event * pBlock )
    return(pThisQueue->NumEntries == 0);
 }
 
+/****************************************************************************
+ Function
+   ES_GetQueuePeak
+ Parameters
+   ES_Event * pBlock : pointer to the block of memory in use as the Queue
+ Returns
+   uint8_t : the most entries the Queue has held
+ Description
+   returns the high-water mark of the Queue since it was initialized or
+   since the last call to ES_ResetQueuePeak
+ Notes
+
+ Author
+   J. He, 10/17/26, 13:44
+****************************************************************************/
+uint8_t ES_GetQueuePeak( ES_Event * pBlock )
+{
+   pQueue_t pThisQueue;
+
+   pThisQueue = (pQueue_t)pBlock;
+   return(pThisQueue->PeakEntries);
+}
+
+/****************************************************************************
+ Function
+   ES_ResetQueuePeak
+ Parameters
+   ES_Event * pBlock : pointer to the block of memory in use as the Queue
+ Returns
+   nothing
+ Description
+   restarts the high-water mark from the current number of entries
+ Notes
+
+ Author
+   J. He, 10/17/26, 13:46
+****************************************************************************/
+void ES_ResetQueuePeak( ES_Event * pBlock )
+{
+   pQueue_t pThisQueue;
+
+   pThisQueue = (pQueue_t)pBlock;
+   EnterCritical();   // save interrupt state, turn ints off
+   pThisQueue->PeakEntries = pThisQueue->NumEntries;
+   ExitCritical();  // restore saved interrupt state
+}
+
+/****************************************************************************
+ Function
+   ES_SpliceToFront
+ Parameters
+   ES_Event * pDest : pointer to the block of memory of the Queue to add to
+   ES_Event * pSource : pointer to the block of memory of the Queue to empty
+ Returns
+   uint8_t : the number of events moved
+ Description
+   moves the events in pSource to the front of pDest, keeping their order,
+   so that the oldest event in pSource is the next to come out of pDest.
+   If they will not all fit, as many of the oldest as will fit are moved
+   and the rest are left in pSource.
+ Notes
+   the whole move is done in a single critical section
+ Author
+   J. He, 10/17/26, 21:34
+****************************************************************************/
+uint8_t ES_SpliceToFront( ES_Event * pDest, ES_Event * pSource )
+{
+   pQueue_t pDestQueue;
+   pQueue_t pSourceQueue;
+   uint8_t NumToMove;
+   uint8_t i;
+
+   pDestQueue = (pQueue_t)pDest;
+   pSourceQueue = (pQueue_t)pSource;
+   EnterCritical();   // save interrupt state, turn ints off
+   NumToMove = pDestQueue->QueueSize - pDestQueue->NumEntries;
+   if (pSourceQueue->NumEntries < NumToMove)
+      NumToMove = pSourceQueue->NumEntries;
+   if (NumToMove > 0)
+   {  // back up the read index of pDest to open a gap for the events
+      pDestQueue->CurrentIndex = (uint8_t)((pDestQueue->CurrentIndex +
+            pDestQueue->QueueSize - NumToMove) % pDestQueue->QueueSize);
+      for (i = 0; i < NumToMove; i++)
+      {
+         pDest[ 1 + ((pDestQueue->CurrentIndex + i) % pDestQueue->QueueSize)] =
+            pSource[ 1 + ((pSourceQueue->CurrentIndex + i) %
+                          pSourceQueue->QueueSize)];
+      }
+      pDestQueue->NumEntries += NumToMove;
+      if (pDestQueue->NumEntries > pDestQueue->PeakEntries)
+         pDestQueue->PeakEntries = pDestQueue->NumEntries;
+      pSourceQueue->CurrentIndex = (uint8_t)((pSourceQueue->CurrentIndex +
+            NumToMove) % pSourceQueue->QueueSize);
+      pSourceQueue->NumEntries -= NumToMove;
+   }
+   ExitCritical();  // restore saved interrupt state
+   return NumToMove;
+}
+
 #if 0
 /****************************************************************************
  Function
@@ -238,7 +352,7 @@ void QueueFlushQueue( uint8_t * pBlock )
 /***************************************************************************
  private functions
  ***************************************************************************/
-#ifdef TEST
+#if defined(TEST) && !defined(ES_PORT_POSIX)
 
 #include <stdio.h>
 #include "ES_General.h"
@@ -284,6 +398,10 @@ void main(void){
   bReturn = ES_EnQueueFIFO( TestQueue, MyEvent );
   bReturn +=1; // keep that sily optimizer away
   
+  // the queue has been full, so the high-water mark should be 3
+  if ( ES_GetQueuePeak( TestQueue ) != 3)
+    bReturn = 0;
+
   // at this point, the events in the queue should be 0,2,4
   // so pull off the 0, leaving 2 entries
   NumLeft = ES_DeQueue( TestQueue, &MyEvent);
@@ -304,6 +422,92 @@ void main(void){
     ;
 }
 
+#elif defined(TEST) && defined(ES_PORT_POSIX)
+/*
+  Host test for ES_SpliceToFront: for every starting index and fill of both
+  queues, splice and then check the destination against a plain array model
+  of what should come out of it, and that the source kept what did not fit.
+*/
+#include <stdio.h>
+#include "ES_General.h"
+
+// built without ES_Port_POSIX.c, so stand in for its interrupt mask
+sigset_t _SIGMASK_temp;
+sigset_t _HW_IntSigSet;
+
+#define DEST_SIZE 5
+#define SOURCE_SIZE 4
+
+static ES_Event DestQueue[DEST_SIZE+1];
+static ES_Event SourceQueue[SOURCE_SIZE+1];
+
+// rotate the queue's read index to Start by cycling an event through it
+static void Rotate( ES_Event * pBlock, uint8_t Start )
+{
+  ES_Event Dummy = { .EventType = ES_NO_EVENT, .EventParam = 0 };
+  uint8_t i;
+
+  for ( i = 0; i < Start; i++ ) {
+    ES_EnQueueFIFO( pBlock, Dummy );
+    ES_DeQueue( pBlock, &Dummy );
+  }
+}
+
+int main(void)
+{
+  uint8_t DestStart, DestFill, SourceStart, SourceFill, i, Moved;
+  uint16_t Expected[DEST_SIZE + SOURCE_SIZE];
+  uint8_t NumExpected;
+  unsigned long Cases = 0, Errors = 0;
+  ES_Event MyEvent;
+
+  for ( DestStart = 0; DestStart < DEST_SIZE; DestStart++ )
+  for ( DestFill = 0; DestFill <= DEST_SIZE; DestFill++ )
+  for ( SourceStart = 0; SourceStart < SOURCE_SIZE; SourceStart++ )
+  for ( SourceFill = 0; SourceFill <= SOURCE_SIZE; SourceFill++ ) {
+    ES_InitQueue( DestQueue, ARRAY_SIZE(DestQueue) );
+    ES_InitQueue( SourceQueue, ARRAY_SIZE(SourceQueue) );
+    Rotate( DestQueue, DestStart );
+    Rotate( SourceQueue, SourceStart );
+    MyEvent.EventType = ES_TIMEOUT;
+    NumExpected = 0;
+    // source events are numbered from 100, in the order they were queued
+    for ( i = 0; i < SourceFill; i++ ) {
+      MyEvent.EventParam = 100 + i;
+      ES_EnQueueFIFO( SourceQueue, MyEvent );
+      if ( i < DEST_SIZE - DestFill )
+        Expected[NumExpected++] = 100 + i;
+    }
+    for ( i = 0; i < DestFill; i++ ) {
+      MyEvent.EventParam = i;
+      ES_EnQueueFIFO( DestQueue, MyEvent );
+      Expected[NumExpected++] = i;
+    }
+
+    Moved = ES_SpliceToFront( DestQueue, SourceQueue );
+
+    if ( Moved != NumExpected - DestFill )
+      Errors++;
+    for ( i = 0; i < NumExpected; i++ ) {
+      ES_DeQueue( DestQueue, &MyEvent );
+      if ( MyEvent.EventParam != Expected[i] )
+        Errors++;
+    }
+    if ( ES_IsQueueEmpty( DestQueue ) != true )
+      Errors++;
+    // whatever did not fit is still in the source, in order
+    for ( i = Moved; i < SourceFill; i++ ) {
+      ES_DeQueue( SourceQueue, &MyEvent );
+      if ( MyEvent.EventParam != 100 + i )
+        Errors++;
+    }
+    if ( ES_IsQueueEmpty( SourceQueue ) != true )
+      Errors++;
+    Cases++;
+  }
+  printf( "%lu cases, %lu errors\n", Cases, Errors );
+  return (Errors == 0) ? 0 : 1;
+}
 #endif
 /*------------------------------- Footnotes -------------------------------*/
 /*------------------------------ End of file ------------------------------*/
@@ -0,0 +1,421 @@
+/****************************************************************************
+ Module
+     ES_Replay.c
+ Description
+     Records everything that the interrupt responses feed into the services,
+     so that a run on the robot can be played back on the host.
+ Notes
+     Three things are logged, each with the time since ES_Initialize and the
+     interrupt number it came from:
+       - every event posted from an ISR, by PostFromISR in ES_Framework.c
+       - every timer started from an ISR, by ES_Timer_InitTimer
+       - the capture & data registers that an ISR reads through
+         ES_ReplayCapture
+     The log keeps the first ES_REPLAY_RECORDS of them and counts the rest
+     as lost, since a replay has to start from the beginning. ES_ReplayDump
+     prints it on the console, every field in hex:
+       ES_REPLAY BEGIN <records in the dump> <records lost>
+       <Time> <Source> <Target> <EventType> <Value>
+       ES_REPLAY END
+     On the host, ES_ReplayLoad reads the last complete dump from a console
+     log. From then on the port calls ES_ReplayDeliver & ES_ReplayTick as it
+     runs the tick responses, and each post or timer start is made again,
+     from a simulated ISR, after the same tick as on the Tiva. Nothing is
+     recorded while replaying. The captured registers are kept in the log
+     for working offline, the ISRs that read them do not run on the host.
+
+ History
+ When           Who     What/Why
+ -------------- ---     --------
+ 10/17/26 23:00 jh      started coding
+*****************************************************************************/
+/*----------------------------- Include Files -----------------------------*/
+#include "ES_Configure.h"
+#include "ES_Framework.h"
+#include "ES_Replay.h"
+#include "ES_General.h"
+#include "ES_Port.h"
+#include <stdio.h>
+#if defined(ES_PORT_POSIX)
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <pthread.h>
+#endif
+
+#if ES_REPLAY_RECORDS > 0
+
+/*----------------------------- Module Defines ----------------------------*/
+#define MAX_LINE 128
+
+/*---------------------------- Module Functions ---------------------------*/
+static void AddRecord( uint8_t Target, uint16_t EventType, uint32_t Value );
+#if defined(ES_PORT_POSIX)
+static void Replay( const ES_ReplayRecord_t * pRecord );
+#endif
+
+/*---------------------------- Module Variables ---------------------------*/
+static ES_ReplayRecord_t Log[ES_REPLAY_RECORDS];
+static uint32_t NumLogged;
+static uint32_t NumLost;
+// _HW_GetMicros() at ES_Initialize, the record times count from here
+static uint64_t StartMicros;
+
+#if defined(ES_PORT_POSIX)
+// the log read by ES_ReplayLoad, and the next record to replay from it
+static ES_ReplayRecord_t * pReplayLog;
+static uint32_t NumToReplay;
+static uint32_t NextReplay;
+static bool Replaying;
+// ticks run since ES_Initialize, and the length of one in uS
+static uint32_t ReplayTicks;
+static uint32_t TickMicros;
+#endif
+
+/*------------------------------ Module Code ------------------------------*/
+/****************************************************************************
+ Function
+   ES_InitReplay
+ Parameters
+   TimerRate_t Rate : the tick rate passed to ES_Initialize
+ Returns
+   nothing
+ Description
+   empties the log and starts the clock for the record times. On the host
+   it also rewinds a loaded replay.
+ Notes
+   called by ES_Initialize after the timers are started
+ Author
+   J. He, 10/17/26, 23:06
+****************************************************************************/
+void ES_InitReplay( TimerRate_t Rate )
+{
+  StartMicros = _HW_GetMicros();
+  NumLogged = 0;
+  NumLost = 0;
+#if defined(ES_PORT_POSIX)
+  // the host rates are the tick period in uS
+  TickMicros = (uint32_t)Rate;
+  ReplayTicks = 0;
+  NextReplay = 0;
+#else
+  (void)Rate;
+#endif
+}
+
+/****************************************************************************
+ Function
+   ES_ReplayCapture
+ Parameters
+   uint32_t Value : the register value that the ISR just read
+ Returns
+   uint32_t : Value
+ Description
+   logs a register read by an ISR, wrap the read in it:
+     ThisCapture = ES_ReplayCapture( HWREG(WTIMER5_BASE+TIMER_O_TAR) );
+ Notes
+   only call it from an ISR
+ Author
+   J. He, 10/17/26, 23:10
+****************************************************************************/
+uint32_t ES_ReplayCapture( uint32_t Value )
+{
+  AddRecord( ES_REPLAY_CAPTURE, ES_NO_EVENT, Value );
+  return Value;
+}
+
+/****************************************************************************
+ Function
+   ES_ReplayRecordPost
+ Parameters
+   uint8_t WhichService : the service posted to
+   ES_Event ThisEvent : the event posted
+ Returns
+   nothing
+ Description
+   logs a post made from an ISR, whether or not it fit in the mailbox
+ Notes
+   called by PostFromISR
+ Author
+   J. He, 10/17/26, 23:12
+****************************************************************************/
+void ES_ReplayRecordPost( uint8_t WhichService, ES_Event ThisEvent )
+{
+  AddRecord( WhichService, (uint16_t)ThisEvent.EventType,
+             (uint32_t)ThisEvent.EventParam );
+}
+
+/****************************************************************************
+ Function
+   ES_ReplayRecordTimer
+ Parameters
+   uint8_t Num : the timer started
+   uint16_t NewTime : the time it was started with
+ Returns
+   nothing
+ Description
+   logs a timer started from an ISR
+ Notes
+   called by ES_Timer_InitTimer
+ Author
+   J. He, 10/17/26, 23:14
+****************************************************************************/
+void ES_ReplayRecordTimer( uint8_t Num, uint16_t NewTime )
+{
+  AddRecord( ES_REPLAY_TIMER, Num, NewTime );
+}
+
+/****************************************************************************
+ Function
+   ES_ReplayDump
+ Parameters
+   None
+ Returns
+   nothing
+ Description
+   prints the log on the console, for ES_ReplayLoad to read back
+ Notes
+   ISRs can keep adding to the log while it is printed, only the records
+   that were there at the start are printed
+ Author
+   J. He, 10/17/26, 23:16
+****************************************************************************/
+void ES_ReplayDump( void )
+{
+  uint32_t Index;
+  uint32_t NumInLog;
+  ES_ReplayRecord_t *pRecord;
+
+  NumInLog = NumLogged;
+  printf("ES_REPLAY BEGIN %lx %lx\r\n", (unsigned long)NumInLog,
+         (unsigned long)NumLost);
+  for ( Index = 0; Index < NumInLog; Index++ ) {
+    pRecord = &Log[Index];
+    printf("%08lx %x %x %x %lx\r\n", (unsigned long)pRecord->Time,
+           pRecord->Source, pRecord->Target, pRecord->EventType,
+           (unsigned long)pRecord->Value);
+  }
+  printf("ES_REPLAY END\r\n");
+}
+
+#if defined(ES_PORT_POSIX)
+/****************************************************************************
+ Function
+   ES_ReplayLoad
+ Parameters
+   const char * pFileName : a console log with ES_ReplayDump output in it
+ Returns
+   bool : false if the file could not be read or holds no complete dump
+ Description
+   reads the last complete dump in the file and starts replaying it
+ Notes
+   call it before ES_Initialize. A dump that lost records only replays
+   up to the point where the log filled.
+ Author
+   J. He, 10/17/26, 23:20
+****************************************************************************/
+bool ES_ReplayLoad( const char * pFileName )
+{
+  FILE *pFile;
+  char Line[MAX_LINE];
+  unsigned long InDump, Lost, Time, Value;
+  unsigned int Source, Target, EventType;
+  ES_ReplayRecord_t *pNewLog = NULL;
+  uint32_t NumNew = 0;
+  uint32_t MaxNew = 0;
+
+  pFile = fopen( pFileName, "r" );
+  if ( pFile == NULL )
+    return false;
+  while ( fgets( Line, sizeof(Line), pFile ) != NULL ) {
+    if ( sscanf( Line, "ES_REPLAY BEGIN %lx %lx", &InDump, &Lost ) == 2 ) {
+      free( pNewLog );
+      MaxNew = (uint32_t)InDump;
+      pNewLog = malloc( (MaxNew + 1) * sizeof(ES_ReplayRecord_t) );
+      NumNew = 0;
+      if ( Lost != 0 )
+        printf("replay: %lu ISR records were lost, the replay stops "
+               "short\r\n", Lost);
+      continue;
+    }
+    if ( pNewLog == NULL )
+      continue;
+    if ( strncmp( Line, "ES_REPLAY END", 13 ) == 0 ) {
+      free( pReplayLog );
+      pReplayLog = pNewLog;
+      NumToReplay = NumNew;
+      Replaying = true;
+      pNewLog = NULL;
+      continue;
+    }
+    if ( (sscanf( Line, "%lx %x %x %x %lx", &Time, &Source, &Target,
+                  &EventType, &Value ) != 5) || (NumNew >= MaxNew) )
+      continue; // something else got printed in the middle of the dump
+    pNewLog[NumNew].Time = (uint32_t)Time;
+    pNewLog[NumNew].Value = (uint32_t)Value;
+    pNewLog[NumNew].EventType = (uint16_t)EventType;
+    pNewLog[NumNew].Source = (uint8_t)Source;
+    pNewLog[NumNew].Target = (uint8_t)Target;
+    NumNew++;
+  }
+  free( pNewLog ); // a dump that was cut off
+  fclose( pFile );
+  NextReplay = 0;
+  return Replaying;
+}
+
+/****************************************************************************
+ Function
+   ES_ReplayIsDone
+ Parameters
+   None
+ Returns
+   bool : true once every record of the replay has been delivered, or if
+   there is no replay
+ Description
+   lets a host main() stop when the replay runs out
+ Notes
+
+ Author
+   J. He, 10/17/26, 23:26
+****************************************************************************/
+bool ES_ReplayIsDone( void )
+{
+  return (Replaying != true) || (NextReplay >= NumToReplay);
+}
+
+/****************************************************************************
+ Function
+   ES_ReplayDeliver
+ Parameters
+   None
+ Returns
+   nothing
+ Description
+   replays the records that came in before the end of the current tick
+ Notes
+   called by _HW_Process_Pending_Ints before it runs the tick responses
+ Author
+   J. He, 10/17/26, 23:28
+****************************************************************************/
+void ES_ReplayDeliver( void )
+{
+  uint64_t DueBefore;
+
+  if ( Replaying != true )
+    return;
+  DueBefore = (uint64_t)(ReplayTicks + 1) * TickMicros;
+  while ( (NextReplay < NumToReplay) &&
+          (pReplayLog[NextReplay].Time < DueBefore) ) {
+    Replay( &pReplayLog[NextReplay] );
+    NextReplay++;
+  }
+}
+
+/****************************************************************************
+ Function
+   ES_ReplayTick
+ Parameters
+   None
+ Returns
+   nothing
+ Description
+   moves the replay on by a tick and replays what came in during it
+ Notes
+   called by _HW_Process_Pending_Ints after each tick response
+ Author
+   J. He, 10/17/26, 23:30
+****************************************************************************/
+void ES_ReplayTick( void )
+{
+  ReplayTicks++;
+  ES_ReplayDeliver();
+}
+
+/****************************************************************************
+ Function
+   ES_ReplayTicksToNext
+ Parameters
+   None
+ Returns
+   uint16_t : ticks until the next record is due, ES_Timer_NO_TIMEOUT if
+   there is none
+ Description
+   lets _HW_Idle wake up in time for the next replayed interrupt
+ Notes
+
+ Author
+   J. He, 10/17/26, 23:32
+****************************************************************************/
+uint16_t ES_ReplayTicksToNext( void )
+{
+  uint32_t DueTick;
+
+  if ( ES_ReplayIsDone() == true )
+    return ES_Timer_NO_TIMEOUT;
+  if ( TickMicros == 0 )
+    return 0;
+  DueTick = pReplayLog[NextReplay].Time / TickMicros;
+  if ( DueTick <= ReplayTicks )
+    return 0;
+  if ( DueTick - ReplayTicks >= ES_Timer_NO_TIMEOUT )
+    return ES_Timer_NO_TIMEOUT - 1;
+  return (uint16_t)(DueTick - ReplayTicks);
+}
+#endif /* ES_PORT_POSIX */
+
+/***************************************************************************
+ private functions
+ ***************************************************************************/
+static void AddRecord( uint8_t Target, uint16_t EventType, uint32_t Value )
+{
+  ES_ReplayRecord_t *pRecord;
+
+#if defined(ES_PORT_POSIX)
+  if ( Replaying == true )
+    return;
+#endif
+  EnterCritical();   // save interrupt state, turn ints off
+  if ( NumLogged < ES_REPLAY_RECORDS ) {
+    pRecord = &Log[NumLogged];
+    NumLogged++;
+    // _HW_GetMicros is safe inside a critical region, and taking the time
+    // here keeps the log in time order
+    pRecord->Time = (uint32_t)(_HW_GetMicros() - StartMicros);
+    pRecord->Value = Value;
+    pRecord->EventType = EventType;
+    pRecord->Source = _HW_GetISRNumber();
+    pRecord->Target = Target;
+  } else {
+    NumLost++;
+  }
+  ExitCritical();  // restore saved interrupt state
+}
+
+#if defined(ES_PORT_POSIX)
+// makes a post or timer start again, as if from the ISR that made it
+static void Replay( const ES_ReplayRecord_t * pRecord )
+{
+  ES_Event ThisEvent;
+  sigset_t SavedMask;
+
+  // ES_Timer_InitTimer has its own critical region, so block the interrupt
+  // signals with a local mask rather than EnterCritical
+  pthread_sigmask( SIG_BLOCK, &_HW_IntSigSet, &SavedMask );
+  _HW_ISRNesting++;
+  if ( pRecord->Target == ES_REPLAY_TIMER ) {
+    ES_Timer_InitTimer( (uint8_t)pRecord->EventType,
+                        (uint16_t)pRecord->Value );
+  } else if ( pRecord->Target != ES_REPLAY_CAPTURE ) {
+    ThisEvent.EventType = (ES_EventTyp_t)pRecord->EventType;
+    ThisEvent.EventParam = (ES_EventParam_t)pRecord->Value;
+    ES_PostToService( pRecord->Target, ThisEvent );
+  }
+  _HW_ISRNesting--;
+  pthread_sigmask( SIG_SETMASK, &SavedMask, NULL );
+}
+#endif
+
+#endif /* ES_REPLAY_RECORDS > 0 */
+/*------------------------------- Footnotes -------------------------------*/
+/*------------------------------ End of file ------------------------------*/
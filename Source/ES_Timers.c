@@ -3,16 +3,44 @@
      ES_Timers.c
 
  Description
-     This is a module implementing  8 16 bit timers all using the RTI
-     timebase
+     This is a module implementing the framework timers on a hierarchical
+     timing wheel, all using the RTI timebase
 
  Notes
      Everything is done in terms of RTI Ticks, which can change from
      application to application.
+     Timers 0-15 are bound to the TIMERn_RESP_FUNC post functions from
+     ES_Configure.h, as they always were. The rest of the ES_MAX_TIMERS are
+     handed out to any service by ES_Timer_Alloc. All of them are used
+     through the same ES_Timer_xxx calls and post ES_TIMEOUT with the timer
+     number as the EventParam.
+     A running timer sits in one slot of a 3 level wheel of 64 slots each,
+     chosen by how far away its expiry is. Each tick only looks at the one
+     level 0 slot that is due, and every 64 ticks moves the timers from one
+     level 1 (or 2) slot down a level, so the tick costs the same no matter
+     how many timers are running.
+     A periodic timer is put back on the wheel at its old Expiry + Period
+     when it times out, so the period does not drift with the dispatch
+     delay. It only posts again once ES_Run has passed on its last timeout,
+     a period that comes up while that timeout is still queued is counted
+     as missed instead.
+     The wheel is only changed with interrupts off, so the ES_Timer_xxx
+     calls may also be made from an ISR, as OneShotTriggerISR does.
 
  History
  When           Who     What/Why
  -------------- ---     --------
+ 10/21/26 16:10 jh       clear Pending with ints off in ES_Timer_Dispatched,
+                         it is called from the workers with ES_THREADS
+ 10/18/26 09:43 jh       the wheel & the pool are kept for each robot
+ 10/17/26 23:00 jh       log the timers started from ISRs for replay on the host
+ 10/17/26 18:00 jh       added ES_Timer_GetTicksToNextTimeout for idle sleep
+ 10/17/26 17:25 jh       added ES_Timer_GetClock & ES_Timer_GetMicros
+ 10/17/26 16:30 jh       added periodic timers that reload in the tick
+                         response, and a count of the periods they miss
+ 10/17/26 15:40 jh       replaced the 16 countdown timers with a timing wheel
+                         and a pool of ES_MAX_TIMERS, added ES_Timer_Alloc
+                         and ES_Timer_Free
  10/27/14 14:02 jec      moved ticking of 'time' to ES_Port to allow it to tick
                          even while blocking. required change to ES_GetTime too
  10/20/13 10:48 jec      moved definition of BITS_PER_BYTE to ES_General.h
@@ -47,50 +75,75 @@
 #include "ES_General.h"
 #include "ES_Events.h"
 #include "ES_PostList.h"
-#include "ES_LookupTables.h"
 #include "ES_Timers.h"
 #include "ES_Port.h"
 /*--------------------------- External Variables --------------------------*/
 
 /*----------------------------- Module Defines ----------------------------*/
+// the timers 0-15 that keep their TIMERn_RESP_FUNC binding
+#define NUM_STATIC_TIMERS 16
 
-/*------------------------------ Module Types -----------------------------*/
+// each level of the wheel has 2^WHEEL_BITS slots, 3 levels cover 2^18 ticks
+// which is more than the longest time a Timer_t can hold
+#define WHEEL_BITS 6
+#define WHEEL_SLOTS (1 << WHEEL_BITS)
+#define WHEEL_MASK (WHEEL_SLOTS - 1)
+#define WHEEL_LEVELS 3
 
-/*
-   the size of Tflag sets the number of timers, uint8 = 8, uint16 = 16 ...)
-   to add more timers, you will need to change the data type and modify
-   the initialization of TMR_TimerArray and TMR_MaskArray
-*/
+// marks the end of a list of timers
+#define NO_TIMER 0xFF
 
-typedef uint16_t Tflag_t;
+#if (ES_MAX_TIMERS < NUM_STATIC_TIMERS) || (ES_MAX_TIMERS > 255)
+#error ES_MAX_TIMERS must be between 16 and 255
+#endif
 
+/*------------------------------ Module Types -----------------------------*/
 typedef uint16_t Timer_t; // sets size of timers to 16 bits
 
+typedef enum { TimerFree, TimerStopped, TimerRunning } TimerState_t;
+
+typedef struct {
+   uint32_t    Expiry;   // WheelTime at which a running timer times out
+   pPostFunc   PostFunc; // where the ES_TIMEOUT goes
+   Timer_t     Time;     // ticks left on a timer that is not running
+   Timer_t     Period;   // reload value for a periodic timer, 0 = one shot
+   uint16_t    Missed;   // periods that could not be posted
+   uint8_t     Next;     // links within a wheel slot or the free list
+   uint8_t     Prev;
+   uint8_t     Slot;     // index into Wheel of the slot holding the timer
+   uint8_t     State;    // one of TimerState_t
+   bool        Pending;  // last timeout posted but not yet dispatched
+} TimerNode_t;
 
 /*---------------------------- Module Functions ---------------------------*/
+static void InitTimerPool( void );
+static void InsertTimer( uint8_t Num );
+static void RemoveTimer( uint8_t Num );
+static void CascadeSlot( uint8_t Level, uint8_t Index );
 
 /*---------------------------- Module Variables ---------------------------*/
-static Timer_t TMR_TimerArray[sizeof(Tflag_t)*BITS_PER_BYTE]=
-                                            { 0x0,
-                                              0x0,
-                                              0x0,
-                                              0x0,
-                                              0x0,
-                                              0x0,
-                                              0x0,
-                                              0x0, 
-                                              0x0,
-                                              0x0,
-                                              0x0,
-                                              0x0,
-                                              0x0,
-                                              0x0,
-                                              0x0,
-                                              0x0 };
-
-static Tflag_t TMR_ActiveFlags;
-
-static pPostFunc const Timer2PostFunc[sizeof(Tflag_t)*BITS_PER_BYTE] = 
+// the timers of one robot, see ES_Instance.h
+typedef struct {
+   TimerNode_t Timers[ES_MAX_TIMERS];
+
+   // the first timer in each slot, level 0 first
+   uint8_t Wheel[WHEEL_LEVELS * WHEEL_SLOTS];
+
+   // the number of ticks processed by ES_Timer_Tick_Resp
+   uint32_t WheelTime;
+
+   // list of the timers not yet handed out by ES_Timer_Alloc
+   uint8_t FreeList;
+
+   // set once InitTimerPool has set up the pool & the wheel
+   bool IsInitialized;
+} TimersData_t;
+
+static TimersData_t Instances[ES_NUM_INSTANCES];
+
+#define Me ES_THIS(Instances)
+
+static pPostFunc const Timer2PostFunc[NUM_STATIC_TIMERS] = 
                                             { TIMER0_RESP_FUNC,
                                               TIMER1_RESP_FUNC,
                                               TIMER2_RESP_FUNC,
@@ -129,10 +182,80 @@ static pPostFunc const Timer2PostFunc[sizeof(Tflag_t)*BITS_PER_BYTE] =
 ****************************************************************************/
 void ES_Timer_Init(TimerRate_t Rate)
 {
+   InitTimerPool();
    // call the hardware init routine
    _HW_Timer_Init(Rate);
 }
 
+/****************************************************************************
+ Function
+     ES_Timer_Alloc
+ Parameters
+     pPostFunc Owner, the post function of the service that will get the
+     ES_TIMEOUT events from this timer
+ Returns
+     the number of the new timer, or ES_Timer_NONE if they are all in use
+ Description
+     hands out one of the timers above the 16 bound in ES_Configure.h. The
+     timer starts out stopped, use the other ES_Timer_xxx calls to run it.
+ Notes
+     None.
+ Author
+     J. He, 10/17/26 15:44
+****************************************************************************/
+uint8_t ES_Timer_Alloc(pPostFunc Owner)
+{
+   uint8_t Num;
+
+   InitTimerPool();
+   if ( Owner == TIMER_UNUSED )
+      return ES_Timer_NONE;
+   EnterCritical();   // save interrupt state, turn ints off
+   Num = Me->FreeList;
+   if ( Num != NO_TIMER )
+   {
+      Me->FreeList = Me->Timers[Num].Next;
+      Me->Timers[Num].PostFunc = Owner;
+      Me->Timers[Num].Time = 0;
+      Me->Timers[Num].Period = 0;
+      Me->Timers[Num].Missed = 0;
+      Me->Timers[Num].Pending = false;
+      Me->Timers[Num].State = TimerStopped;
+   }
+   ExitCritical();  // restore saved interrupt state
+   return (Num == NO_TIMER) ? ES_Timer_NONE : Num;
+}
+
+/****************************************************************************
+ Function
+     ES_Timer_Free
+ Parameters
+     unsigned char Num, a timer returned by ES_Timer_Alloc
+ Returns
+     ES_Timer_ERR if Num was not allocated, ES_Timer_OK otherwise
+ Description
+     stops the timer and gives it back to the pool
+ Notes
+     a timeout that has already been posted will still be delivered
+ Author
+     J. He, 10/17/26 15:47
+****************************************************************************/
+ES_TimerReturn_t ES_Timer_Free(uint8_t Num)
+{
+   if( (Num < NUM_STATIC_TIMERS) || (Num >= ARRAY_SIZE(Me->Timers)) ||
+       (Me->Timers[Num].State == TimerFree) )
+      return ES_Timer_ERR;
+   EnterCritical();   // save interrupt state, turn ints off
+   if( Me->Timers[Num].State == TimerRunning )
+      RemoveTimer(Num);
+   Me->Timers[Num].State = TimerFree;
+   Me->Timers[Num].PostFunc = TIMER_UNUSED;
+   Me->Timers[Num].Next = Me->FreeList;
+   Me->FreeList = Num;
+   ExitCritical();  // restore saved interrupt state
+   return ES_Timer_OK;
+}
+
 /****************************************************************************
  Function
      ES_Timer_SetTimer
@@ -151,13 +274,24 @@ void ES_Timer_Init(TimerRate_t Rate)
 ****************************************************************************/
 ES_TimerReturn_t ES_Timer_SetTimer(uint8_t Num, uint16_t NewTime)
 {
+   InitTimerPool();
    /* tried to set a timer that doesn't exist */
-   if( (Num >= ARRAY_SIZE(TMR_TimerArray)) ||
+   if( (Num >= ARRAY_SIZE(Me->Timers)) ||
    /* tried to set a timer without a service */
-       (Timer2PostFunc[Num] == TIMER_UNUSED) ||
+       (Me->Timers[Num].PostFunc == TIMER_UNUSED) ||
        (NewTime == 0) ) /* no time being set */
       return ES_Timer_ERR;  
-   TMR_TimerArray[Num] = NewTime;
+   EnterCritical();   // save interrupt state, turn ints off
+   if( Me->Timers[Num].State == TimerRunning )
+   {
+      // keep the old behavior, the new time is counted from now
+      RemoveTimer(Num);
+      Me->Timers[Num].Expiry = Me->WheelTime + NewTime;
+      InsertTimer(Num);
+   }
+   Me->Timers[Num].Time = NewTime;
+   Me->Timers[Num].Period = 0; /* back to a one shot */
+   ExitCritical();  // restore saved interrupt state
    return ES_Timer_OK;
 }
 
@@ -169,8 +303,8 @@ ES_TimerReturn_t ES_Timer_SetTimer(uint8_t Num, uint16_t NewTime)
  Returns
      ES_Timer_ERR for error ES_Timer_OK for success
  Description
-     simply sets the active flag in TMR_ActiveFlags to (re)start a
-     stopped timer.
+     puts the timer back on the wheel to (re)start a stopped timer with
+     the time it had left.
  Notes
      None.
  Author
@@ -178,13 +312,28 @@ ES_TimerReturn_t ES_Timer_SetTimer(uint8_t Num, uint16_t NewTime)
 ****************************************************************************/
 ES_TimerReturn_t ES_Timer_StartTimer(uint8_t Num)
 {
+   ES_TimerReturn_t ReturnVal;
+
+   InitTimerPool();
    /* tried to set a timer that doesn't exist */
-   if( (Num >= ARRAY_SIZE(TMR_TimerArray)) ||
-       /* tried to set a timer with no time on it */
-       (TMR_TimerArray[Num] == 0) )
+   if( (Num >= ARRAY_SIZE(Me->Timers)) ||
+       (Me->Timers[Num].PostFunc == TIMER_UNUSED) )
       return ES_Timer_ERR;  
-   TMR_ActiveFlags |= BitNum2SetMask[Num]; /* set timer as active */
-   return ES_Timer_OK;
+   EnterCritical();   // save interrupt state, turn ints off
+   if( Me->Timers[Num].State == TimerRunning )
+      ReturnVal = ES_Timer_OK; /* already counting */
+   /* tried to set a timer with no time on it */
+   else if( Me->Timers[Num].Time == 0 )
+      ReturnVal = ES_Timer_ERR;  
+   else
+   {
+      Me->Timers[Num].Expiry = Me->WheelTime + Me->Timers[Num].Time;
+      Me->Timers[Num].State = TimerRunning; /* set timer as active */
+      InsertTimer(Num);
+      ReturnVal = ES_Timer_OK;
+   }
+   ExitCritical();  // restore saved interrupt state
+   return ReturnVal;
 }
 
 /****************************************************************************
@@ -195,8 +344,8 @@ ES_TimerReturn_t ES_Timer_StartTimer(uint8_t Num)
  Returns
      ES_Timer_ERR for error (timer doesn't exist) ES_Timer_OK for success.
  Description
-     simply clears the bit in TMR_ActiveFlags associated with this
-     timer. This will cause it to stop counting.
+     takes the timer off the wheel, remembering the time it had left. This
+     will cause it to stop counting.
  Notes
      None.
  Author
@@ -204,9 +353,17 @@ ES_TimerReturn_t ES_Timer_StartTimer(uint8_t Num)
 ****************************************************************************/
 ES_TimerReturn_t ES_Timer_StopTimer(uint8_t Num)
 {
-   if( Num >= ARRAY_SIZE(TMR_TimerArray) )
+   InitTimerPool();
+   if( Num >= ARRAY_SIZE(Me->Timers) )
       return ES_Timer_ERR;  /* tried to set a timer that doesn't exist */
-   TMR_ActiveFlags &= BitNum2ClrMask[Num]; /* set timer as inactive */
+   EnterCritical();   // save interrupt state, turn ints off
+   if( Me->Timers[Num].State == TimerRunning )
+   {
+      RemoveTimer(Num);
+      Me->Timers[Num].Time = (Timer_t)(Me->Timers[Num].Expiry - Me->WheelTime);
+      Me->Timers[Num].State = TimerStopped; /* set timer as inactive */
+   }
+   ExitCritical();  // restore saved interrupt state
    return ES_Timer_OK;
 }
 
@@ -228,18 +385,180 @@ ES_TimerReturn_t ES_Timer_StopTimer(uint8_t Num)
 ****************************************************************************/
 ES_TimerReturn_t ES_Timer_InitTimer(uint8_t Num, uint16_t NewTime)
 {
+   InitTimerPool();
    /* tried to set a timer that doesn't exist */
-   if( (Num >= ARRAY_SIZE(TMR_TimerArray)) ||
+   if( (Num >= ARRAY_SIZE(Me->Timers)) ||
    /* tried to set a timer without a service */
-       (Timer2PostFunc[Num] == TIMER_UNUSED) ||
+       (Me->Timers[Num].PostFunc == TIMER_UNUSED) ||
        /* tried to set a timer without putting any time on it */
        (NewTime == 0) )
       return ES_Timer_ERR;  
-   TMR_TimerArray[Num] = NewTime;
-   TMR_ActiveFlags |= BitNum2SetMask[Num]; /* set timer as active */
+   if( _HW_IsInISR() )
+   {
+      ES_ReplayRecordTimer(Num, NewTime); /* as the post of an ISR would be */
+   }
+   EnterCritical();   // save interrupt state, turn ints off
+   if( Me->Timers[Num].State == TimerRunning )
+      RemoveTimer(Num);
+   Me->Timers[Num].Time = NewTime;
+   Me->Timers[Num].Period = 0; /* a one shot */
+   Me->Timers[Num].Expiry = Me->WheelTime + NewTime;
+   Me->Timers[Num].State = TimerRunning; /* set timer as active */
+   InsertTimer(Num);
+   ExitCritical();  // restore saved interrupt state
    return ES_Timer_OK;
 }
 
+/****************************************************************************
+ Function
+     ES_Timer_StartPeriodic
+ Parameters
+     unsigned char Num, the number of the timer to start
+     unsigned int Period, the number of ticks between timeouts
+ Returns
+     ES_Timer_ERR if the requested timer does not exist, ES_Timer_OK otherwise.
+ Description
+     starts the timer counting, it will post an ES_TIMEOUT every Period
+     ticks until it is stopped or re-initialized as a one shot.
+ Notes
+     the first timeout comes Period ticks from now. Clears the missed count.
+     ES_Timer_StopTimer followed by ES_Timer_StartTimer resumes the period.
+ Author
+     J. He, 10/17/26 16:34
+****************************************************************************/
+ES_TimerReturn_t ES_Timer_StartPeriodic(uint8_t Num, uint16_t Period)
+{
+   InitTimerPool();
+   /* tried to set a timer that doesn't exist */
+   if( (Num >= ARRAY_SIZE(Me->Timers)) ||
+   /* tried to set a timer without a service */
+       (Me->Timers[Num].PostFunc == TIMER_UNUSED) ||
+       /* tried to set a timer without putting any time on it */
+       (Period == 0) )
+      return ES_Timer_ERR;  
+   EnterCritical();   // save interrupt state, turn ints off
+   if( Me->Timers[Num].State == TimerRunning )
+      RemoveTimer(Num);
+   Me->Timers[Num].Time = Period;
+   Me->Timers[Num].Period = Period;
+   Me->Timers[Num].Missed = 0;
+   Me->Timers[Num].Pending = false;
+   Me->Timers[Num].Expiry = Me->WheelTime + Period;
+   Me->Timers[Num].State = TimerRunning; /* set timer as active */
+   InsertTimer(Num);
+   ExitCritical();  // restore saved interrupt state
+   return ES_Timer_OK;
+}
+
+/****************************************************************************
+ Function
+     ES_Timer_GetMissed
+ Parameters
+     unsigned char Num the number of the timer to check
+ Returns
+     the number of periods since ES_Timer_StartPeriodic whose timeout was
+     not posted, either because the last one had not been dispatched yet
+     or because the post failed. 0 for a timer that does not exist.
+ Description
+     see above
+ Notes
+     sticks at 0xFFFF
+ Author
+     J. He, 10/17/26 16:38
+****************************************************************************/
+uint16_t ES_Timer_GetMissed(uint8_t Num)
+{
+   if( Num >= ARRAY_SIZE(Me->Timers) )
+      return 0;
+   return Me->Timers[Num].Missed;
+}
+
+/****************************************************************************
+ Function
+     ES_Timer_Dispatched
+ Parameters
+     unsigned char Num the number of the timer whose ES_TIMEOUT is about
+     to be passed to a run function
+ Returns
+     None.
+ Description
+     lets a periodic timer post again. Called by ES_Run.
+ Notes
+     with ES_THREADS it is called from a worker thread while the tick
+     response may be reading Pending, so it turns ints off like the other
+     writers of Pending.
+ Author
+     J. He, 10/17/26 16:41
+****************************************************************************/
+void ES_Timer_Dispatched(uint8_t Num)
+{
+   if( Num >= ARRAY_SIZE(Me->Timers) )
+      return;
+   EnterCritical();   // save interrupt state, turn ints off
+   Me->Timers[Num].Pending = false;
+   ExitCritical();  // restore saved interrupt state
+}
+
+/****************************************************************************
+ Function
+     ES_Timer_IsTimerActive
+ Parameters
+     unsigned char Num the number of the timer to check
+ Returns
+     ES_Timer_ERR if the timer does not exist, ES_Timer_ACTIVE if it is
+     counting, ES_Timer_NOT_ACTIVE otherwise
+ Description
+     see above
+ Notes
+     None.
+ Author
+     J. He, 10/17/26 15:52
+****************************************************************************/
+ES_TimerReturn_t ES_Timer_IsTimerActive(uint8_t Num)
+{
+   if( Num >= ARRAY_SIZE(Me->Timers) )
+      return ES_Timer_ERR;
+   return (Me->Timers[Num].State == TimerRunning) ? ES_Timer_ACTIVE :
+                                                ES_Timer_NOT_ACTIVE;
+}
+
+/****************************************************************************
+ Function
+     ES_Timer_GetTicksToNextTimeout
+ Parameters
+     None.
+ Returns
+     the number of ticks until the wheel next has work to do, or
+     ES_Timer_NO_TIMEOUT if no timer is running
+ Description
+     lets ES_Run sleep until the next timeout. If the next timeout is not in
+     level 0 of the wheel, this is the time to the next cascade, which is
+     never more than 64 ticks away.
+ Notes
+     only a hint if a timer is started from an ISR while this runs, but the
+     interrupt wakes the idle sleep anyway.
+ Author
+     J. He, 10/17/26 18:04
+****************************************************************************/
+uint16_t ES_Timer_GetTicksToNextTimeout(void)
+{
+   uint8_t Ahead;
+   uint8_t i;
+
+   InitTimerPool();
+   for ( Ahead = 1; Ahead <= WHEEL_SLOTS; Ahead++ )
+   {
+      if ( Me->Wheel[(uint8_t)((Me->WheelTime + Ahead) & WHEEL_MASK)] !=
+                                                                  NO_TIMER )
+         return Ahead;
+   }
+   for ( i = WHEEL_SLOTS; i < ARRAY_SIZE(Me->Wheel); i++ )
+   {
+      if ( Me->Wheel[i] != NO_TIMER )
+         return (uint16_t)(WHEEL_SLOTS - (Me->WheelTime & WHEEL_MASK));
+   }
+   return ES_Timer_NO_TIMEOUT;
+}
 
 /****************************************************************************
  Function
@@ -262,6 +581,46 @@ uint16_t ES_Timer_GetTime(void)
    return (_HW_GetTickCount());
 }
 
+/****************************************************************************
+ Function
+     ES_Timer_GetClock
+ Parameters
+     None.
+ Returns
+     the 64 bit free running clock, ES_CLOCK_TICKS_PER_US counts per uS
+ Description
+     a time that will not wrap in the life of the robot, for timing things
+     longer than the 65S that ES_Timer_GetTime can handle or that need 
+     better than tick resolution
+ Notes
+     safe to call from an ISR
+ Author
+     J. He, 10/17/26 17:26
+****************************************************************************/
+uint64_t ES_Timer_GetClock(void)
+{
+   return (_HW_GetClock());
+}
+
+/****************************************************************************
+ Function
+     ES_Timer_GetMicros
+ Parameters
+     None.
+ Returns
+     the 64 bit free running clock in uS
+ Description
+     see ES_Timer_GetClock
+ Notes
+     safe to call from an ISR
+ Author
+     J. He, 10/17/26 17:27
+****************************************************************************/
+uint64_t ES_Timer_GetMicros(void)
+{
+   return (_HW_GetMicros());
+}
+
 /****************************************************************************
  Function
      ES_Timer_Tick_Resp
@@ -271,45 +630,168 @@ uint16_t ES_Timer_GetTime(void)
      None.
  Description
      This is the new Tick response routine to support the timer module.
-     It will increment time, to maintain the functionality of the
-     GetTime() timer and it will check through the active timers,
-     decrementing each active timers count, if the count goes to 0, it
-     will post an event to the corresponding SM and clear the active flag to
-     prevent further counting.
+     It advances the wheel by one tick. When a level 0 lap is complete the
+     next level 1 slot (and after 64 of those the next level 2 slot) is
+     moved down to the lower level. Every timer in the level 0 slot for this
+     tick has then timed out, so it is taken off the wheel and an ES_TIMEOUT
+     is posted to its service.
  Notes
-     Called from _Timer_Int_Resp in ES_Port.c.
+     Called from _HW_Process_Pending_Ints in ES_Port.c.
  Author
      J. Edward Carryer, 02/24/97 15:06
 ****************************************************************************/
 void ES_Timer_Tick_Resp(void)
 {
-	static Tflag_t NeedsProcessing;
-	static uint8_t NextTimer2Process;
 	static ES_Event NewEvent;
+	uint8_t Index;
+	uint8_t NextTimer2Process;
+	pPostFunc PostFunc;
 
-	if (TMR_ActiveFlags != 0) /* if !=0 , then at least 1 timer is active */
+	InitTimerPool();
+	EnterCritical();   // save interrupt state, turn ints off
+	Me->WheelTime++;
+	Index = (uint8_t)(Me->WheelTime & WHEEL_MASK);
+	if ( Index == 0 )
 	{
-		// start by getting a list of all the active timers
-		NeedsProcessing = TMR_ActiveFlags;
-		do{
-			// find the MSB that is set
-			NextTimer2Process = ES_GetMSBitSet(NeedsProcessing);
-			/* decrement that timer, check if timed out */
-			if(--TMR_TimerArray[NextTimer2Process] == 0)
+		Index = (uint8_t)((Me->WheelTime >> WHEEL_BITS) & WHEEL_MASK);
+		CascadeSlot(1, Index);
+		if ( Index == 0 )
+			CascadeSlot(2, (uint8_t)((Me->WheelTime >> (2*WHEEL_BITS)) &
+			                        WHEEL_MASK));
+		Index = 0;
+	}
+	// every timer left in this slot is due now. The post has to be made
+	// with ints back on, so the slot is re-checked each time through
+	while ( Me->Wheel[Index] != NO_TIMER )
+	{
+		NextTimer2Process = Me->Wheel[Index];
+		/* take it off the wheel, periodic timers go back on for next time */
+		RemoveTimer(NextTimer2Process);
+		if ( Me->Timers[NextTimer2Process].Period != 0 )
+		{
+			Me->Timers[NextTimer2Process].Expiry +=
+			                                 Me->Timers[NextTimer2Process].Period;
+			InsertTimer(NextTimer2Process);
+			if ( Me->Timers[NextTimer2Process].Pending == true )
 			{
-				NewEvent.EventType = ES_TIMEOUT;
-				NewEvent.EventParam = NextTimer2Process;
-				/* post the timeout event to the right Service */
-				Timer2PostFunc[NextTimer2Process](NewEvent);
-				/* and stop counting */
-				TMR_ActiveFlags &= BitNum2ClrMask[NextTimer2Process];
+				// the last timeout is still waiting, don't pile up another
+				if ( Me->Timers[NextTimer2Process].Missed != UINT16_MAX )
+					Me->Timers[NextTimer2Process].Missed++;
+				continue;
 			}
-			// mark off the active timer that we just processed
-			NeedsProcessing &= BitNum2ClrMask[NextTimer2Process];
-		}while(NeedsProcessing != 0);
-      
+			Me->Timers[NextTimer2Process].Pending = true;
+		}
+		else
+		{
+			/* and stop counting */
+			Me->Timers[NextTimer2Process].Time = 0;
+			Me->Timers[NextTimer2Process].State = TimerStopped;
+		}
+		PostFunc = Me->Timers[NextTimer2Process].PostFunc;
+		ExitCritical();  // restore saved interrupt state
+		NewEvent.EventType = ES_TIMEOUT;
+		NewEvent.EventParam = NextTimer2Process;
+		/* post the timeout event to the right Service */
+		if ( (PostFunc(NewEvent) == false) && 
+		     (Me->Timers[NextTimer2Process].Period != 0) )
+		{
+			EnterCritical();
+			Me->Timers[NextTimer2Process].Pending = false;
+			if ( Me->Timers[NextTimer2Process].Missed != UINT16_MAX )
+				Me->Timers[NextTimer2Process].Missed++;
+			ExitCritical();
+		}
+		EnterCritical();
+	}
+	ExitCritical();
+}
+
+/***************************************************************************
+ private functions
+ ***************************************************************************/
+/* sets up the pool & an empty wheel the first time through, several 
+   services call ES_Timer_Init so it only happens once */
+static void InitTimerPool( void )
+{
+	uint16_t i;
+
+	if ( Me->IsInitialized == true )
+		return;
+	for ( i = 0; i < ARRAY_SIZE(Me->Wheel); i++ )
+		Me->Wheel[i] = NO_TIMER;
+	Me->FreeList = NO_TIMER;
+	for ( i = ARRAY_SIZE(Me->Timers); i-- > 0; )
+	{
+		Me->Timers[i].Time = 0;
+		Me->Timers[i].Period = 0;
+		Me->Timers[i].Missed = 0;
+		Me->Timers[i].Pending = false;
+		if ( i < NUM_STATIC_TIMERS )
+		{
+			Me->Timers[i].PostFunc = Timer2PostFunc[i];
+			Me->Timers[i].State = TimerStopped;
+		}
+		else
+		{
+			Me->Timers[i].PostFunc = TIMER_UNUSED;
+			Me->Timers[i].State = TimerFree;
+			Me->Timers[i].Next = Me->FreeList;
+			Me->FreeList = (uint8_t)i;
+		}
+	}
+	Me->IsInitialized = true;
+}
+
+/* links a timer into the slot matching how far away its Expiry is */
+static void InsertTimer( uint8_t Num )
+{
+	uint32_t Expiry = Me->Timers[Num].Expiry;
+	uint32_t Delta = Expiry - Me->WheelTime;
+	uint8_t Slot;
+
+	if ( Delta < WHEEL_SLOTS )
+		Slot = (uint8_t)(Expiry & WHEEL_MASK);
+	else if ( Delta < (1UL << (2*WHEEL_BITS)) )
+		Slot = WHEEL_SLOTS + (uint8_t)((Expiry >> WHEEL_BITS) & WHEEL_MASK);
+	else
+		Slot = 2*WHEEL_SLOTS + (uint8_t)((Expiry >> (2*WHEEL_BITS)) & WHEEL_MASK);
+	Me->Timers[Num].Slot = Slot;
+	Me->Timers[Num].Prev = NO_TIMER;
+	Me->Timers[Num].Next = Me->Wheel[Slot];
+	if ( Me->Wheel[Slot] != NO_TIMER )
+		Me->Timers[Me->Wheel[Slot]].Prev = Num;
+	Me->Wheel[Slot] = Num;
+}
+
+/* unlinks a timer from whichever slot it is in */
+static void RemoveTimer( uint8_t Num )
+{
+	uint8_t Next = Me->Timers[Num].Next;
+	uint8_t Prev = Me->Timers[Num].Prev;
+
+	if ( Prev == NO_TIMER )
+		Me->Wheel[Me->Timers[Num].Slot] = Next;
+	else
+		Me->Timers[Prev].Next = Next;
+	if ( Next != NO_TIMER )
+		Me->Timers[Next].Prev = Prev;
+}
+
+/* moves every timer in one slot of an upper level down to where it now
+   belongs, the ones due this tick land in the current level 0 slot */
+static void CascadeSlot( uint8_t Level, uint8_t Index )
+{
+	uint8_t Slot = Level*WHEEL_SLOTS + Index;
+	uint8_t ThisTimer = Me->Wheel[Slot];
+	uint8_t NextTimer;
+
+	Me->Wheel[Slot] = NO_TIMER;
+	while ( ThisTimer != NO_TIMER )
+	{
+		NextTimer = Me->Timers[ThisTimer].Next;
+		InsertTimer(ThisTimer);
+		ThisTimer = NextTimer;
 	}
 }
 /*------------------------------- Footnotes -------------------------------*/
 /*------------------------------ End of file ------------------------------*/
-
@@ -0,0 +1,149 @@
+/****************************************************************************
+ Module
+     ES_Trace.c
+ Description
+     Implements the flight recorder, a ring of ES_TraceRecord_t that always
+     holds the last ES_TRACE_RECORDS posts, dispatches and transitions.
+ Notes
+     The framework records the posts and dispatches, the state machines call
+     ES_TraceTransition from their transition blocks. ES_TraceDump prints the
+     ring as text on the console, oldest record first:
+       ES_TRACE BEGIN <records written> <records in the dump>
+       <Time> <Kind> <Source> <Target> <State> <EventType> <EventParam>
+       ES_TRACE END
+     with every field in hex. Tools/ES_TraceDecode.c reads a console log and
+     prints the timeline with the service & machine names.
+
+ History
+ When           Who     What/Why
+ -------------- ---     --------
+ 10/17/26 22:00 jh      started coding
+*****************************************************************************/
+/*----------------------------- Include Files -----------------------------*/
+#include "ES_Configure.h"
+#include "ES_Trace.h"
+#include "ES_General.h"
+#include "ES_Port.h"
+#include <stdio.h>
+
+#if ES_TRACE_RECORDS > 0
+
+/*----------------------------- Module Defines ----------------------------*/
+// the ring is indexed by masking the free running record count
+#define TRACE_MASK (ES_TRACE_RECORDS - 1)
+
+ES_STATIC_ASSERT( (ES_TRACE_RECORDS & TRACE_MASK) == 0, TraceRecordsPowerOf2 );
+
+/*---------------------------- Module Functions ---------------------------*/
+
+/*---------------------------- Module Variables ---------------------------*/
+static ES_TraceRecord_t Ring[ES_TRACE_RECORDS];
+// number of records ever written, the next goes in Ring[NumRecorded & MASK]
+static uint32_t NumRecorded;
+// set while dumping, so the ring holds still
+static volatile bool Frozen;
+
+/*------------------------------ Module Code ------------------------------*/
+/****************************************************************************
+ Function
+   ES_TraceRecord
+ Parameters
+   ES_TraceKind_t Kind : what happened
+   uint8_t Source : the service, machine, ES_TRACE_ISR or ES_TRACE_NO_SERVICE
+   uint8_t Target : the service, or the state left for a transition
+   uint8_t State : the state entered for a transition, otherwise 0
+   ES_Event ThisEvent : the event involved
+ Returns
+   nothing
+ Description
+   time stamps a record and writes it over the oldest one in the ring
+ Notes
+   safe to call from an ISR. Does nothing while the ring is being dumped.
+ Author
+   J. He, 10/17/26, 22:08
+****************************************************************************/
+void ES_TraceRecord( ES_TraceKind_t Kind, uint8_t Source, uint8_t Target,
+                     uint8_t State, ES_Event ThisEvent )
+{
+  ES_TraceRecord_t *pRecord;
+
+  if ( Frozen == true )
+    return;
+  EnterCritical();   // save interrupt state, turn ints off
+  pRecord = &Ring[NumRecorded & TRACE_MASK];
+  NumRecorded++;
+  pRecord->Time = _HW_GetTimestamp();
+  pRecord->EventType = (uint16_t)ThisEvent.EventType;
+  pRecord->EventParam = (uint16_t)ThisEvent.EventParam;
+  pRecord->Kind = (uint8_t)Kind;
+  pRecord->Source = Source;
+  pRecord->Target = Target;
+  pRecord->State = State;
+  ExitCritical();  // restore saved interrupt state
+}
+
+/****************************************************************************
+ Function
+   ES_TraceTransition
+ Parameters
+   ES_TraceMachine_t Machine : the ES_TRACE_<name> of the state machine
+   uint8_t FromState : the state being left
+   uint8_t ToState : the state being entered
+   ES_Event ThisEvent : the event that caused the transition
+ Returns
+   nothing
+ Description
+   records a state transition
+ Notes
+   call it at the top of the MakeTransition block, before the event is
+   replaced with ES_EXIT
+ Author
+   J. He, 10/17/26, 22:12
+****************************************************************************/
+void ES_TraceTransition( ES_TraceMachine_t Machine, uint8_t FromState,
+                         uint8_t ToState, ES_Event ThisEvent )
+{
+  ES_TraceRecord( ES_TRACE_TRANSITION, (uint8_t)Machine, FromState, ToState,
+                  ThisEvent );
+}
+
+/****************************************************************************
+ Function
+   ES_TraceDump
+ Parameters
+   None
+ Returns
+   nothing
+ Description
+   prints the ring on the console, oldest record first, for
+   Tools/ES_TraceDecode.c to decode
+ Notes
+   nothing is recorded while the dump is going on, which takes a while at
+   115200 baud
+ Author
+   J. He, 10/17/26, 22:16
+****************************************************************************/
+void ES_TraceDump( void )
+{
+  uint32_t Index;
+  uint32_t NumInRing;
+  ES_TraceRecord_t *pRecord;
+
+  Frozen = true;
+  NumInRing = (NumRecorded < ES_TRACE_RECORDS) ? NumRecorded :
+                                                  ES_TRACE_RECORDS;
+  printf("ES_TRACE BEGIN %lx %lx\r\n", (unsigned long)NumRecorded,
+         (unsigned long)NumInRing);
+  for ( Index = NumRecorded - NumInRing; Index != NumRecorded; Index++ ) {
+    pRecord = &Ring[Index & TRACE_MASK];
+    printf("%08lx %x %x %x %x %x %x\r\n", (unsigned long)pRecord->Time,
+           pRecord->Kind, pRecord->Source, pRecord->Target, pRecord->State,
+           pRecord->EventType, pRecord->EventParam);
+  }
+  printf("ES_TRACE END\r\n");
+  Frozen = false;
+}
+
+#endif /* ES_TRACE_RECORDS > 0 */
+/*------------------------------- Footnotes -------------------------------*/
+/*------------------------------ End of file ------------------------------*/
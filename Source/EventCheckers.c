@@ -16,6 +16,15 @@
  History
  When           Who     What/Why
  -------------- ---     --------
+ 10/19/26 19:36 jh      's' dumps the starvation statistics
+ 10/19/26 16:37 jh      'k' prints the time the event checkers take
+ 10/18/26 14:29 jh      'n' dumps the ISR statistics
+ 10/18/26 11:48 jh      'x' dumps the run function execution times
+ 10/17/26 23:05 jh      'p' dumps the ISR log for replay on the host
+ 10/17/26 22:20 jh      't' dumps the flight recorder
+ 10/17/26 18:32 jh      'i' prints the idle percentage
+ 10/17/26 15:12 jh      'l' dumps the post-to-dispatch latency histograms
+ 10/17/26 14:15 jh      'q' on the console dumps the framework queue stats
  08/06/13 13:36 jec     initial version
 ****************************************************************************/
 
@@ -28,6 +37,8 @@
 // if you want to use distribution lists then you need those function 
 // definitions too.
 #include "ES_PostList.h"
+// for the queue statistics dump
+#include "ES_Framework.h"
 // This include will pull in all of the headers from the service modules
 // providing the prototypes for all of the post functions
 #include "ES_ServiceHeaders.h"
@@ -114,6 +125,41 @@ bool Check4Keystroke(void)
     ES_Event ThisEvent;
     ThisEvent.EventType = ES_NEW_KEY;
     ThisEvent.EventParam = GetNewKey();
+		if (ThisEvent.EventParam == 'q'){
+		  ES_DumpQueueStats(); // queue high-water marks & dropped posts
+		}
+		if (ThisEvent.EventParam == 't'){
+		  ES_TraceDump(); // the last posts, dispatches & transitions
+		}
+		if (ThisEvent.EventParam == 'p'){
+		  ES_ReplayDump(); // the ISR log, for replay on the host
+		}
+		if (ThisEvent.EventParam == 'n'){
+		  ES_DumpISRStats(); // interrupt counts, run times & jitter
+		}
+		if (ThisEvent.EventParam == 'i'){
+		  printf("Idle %u%%\r\n", ES_GetIdlePercent()); // 100 - CPU load
+		  ES_ResetIdleStats();
+		}
+		if (ThisEvent.EventParam == 'k'){
+		  ES_DumpCheckerStats(); // calls & CPU load of the event checkers
+		  ES_ResetCheckerStats();
+		}
+#ifdef ES_LATENCY_STATS
+		if (ThisEvent.EventParam == 'l'){
+		  ES_DumpLatencyStats(); // how long events wait in the queues
+		}
+#endif
+#ifdef ES_STARVATION_GUARD
+		if (ThisEvent.EventParam == 's'){
+		  ES_DumpStarvationStats(); // how long the guarded services waited
+		}
+#endif
+#ifdef ES_RUN_PROFILE
+		if (ThisEvent.EventParam == 'x'){
+		  ES_DumpRunProfile(); // how long the run functions take
+		}
+#endif
 		//PostMapKeys( ThisEvent );
 		PostHallEffectService( ThisEvent );
 		if (GetNewKey() == 'r'){
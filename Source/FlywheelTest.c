@@ -46,32 +46,40 @@
    relevant to the behavior of this service
 */
 static void Stop(void);
+static void PIControl(void);
 static void InitFlywheelInputCapture(void);
 static void InitPIControlPeriodTimer(void);
 
 /*---------------------------- Module Variables ---------------------------*/
-// with the introduction of Gen2, we need a module level Priority variable
-static uint8_t MyPriority;
-static FlywheelTestState_t CurrentState;
-// PI control parameters
-static uint32_t Period;
-static uint32_t LastCapture;
-static uint16_t TargetRPM;
-static uint16_t CurrentRPM;
-static double RPMError;
-static double SumError;
-static int RequestedDuty; 
-static double Kp = 0.2;
-static double Ki = 0.01;
-// for debug
-static uint32_t debugger1;
-static uint32_t debugger2;
+// the state of one robot, see ES_Instance.h
+typedef struct {
+  // with the introduction of Gen2, we need a module level Priority variable
+  uint8_t MyPriority;
+  FlywheelTestState_t CurrentState;
+  // PI control parameters
+  uint32_t Period;
+  uint32_t LastCapture;
+  uint16_t TargetRPM;
+  uint16_t CurrentRPM;
+  double RPMError;
+  double SumError;
+  int RequestedDuty; 
+  double Kp;
+  double Ki;
+} FlywheelTestData_t;
+
+static FlywheelTestData_t Instances[ES_NUM_INSTANCES] = ES_INSTANCE_INIT({
+  .Kp = 0.2,
+  .Ki = 0.01
+});
+
+#define Me ES_THIS(Instances)
 
 /*------------------------------ Module Code ------------------------------*/
 bool InitFlywheelTest ( uint8_t Priority )
 {
   ES_Event ThisEvent;
-  MyPriority = Priority;
+  Me->MyPriority = Priority;
 	
 	// Initialize PWM (PWMModule)
 	InitFlywheelPWMModule();
@@ -81,15 +89,15 @@ bool InitFlywheelTest ( uint8_t Priority )
 	InitPIControlPeriodTimer();
 	
 	// State machine initialization
-	LastCapture = 0;
-	RequestedDuty = 0;
-	CurrentState = IdleMode;
-	Period = 100000000;
+	Me->LastCapture = 0;
+	Me->RequestedDuty = 0;
+	Me->CurrentState = IdleMode;
+	Me->Period = 100000000;
 	puts("FlywheelTest Initializing...\r");
 	
   // post the initial transition event
   ThisEvent.EventType = ES_INIT;
-  if (ES_PostToService( MyPriority, ThisEvent) == true)
+  if (ES_PostToService( Me->MyPriority, ThisEvent) == true)
   {
       return true;
   }else
@@ -100,7 +108,7 @@ bool InitFlywheelTest ( uint8_t Priority )
 
 bool PostFlywheelTest( ES_Event ThisEvent )
 {
-  return ES_PostToService( MyPriority, ThisEvent);
+  return ES_PostToService( Me->MyPriority, ThisEvent);
 }
 
 ES_Event RunFlywheelTest( ES_Event ThisEvent )
@@ -110,16 +118,22 @@ ES_Event RunFlywheelTest( ES_Event ThisEvent )
   printf("FlywheelTest receives an event\r\n");
 	if (ThisEvent.EventType == ES_RUNFLYWHEEL) {      // start running flywheel
 		SetFlywheelDuty(30);
-		TargetRPM = TargetRPMVal;
-		CurrentRPM = 10;
+		Me->TargetRPM = TargetRPMVal;
+		Me->CurrentRPM = 10;
+		Me->CurrentState = TestMode;
+#ifndef ES_CYCLIC
 		// enable the control interrupt
 		HWREG(WTIMER3_BASE+TIMER_O_IMR) |= TIMER_IMR_TBTOIM; 					
+#endif
 		puts("Flywheel runs\r\n");
 	}
 	if (ThisEvent.EventType == ES_STOPFLYWHEEL) {      // for emergency stop
+#ifndef ES_CYCLIC
 		// disable the control interrupt
 		HWREG(WTIMER3_BASE+TIMER_O_IMR) &= ~TIMER_IMR_TBTOIM;
-		CurrentRPM = 0;
+#endif
+		Me->CurrentState = IdleMode;
+		Me->CurrentRPM = 0;
 		Stop();	
 		puts("Flywheel stops\r\n");
 	}
@@ -129,41 +143,38 @@ ES_Event RunFlywheelTest( ES_Event ThisEvent )
 
 void FlywheelInputCaptureISR(void)
 {
+	ES_ISR_BEGIN(FlywheelInputCaptureISR);
 	uint32_t ThisCapture;
 	// start by clearing the source of the interrupt, the input capture event
 	HWREG(WTIMER3_BASE+TIMER_O_ICR) = TIMER_ICR_CAECINT;
-	debugger1++;
 	// now grab the captured value and calculate the period
 	ThisCapture = HWREG(WTIMER3_BASE+TIMER_O_TAR);
-	Period = ThisCapture - LastCapture;
+	Me->Period = ThisCapture - Me->LastCapture;
 	// update LastCapture to prepare for the next edge
-	LastCapture = ThisCapture;
+	Me->LastCapture = ThisCapture;
+#ifndef ES_CYCLIC
 	// enable the control interrupt (although a 2mS delay)
 	HWREG(WTIMER3_BASE+TIMER_O_IMR) |= TIMER_IMR_TBTOIM;
+#endif
+	ES_ISR_END(FlywheelInputCaptureISR);
 }
 
 void PIControlISR(void)
 {
+	// count this run so that we can tell this interrupt is actually working
+	ES_ISR_BEGIN(PIControlISR);
 	// start by clearing the source of the interrupt
 	HWREG(WTIMER3_BASE+TIMER_O_ICR) = TIMER_ICR_TBTOCINT;
-	// increment our counter so that we can tell this interrupt is actually working
-	debugger2++;
-	if (Period == -1){SetFlywheelDuty(30);}
-	else {
-		CurrentRPM = (60.0*SysClkFreq)/(Period*FlyWEncoderTicksPerRev); // Calculate the current RPM based on Period
-		if (CurrentRPM > 3000){CurrentRPM = 10;}
-		RPMError = ((double)TargetRPM - (double)CurrentRPM);
-		SumError += RPMError;
-		RequestedDuty = (int)(Kp * (RPMError +  Ki* SumError));
-		// add anti-windup for the integrator
-		if (RequestedDuty > 100)  {
-			RequestedDuty = 100;
-			SumError -= RPMError;
-		} else if (RequestedDuty < 0) {
-			RequestedDuty = 0;
-			SumError -= RPMError;
-		}
-		SetFlywheelDuty(RequestedDuty); // Update the PWM
+	PIControl();
+	ES_ISR_END(PIControlISR);
+}
+
+// the flywheel control loop with ES_CYCLIC, run in every minor frame by the
+// cyclic executive in place of PIControlISR while the flywheel is running
+void FlywheelControlSlot(void)
+{
+	if (Me->CurrentState == TestMode) {
+		PIControl();
 	}
 }
 
@@ -171,10 +182,32 @@ void PIControlISR(void)
  private functions
  ***************************************************************************/
 
+// the PI speed control, updates the flywheel duty from the last period
+static void PIControl(void)
+{
+	if (Me->Period == -1){SetFlywheelDuty(30);}
+	else {
+		Me->CurrentRPM = (60.0*SysClkFreq)/(Me->Period*FlyWEncoderTicksPerRev); // Calculate the current RPM based on Period
+		if (Me->CurrentRPM > 3000){Me->CurrentRPM = 10;}
+		Me->RPMError = ((double)Me->TargetRPM - (double)Me->CurrentRPM);
+		Me->SumError += Me->RPMError;
+		Me->RequestedDuty = (int)(Me->Kp * (Me->RPMError +  Me->Ki* Me->SumError));
+		// add anti-windup for the integrator
+		if (Me->RequestedDuty > 100)  {
+			Me->RequestedDuty = 100;
+			Me->SumError -= Me->RPMError;
+		} else if (Me->RequestedDuty < 0) {
+			Me->RequestedDuty = 0;
+			Me->SumError -= Me->RPMError;
+		}
+		SetFlywheelDuty(Me->RequestedDuty); // Update the PWM
+	}
+}
+
 static void Stop(void)
 {
 	SetFlywheelDuty(0);
-	TargetRPM = 0;
+	Me->TargetRPM = 0;
 }
 
 static void InitFlywheelInputCapture(void)  // pin: PD2 (WT3CCP0)
@@ -49,7 +49,16 @@ One shot timer:  1st stop: 60 seconds, 2nd stop: 60 seconds, final stop: 20 seco
 #define FREE_SHOOTING_WINDOW 20000*TicksPerMS
 
 /*----------------------------- Module Variables ----------------------------*/
-static uint8_t TimePassage = 0;
+// the state of one robot, see ES_Instance.h
+typedef struct {
+  uint8_t TimePassage;
+  // when the game started, from the 64 bit framework clock
+  uint64_t GameStartTime;
+} GameTimerData_t;
+
+static GameTimerData_t Instances[ES_NUM_INSTANCES];
+
+#define Me ES_THIS(Instances)
 
 void InitGameTimer(void) {  // pin: PD4 (WT4CCP1)
 	// start by enabling the clock to the timer (Wide Timer 4)
@@ -87,6 +96,7 @@ void InitGameTimer(void) {  // pin: PD4 (WT4CCP1)
 
 	// Kick off the game timer when the init function is called.
 	HWREG(WTIMER4_BASE+TIMER_O_CTL) |= (TIMER_CTL_TBEN | TIMER_CTL_TBSTALL);
+	Me->GameStartTime = ES_Timer_GetMicros();
 }
 
 void GameTimerISR(void)
@@ -94,7 +104,7 @@ void GameTimerISR(void)
 	// start by clearing the source of the interrupt
 	HWREG(WTIMER4_BASE+TIMER_O_ICR) = TIMER_ICR_TBTOCINT;
 	// load time to timer based on the TimePassage variable
-	if (TimePassage < 5)
+	if (Me->TimePassage < 5)
 	{
 		printf("Normal TimePassage\r\n");
 		HWREG(WTIMER4_BASE+TIMER_O_TBILR) = TWENTY_SECOND;
@@ -102,7 +112,7 @@ void GameTimerISR(void)
 		// kick off game timer again 
 		HWREG(WTIMER4_BASE+TIMER_O_CTL) |= (TIMER_CTL_TBEN | TIMER_CTL_TBSTALL);
 	}
-	else if (TimePassage == 5)
+	else if (Me->TimePassage == 5)
 	{
 		printf("Last 20 sec TimePassage and Post Crazy Event to MasterSM\r\n");
 		HWREG(WTIMER4_BASE+TIMER_O_TBILR) = FREE_SHOOTING_WINDOW;
@@ -113,16 +123,22 @@ void GameTimerISR(void)
 		// kick off game timer again 
 		HWREG(WTIMER4_BASE+TIMER_O_CTL) |= (TIMER_CTL_TBEN | TIMER_CTL_TBSTALL);
 	}
-	else if (TimePassage == 6)
+	else if (Me->TimePassage == 6)
 	{
 		ES_Event GameOver;
 		GameOver.EventType = ES_GAME_OVER;
 		PostMasterSM(GameOver);
 	}
-	TimePassage ++;
+	Me->TimePassage ++;
 }
 
 uint8_t QueryTimePassage(void)
 {
-	return TimePassage;
+	return Me->TimePassage;
+}
+
+// milliseconds since InitGameTimer, does not wrap like ES_Timer_GetTime
+uint32_t QueryGameTimeMS(void)
+{
+	return (uint32_t)((ES_Timer_GetMicros() - Me->GameStartTime) / 1000);
 }
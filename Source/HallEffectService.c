@@ -44,22 +44,29 @@ It uses the interrupt timer associated with tiva input PD6
 #define PeriodMargin 20
 
 /*---------------------------- Module Variables ---------------------------*/
-// with the introduction of Gen2, we need a module level Priority variable
-static uint8_t HallEffectPriority;
 static uint16_t PeriodArray[16] = {1333, 1277, 1222, 1166, 1111,
 																	1055, 1000, 944, 889, 833,
 																	778, 722, 667, 611, 556, 500};
-static uint32_t ThisPeriod;
-static uint8_t PeriodIndex;
-static uint32_t LastCapture;
-static uint32_t LastPeriod;
-static uint8_t PeriodCount;
-static uint32_t CapturedPeriod[32];
-static bool ReadytoSendPeriod;
-static uint8_t stageNum;
-static int SensorStatus; // for future debugging
-static HallEffectSensorState_t HallEffectState;
-static int debugger;
+
+// the state of one robot, see ES_Instance.h
+typedef struct {
+  // with the introduction of Gen2, we need a module level Priority variable
+  uint8_t HallEffectPriority;
+  uint32_t ThisPeriod;
+  uint8_t PeriodIndex;
+  uint32_t LastCapture;
+  uint32_t LastPeriod;
+  uint8_t PeriodCount;
+  uint32_t CapturedPeriod[32];
+  bool ReadytoSendPeriod;
+  uint8_t stageNum;
+  int SensorStatus; // for future debugging
+  HallEffectSensorState_t HallEffectState;
+} HallEffectServiceData_t;
+
+static HallEffectServiceData_t Instances[ES_NUM_INSTANCES];
+
+#define Me ES_THIS(Instances)
    										
 /*---------------------------- Module Functions ---------------------------*/
 /* prototypes for private functions for this service.They should be functions
@@ -75,9 +82,9 @@ Initialize state machine
 **************************/
 
 bool InitHallEffectService(uint8_t Priority) {
-	HallEffectPriority = Priority;
+	Me->HallEffectPriority = Priority;
 	InitHallEffectCapture(); // input capture has not started yet (locally disable interrupt in Init function)
-	HallEffectState = Waiting4Capture;
+	Me->HallEffectState = Waiting4Capture;
 	
 	// Initialize PB2 as GPIO pins for selecting mux
 	HWREG(SYSCTL_RCGCGPIO) |= SYSCTL_RCGCGPIO_R1;
@@ -101,7 +108,7 @@ Posts events to service. Returns true if successful
 **************************************************/
 
 bool PostHallEffectService(ES_Event ThisEvent) {
-  return ES_PostToService(HallEffectPriority, ThisEvent); 
+  return ES_PostToService(Me->HallEffectPriority, ThisEvent); 
 }
 
 /******************************************************************
@@ -114,33 +121,32 @@ MagneticPeriod.
 ES_Event RunHallEffectService(ES_Event ThisEvent) {
 	ES_Event ReturnEvent;
   ReturnEvent.EventType = ES_NO_EVENT; // assume no errors
-		switch(HallEffectState) {
+		switch(Me->HallEffectState) {
 			case Waiting4Capture :
 				
 				if(ThisEvent.EventType == ES_START_MAG_FIELD_CAPTURE) {
-					HallEffectState = PeriodCapturing;
+					Me->HallEffectState = PeriodCapturing;
 					// clear all module vars for a new-round capturing
-					LastCapture = 0;
-					PeriodCount = 0;
-					LastPeriod = 0;
-					ThisPeriod = 0;
-					SensorStatus = 0; // a dummy status (real status is 1 or 2)
+					Me->LastCapture = 0;
+					Me->PeriodCount = 0;
+					Me->LastPeriod = 0;
+					Me->ThisPeriod = 0;
+					Me->SensorStatus = 0; // a dummy status (real status is 1 or 2)
 					for (int i = 0; i < 32; i++) {
-						CapturedPeriod[i] = 0;
+						Me->CapturedPeriod[i] = 0;
 					}
-					PeriodIndex = 0;
-					ReadytoSendPeriod = false;
+					Me->PeriodIndex = 0;
+					Me->ReadytoSendPeriod = false;
 					
 					// Choose to turn on which side of sensors based on stage number
-					stageNum = ThisEvent.EventParam;  //!!! Change: stageNum is passed in the EventParam instead (LEFT or RIGHT)
-					InitSensors(stageNum); // initialize sensors based on stage number
+					Me->stageNum = ThisEvent.EventParam;  //!!! Change: stageNum is passed in the EventParam instead (LEFT or RIGHT)
+					InitSensors(Me->stageNum); // initialize sensors based on stage number
 					// Enable WTimer5A for input capture
 					HWREG(WTIMER5_BASE+TIMER_O_IMR) |= TIMER_IMR_CAEIM;
 					printf("Start to capture mag field\r\n");
 				}
 				
-				//if (ThisEvent.EventType == ES_NEW_KEY) {printf("debugger: %d\r\n", debugger);}
-				if (ThisEvent.EventType == ES_NEW_KEY) {printf("This Period: %d\r\n", ThisPeriod);}
+				if (ThisEvent.EventType == ES_NEW_KEY) {printf("This Period: %d\r\n", Me->ThisPeriod);}
 			break;
 
 			case PeriodCapturing :
@@ -150,83 +156,83 @@ ES_Event RunHallEffectService(ES_Event ThisEvent) {
 					HWREG(WTIMER5_BASE+TIMER_O_IMR) &= ~TIMER_IMR_CAEIM;
 					for (int i = 0; i < 16; i++) {
 						if (ThisEvent.EventParam >= (PeriodArray[i] - 20) && ThisEvent.EventParam <= (PeriodArray[i] + 20)) {
-							ReadytoSendPeriod = true;
-							PeriodIndex = i;
+							Me->ReadytoSendPeriod = true;
+							Me->PeriodIndex = i;
 						}
 					}
 					
-					if (ReadytoSendPeriod) {
+					if (Me->ReadytoSendPeriod) {
 						// Post event to MasterSM
 						ES_Event Event2Post;
 						Event2Post.EventType = ES_MAG_FIELD;
 						// Want to let Master know what period is captured so that it can print it out
-						Event2Post.EventParam = PeriodArray[PeriodIndex];
+						Event2Post.EventParam = PeriodArray[Me->PeriodIndex];
 						printf("Mag Freq: %duS\r\n", Event2Post.EventParam);
 						PostMasterSM(Event2Post);
 						puts("Mag found, posted back to Master\r\n");
 						// return to Waiting4Capture state
-						HallEffectState = Waiting4Capture;
+						Me->HallEffectState = Waiting4Capture;
 						puts("Going back to Waiting4Capture......\r\n");
 					} else {
 						HWREG(WTIMER5_BASE+TIMER_O_IMR) |= TIMER_IMR_CAEIM;
 					}
 				}
 				
-				//if (ThisEvent.EventType == ES_NEW_KEY) {printf("debugger: %d\r\n", debugger);}
-				if (ThisEvent.EventType == ES_NEW_KEY) {printf("This Period: %d\r\n", ThisPeriod);}
+				if (ThisEvent.EventType == ES_NEW_KEY) {printf("This Period: %d\r\n", Me->ThisPeriod);}
 			break;
 		}
 	return ReturnEvent;
 }
 
 void HallEffectCaptureISR(void) {
-	debugger++;
+	ES_ISR_BEGIN(HallEffectCaptureISR);
 	uint32_t ThisCapture;
 // start by clearing the source of the interrupt, the input capture event
 	HWREG(WTIMER5_BASE+TIMER_O_ICR) = TIMER_ICR_CAECINT;
 // now grab the captured value and calculate the period
-	ThisCapture = HWREG(WTIMER5_BASE+TIMER_O_TAR); // ticks
-	ThisPeriod = (ThisCapture - LastCapture) * 25 / 1000; // (uS)
-	LastCapture = ThisCapture;
+	ThisCapture = ES_ReplayCapture(HWREG(WTIMER5_BASE+TIMER_O_TAR)); // ticks
+	Me->ThisPeriod = (ThisCapture - Me->LastCapture) * 25 / 1000; // (uS)
+	Me->LastCapture = ThisCapture;
 	
-	if (PeriodCount == 0) {
-		CapturedPeriod[PeriodCount] = ThisPeriod;
-		PeriodCount++;
-		LastPeriod = ThisPeriod;
+	if (Me->PeriodCount == 0) {
+		Me->CapturedPeriod[Me->PeriodCount] = Me->ThisPeriod;
+		Me->PeriodCount++;
+		Me->LastPeriod = Me->ThisPeriod;
 	} else {
 		
-		if (ThisPeriod > (LastPeriod + 60) || ThisPeriod < (LastPeriod - 60)) {
+		if (Me->ThisPeriod > (Me->LastPeriod + 60) || Me->ThisPeriod < (Me->LastPeriod - 60)) {
 			// clear all measured periods
-			for (int i = 0; i < PeriodCount; i++) {
-				CapturedPeriod[i] = 0;
+			for (int i = 0; i < Me->PeriodCount; i++) {
+				Me->CapturedPeriod[i] = 0;
 			}
 			// re-count from 0
-			PeriodCount = 0;
+			Me->PeriodCount = 0;
 		} else {
-			CapturedPeriod[PeriodCount] = ThisPeriod;
-			PeriodCount++;
+			Me->CapturedPeriod[Me->PeriodCount] = Me->ThisPeriod;
+			Me->PeriodCount++;
 			// update LastPeriod to be the average of all measured values
 			uint32_t sum = 0;
-			for (int i = 0; i < PeriodCount; i++) {
-				sum += CapturedPeriod[i];
+			for (int i = 0; i < Me->PeriodCount; i++) {
+				sum += Me->CapturedPeriod[i];
 			}
-			LastPeriod = sum/PeriodCount;
+			Me->LastPeriod = sum/Me->PeriodCount;
 			
-			if (PeriodCount == 32) {
+			if (Me->PeriodCount == 32) {
 				ES_Event MagPeriodEvent;
 				MagPeriodEvent.EventType = ES_MAGNETIC_PULSE;
-				MagPeriodEvent.EventParam = LastPeriod;
+				MagPeriodEvent.EventParam = Me->LastPeriod;
 				PostHallEffectService(MagPeriodEvent);
 			}
 		}
 	}
+	ES_ISR_END(HallEffectCaptureISR);
 }
 
 uint8_t getFreqCode(void) {
 	// If ready to send period, return frequency code
-	if(ReadytoSendPeriod) {
+	if(Me->ReadytoSendPeriod) {
 		puts("Frequency code sent to LOC\r\n");
-		return PeriodIndex;
+		return Me->PeriodIndex;
 	}
 	
 	// If something wrong, return nonsense number
@@ -240,11 +246,11 @@ static void InitSensors(uint8_t stageNum)
 		if (stageNum == 1 || stageNum == 3) { // 1R or 3R (left)
 			// set PB2 to be low 
 			HWREG(GPIO_PORTB_BASE+(GPIO_O_DATA+ALL_BITS)) &= ~GPIO_PIN_2;
-			SensorStatus = LEFT;
+			Me->SensorStatus = LEFT;
 		} else if (stageNum == 2) { // 2R (right)
 			// set PB2 to be high 
 			HWREG(GPIO_PORTB_BASE+(GPIO_O_DATA+ALL_BITS)) |= GPIO_PIN_2;
-			SensorStatus = RIGHT;
+			Me->SensorStatus = RIGHT;
 	  }
 }
 
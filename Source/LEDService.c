@@ -65,11 +65,18 @@ static void TurnOnGreenLED(void);
 static void TurnOffBothLEDs(void);
 
 /*---------------------------- Module Variables ---------------------------*/
-// with the introduction of Gen2, we need a module level Priority variable
-static uint8_t MyPriority;
-static LEDState_t CurrentState;
-static bool LED_ON;
-static int BlinkTimes;
+// the state of one robot, see ES_Instance.h
+typedef struct {
+  // with the introduction of Gen2, we need a module level Priority variable
+  uint8_t MyPriority;
+  LEDState_t CurrentState;
+  bool LED_ON;
+  int BlinkTimes;
+} LEDServiceData_t;
+
+static LEDServiceData_t Instances[ES_NUM_INSTANCES];
+
+#define Me ES_THIS(Instances)
 
 
 /*------------------------------ Module Code ------------------------------*/
@@ -91,7 +98,7 @@ static int BlinkTimes;
 ****************************************************************************/
 bool InitLEDService ( uint8_t Priority )
 {
-  MyPriority = Priority;
+  Me->MyPriority = Priority;
  // Initialize the port line PE0,PE1 for R & G LEDs
 	HWREG(SYSCTL_RCGCGPIO) |= SYSCTL_RCGCGPIO_R4;
 	// Wait until clock is ready
@@ -105,14 +112,14 @@ bool InitLEDService ( uint8_t Priority )
 	// Turn off both LEDs
 	TurnOffBothLEDs();
 	// Set CurrentState to Waiting4Command
-	CurrentState = Waiting4Designation;
+	Me->CurrentState = Waiting4Designation;
 	// Set LED_ON to false
-	LED_ON = false;
+	Me->LED_ON = false;
 	// Set BlinkTimes to 0
-	BlinkTimes = 0;
+	Me->BlinkTimes = 0;
   ES_Event ThisEvent;
 	ThisEvent.EventType = ES_INIT;
-	if (ES_PostToService( MyPriority, ThisEvent) == true){
+	if (ES_PostToService( Me->MyPriority, ThisEvent) == true){
     return true;
 	}
 	else{
@@ -136,7 +143,7 @@ bool InitLEDService ( uint8_t Priority )
 ****************************************************************************/
 bool PostLEDService( ES_Event ThisEvent )
 {
-  return ES_PostToService( MyPriority, ThisEvent);
+  return ES_PostToService( Me->MyPriority, ThisEvent);
 }
 
 
@@ -159,18 +166,18 @@ ES_Event RunLEDService( ES_Event ThisEvent )
   ReturnEvent.EventType = ES_NO_EVENT; // assume no errors
   printf("LED Service receives an event\r\n");
 	// Based on the current state, choose the corresponding block of code
-	switch(CurrentState){
+	switch(Me->CurrentState){
 	  // If it is in the beginning without knowing which color it is
 		case Waiting4Designation:
 			// If receiving an color designation event
 		  if (ThisEvent.EventType  == ES_COLORDESIGNATION){
 				printf("Now designate color\r\n");
 				// Set LED_ON to true
-				LED_ON = true;
+				Me->LED_ON = true;
 			  // If parameter is RED
 				if (ThisEvent.EventParam == RED){
 				  // Set CurrentState to Red
-					CurrentState = Red;
+					Me->CurrentState = Red;
 					// Turn on red LEDs
 					TurnOnRedLED();
 					printf("Red LED on\r\n");
@@ -178,7 +185,7 @@ ES_Event RunLEDService( ES_Event ThisEvent )
 				// Else if parameter is GREEN
 				if (ThisEvent.EventParam == GREEN){
 				  // Set CurrentState to Green
-					CurrentState = Green;
+					Me->CurrentState = Green;
 					// Turn on green LEDs
 					TurnOnGreenLED();
 					printf("Green LED on\r\n");
@@ -189,28 +196,26 @@ ES_Event RunLEDService( ES_Event ThisEvent )
 		case Red:
 			// if this event is ES_QUERYBALL
 		  if (ThisEvent.EventType == ES_QUERYBALL){
-				// Initialize LED_BLINK_TIMER
-			  ES_Timer_InitTimer(LED_BLINK_TIMER,BLINK_INTERVAL);
+				// Start LED_BLINK_TIMER, it reloads itself every BLINK_INTERVAL
+			  ES_Timer_StartPeriodic(LED_BLINK_TIMER,BLINK_INTERVAL);
 			}
 			// if this event is LED_BLINK_TIMER timeout
 			if (ThisEvent.EventType == ES_TIMEOUT && ThisEvent.EventParam == LED_BLINK_TIMER){
 				// Switch on and off LED
-				if (LED_ON){
+				if (Me->LED_ON){
 				  TurnOffBothLEDs();
-					LED_ON = false;
+					Me->LED_ON = false;
 				}
 				else {
 				  TurnOnRedLED();
-					LED_ON = true;
+					Me->LED_ON = true;
 				}
 				// Increment BlinkTimes
-				BlinkTimes++;
-				if (BlinkTimes < TotalBlinkTimes){
-				  // Initialize LED_BLINK_TIMER again
-				  ES_Timer_InitTimer(LED_BLINK_TIMER,BLINK_INTERVAL);
-				}
-				else {
-					BlinkTimes = 0;
+				Me->BlinkTimes++;
+				if (Me->BlinkTimes >= TotalBlinkTimes){
+				  // Done blinking, stop LED_BLINK_TIMER
+				  ES_Timer_StopTimer(LED_BLINK_TIMER);
+					Me->BlinkTimes = 0;
 				}
 			}
 			
@@ -219,28 +224,26 @@ ES_Event RunLEDService( ES_Event ThisEvent )
 		case Green:
 			// if this event is ES_QUERYBALL
 		  if (ThisEvent.EventType == ES_QUERYBALL){
-				// Initialize LED_BLINK_TIMER
-			  ES_Timer_InitTimer(LED_BLINK_TIMER,BLINK_INTERVAL);
+				// Start LED_BLINK_TIMER, it reloads itself every BLINK_INTERVAL
+			  ES_Timer_StartPeriodic(LED_BLINK_TIMER,BLINK_INTERVAL);
 			}
 			// if this event is LED_BLINK_TIMER timeout
 			if (ThisEvent.EventType == ES_TIMEOUT && ThisEvent.EventParam == LED_BLINK_TIMER){
 				// Switch on and off LED
-				if (LED_ON){
+				if (Me->LED_ON){
 				  TurnOffBothLEDs();
-					LED_ON = false;
+					Me->LED_ON = false;
 				}
 				else {
 				  TurnOnGreenLED();
-					LED_ON = true;
+					Me->LED_ON = true;
 				}
 				// Increment BlinkTimes
-				BlinkTimes++;
-				if (BlinkTimes < TotalBlinkTimes){
-				  // Initialize LED_BLINK_TIMER again
-				  ES_Timer_InitTimer(LED_BLINK_TIMER,BLINK_INTERVAL);
-				}
-				else {
-					BlinkTimes = 0;
+				Me->BlinkTimes++;
+				if (Me->BlinkTimes >= TotalBlinkTimes){
+				  // Done blinking, stop LED_BLINK_TIMER
+				  ES_Timer_StopTimer(LED_BLINK_TIMER);
+					Me->BlinkTimes = 0;
 				}
 			}
 			break;
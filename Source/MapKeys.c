@@ -13,6 +13,7 @@
  History
  When           Who     What/Why
  -------------- ---     --------
+ 10/18/26 09:43 jh       keep the state in one struct for each robot
  02/06/14 14:44 jec      tweaked to be a more generic key-mapper
  02/07/12 00:00 jec      converted to service for use with E&S Gen2
  02/20/07 21:37 jec      converted to use enumerated type for events
@@ -37,8 +38,15 @@
 
 
 /*---------------------------- Module Variables ---------------------------*/
-// with the introduction of Gen2, we need a module level Priority variable
-static uint8_t MyPriority;
+// the state of one robot, see ES_Instance.h
+typedef struct {
+  // with the introduction of Gen2, we need a module level Priority variable
+  uint8_t MyPriority;
+} MapKeysData_t;
+
+static MapKeysData_t Instances[ES_NUM_INSTANCES];
+
+#define Me ES_THIS(Instances)
 
 
 /*------------------------------ Module Code ------------------------------*/
@@ -62,10 +70,10 @@ static uint8_t MyPriority;
 ****************************************************************************/
 bool InitMapKeys ( uint8_t Priority )
 {
-  MyPriority = Priority;
+  Me->MyPriority = Priority;
 	ES_Event ThisEvent;
   ThisEvent.EventType = ES_INIT;
-  if (ES_PostToService( MyPriority, ThisEvent) == true)
+  if (ES_PostToService( Me->MyPriority, ThisEvent) == true)
   {
 		puts("MapKeys initialized\r\n");
       return true;
@@ -94,7 +102,7 @@ bool InitMapKeys ( uint8_t Priority )
 ****************************************************************************/
 bool PostMapKeys( ES_Event ThisEvent )
 {
-  return ES_PostToService( MyPriority, ThisEvent);
+  return ES_PostToService( Me->MyPriority, ThisEvent);
 }
 
 
@@ -13,6 +13,8 @@
  History
  When           Who     What/Why
  -------------- ---     --------
+ 10/18/26 09:43 jh      keep the state in one struct for each robot
+ 10/17/26 22:20 jh      record state transitions in the flight recorder
  02/20/17 14:30 jec      updated to remove sample of consuming an event. We 
                          always want to return ES_NO_EVENT at the top level 
                          unless there is a non-recoverable error at the 
@@ -80,16 +82,23 @@ static ES_Event DuringDrivingSM( ES_Event Event);
 static ES_Event DuringShooting( ES_Event Event);
 
 /*---------------------------- Module Variables ---------------------------*/
-// everybody needs a state variable, though if the top level state machine
-// is just a single state container for orthogonal regions, you could get
-// away without it
-static MasterState_t CurrentMasterState;
-// with the introduction of Gen2, we need a module level Priority var as well
-static uint8_t MasterPriority;
-//!!! Need to read a pin to determine the color later!!!
-static bool Color; // green -> 0, red -> 1
-static bool isBackFromDepot;
-static bool isFreeShooting;
+// the state of one robot, see ES_Instance.h
+typedef struct {
+  // everybody needs a state variable, though if the top level state machine
+  // is just a single state container for orthogonal regions, you could get
+  // away without it
+  MasterState_t CurrentMasterState;
+  // with the introduction of Gen2, we need a module level Priority var as well
+  uint8_t MasterPriority;
+  //!!! Need to read a pin to determine the color later!!!
+  bool Color; // green -> 0, red -> 1
+  bool isBackFromDepot;
+  bool isFreeShooting;
+} MasterSMData_t;
+
+static MasterSMData_t Instances[ES_NUM_INSTANCES];
+
+#define Me ES_THIS(Instances)
 /*------------------------------ Module Code ------------------------------*/
 /****************************************************************************
  Function
@@ -113,7 +122,7 @@ bool InitMasterSM ( uint8_t Priority )
 {
   ES_Event ThisEvent;
 
-  MasterPriority = Priority;  // save our priority
+  Me->MasterPriority = Priority;  // save our priority
 
   ThisEvent.EventType = ES_ENTRY;
   // Start the Master State machine
@@ -142,7 +151,7 @@ bool InitMasterSM ( uint8_t Priority )
 ****************************************************************************/
 bool PostMasterSM( ES_Event ThisEvent )
 {
-  return ES_PostToService( MasterPriority, ThisEvent);
+  return ES_PostToService( Me->MasterPriority, ThisEvent);
 }
 
 /****************************************************************************
@@ -165,10 +174,10 @@ bool PostMasterSM( ES_Event ThisEvent )
 ES_Event RunMasterSM( ES_Event CurrentEvent )
 {
    bool MakeTransition = false;/* are we making a state transition? */
-   MasterState_t NextMasterState = CurrentMasterState;
+   MasterState_t NextMasterState = Me->CurrentMasterState;
    ES_Event EntryEventKind = { ES_ENTRY, 0 };// default to normal entry to new state
    ES_Event ReturnEvent = { ES_NO_EVENT, 0 }; // assume no error
-   switch ( CurrentMasterState )
+   switch ( Me->CurrentMasterState )
    {
        case WaitToStartGame :       // If current master state is wait to start game
          // Execute During function for WaitToStartGame. ES_ENTRY & ES_EXIT are
@@ -195,7 +204,7 @@ ES_Event RunMasterSM( ES_Event CurrentEvent )
 					 }
 					 else if (CurrentEvent.EventType == ES_LOC_STATUS)   // If LOC posts an event about status byte 3 ( byte in its param) 
 					 {
-						 	static bool GameStart = false;
+						 	bool GameStart = false;
 							GameStart = DecipherGameStatus(CurrentEvent.EventParam);
 							if (!GameStart)  // if GameStart == false
 							{
@@ -214,7 +223,7 @@ ES_Event RunMasterSM( ES_Event CurrentEvent )
 					 else if (CurrentEvent.EventType == ES_FREE_SHOOTING)  
 					 {
 							puts("Last 18 seconds!\r\n");
-							isFreeShooting = true;
+							Me->isFreeShooting = true;
 						 	NextMasterState = Driving;
 						  MakeTransition = true;
 				   }
@@ -258,7 +267,7 @@ ES_Event RunMasterSM( ES_Event CurrentEvent )
 					 else if (CurrentEvent.EventType == ES_FREE_SHOOTING)  
 					 {
 							puts("Last 18 seconds!!!!!!!!!!!!!!!!!!!!!!!!!!!Now is still driving\r\n");
-							isFreeShooting = true;
+							Me->isFreeShooting = true;
 						 	NextMasterState = Driving;
 						  MakeTransition = true;
 				   }
@@ -304,7 +313,7 @@ ES_Event RunMasterSM( ES_Event CurrentEvent )
 					 {
 						 puts("Notify MasterSM of returning from the depot\r\n");
 						 // Go back to Driving (which will be initialized to WaitToMove and query LOC for next stage)
-						 isBackFromDepot = true;
+						 Me->isBackFromDepot = true;
 						 NextMasterState = Driving;
 						 MakeTransition = true;
 					 }
@@ -319,7 +328,7 @@ ES_Event RunMasterSM( ES_Event CurrentEvent )
 					 else if (CurrentEvent.EventType == ES_FREE_SHOOTING)  
 					 {
 							puts("Last 18 seconds!!!!!!!!!!!!!!!!!!!!!!!!!!!!Now is shooting\r\n");
-							isFreeShooting = true;
+							Me->isFreeShooting = true;
 							// If it's in shooting state already, no need to move to staging area 1,
 						 // just post the event and set the guard true.
 				   }
@@ -352,11 +361,13 @@ ES_Event RunMasterSM( ES_Event CurrentEvent )
     //   If we are making a state transition
     if (MakeTransition == true)
     {
+       // leave a record of it in the flight recorder
+       ES_TraceTransition( ES_TRACE_MasterSM, Me->CurrentMasterState, NextMasterState, CurrentEvent );
        //   Execute exit function for current state
        CurrentEvent.EventType = ES_EXIT;
        RunMasterSM(CurrentEvent);
 
-       CurrentMasterState = NextMasterState; //Modify state variable
+       Me->CurrentMasterState = NextMasterState; //Modify state variable
 
        // Execute entry function for new state
        // this defaults to ES_ENTRY
@@ -388,15 +399,15 @@ void StartMasterSM ( ES_Event CurrentEvent )
 	// Initialize peripheral hardware, GPIO functions
   // if there is more than 1 state to the top level machine you will need 
   // to initialize the state variable
-  CurrentMasterState = WaitToStartGame;
-	Color = DetermineColor();
+  Me->CurrentMasterState = WaitToStartGame;
+	Me->Color = DetermineColor();
 	ES_Event ColorEvent;
 	ColorEvent.EventType = ES_COLORDESIGNATION;
-	ColorEvent.EventParam = Color;
+	ColorEvent.EventParam = Me->Color;
 	PostLEDService(ColorEvent);
 	puts("Color determined\r\n");
-	isBackFromDepot = false;
-	isFreeShooting = false;
+	Me->isBackFromDepot = false;
+	Me->isFreeShooting = false;
 	puts("Posted run flywheel event\r\n");
   // now we need to let the Run function init the lower level state machines
   // use LocalEvent to keep the compiler from complaining about unused var
@@ -520,14 +531,14 @@ static ES_Event DuringShooting( ES_Event Event)
 /*********** Query functions that return module level variables  *******/
 bool QueryColor(void)
 {
-	return Color;
+	return Me->Color;
 }
 
 bool Query_isBackFromDepot(void)
 {
-	return isBackFromDepot;
+	return Me->isBackFromDepot;
 }
 bool Query_isFreeShooting(void)
 {
-	return isFreeShooting;
+	return Me->isFreeShooting;
 }
@@ -12,10 +12,12 @@
  History
  When           Who     What/Why
  -------------- ---     --------
- 02/28/17 19:21 ZS      Updated TurnToX
+ 10/18/26 09:43 jh      keep the state in one struct for each robot
+ 10/17/26 22:20 jh      record state transitions in the flight recorder
  03/04/17 14:23 ZS			For straight forward/backward moving strategy, bypass MoveInX, TurnToY, TurnToY.
 												And change the MoveToStage stop criterium to ES_TARGET_Y_HIT which will be posted by
 												the motor service.
+ 02/28/17 19:21 ZS      Updated TurnToX
 ****************************************************************************/
 /*----------------------------- Include Files -----------------------------*/
 
@@ -66,18 +68,28 @@ static ES_Event DuringHandshake( ES_Event Event);
 static ES_Event DuringGoToShootingSpot( ES_Event Event);
 
 /*---------------------------- Module Variables ---------------------------*/
-// Every SM needs a "CurrentState"
-static MoveToDestinationState_t CurrentMTDstate;
-static bool AckStatus;
-static uint8_t TargetStage;  // TargetStage is updated every time a new cycle starts (when StartMovingToDestination() gets called)
-static uint8_t TargetShootingLocation;
-static bool CurrentColor;
-static uint8_t CurrentLocation = BACK_WALL;  // CurrentLocation initializes to BACK_WALL
-																						 // And it will remember the current location as it's static
-																						 // All other state machines query CurrentLocation from here if needed
-static uint8_t Speed = 80;  //rpm
-static bool CurrentDirection;
-static uint8_t HitWallCounter = 0;
+// the state of one robot, see ES_Instance.h
+typedef struct {
+  // Every SM needs a "CurrentState"
+  MoveToDestinationState_t CurrentMTDstate;
+  bool AckStatus;
+  uint8_t TargetStage;  // TargetStage is updated every time a new cycle starts (when StartMovingToDestination() gets called)
+  uint8_t TargetShootingLocation;
+  bool CurrentColor;
+  uint8_t CurrentLocation;  // CurrentLocation initializes to BACK_WALL
+  																						 // And it will remember the current location as it's static
+  																						 // All other state machines query CurrentLocation from here if needed
+  uint8_t Speed;  //rpm
+  bool CurrentDirection;
+  uint8_t HitWallCounter;
+} MoveToDestinationData_t;
+
+static MoveToDestinationData_t Instances[ES_NUM_INSTANCES] = ES_INSTANCE_INIT({
+  .CurrentLocation = BACK_WALL,
+  .Speed = 80
+});
+
+#define Me ES_THIS(Instances)
 /*------------------------------ Module Code ------------------------------*/
 
 /****************************************************************************
@@ -101,11 +113,11 @@ static uint8_t HitWallCounter = 0;
 ES_Event RunMoveToDestination( ES_Event CurrentEvent )
 {
    bool MakeTransition = false;/* are we making a state transition? */
-   MoveToDestinationState_t NextMTDstate = CurrentMTDstate;
+   MoveToDestinationState_t NextMTDstate = Me->CurrentMTDstate;
    ES_Event EntryEventKind = { ES_ENTRY, 0 };// default to normal entry to new state
    ES_Event ReturnEvent = CurrentEvent; // assume no consumption of passed in event
 
-   switch ( CurrentMTDstate )
+   switch ( Me->CurrentMTDstate )
    {
 
        case MoveToStage :  // If current state is to move in y direction
@@ -120,7 +132,7 @@ ES_Event RunMoveToDestination( ES_Event CurrentEvent )
 						 	// Post an event to magnetic field frequency capture service
 							ES_Event Event2HallEffect;
 							Event2HallEffect.EventType = ES_START_MAG_FIELD_CAPTURE;
-							if (TargetStage == 1 || TargetStage == 3)
+							if (Me->TargetStage == 1 || Me->TargetStage == 3)
 							{
 								// enable the Hall effect sensor on the left if target stage is 1 or 3
 								Event2HallEffect.EventParam = LEFT;
@@ -176,11 +188,11 @@ ES_Event RunMoveToDestination( ES_Event CurrentEvent )
 						  // DecipherReportStatus() reads bit 7 and 6
 						  // 00-ACK, 10-inactive, 11-NACK
 						  // returns true for ACK, false for the other two
-							AckStatus = DecipherReportStatus(CurrentEvent.EventParam);
+							Me->AckStatus = DecipherReportStatus(CurrentEvent.EventParam);
 						  // DecipherLocationInReport() returns the number of current staging area (for our color)
-							CurrentLocation = DecipherLocationInReport(CurrentEvent.EventParam);
-						  printf("CurrentLocation = %d (1:stage1, 2:stage2, 3:stage3 regardless of the color)\r\n",CurrentLocation);
-							if ( AckStatus ) // if LOC returns ACK
+							Me->CurrentLocation = DecipherLocationInReport(CurrentEvent.EventParam);
+						  printf("CurrentLocation = %d (1:stage1, 2:stage2, 3:stage3 regardless of the color)\r\n",Me->CurrentLocation);
+							if ( Me->AckStatus ) // if LOC returns ACK
 							{
 								// The reported freq is valid, continue to complete the handshake
 								// (handshake = query again with the newly detected freq for shooting area)
@@ -193,7 +205,7 @@ ES_Event RunMoveToDestination( ES_Event CurrentEvent )
 								// If check-in fails, re-enter state MoveToStage. Execute again the entry function
 								// (continue MoveToStage in Y to find next stage)
 								puts("NACK\r\n");
-								CurrentLocation = DecipherLocationInReport(CurrentEvent.EventParam);
+								Me->CurrentLocation = DecipherLocationInReport(CurrentEvent.EventParam);
 								NextMTDstate = MoveToStage;
 								MakeTransition = true;
 							}
@@ -228,7 +240,7 @@ ES_Event RunMoveToDestination( ES_Event CurrentEvent )
 						 	// Post an event to magnetic field frequency capture service
 							ES_Event Event2MagFieldService;
 							Event2MagFieldService.EventType = ES_START_MAG_FIELD_CAPTURE;
-						  if (TargetStage == 1 || TargetStage == 3)
+						  if (Me->TargetStage == 1 || Me->TargetStage == 3)
 							{
 								Event2MagFieldService.EventParam = LEFT;
 							}
@@ -257,14 +269,14 @@ ES_Event RunMoveToDestination( ES_Event CurrentEvent )
 						  // DecipherReportStatus() reads bit 7 and 6
 						  // 00-ACK, 10-inactive, 11-NACK
 						  // returns true for ACK, false for the other two
-							AckStatus = DecipherReportStatus(CurrentEvent.EventParam);
-							if ( AckStatus ) // if LOC returns ACK
+							Me->AckStatus = DecipherReportStatus(CurrentEvent.EventParam);
+							if ( Me->AckStatus ) // if LOC returns ACK
 							{
 								// The reported freq is valid, handshake completed
 								// Store the shooting area code
 								// DecipherLocationInReport() returns the number of current shooting area
-								TargetShootingLocation = DecipherLocationInReport(CurrentEvent.EventParam);
-								printf("Shooting area %d opened \r\n",TargetShootingLocation);
+								Me->TargetShootingLocation = DecipherLocationInReport(CurrentEvent.EventParam);
+								printf("Shooting area %d opened \r\n",Me->TargetShootingLocation);
 								NextMTDstate = GoToShootingSpot;
 								MakeTransition = true; //mark that we are taking a transition
 							}
@@ -272,7 +284,7 @@ ES_Event RunMoveToDestination( ES_Event CurrentEvent )
 							{
 								puts("Handshake failed\r\n");
 								// Update CurrentStage
-								CurrentLocation = DecipherLocationInReport(CurrentEvent.EventParam);
+								Me->CurrentLocation = DecipherLocationInReport(CurrentEvent.EventParam);
 								NextMTDstate = MoveToStage; // move to target stage and restart the check-in process
 								MakeTransition = true;  // consume this event and pass NO_EVENT to DrivingSM
 							}
@@ -297,7 +309,7 @@ ES_Event RunMoveToDestination( ES_Event CurrentEvent )
 							 // Stop motors
 							 Stop();
 						  // Update CurrentLocation
-						  CurrentLocation = TargetShootingLocation;
+						  Me->CurrentLocation = Me->TargetShootingLocation;
 							ReturnEvent.EventType = ES_NO_EVENT;  // CONSUME this event
 						  // Post notification event to MasterSM for it to transit from Driving to Shooting
 							ES_Event ThisEvent;
@@ -314,11 +326,13 @@ ES_Event RunMoveToDestination( ES_Event CurrentEvent )
     //   If we are making a state transition
     if (MakeTransition == true)
     {
+       // leave a record of it in the flight recorder
+       ES_TraceTransition( ES_TRACE_MoveToDestination, Me->CurrentMTDstate, NextMTDstate, CurrentEvent );
        //   Execute exit function for current state
        CurrentEvent.EventType = ES_EXIT;
        RunMoveToDestination(CurrentEvent);
 
-       CurrentMTDstate = NextMTDstate; //Modify state variable
+       Me->CurrentMTDstate = NextMTDstate; //Modify state variable
 
        //   Execute entry function for new state
        // this defaults to ES_ENTRY
@@ -349,26 +363,26 @@ void StartMoveToDestination ( ES_Event CurrentEvent )
    // you can modify the initialization of the CurrentMTDstate variable
    // otherwise just start in the entry state every time the state machine
    // is started
-	 CurrentColor = QueryColor();  // 0-> green, 1-> red
+	 Me->CurrentColor = QueryColor();  // 0-> green, 1-> red
 	 bool LastDepot, FreeShooting;
 	 LastDepot = Query_isBackFromDepot();
 	 FreeShooting = Query_isFreeShooting();
 	 if (LastDepot)
 	 {
 		 // If just returned from the supplu depot, initialize the currentlocation to DEPOT
-		 CurrentLocation = DEPOT;
+		 Me->CurrentLocation = DEPOT;
 	 }
 	 if (FreeShooting)
 	 {
-		 TargetStage = SA_1;  // in the free shooting period, always go to stage #1
+		 Me->TargetStage = SA_1;  // in the free shooting period, always go to stage #1
 	 }
 	 else
 	 {
-		 TargetStage = QueryStartingStage(); // in normal cases, query for starting stage and update the current destination
+		 Me->TargetStage = QueryStartingStage(); // in normal cases, query for starting stage and update the current destination
 	 }
    if ( ES_ENTRY_HISTORY != CurrentEvent.EventType )
    {
-        CurrentMTDstate = ENTRY_STATE;
+        Me->CurrentMTDstate = ENTRY_STATE;
    }
    // call the entry function (if any) for the ENTRY_STATE
    RunMoveToDestination(CurrentEvent);
@@ -393,7 +407,7 @@ void StartMoveToDestination ( ES_Event CurrentEvent )
 ****************************************************************************/
 MoveToDestinationState_t QueryCurrentMTDstate ( void )
 {
-   return(CurrentMTDstate);
+   return(Me->CurrentMTDstate);
 }
 
 /****************************************************************************
@@ -422,27 +436,27 @@ Zoey, 2/28/17, 19:41
 
 static void HitWall(void) {
 	 Stop();
-	 if (CurrentColor == GREEN)
+	 if (Me->CurrentColor == GREEN)
 	 {
-		 if (CurrentDirection == BWD)
+		 if (Me->CurrentDirection == BWD)
 		 {
 		 puts("Hit the wall at depot\r\n");
-		 CurrentLocation = DEPOT;
+		 Me->CurrentLocation = DEPOT;
 		 } else
 		 {
 		 puts("Hit the back wall\r\n");
-		 CurrentLocation = BACK_WALL;
+		 Me->CurrentLocation = BACK_WALL;
 		 }
 	 }
-	 else if (CurrentColor == RED) {
-		 if (CurrentDirection == FWD)
+	 else if (Me->CurrentColor == RED) {
+		 if (Me->CurrentDirection == FWD)
 		 {
 		 puts("Hit the wall at depot\r\n");
-		 CurrentLocation = DEPOT;
+		 Me->CurrentLocation = DEPOT;
 		 } else
 		 {
 		 puts("Hit the back wall\r\n");
-		 CurrentLocation = BACK_WALL;
+		 Me->CurrentLocation = BACK_WALL;
 		 }
 	 }
 }
@@ -459,48 +473,48 @@ static ES_Event DuringMoveToStage( ES_Event Event)
          (Event.EventType == ES_ENTRY_HISTORY) )
     {
 			// Determine driving direction based on Color, CurrentLocation, and TargetStage
-			if (CurrentColor == RED)
+			if (Me->CurrentColor == RED)
 			{
-				if (CurrentLocation == BACK_WALL)
+				if (Me->CurrentLocation == BACK_WALL)
 				{
 					//Call drive function in DCMotorService
-					CurrentDirection = FWD;
-					Drive(Speed,FWD);
+					Me->CurrentDirection = FWD;
+					Drive(Me->Speed,FWD);
 				}
-				else if (CurrentLocation - TargetStage > 0)
+				else if (Me->CurrentLocation - Me->TargetStage > 0)
 				{
 					//Call drive function in DCMotorService
-					CurrentDirection = FWD;
-					Drive(Speed,FWD);
+					Me->CurrentDirection = FWD;
+					Drive(Me->Speed,FWD);
 				}
-				else if (CurrentLocation - TargetStage < 0)
+				else if (Me->CurrentLocation - Me->TargetStage < 0)
 				{
 					//Call drive function in DCMotorService
-					CurrentDirection = BWD;
-					Drive(Speed,BWD);
+					Me->CurrentDirection = BWD;
+					Drive(Me->Speed,BWD);
 				}
 				// else if CurrentLocation == TargetStage, don't need to drive the motors
 			}
 			
-			else if (CurrentColor == GREEN)
+			else if (Me->CurrentColor == GREEN)
 			{
-				if (CurrentLocation == BACK_WALL)
+				if (Me->CurrentLocation == BACK_WALL)
 				{
 					//Call drive function in DCMotorService
-					CurrentDirection = BWD;
-					Drive(Speed,BWD);
+					Me->CurrentDirection = BWD;
+					Drive(Me->Speed,BWD);
 				}
-				else if (CurrentLocation - TargetStage > 0)
+				else if (Me->CurrentLocation - Me->TargetStage > 0)
 				{
 					//Call drive function in DCMotorService
-					CurrentDirection = BWD;
-					Drive(Speed,BWD);
+					Me->CurrentDirection = BWD;
+					Drive(Me->Speed,BWD);
 				}
-				else if (CurrentLocation - TargetStage < 0)
+				else if (Me->CurrentLocation - Me->TargetStage < 0)
 				{
 					//Call drive function in DCMotorService
-					CurrentDirection = FWD;
-					Drive(Speed,FWD);
+					Me->CurrentDirection = FWD;
+					Drive(Me->Speed,FWD);
 				}
 				// else if CurrentLocation == TargetStage, don't need to drive the motors
 			}
@@ -583,52 +597,52 @@ static ES_Event DuringGoToShootingSpot( ES_Event Event)
          (Event.EventType == ES_ENTRY_HISTORY) )
     {
 			// Determine driving direction based on Color, CurrentLocation, and TargetStage
-			if (CurrentColor == RED)
+			if (Me->CurrentColor == RED)
 			{
-				if (CurrentLocation - TargetShootingLocation > 0)
+				if (Me->CurrentLocation - Me->TargetShootingLocation > 0)
 				{
 					//Call drive function in DCMotorService
-					CurrentDirection = FWD;
-					Drive(Speed,FWD);
+					Me->CurrentDirection = FWD;
+					Drive(Me->Speed,FWD);
 				}
-				else if (CurrentLocation - TargetShootingLocation < 0)
+				else if (Me->CurrentLocation - Me->TargetShootingLocation < 0)
 				{
 					//Call drive function in DCMotorService
-					CurrentDirection = BWD;
-					Drive(Speed,BWD);
+					Me->CurrentDirection = BWD;
+					Drive(Me->Speed,BWD);
 				}
 				// if robot is on SA2 now but need to shoot to bucket 2
-				if (CurrentLocation == 2)
+				if (Me->CurrentLocation == 2)
 				{ 
 					// then simply drive backward. it would be stopped by ultrasonic sensor
-					CurrentDirection = BWD;
-					Drive(Speed,BWD);
+					Me->CurrentDirection = BWD;
+					Drive(Me->Speed,BWD);
 				}
 				// else if CurrentLocation == TargetShootingLocation, don't need to drive the motors
 			}
 			
-			else if (CurrentColor == GREEN)
+			else if (Me->CurrentColor == GREEN)
 			{
-				if (CurrentLocation - TargetShootingLocation > 0)
+				if (Me->CurrentLocation - Me->TargetShootingLocation > 0)
 				{
 					//Call drive function in DCMotorService
-					CurrentDirection = BWD;
-					Drive(Speed,BWD);
+					Me->CurrentDirection = BWD;
+					Drive(Me->Speed,BWD);
 				}
-				else if (CurrentLocation - TargetShootingLocation < 0)
+				else if (Me->CurrentLocation - Me->TargetShootingLocation < 0)
 				{
 					//Call drive function in DCMotorService
-					CurrentDirection = FWD;
-					Drive(Speed,FWD);
+					Me->CurrentDirection = FWD;
+					Drive(Me->Speed,FWD);
 				}
 				// else if CurrentLocation == TargetShootingLocation, don't need to drive the motors
 			}
 			
 			
 			  // IF THE TARGET SHOOTING LOCATION IS 2, post an event to Ultrasonic service
-			if (TargetShootingLocation == 2)
+			if (Me->TargetShootingLocation == 2)
 			{
-				if (CurrentLocation != TargetShootingLocation)
+				if (Me->CurrentLocation != Me->TargetShootingLocation)
 				{
 					ES_Event Event2Ultrasonic;
 					Event2Ultrasonic.EventType = ES_START_ULTRASONIC;
@@ -661,10 +675,10 @@ static ES_Event DuringGoToShootingSpot( ES_Event Event)
 					*/
 				}
 			}
-			else if (TargetShootingLocation == 1 || TargetShootingLocation == 3 || TargetShootingLocation == 4)
+			else if (Me->TargetShootingLocation == 1 || Me->TargetShootingLocation == 3 || Me->TargetShootingLocation == 4)
 				// IF THE TARGET SHOOTING LOCATION IS 1 or 3, post an event to Hall Effect service
 			{
-				if (CurrentLocation != TargetShootingLocation)
+				if (Me->CurrentLocation != Me->TargetShootingLocation)
 				{
 					// Possible scenarios: 1 -> 3, 2->3, 3->1, 2->1. In all cases, and regardless of the color,
 					// always turn on the left Hall Effect sensor so that the next mag field must be the TargetShootingLocation
@@ -705,9 +719,9 @@ static ES_Event DuringGoToShootingSpot( ES_Event Event)
 
 uint8_t QueryCurrentLocation(void)
 {
-	return (CurrentLocation);
+	return (Me->CurrentLocation);
 }
 uint8_t QueryTargetShootingLocation(void)
 {
-	return TargetShootingLocation;
+	return Me->TargetShootingLocation;
 }	
@@ -15,6 +15,8 @@
  History
  When           Who     What/Why
  -------------- ---     --------
+ 10/18/26 09:43 jh      keep the state in one struct for each robot
+ 10/17/26 22:20 jh      record state transitions in the flight recorder
  02/28/17 19:35 ZS      Began coding
 ****************************************************************************/
 /*----------------------------- Include Files -----------------------------*/
@@ -64,11 +66,18 @@ static ES_Event DuringMoveInY( ES_Event Event);
 static ES_Event DuringTurnToX( ES_Event Event);
 
 /*---------------------------- Module Variables ---------------------------*/
-// Every SM needs a "CurrentState"
-static MoveToSSState_t CurrentSSState;
-static float CurrentTargetX;  // Initialized in the start function to be SHOOTING_X
-static uint8_t CurrentTargetY;
-static bool CurrentColor;
+// the state of one robot, see ES_Instance.h
+typedef struct {
+  // Every SM needs a "CurrentState"
+  MoveToSSState_t CurrentSSState;
+  float CurrentTargetX;  // Initialized in the start function to be SHOOTING_X
+  uint8_t CurrentTargetY;
+  bool CurrentColor;
+} MoveToShootingSpotData_t;
+
+static MoveToShootingSpotData_t Instances[ES_NUM_INSTANCES];
+
+#define Me ES_THIS(Instances)
 
 /*------------------------------ Module Code ------------------------------*/
 
@@ -93,11 +102,11 @@ static bool CurrentColor;
 ES_Event RunMoveToShootingSpot( ES_Event CurrentEvent )
 {
    bool MakeTransition = false;/* are we making a state transition? */
-   MoveToSSState_t NextSSState = CurrentSSState;
+   MoveToSSState_t NextSSState = Me->CurrentSSState;
    ES_Event EntryEventKind = { ES_ENTRY, 0 };// default to normal entry to new state
    ES_Event ReturnEvent = CurrentEvent; // assume no consumption of passed in event
 	 
-   switch ( CurrentSSState )
+   switch ( Me->CurrentSSState )
    {
        case S_MoveInY :  // If current state is to move in y direction
 				 puts("Curent MoveToSA state = MoveInY\r\n");
@@ -124,11 +133,13 @@ ES_Event RunMoveToShootingSpot( ES_Event CurrentEvent )
     //   If we are making a state transition
     if (MakeTransition == true)
     {
+       // leave a record of it in the flight recorder
+       ES_TraceTransition( ES_TRACE_MoveToShootingSpot, Me->CurrentSSState, NextSSState, CurrentEvent );
        //   Execute exit function for current state
        CurrentEvent.EventType = ES_EXIT;
        RunMoveToSA(CurrentEvent);
 
-       CurrentSSState = NextSSState; //Modify state variable
+       Me->CurrentSSState = NextSSState; //Modify state variable
 
        //   Execute entry function for new state
        // this defaults to ES_ENTRY
@@ -159,11 +170,11 @@ void StartMoveToShootingSpot ( ES_Event CurrentEvent )
    // you can modify the initialization of the CurrentSSState variable
    // otherwise just start in the entry state every time the state machine
    // is started
-	 CurrentTargetX = SHOOTING_X;
-	 CurrentColor = QueryColor();
+	 Me->CurrentTargetX = SHOOTING_X;
+	 Me->CurrentColor = QueryColor();
    if ( ES_ENTRY_HISTORY != CurrentEvent.EventType )
    {
-        CurrentSSState = ENTRY_STATE;
+        Me->CurrentSSState = ENTRY_STATE;
    }
    // call the entry function (if any) for the ENTRY_STATE
    RunMoveToSA(CurrentEvent);
@@ -188,7 +199,7 @@ void StartMoveToShootingSpot ( ES_Event CurrentEvent )
 ****************************************************************************/
 MoveToSSState_t QueryMoveToShootingSpot ( void )
 {
-   return(CurrentSSState);
+   return(Me->CurrentSSState);
 }
 
 /***************************************************************************
@@ -213,7 +224,7 @@ static ES_Event DuringMoveInY( ES_Event Event)
 			// If want to stop in Y by aligning with the beacon, enable the following code
 			ES_Event Event2Beacon;
 			Event2Beacon.EventType = ES_START_IR_CAPTURE;
-			if (CurrentColor) // if current color is red
+			if (Me->CurrentColor) // if current color is red
 			{
 				Event2Beacon.EventParam = ( TASK_CODE_SHOOTING + COLOR_CODE_RED );
 			}
@@ -13,6 +13,8 @@
  History
  When           Who     What/Why
  -------------- ---     --------
+ 10/18/26 09:43 jh      keep the state in one struct for each robot
+ 10/17/26 22:20 jh      record state transitions in the flight recorder
  02/23/17 20:18 czhang94  Began coding    
 ****************************************************************************/
 /*----------------------------- Include Files -----------------------------*/
@@ -73,17 +75,24 @@ static ES_Event DuringWaiting4ResponseReady( ES_Event Event);
 static ES_Event DuringWaiting4Timeout(ES_Event Event);
 
 /*---------------------------- Module Variables ---------------------------*/
-// everybody needs a state variable, though if the top level state machine
-// is just a single state container for orthogonal regions, you could get
-// away without it
-static SPIState_t CurrentState;
-static uint8_t MyPriority;
-static uint8_t Command;
-static int StatusIndex2Return;
-static uint8_t Response[5];
-static uint32_t Response32bit;
-static bool isResponseReady;
-static uint8_t CurrentFreq2Report;
+// the state of one robot, see ES_Instance.h
+typedef struct {
+  // everybody needs a state variable, though if the top level state machine
+  // is just a single state container for orthogonal regions, you could get
+  // away without it
+  SPIState_t CurrentState;
+  uint8_t MyPriority;
+  uint8_t Command;
+  int StatusIndex2Return;
+  uint8_t Response[5];
+  uint32_t Response32bit;
+  bool isResponseReady;
+  uint8_t CurrentFreq2Report;
+} SPIServiceData_t;
+
+static SPIServiceData_t Instances[ES_NUM_INSTANCES];
+
+#define Me ES_THIS(Instances)
 
 /*------------------------------ Module Code ------------------------------*/
 /****************************************************************************
@@ -108,7 +117,7 @@ bool InitSPIService ( uint8_t Priority )
 {
   ES_Event ThisEvent;
 
-  MyPriority = Priority;  // save our priority
+  Me->MyPriority = Priority;  // save our priority
 	
 	// call all initialization functions below
 	SPIInit();
@@ -141,7 +150,7 @@ bool InitSPIService ( uint8_t Priority )
 ****************************************************************************/
 bool PostSPIService( ES_Event ThisEvent )
 {
-  return ES_PostToService( MyPriority, ThisEvent);
+  return ES_PostToService( Me->MyPriority, ThisEvent);
 }
 
 /****************************************************************************
@@ -164,11 +173,11 @@ bool PostSPIService( ES_Event ThisEvent )
 ES_Event RunSPIService( ES_Event CurrentEvent )
 {
    bool MakeTransition = false;/* are we making a state transition? */
-   SPIState_t NextState = CurrentState;
+   SPIState_t NextState = Me->CurrentState;
    ES_Event EntryEventKind = { ES_ENTRY, 0 };// default to normal entry to new state
    ES_Event ReturnEvent = { ES_NO_EVENT, 0 }; // assume no error
 
-    switch ( CurrentState )
+    switch ( Me->CurrentState )
    {
        case Waiting2Send : 
          // Execute During function for state one. ES_ENTRY & ES_EXIT are
@@ -182,31 +191,31 @@ ES_Event RunSPIService( ES_Event CurrentEvent )
             {
                case SEND_CMD :
 									if (CurrentEvent.EventParam < 4) { // MasterSM is asking for SB1, SB2 or SB3 (1-3)
-										Command = STATUS_QUERY;
-										StatusIndex2Return = CurrentEvent.EventParam;
+										Me->Command = STATUS_QUERY;
+										Me->StatusIndex2Return = CurrentEvent.EventParam;
 										NextState = Waiting4EOT;
 										puts("Querying status byte......\r\n");
 									} else {
-										CurrentFreq2Report = getFreqCode();
-										printf("Mag field freq code = %d\r\n", CurrentFreq2Report);
-										Command = 0x80 + CurrentFreq2Report;
+										Me->CurrentFreq2Report = getFreqCode();
+										printf("Mag field freq code = %d\r\n", Me->CurrentFreq2Report);
+										Me->Command = 0x80 + Me->CurrentFreq2Report;
 										NextState = Waiting4ResponseReady;
-										isResponseReady = false;
+										Me->isResponseReady = false;
 										puts("Reporting frequency.....\r\n");
 										ES_Timer_InitTimer(REPORT_RESEND_TIMER, REPORT_RESEND_INTERVAL);
 									}
                   
 									HWREG(SSI0_BASE + SSI_O_IM) |= SSI_IM_TXIM;
 									// Execute action function for Waiting2Send
-							    SPI_SendCMD(Command);
+							    SPI_SendCMD(Me->Command);
 							    SPI_SendCMD(0x00);
 							    SPI_SendCMD(0x00);
 							    SPI_SendCMD(0x00);
 							    SPI_SendCMD(0x00);
 								  for (int i = 0; i < 5; i++) { // clear it for a new response
-										Response[i] = 0;
+										Me->Response[i] = 0;
 									}
-									Response32bit = 0;
+									Me->Response32bit = 0;
 									uint8_t SSIRawINTStatus;
 									SSIRawINTStatus = HWREG(SSI0_BASE+SSI_O_RIS);
 								  printf("Command Sent,SSI0 raw interrupt status byte = %02x\r\n",SSIRawINTStatus);
@@ -232,13 +241,13 @@ ES_Event RunSPIService( ES_Event CurrentEvent )
                case SSI_EOT: 
                   // Execute action function for Waiting2Send
 									for (int i = 0; i < 5; i++) {
-										Response[i] = SPI_ReadRES(); // the five response bytes are indexed from 0 to 4
-										printf("StatusResponse: 0x%02x\r\n", Response[i]);
+										Me->Response[i] = SPI_ReadRES(); // the five response bytes are indexed from 0 to 4
+										printf("StatusResponse: 0x%02x\r\n", Me->Response[i]);
 									}
 									
 							    ES_Event ThisEvent;
 									ThisEvent.EventType = ES_LOC_STATUS;                        
-									ThisEvent.EventParam = Response[StatusIndex2Return + 1]; 
+									ThisEvent.EventParam = Me->Response[Me->StatusIndex2Return + 1]; 
 									PostMasterSM(ThisEvent);                                    
 									
                   NextState = Waiting4Timeout;//Decide what the next state will be
@@ -263,18 +272,18 @@ ES_Event RunSPIService( ES_Event CurrentEvent )
             {
 							case SSI_EOT: 
 									for (int i = 0; i < 5; i++) {
-										Response[i] = SPI_ReadRES(); // the five response bytes are indexed from 0 to 4
-										printf("ReportResponse: 0x%02x\r\n", Response[i]);
+										Me->Response[i] = SPI_ReadRES(); // the five response bytes are indexed from 0 to 4
+										printf("ReportResponse: 0x%02x\r\n", Me->Response[i]);
 									}
-							    if (Response[2] == 0xAA) { // check whether response is ready
-										isResponseReady = true;
+							    if (Me->Response[2] == 0xAA) { // check whether response is ready
+										Me->isResponseReady = true;
 										ES_Timer_StopTimer(REPORT_RESEND_TIMER);
 										puts("Response Ready!!!!\r");
-										printf("ACK bits are: %02x\r\n", Response[3]>>6);
+										printf("ACK bits are: %02x\r\n", Me->Response[3]>>6);
 										
 										ES_Event ThisEvent;
 										ThisEvent.EventType = ES_LOC_RS;          
-										ThisEvent.EventParam = Response[3]; 
+										ThisEvent.EventParam = Me->Response[3]; 
 										PostMasterSM(ThisEvent); 
 									} else {
 										puts("Response NOT ready!!!!\r\n");
@@ -284,7 +293,7 @@ ES_Event RunSPIService( ES_Event CurrentEvent )
 									
 							case ES_TIMEOUT:
 								  if (CurrentEvent.EventParam == REPORT_QUERY_TIMER) {
-										if (isResponseReady) {
+										if (Me->isResponseReady) {
 											NextState = Waiting2Send;
                       MakeTransition = true;
 											//puts("Going back to Waiting2Send\r\n");
@@ -298,8 +307,8 @@ ES_Event RunSPIService( ES_Event CurrentEvent )
 									}
 									
 									if (CurrentEvent.EventParam == REPORT_RESEND_TIMER) {
-										CurrentFreq2Report = getFreqCode();
-										uint8_t FreqCommand = 0x80 + CurrentFreq2Report;
+										Me->CurrentFreq2Report = getFreqCode();
+										uint8_t FreqCommand = 0x80 + Me->CurrentFreq2Report;
 										ES_Event ThisEvent;
 										ThisEvent.EventType = SEND_CMD;
 										ThisEvent.EventParam = FreqCommand;
@@ -317,7 +326,7 @@ ES_Event RunSPIService( ES_Event CurrentEvent )
 									puts("Resending....\r\n");
 							    HWREG(SSI0_BASE + SSI_O_IM) |= SSI_IM_TXIM;
 								  for (int i = 0; i < 5; i++) { // clear it for a new response
-										Response[i] = 0;
+										Me->Response[i] = 0;
 									}
 								 break;
 									
@@ -351,11 +360,13 @@ ES_Event RunSPIService( ES_Event CurrentEvent )
     //   If we are making a state transition
     if (MakeTransition == true)
     {
+       // leave a record of it in the flight recorder
+       ES_TraceTransition( ES_TRACE_SPIService, Me->CurrentState, NextState, CurrentEvent );
        //   Execute exit function for current state
        CurrentEvent.EventType = ES_EXIT;
        RunSPIService(CurrentEvent);
 
-       CurrentState = NextState; //Modify state variable
+       Me->CurrentState = NextState; //Modify state variable
 
        // Execute entry function for new state
        // this defaults to ES_ENTRY
@@ -384,11 +395,11 @@ ES_Event RunSPIService( ES_Event CurrentEvent )
 ****************************************************************************/
 void StartSPIService ( ES_Event CurrentEvent )
 {
-  CurrentState = Waiting2Send;
+  Me->CurrentState = Waiting2Send;
 	for (int i = 0; i < 5; i++) {
-		Response[i] = 0;
+		Me->Response[i] = 0;
 	}
-	Response32bit = 0;
+	Me->Response32bit = 0;
   // now we need to let the Run function init the lower level state machines
   // use LocalEvent to keep the compiler from complaining about unused var
   RunSPIService(CurrentEvent);
@@ -398,9 +409,9 @@ void StartSPIService ( ES_Event CurrentEvent )
 uint32_t getResponse32bit(void)
 { 
 	for (int i = 0; i < 5; i++) {
-		Response32bit = (Response32bit<<8) + SPI_ReadRES();
+		Me->Response32bit = (Me->Response32bit<<8) + SPI_ReadRES();
 	}
-	return Response32bit;
+	return Me->Response32bit;
 }
 
 /***************************************************************************
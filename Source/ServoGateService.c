@@ -52,11 +52,18 @@ This service will control shooting cycles (shoot 1 ball or all balls) based on c
 #define SINGLE_SHOOT_TIME ONE_SEC
 #define FLYWHEEL_PREPARATION_TIME QUARTER_SEC
 /*---------------------------- Module Variables ---------------------------*/
-// everybody needs a state variable, you may need others as well.
-// type of state variable should match htat of enum in header file
-static ServoShootingState_t CurrentState;
-static uint8_t MyPriority;
-static bool HalfOpen;
+// the state of one robot, see ES_Instance.h
+typedef struct {
+  // everybody needs a state variable, you may need others as well.
+  // type of state variable should match htat of enum in header file
+  ServoShootingState_t CurrentState;
+  uint8_t MyPriority;
+  bool HalfOpen;
+} ServoGateServiceData_t;
+
+static ServoGateServiceData_t Instances[ES_NUM_INSTANCES];
+
+#define Me ES_THIS(Instances)
 
 /*------------------------------ Module Code ------------------------------*/
 /****************************************************************************
@@ -80,7 +87,7 @@ static bool HalfOpen;
 bool InitServoGateService ( uint8_t Priority )
 {
   ES_Event ThisEvent;
-  MyPriority = Priority;
+  Me->MyPriority = Priority;
 	// GATE SERVO: PE5
 	
 	// Initialize framework timer resolution (1mS)
@@ -90,11 +97,11 @@ bool InitServoGateService ( uint8_t Priority )
 	// Close servo gate
 	CloseServoGate();
 	// Initialize all module vars
-  CurrentState = Waiting2Open;
-	HalfOpen = false;
+  Me->CurrentState = Waiting2Open;
+	Me->HalfOpen = false;
   // post the initial transition event
   ThisEvent.EventType = ES_INIT;
-  if (ES_PostToService( MyPriority, ThisEvent) == true)
+  if (ES_PostToService( Me->MyPriority, ThisEvent) == true)
   {
       return true;
   }else
@@ -122,7 +129,7 @@ bool InitServoGateService ( uint8_t Priority )
 ****************************************************************************/
 bool PostServoGateService( ES_Event ThisEvent )
 {
-  return ES_PostToService( MyPriority, ThisEvent);
+  return ES_PostToService( Me->MyPriority, ThisEvent);
 }
 
 /****************************************************************************
@@ -147,14 +154,14 @@ ES_Event RunServoGateService( ES_Event ThisEvent )
   ES_Event ReturnEvent;
   ReturnEvent.EventType = ES_NO_EVENT; // assume no errors
 
-  switch ( CurrentState )
+  switch ( Me->CurrentState )
   {
     // In Waiting to Open state
 		case Waiting2Open:       
 			// If Key is o, which means opening servo gate
 		  if (ThisEvent.EventType == ES_OPENGATE){
 				// Change CurrentState to Opening
-				CurrentState = Opening;
+				Me->CurrentState = Opening;
 				//printf("Go to shoot 1 cycle\r\n");
 				// Turn on flywheel
 				//ES_Event Event2Post;
@@ -165,7 +172,7 @@ ES_Event RunServoGateService( ES_Event ThisEvent )
 				HalfOpenServoGate();
 				printf("Half open servo gate\r\n");
 				// Set HalfOpen to true
-				HalfOpen = true;
+				Me->HalfOpen = true;
 				// Init ServoGate Timer
 				ES_Timer_InitTimer(SERVOGATE_TIMER, FLYWHEEL_PREPARATION_TIME);
 			}
@@ -175,17 +182,17 @@ ES_Event RunServoGateService( ES_Event ThisEvent )
 			// If This event is SERVOGATE_TIME timeout
 		  if (ThisEvent.EventType == ES_TIMEOUT && ThisEvent.EventParam == SERVOGATE_TIMER){
 				// If the gate is half open
-				if (HalfOpen == true){
+				if (Me->HalfOpen == true){
 				  // Open ServoGate
 				  OpenServoGate();
 					//printf("Open servo gate\r\n");
 					// Set HalfOpen to false
-				  HalfOpen = false;
+				  Me->HalfOpen = false;
 				  // Init ServoGate Timer
 				  ES_Timer_InitTimer(SERVOGATE_TIMER, SINGLE_SHOOT_TIME);
 				}
 				// Else if the gate is fully open
-				else if (HalfOpen == false){
+				else if (Me->HalfOpen == false){
 					// Turn off flywheel
 					//ES_Event Event2Post;
 					//Event2Post.EventType = ES_STOPFLYWHEEL;
@@ -194,7 +201,7 @@ ES_Event RunServoGateService( ES_Event ThisEvent )
 					CloseServoGate();
 					//printf("Close servo gate\r\n");
 					// Change CurrentState to Waiting for Command
-					CurrentState = Waiting2Open;
+					Me->CurrentState = Waiting2Open;
 					//printf("Shoot 1 cycle ends\r\n");
 				}
 			}
@@ -14,6 +14,8 @@
  History
  When           Who     What/Why
  -------------- ---     --------
+ 10/18/26 09:43 jh      keep the state in one struct for each robot
+ 10/17/26 22:20 jh      record state transitions in the flight recorder
  02/28/17 18:44 ZS      
 ****************************************************************************/
 /*----------------------------- Include Files -----------------------------*/
@@ -66,13 +68,23 @@ static ES_Event DuringScoring( ES_Event Event);
 static ES_Event DuringGetCOWs( ES_Event Event);
 
 /*---------------------------- Module Variables ---------------------------*/
-// Every SM needs a "CurrentState"
-static ShootingState_t CurrentShootingState;
-static bool CurrentColor; // 0-Green, 1-Red
-static uint8_t LastScore = 0;
-static uint8_t COW_Number = 100;  // Initialized to 5 balls
-static uint8_t Speed = 40;
-static bool CurrentDirection;
+// the state of one robot, see ES_Instance.h
+typedef struct {
+  // Every SM needs a "CurrentState"
+  ShootingState_t CurrentShootingState;
+  bool CurrentColor; // 0-Green, 1-Red
+  uint8_t LastScore;
+  uint8_t COW_Number;  // Initialized to 5 balls
+  uint8_t Speed;
+  bool CurrentDirection;
+} ShootingData_t;
+
+static ShootingData_t Instances[ES_NUM_INSTANCES] = ES_INSTANCE_INIT({
+  .COW_Number = 100,
+  .Speed = 40
+});
+
+#define Me ES_THIS(Instances)
 /*------------------------------ Module Code ------------------------------*/
 
 /****************************************************************************
@@ -96,11 +108,11 @@ static bool CurrentDirection;
 ES_Event RunShooting( ES_Event CurrentEvent )
 {
    bool MakeTransition = false;/* are we making a state transition? */
-   ShootingState_t NextShootingState = CurrentShootingState;
+   ShootingState_t NextShootingState = Me->CurrentShootingState;
    ES_Event EntryEventKind = { ES_ENTRY, 0 };// default to normal entry to new state
    ES_Event ReturnEvent = CurrentEvent; // assume no consumption of passed in event
 
-   switch ( CurrentShootingState )
+   switch ( Me->CurrentShootingState )
    {
        case FlywheelRamping :   // Current state is to ramp up the flywheel and get it stable
 				 puts("Current Shooting State = FlywheelRamping\r\n");
@@ -149,7 +161,7 @@ ES_Event RunShooting( ES_Event CurrentEvent )
 						 puts("Ball Travel Timer expires\r\n");
 							bool FreeShooting;
 							FreeShooting = Query_isFreeShooting();
-							if (COW_Number == 0)
+							if (Me->COW_Number == 0)
 							{
 									puts("COWs run out. Go supplement COWs\r\n");
 									// Flywheel will be turned off in the exit function of Scoring
@@ -173,8 +185,8 @@ ES_Event RunShooting( ES_Event CurrentEvent )
 									LEDEvent.EventType = ES_QUERYBALL;
 									PostLEDService(LEDEvent);
 									// Update COW counts
-									COW_Number --;
-									printf("Current COW number  = %d\r\n",COW_Number);
+									Me->COW_Number --;
+									printf("Current COW number  = %d\r\n",Me->COW_Number);
 									ES_Timer_InitTimer(BallTravelTimer, BALL_TRAVEL_TIME/3);
 									ES_Timer_StopTimer(ShootingTimer);
 									puts("Start ball travel timer!\r\n");
@@ -186,7 +198,7 @@ ES_Event RunShooting( ES_Event CurrentEvent )
 									// Poll LOC to ask for the score (of current color)
 									ES_Event ThisEvent;
 									ThisEvent.EventType = SEND_CMD;
-									if (CurrentColor)  // current color = 1 -> red
+									if (Me->CurrentColor)  // current color = 1 -> red
 									{
 										ThisEvent.EventParam = SB3;  // Red score in status byte 3
 										puts("Now ask for the RED side score!!\r\n");
@@ -206,8 +218,8 @@ ES_Event RunShooting( ES_Event CurrentEvent )
 					 {
 						 uint8_t CurrentScore;
 						 CurrentScore = DecipherScore(CurrentEvent.EventParam);
-						 printf("CurrentScore = %d, LastScore = %d, for color %d\r\n",CurrentScore, LastScore, CurrentColor);
-						 if (CurrentScore > LastScore) // Score successfully
+						 printf("CurrentScore = %d, LastScore = %d, for color %d\r\n",CurrentScore, Me->LastScore, Me->CurrentColor);
+						 if (CurrentScore > Me->LastScore) // Score successfully
 						 {
 							 puts("Score++! Post ES_SCORE to MasterSM\r\n");
 							 // Notify MasterSM that we have scored
@@ -225,13 +237,13 @@ ES_Event RunShooting( ES_Event CurrentEvent )
 							 LaunchEvent.EventType = ES_OPENGATE;
 							 PostServoGateService(LaunchEvent);
 							 // Update COW counts
-							 COW_Number --;
-							 printf("Current COW number  = %d\r\n",COW_Number);
+							 Me->COW_Number --;
+							 printf("Current COW number  = %d\r\n",Me->COW_Number);
 							 ES_Timer_InitTimer(BallTravelTimer, BALL_TRAVEL_TIME);
 							 puts("Start ball travel timer!\r\n");
 						 }
 						 ReturnEvent.EventType = ES_NO_EVENT;  // Consume this ES_LOC_STATUS event
-						 LastScore = CurrentScore;
+						 Me->LastScore = CurrentScore;
 					 }
 					 else if (CurrentEvent.EventType == ES_TIMEOUT && CurrentEvent.EventParam == ShootingTimer)
 					 {
@@ -270,7 +282,7 @@ ES_Event RunShooting( ES_Event CurrentEvent )
 					 {
 						 	puts("Got four COWs!\r\n");
 						  // Update COW_Number
-						  COW_Number = 5;
+						  Me->COW_Number = 5;
 						  // Ask for next active stage
 						  ES_Event QueryLOCEvent;
 							QueryLOCEvent.EventType = SEND_CMD;
@@ -281,7 +293,7 @@ ES_Event RunShooting( ES_Event CurrentEvent )
 					 else if (CurrentEvent.EventType == ES_LOC_STATUS)
 					 {
 						 bool isStillShooting;
-						 isStillShooting = DecipherDestinationType(CurrentEvent.EventParam,CurrentColor);
+						 isStillShooting = DecipherDestinationType(CurrentEvent.EventParam,Me->CurrentColor);
 						 if (isStillShooting)
 						 {
 							 // This is rare, but if after refilling COWs it's still within the 20 shooting window,
@@ -291,7 +303,7 @@ ES_Event RunShooting( ES_Event CurrentEvent )
 						 else
 						 {
 							 uint8_t NextStage;
-							 NextStage = DecipherDestination(CurrentEvent.EventParam,CurrentColor);
+							 NextStage = DecipherDestination(CurrentEvent.EventParam,Me->CurrentColor);
 							 printf("Next active stage = %d\r\n", NextStage);
 							 ReturnEvent.EventType = ES_NO_EVENT; // Consume this ES_LOC_STATUS event
 							 
@@ -322,11 +334,13 @@ ES_Event RunShooting( ES_Event CurrentEvent )
     //   If we are making a state transition
     if (MakeTransition == true)
     {
+       // leave a record of it in the flight recorder
+       ES_TraceTransition( ES_TRACE_Shooting, Me->CurrentShootingState, NextShootingState, CurrentEvent );
        //   Execute exit function for current state
        CurrentEvent.EventType = ES_EXIT;
        RunShooting(CurrentEvent);
 
-       CurrentShootingState = NextShootingState; //Modify state variable
+       Me->CurrentShootingState = NextShootingState; //Modify state variable
 
        //   Execute entry function for new state
        // this defaults to ES_ENTRY
@@ -358,10 +372,10 @@ void StartShooting ( ES_Event CurrentEvent )
    // otherwise just start in the entry state every time the state machine
    // is started
 	 
-	 CurrentColor = QueryColor();
+	 Me->CurrentColor = QueryColor();
    if ( ES_ENTRY_HISTORY != CurrentEvent.EventType )
    {
-        CurrentShootingState = ENTRY_STATE;
+        Me->CurrentShootingState = ENTRY_STATE;
    }
    // call the entry function (if any) for the ENTRY_STATE
    RunShooting(CurrentEvent);
@@ -386,7 +400,7 @@ void StartShooting ( ES_Event CurrentEvent )
 ****************************************************************************/
 ShootingState_t QueryShooting ( void )
 {
-   return(CurrentShootingState);
+   return(Me->CurrentShootingState);
 }
 
 /***************************************************************************
@@ -440,8 +454,8 @@ static ES_Event DuringScoring( ES_Event Event)
 				LaunchEvent.EventType = ES_OPENGATE;
 				PostServoGateService(LaunchEvent);
 				// Update COW counts
-				COW_Number --;
-				printf("Current COW number  = %d\r\n",COW_Number);
+				Me->COW_Number --;
+				printf("Current COW number  = %d\r\n",Me->COW_Number);
 				ES_Timer_InitTimer(BallTravelTimer, BALL_TRAVEL_TIME);
 			  puts("Start ball travel timer!\r\n");
         // after that start any lower level machines that run in this state
@@ -481,15 +495,15 @@ static ES_Event DuringGetCOWs( ES_Event Event)
 			// Local entry function: post an event to COWSupplementService
 			puts("First move to RELOAD location\r\n");
 			//Call drive function in DCMotorService
-			if (CurrentColor == RED)
+			if (Me->CurrentColor == RED)
 			{
-				CurrentDirection = FWD;
-				Drive(Speed,FWD);
+				Me->CurrentDirection = FWD;
+				Drive(Me->Speed,FWD);
 			}
 			else
 			{
-				CurrentDirection = BWD;
-				Drive(Speed,BWD);
+				Me->CurrentDirection = BWD;
+				Drive(Me->Speed,BWD);
 			}
     }
     else if ( Event.EventType == ES_EXIT )
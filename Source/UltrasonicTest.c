@@ -62,26 +62,36 @@
 */
 static void InitUltrasonicCapture(void);
 static void InitOneShotTrigger(void);
+static void StartTrigger(void);
 
 /*---------------------------- Module Variables ---------------------------*/
-// with the introduction of Gen2, we need a module level Priority variable
-static uint8_t MyPriority;
-// add a deferral queue for up to 3 pending deferrals +1 to allow for ovehead
-static ES_Event DeferralQueue[3+1];
-// for distance measurement
-static uint32_t Period;
-static uint32_t LastCapture;
-static uint32_t ThisCapture;
-static double Distance;
-// for debugging
-static int debugger1 = 0;
-static int debugger2 = 0;
-// for distance calculation
-static double Temperature = 20; //(degree C)
-static double SonicSpeed;
-static bool isFirstOneShotISR = true;
-// for posting event to MastSM
-static bool report;
+// the state of one robot, see ES_Instance.h
+typedef struct {
+  // with the introduction of Gen2, we need a module level Priority variable
+  uint8_t MyPriority;
+  // add a deferral queue for up to 3 pending deferrals +1 to allow for ovehead
+  ES_Event DeferralQueue[3+1];
+  // for distance measurement
+  uint32_t Period;
+  uint32_t LastCapture;
+  uint32_t ThisCapture;
+  double Distance;
+  // for distance calculation
+  double Temperature; //(degree C)
+  double SonicSpeed;
+  bool isFirstOneShotISR;
+  // for posting event to MastSM
+  bool report;
+  // PC4 is in capture mode, from the end of the trigger to the shutoff
+  bool isCapturing;
+} UltrasonicTestData_t;
+
+static UltrasonicTestData_t Instances[ES_NUM_INSTANCES] = ES_INSTANCE_INIT({
+  .Temperature = 20,
+  .isFirstOneShotISR = true
+});
+
+#define Me ES_THIS(Instances)
 //static UltrasonicState_t CurrentState;
 /*------------------------------ Module Code ------------------------------*/
 /****************************************************************************
@@ -106,7 +116,7 @@ bool InitUltrasonicTest ( uint8_t Priority )
 {
   ES_Event ThisEvent;
   
-  MyPriority = Priority;
+  Me->MyPriority = Priority;
 	
 	// Initialize the port line PC4 
 	HWREG(SYSCTL_RCGCGPIO) |= SYSCTL_RCGCGPIO_R2;
@@ -123,17 +133,19 @@ bool InitUltrasonicTest ( uint8_t Priority )
 	
 	// Initialize framework timer resolution (1mS)
 	ES_Timer_Init(ES_Timer_RATE_1mS);
+#ifndef ES_CYCLIC
 	ES_Timer_InitTimer(ULTRASONICTRIG_TIMER, TriggerInterval);
+#endif
 	// ES_Timer_InitTimer(ULTRASONICSHUTOFF_TIMER, ShutoffCaptureInterval);
 	
 	// calculate sonic speed based on temperature
-	SonicSpeed = 331.5 + (0.6 * Temperature); //(m/s)
+	Me->SonicSpeed = 331.5 + (0.6 * Me->Temperature); //(m/s)
 	
 	// set Report to false
-	report = false;
+	Me->report = false;
   // post the initial transition event
   ThisEvent.EventType = ES_INIT;
-  if (ES_PostToService( MyPriority, ThisEvent) == true)
+  if (ES_PostToService( Me->MyPriority, ThisEvent) == true)
   {
       return true;
   }else
@@ -161,7 +173,7 @@ bool InitUltrasonicTest ( uint8_t Priority )
 ****************************************************************************/
 bool PostUltrasonicTest( ES_Event ThisEvent )
 {
-  return ES_PostToService( MyPriority, ThisEvent);
+  return ES_PostToService( Me->MyPriority, ThisEvent);
 }
 
 /****************************************************************************
@@ -191,18 +203,13 @@ ES_Event RunUltrasonicTest( ES_Event ThisEvent )
 				// If ThisEvent is ES_START_ULTRASONIC
 				case ES_START_ULTRASONIC:
 					// set report to true
-				  report = true;
+				  Me->report = true;
 				  printf("Start reporting Ultrasonic sensor\r\n");
 					break;
 				// If ThisEvent is ultrosonictimer time out
 				case ES_TIMEOUT :
 					if (ThisEvent.EventParam == ULTRASONICTRIG_TIMER){
-						// set trigger GPIO (PC4) to high
-						HWREG(GPIO_PORTC_BASE+(GPIO_O_DATA+ALL_BITS)) |= GPIO_PIN_4;
-						// reload timeout to one-shot timer to restart it
-						HWREG(WTIMER0_BASE+TIMER_O_TBV) = HWREG(WTIMER0_BASE+TIMER_O_TBILR);
-						HWREG(WTIMER0_BASE+TIMER_O_CTL) |= (TIMER_CTL_TBEN | TIMER_CTL_TBSTALL);
-						
+						StartTrigger();
 					}
 					else if (ThisEvent.EventParam == ULTRASONICSHUTOFF_TIMER){
 						// locally disable ultrasonic input capture interrupt
@@ -222,22 +229,23 @@ ES_Event RunUltrasonicTest( ES_Event ThisEvent )
 						HWREG(GPIO_PORTC_BASE+GPIO_O_DEN) |= GPIO_PIN_4;
 						// Set bit 4 on Port C to be output
 						HWREG(GPIO_PORTC_BASE+GPIO_O_DIR) |= GPIO_PIN_4;
+						Me->isCapturing = false;
 					}
 					break;
 					
 				// If ThisEvent is ultrasonic capture	
 				case ES_ULTRASONIC_CAPTURE :
-					Distance = ((double)Period * 25.0 / 1000000.0)* SonicSpeed / 2.0;
+					Me->Distance = ((double)Me->Period * 25.0 / 1000000.0)* Me->SonicSpeed / 2.0;
 					// if reach the critical distance to the wall that corresponds to shooting area 2
-					printf("!!!!!!!!!!!!!!!!!!!!!!!!!!!!!Distance measured as: %f \r\n", Distance);		
-				  if ((Distance < 900) && (Distance > 800) && (report == true)){
+					printf("!!!!!!!!!!!!!!!!!!!!!!!!!!!!!Distance measured as: %f \r\n", Me->Distance);		
+				  if ((Me->Distance < 900) && (Me->Distance > 800) && (Me->report == true)){
 						// post event to MasterSM
 						ES_Event Event2Post;
 						Event2Post.EventType = ES_DISTANCE_DETECTED;
 						PostMasterSM(Event2Post);
 						// set report to false
-						report = false;
-						printf("Critical distance detected, measured as: %f \r\n", Distance);		
+						Me->report = false;
+						printf("Critical distance detected, measured as: %f \r\n", Me->Distance);		
 					}				
 					break;
 					
@@ -247,25 +255,25 @@ ES_Event RunUltrasonicTest( ES_Event ThisEvent )
 }
 
 void UltrasonicCaptureResponse(void){
+  ES_ISR_BEGIN(UltrasonicCaptureResponse);
   uint8_t CurrentPortStatus;
 	
 	// start by clearing the source of the interrupt, the input capture event
 	HWREG(WTIMER0_BASE+TIMER_O_ICR) = TIMER_ICR_CAECINT;
-	debugger1++;
 	// now grab the captured value
-	ThisCapture = HWREG(WTIMER0_BASE+TIMER_O_TAR);
+	Me->ThisCapture = HWREG(WTIMER0_BASE+TIMER_O_TAR);
 	// Update the current status of PC4
 	CurrentPortStatus = (HWREG(GPIO_PORTC_BASE+(GPIO_O_DATA+ALL_BITS)) & GPIO_PIN_4);
 	
 	// If this is a rising edge
 	if (CurrentPortStatus != 0){
 	  // update LastCapture to prepare for the next edge
-	  LastCapture = ThisCapture;
+	  Me->LastCapture = Me->ThisCapture;
 	}
 	// Else if this is a falling edge
 	else{
 	  // Calculate period
-	  Period = ThisCapture - LastCapture;
+	  Me->Period = Me->ThisCapture - Me->LastCapture;
 		// Post event with this period as parameter
 		ES_Event Event2Post;
 	  Event2Post.EventType = ES_ULTRASONIC_CAPTURE;
@@ -273,27 +281,75 @@ void UltrasonicCaptureResponse(void){
 		// locally disable ultrasonic input capture interrupt
 	  HWREG(WTIMER0_BASE+TIMER_O_IMR) &= ~TIMER_IMR_CAEIM;
 	}
+	ES_ISR_END(UltrasonicCaptureResponse);
 }
 
 void OneShotTriggerISR(void)
 {
+	ES_ISR_BEGIN(OneShotTriggerISR);
 	// start by clearing the source of the interrupt, the input capture event
 	HWREG(WTIMER0_BASE+TIMER_O_ICR) = TIMER_ICR_TBTOCINT;
 	// set trigger GPIO (PC4) to low
 	HWREG(GPIO_PORTC_BASE+(GPIO_O_DATA+ALL_BITS)) &= ~GPIO_PIN_4;
-	// set the timer for next measurement
+#ifndef ES_CYCLIC
+	// set the timer for next measurement. It is a one shot set here, not a
+	// periodic timer, so that the next trigger always comes TriggerInterval -
+	// ShutoffCaptureInterval after the shutoff, however late the timeouts
+	// are dispatched. With ES_CYCLIC the trigger slot comes every
+	// TriggerInterval whenever the shutoff is dispatched, so it skips its
+	// turn if PC4 is still capturing, see UltrasonicTriggerSlot.
 	ES_Timer_InitTimer(ULTRASONICTRIG_TIMER, TriggerInterval);
+#endif
 	// set the timer for automatically shutting off input capture
 	ES_Timer_InitTimer(ULTRASONICSHUTOFF_TIMER, ShutoffCaptureInterval);
 	// Init PC4 as input capture with interrupt also enabled
 	InitUltrasonicCapture();
-	// Increment debugger2
-	debugger2++;	
+	Me->isCapturing = true;
+	ES_ISR_END(OneShotTriggerISR);
 	}
 
+/****************************************************************************
+ Function
+    UltrasonicTriggerSlot
+
+ Parameters
+   None
+
+ Returns
+   nothing
+
+ Description
+   starts a measurement from its slot in the cyclic executive, in place of
+   the ULTRASONICTRIG_TIMER timeout
+ Notes
+   with ES_CYCLIC, the slot period in ES_CYCLIC_SCHEDULE gives
+   TriggerInterval. The ULTRASONICSHUTOFF_TIMER timeout runs in the time
+   left over in the frames, so it can come after the next slot. Driving
+   PC4 then would do nothing, as it is still the capture input, so the
+   slot waits for the next period.
+ Author
+   J. He, 10/19/26, 13:58
+****************************************************************************/
+void UltrasonicTriggerSlot(void)
+{
+	if (Me->isCapturing == false){
+		StartTrigger();
+	}
+}
+
 /***************************************************************************
  private functions
  ***************************************************************************/
+// starts the trigger pulse, OneShotTriggerISR ends it
+static void StartTrigger(void)
+{
+	// set trigger GPIO (PC4) to high
+	HWREG(GPIO_PORTC_BASE+(GPIO_O_DATA+ALL_BITS)) |= GPIO_PIN_4;
+	// reload timeout to one-shot timer to restart it
+	HWREG(WTIMER0_BASE+TIMER_O_TBV) = HWREG(WTIMER0_BASE+TIMER_O_TBILR);
+	HWREG(WTIMER0_BASE+TIMER_O_CTL) |= (TIMER_CTL_TBEN | TIMER_CTL_TBSTALL);
+}
+
 static void InitUltrasonicCapture(void){ // pin: PC4 (WT0CCP0)
   // start by enabling the clock to the timer(Wide Timer 0)
 	HWREG(SYSCTL_RCGCWTIMER) |= SYSCTL_RCGCWTIMER_R0;
@@ -0,0 +1,417 @@
+/****************************************************************************
+ Module
+     ES_HostCheck.c
+ Description
+     Host program that plays a 140 S game on the virtual clock against
+     stand-in services, and checks that the framework kept time: the game
+     timer interrupts, the periodic timer, the event checker periods and,
+     with ES_CYCLIC, the slots of the cyclic executive, with
+     ES_STARVATION_GUARD, the starvation guard
+ Notes
+     The services are stand-ins with the priorities of ES_SERVICE_LIST. Only
+     MasterSM does anything. It runs a periodic timer through the game and
+     counts the timeouts. The game timer interrupt is scheduled every 20 S
+     with _HW_ScheduleInterrupt, as GameTimerModule.c sets Wide Timer 4, and
+     posts ES_FREE_SHOOTING at 120 S and ES_GAME_OVER at 140 S.
+     Build it on the PC with the POSIX port, from the Tools directory:
+       gcc -std=gnu99 -O2 -DES_PORT_POSIX -DES_VIRTUAL_CLOCK
+           [-DES_CYCLIC | -DES_NUM_INSTANCES=<n>] -I../Headers
+           -o ES_HostCheck ES_HostCheck.c ../Source/ES_Framework.c
+           ../Source/ES_Queue.c ../Source/ES_Timers.c
+           ../Source/ES_LookupTables.c ../Source/ES_PostList.c
+           ../Source/ES_CheckEvents.c ../Source/ES_DeferRecall.c
+           ../Source/ES_Mailbox.c ../Source/ES_Payload.c ../Source/ES_Trace.c
+           ../Source/ES_Replay.c ../Source/ES_ISRStats.c
+           ../Source/EventCheckers.c ../Source/ES_Port_POSIX.c -pthread
+     and run it with stdin from /dev/null. It prints each check and PASS or
+     FAIL, and exits with 0 only if all of them passed.
+     With ES_NUM_INSTANCES > 1 every robot plays the game, through
+     ES_RunInstances, with a timer period of its own so that the robots do
+     not all see the same ticks.
+     With ES_CYCLIC the slots of ES_CYCLIC_SCHEDULE are stand-ins that check
+     the ticks between their runs. The services take no time on the virtual
+     clock, so no frame may overrun.
+     With ES_STARVATION_GUARD, the services in ES_STARVATION_GUARD_LIST get
+     events that they can only run while MasterSM floods itself with posts.
+     A service with a limit above 0 must then wait exactly its limit every
+     time, and one with a limit of 0, which only counts, until the flood is
+     over. -DES_STARVATION_GUARD checks the list in ES_Configure.h, give
+     another one on the command line to check a limit of 0 too:
+       '-DES_STARVATION_GUARD_LIST(E)=E(SPIService,16) E(LEDService,0)'
+
+ History
+ When           Who     What/Why
+ -------------- ---     --------
+ 10/21/26 13:10 jh      check the services of ES_STARVATION_GUARD_LIST, not a
+                        fixed pair
+ 10/20/26 15:20 jh      check the starvation guard
+ 10/20/26 13:15 jh      started coding
+*****************************************************************************/
+/*----------------------------- Include Files -----------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "ES_Configure.h"
+#include "ES_Framework.h"
+#include "ES_ServiceHeaders.h"
+
+#if !defined(ES_VIRTUAL_CLOCK)
+#error ES_HostCheck needs the virtual clock
+#endif
+
+/*----------------------------- Module Defines ----------------------------*/
+// the game timer comes every 20 S, the 7th time is the end of the game
+#define PASSAGE_US 20000000UL
+#define NUM_PASSAGES 7
+#define FREE_SHOOTING_US (6 * (uint64_t)PASSAGE_US)
+#define GAME_OVER_US (NUM_PASSAGES * (uint64_t)PASSAGE_US)
+
+// the timer that MasterSM runs, TIMER3_RESP_FUNC posts to it
+#define GAME_TIMER 3
+// its period, different for each robot
+#define TIMER_PERIOD (10 + (ES_INSTANCE % 7))
+
+// the period of Check4Keystroke in ES_EVENT_CHECK_LIST
+#define KEYSTROKE_CHECK_PERIOD 10
+
+// the ticks to run each robot for, per call to ES_RunInstances
+#define INSTANCE_SLICE 10000
+
+#ifdef ES_STARVATION_GUARD
+// the events MasterSM posts to itself, one at a time, on its first timeout
+#define FLOOD_RUNS 200
+// the events that each guarded service gets as the flood starts
+#define NUM_STARVED_EVENTS 3
+// an event that the stand-ins take no notice of, for the flood & the rest
+#define STARVE_EVENT ES_RELOAD
+#endif
+
+/*---------------------------- Module Functions ---------------------------*/
+static ES_Event RunStandIn( uint8_t Priority, ES_Event ThisEvent );
+static void GameTimerISR( void );
+static void CheckRobot( void );
+#ifdef ES_STARVATION_GUARD
+static void StartFlood( void );
+static void CheckStarved( uint8_t Priority, const char *pName );
+#endif
+static void Check( bool Passed, const char *pWhat );
+static void Report( void );
+
+/*---------------------------- Module Variables ---------------------------*/
+// the state of one robot, see ES_Instance.h
+typedef struct {
+  uint64_t GameStart;       // uS, when MasterSM was initialized
+  uint64_t FreeShootingAt;  // uS, when ES_FREE_SHOOTING came
+  uint64_t GameOverAt;      // uS, when ES_GAME_OVER came
+  uint32_t NumTimeouts;     // of GAME_TIMER
+  uint8_t TimePassage;      // game timer interrupts so far
+  bool IsOver;
+#ifdef ES_STARVATION_GUARD
+  uint32_t NumDispatches;   // run function calls, of any service
+  uint16_t NumFloodRuns;    // of MasterSM with STARVE_EVENT
+  // for each service, the dispatch it was last given a STARVE_EVENT or
+  // ran one on, and the most other dispatches between those & its runs
+  uint32_t LastMark[NUM_SERVICES];
+  uint32_t LongestGap[NUM_SERVICES];
+  uint8_t NumStarvedRuns[NUM_SERVICES];
+#endif
+} HostCheckData_t;
+
+static HostCheckData_t Instances[ES_NUM_INSTANCES];
+
+#define Me ES_THIS(Instances)
+
+#ifdef ES_CYCLIC
+// the runs of each slot, the tick of the last one and the runs that did
+// not come a whole period after the one before
+static uint32_t SlotRuns[ES_NUM_CYCLIC_SLOTS];
+static uint16_t SlotLastTick[ES_NUM_CYCLIC_SLOTS];
+static uint32_t SlotBadGaps[ES_NUM_CYCLIC_SLOTS];
+#endif
+
+static uint16_t NumChecks;
+static uint16_t NumFailed;
+static struct timespec WallStart;
+
+/*------------------------------ Module Code ------------------------------*/
+int main( void )
+{
+  ES_Return_t ErrorType;
+#if ES_NUM_INSTANCES > 1
+  uint16_t Robot;
+  uint16_t NumOver;
+
+  clock_gettime( CLOCK_MONOTONIC, &WallStart );
+  for ( Robot = 0; Robot < ES_NUM_INSTANCES; Robot++ ) {
+    ES_SelectInstance( Robot );
+    ErrorType = ES_Initialize( ES_Timer_RATE_1mS );
+    if ( ErrorType != Success ) {
+      printf( "ES_Initialize failed %d for robot %u\n", ErrorType, Robot );
+      return 1;
+    }
+  }
+  do {
+    ErrorType = ES_RunInstances( INSTANCE_SLICE );
+    if ( ErrorType != Success ) {
+      printf( "ES_RunInstances failed %d\n", ErrorType );
+      return 1;
+    }
+    for ( Robot = 0, NumOver = 0; Robot < ES_NUM_INSTANCES; Robot++ ) {
+      if ( Instances[Robot].IsOver == true )
+        NumOver++;
+    }
+  } while ( NumOver < ES_NUM_INSTANCES );
+  for ( Robot = 0; Robot < ES_NUM_INSTANCES; Robot++ ) {
+    ES_SelectInstance( Robot );
+    CheckRobot();
+  }
+  Report();
+#else
+  clock_gettime( CLOCK_MONOTONIC, &WallStart );
+  ErrorType = ES_Initialize( ES_Timer_RATE_1mS );
+  if ( ErrorType != Success ) {
+    printf( "ES_Initialize failed %d\n", ErrorType );
+    return 1;
+  }
+  // MasterSM reports at the end of the game
+  ErrorType = ES_Run();
+  printf( "ES_Run failed %d\n", ErrorType );
+#endif
+  return 1;
+}
+
+/***************************************************************************
+ the stand-in services
+ ***************************************************************************/
+// every service in ES_SERVICE_LIST takes its ES_INIT, as the real ones do
+#define ES_CHECK_SERVICE(Name, QueueSize) \
+  static uint8_t Name##Priority; \
+  bool Init##Name( uint8_t Priority ) \
+  { ES_Event ThisEvent = { .EventType = ES_INIT, .EventParam = 0 }; \
+    Name##Priority = Priority; \
+    return ES_PostToService( Name##Priority, ThisEvent ); } \
+  bool Post##Name( ES_Event ThisEvent ) \
+  { return ES_PostToService( Name##Priority, ThisEvent ); } \
+  ES_Event Run##Name( ES_Event ThisEvent ) \
+  { return RunStandIn( Name##Priority, ThisEvent ); }
+
+ES_SERVICE_LIST(ES_CHECK_SERVICE)
+
+// MasterSM plays the game, the others only take up their place
+static ES_Event RunStandIn( uint8_t Priority, ES_Event ThisEvent )
+{
+  ES_Event ReturnEvent = { .EventType = ES_NO_EVENT, .EventParam = 0 };
+
+#ifdef ES_STARVATION_GUARD
+  uint32_t Gap;
+
+  Me->NumDispatches++;
+  if ( ThisEvent.EventType == STARVE_EVENT ) {
+    Gap = Me->NumDispatches - Me->LastMark[Priority] - 1;
+    if ( Gap > Me->LongestGap[Priority] )
+      Me->LongestGap[Priority] = Gap;
+    Me->LastMark[Priority] = Me->NumDispatches;
+    Me->NumStarvedRuns[Priority]++;
+  }
+#endif
+  if ( Priority != MasterSMPriority )
+    return ReturnEvent;
+  switch ( ThisEvent.EventType ) {
+    case ES_INIT:
+      Me->GameStart = ES_Timer_GetMicros();
+      ES_Timer_StartPeriodic( GAME_TIMER, TIMER_PERIOD );
+      _HW_ScheduleInterrupt( GameTimerISR, PASSAGE_US );
+      break;
+    case ES_TIMEOUT:
+      if ( ThisEvent.EventParam == GAME_TIMER )
+        Me->NumTimeouts++;
+#ifdef ES_STARVATION_GUARD
+      if ( Me->NumTimeouts == 1 )
+        StartFlood();
+#endif
+      break;
+#ifdef ES_STARVATION_GUARD
+    case STARVE_EVENT:
+      // keep MasterSM busy, it is the highest priority
+      if ( ++Me->NumFloodRuns < FLOOD_RUNS )
+        PostMasterSM( ThisEvent );
+      break;
+#endif
+    case ES_FREE_SHOOTING:
+      Me->FreeShootingAt = ES_Timer_GetMicros();
+      break;
+    case ES_GAME_OVER:
+      Me->GameOverAt = ES_Timer_GetMicros();
+      Me->IsOver = true;
+#if ES_NUM_INSTANCES == 1
+      CheckRobot();
+      Report();
+#endif
+      break;
+    default:
+      break;
+  }
+  return ReturnEvent;
+}
+
+#ifdef ES_CYCLIC
+// each slot checks that it came a whole period after its last run
+#define ES_CHECK_SLOT(Func, Period, Phase) \
+  void Func( void ) \
+  { uint16_t Now = ES_Timer_GetTime(); \
+    if ( (SlotRuns[ES_SLOT_##Func] != 0) && \
+         ((uint16_t)(Now - SlotLastTick[ES_SLOT_##Func]) != \
+          (Period) * ES_CYCLIC_MINOR_TICKS) ) \
+      SlotBadGaps[ES_SLOT_##Func]++; \
+    SlotLastTick[ES_SLOT_##Func] = Now; \
+    SlotRuns[ES_SLOT_##Func]++; }
+
+ES_CYCLIC_SCHEDULE(ES_CHECK_SLOT)
+#endif
+
+/***************************************************************************
+ private functions
+ ***************************************************************************/
+// the game timer interrupt, every PASSAGE_US until the end of the game
+static void GameTimerISR( void )
+{
+  ES_Event ThisEvent = { .EventType = ES_NO_EVENT, .EventParam = 0 };
+
+  Me->TimePassage++;
+  if ( Me->TimePassage < NUM_PASSAGES )
+    _HW_ScheduleInterrupt( GameTimerISR, PASSAGE_US );
+  if ( Me->TimePassage == NUM_PASSAGES - 1 )
+    ThisEvent.EventType = ES_FREE_SHOOTING;
+  else if ( Me->TimePassage == NUM_PASSAGES )
+    ThisEvent.EventType = ES_GAME_OVER;
+  if ( ThisEvent.EventType != ES_NO_EVENT )
+    PostMasterSM( ThisEvent );
+}
+
+// checks the times the robot that is selected kept
+static void CheckRobot( void )
+{
+  uint32_t Ticks = (uint32_t)((Me->GameOverAt - Me->GameStart) / 1000);
+  uint32_t Expected = Ticks / TIMER_PERIOD;
+  ES_CheckerStats_t CheckerStats;
+#ifdef ES_CYCLIC
+  uint8_t i;
+  uint32_t Frames = Ticks / ES_CYCLIC_MINOR_TICKS;
+  ES_CyclicStats_t CyclicStats;
+  static const uint8_t SlotPeriods[ES_NUM_CYCLIC_SLOTS] = {
+#define ES_CHECK_SLOT_PERIOD(Func, Period, Phase) Period,
+    ES_CYCLIC_SCHEDULE(ES_CHECK_SLOT_PERIOD)
+  };
+  static const char * const SlotChecks[ES_NUM_CYCLIC_SLOTS] = {
+#define ES_CHECK_SLOT_NAME(Func, Period, Phase) \
+    #Func " ran once every period",
+    ES_CYCLIC_SCHEDULE(ES_CHECK_SLOT_NAME)
+  };
+#endif
+
+  printf( "robot %u: game over at %llu uS, %lu timeouts of %u mS\n",
+          ES_INSTANCE, (unsigned long long)(Me->GameOverAt - Me->GameStart),
+          (unsigned long)Me->NumTimeouts, TIMER_PERIOD );
+  Check( Me->FreeShootingAt - Me->GameStart == FREE_SHOOTING_US,
+         "ES_FREE_SHOOTING on the 6th game timer interrupt" );
+  Check( Me->GameOverAt - Me->GameStart == GAME_OVER_US,
+         "ES_GAME_OVER on the 7th game timer interrupt" );
+  // the timeout due on the last tick may still be queued behind the end
+  Check( (Me->NumTimeouts + 1 >= Expected) && (Me->NumTimeouts <= Expected),
+         "a timeout every period of the periodic timer" );
+  ES_GetCheckerStats( ES_CHECK_Check4Keystroke, &CheckerStats );
+  Expected = Ticks / KEYSTROKE_CHECK_PERIOD;
+  Check( (CheckerStats.NumChecks >= Expected) &&
+         (CheckerStats.NumChecks <= Expected + 1),
+         "Check4Keystroke called once every period" );
+#ifdef ES_CYCLIC
+  ES_GetCyclicStats( &CyclicStats );
+  printf( "robot %u: %lu frames\n", ES_INSTANCE,
+          (unsigned long)CyclicStats.NumFrames );
+  Check( (CyclicStats.NumOverruns == 0) && (CyclicStats.NumSkipped == 0),
+         "no frame overran or was skipped" );
+  for ( i = 0; i < ES_NUM_CYCLIC_SLOTS; i++ ) {
+    Expected = Frames / SlotPeriods[i];
+    Check( (SlotBadGaps[i] == 0) && (SlotRuns[i] + 1 >= Expected) &&
+           (SlotRuns[i] <= Expected + 1), SlotChecks[i] );
+  }
+#endif
+#ifdef ES_STARVATION_GUARD
+#define ES_CHECK_STARVED(Name, MaxWaits) \
+  CheckStarved( Name##Priority, #Name );
+  ES_STARVATION_GUARD_LIST(ES_CHECK_STARVED)
+#endif
+}
+
+#ifdef ES_STARVATION_GUARD
+// gives the guarded services their events & starts MasterSM's flood
+static void StartFlood( void )
+{
+  ES_Event ThisEvent = { .EventType = STARVE_EVENT, .EventParam = 0 };
+  uint8_t i;
+
+  for ( i = 0; i < NUM_STARVED_EVENTS; i++ ) {
+#define ES_CHECK_STARVE_POST(Name, MaxWaits) Post##Name( ThisEvent );
+    ES_STARVATION_GUARD_LIST(ES_CHECK_STARVE_POST)
+  }
+#define ES_CHECK_STARVE_MARK(Name, MaxWaits) \
+  Me->LastMark[Name##Priority] = Me->NumDispatches;
+  ES_STARVATION_GUARD_LIST(ES_CHECK_STARVE_MARK)
+  // the ES_INITs may have starved a guarded service, count only the flood
+  ES_ResetStarvationStats();
+  PostMasterSM( ThisEvent );
+}
+
+// checks the waits of a guarded service against its limit & its counters
+static void CheckStarved( uint8_t Priority, const char *pName )
+{
+  ES_StarvationStats_t Stats = { 0 };
+  bool IsGuarded = ES_GetStarvationStats( Priority, &Stats );
+
+  printf( "robot %u: %s limit %u, longest wait %lu, %lu times starved\n",
+          ES_INSTANCE, pName, Stats.MaxWaits,
+          (unsigned long)Stats.LongestWait, (unsigned long)Stats.NumStarved );
+  Check( IsGuarded == true, "the service is in ES_STARVATION_GUARD_LIST" );
+  Check( Me->NumStarvedRuns[Priority] == NUM_STARVED_EVENTS,
+         "the service ran all of its events" );
+  Check( Stats.LongestWait == Me->LongestGap[Priority],
+         "LongestWait is the most dispatches it waited" );
+  if ( Stats.MaxWaits != 0 ) {
+    // MasterSM was ready all along, so every run was ahead of it
+    Check( Me->LongestGap[Priority] == Stats.MaxWaits,
+           "it ran after exactly its limit of dispatches, every time" );
+    Check( Stats.NumStarved == NUM_STARVED_EVENTS,
+           "NumStarved counts every run ahead of its priority" );
+  }else {
+    Check( Me->LongestGap[Priority] >= FLOOD_RUNS,
+           "with a limit of 0 it waited out the flood" );
+    Check( Stats.NumStarved == 0, "with a limit of 0 it never starved" );
+  }
+}
+#endif
+
+static void Check( bool Passed, const char *pWhat )
+{
+  NumChecks++;
+  if ( Passed == false )
+    NumFailed++;
+  printf( "  %-6s %s\n", (Passed == true) ? "ok" : "FAILED", pWhat );
+}
+
+static void Report( void )
+{
+  struct timespec WallEnd;
+
+  clock_gettime( CLOCK_MONOTONIC, &WallEnd );
+  printf( "%u robot(s), %.1f mS of wall time\n", ES_NUM_INSTANCES,
+          (WallEnd.tv_sec - WallStart.tv_sec) * 1e3 +
+          (WallEnd.tv_nsec - WallStart.tv_nsec) / 1e6 );
+  if ( NumFailed == 0 ) {
+    printf( "PASS, %u checks\n", NumChecks );
+    exit( 0 );
+  }
+  printf( "FAIL, %u of %u checks\n", NumFailed, NumChecks );
+  exit( 1 );
+}
+/*------------------------------- Footnotes -------------------------------*/
+/*------------------------------ End of file ------------------------------*/
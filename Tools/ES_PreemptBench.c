@@ -0,0 +1,211 @@
+/****************************************************************************
+ Module
+     ES_PreemptBench.c
+ Description
+     Host program that measures the worst-case dispatch latency of MasterSM,
+     from the post made by a capture interrupt to the start of its run
+     function, with and without ES_PREEMPTIVE
+ Notes
+     The services are stand-ins with the priorities of ES_SERVICE_LIST.
+     SPIService holds the processor for as long as the real one does when it
+     prints the 5 response bytes at 115200 baud, every QUERY_INTERVAL. The
+     capture interrupt is SIGALRM at a period that does not divide that, so
+     it lands all over the SPIService run.
+     Build it on the PC with the POSIX port, from the Tools directory:
+       gcc -std=gnu99 -O2 -DES_PORT_POSIX [-DES_PREEMPTIVE] -I../Headers
+           -o ES_PreemptBench ES_PreemptBench.c ../Source/ES_Framework.c
+           ../Source/ES_Queue.c ../Source/ES_Timers.c
+           ../Source/ES_LookupTables.c ../Source/ES_PostList.c
+           ../Source/ES_CheckEvents.c ../Source/ES_DeferRecall.c
+           ../Source/ES_Mailbox.c ../Source/ES_Payload.c ../Source/ES_Trace.c
+           ../Source/ES_Replay.c ../Source/ES_ISRStats.c
+           ../Source/EventCheckers.c ../Source/ES_Port_POSIX.c -pthread
+     and run it with stdin from /dev/null. Not for ES_VIRTUAL_CLOCK, the
+     services would take no time at all.
+     The host scheduler adds its own latency, in whole time slices (4 mS at
+     HZ=250) when the machine is busy. Run it on an idle machine, or under
+     chrt -f 50, for the worst case that is down to the framework.
+
+ History
+ When           Who     What/Why
+ -------------- ---     --------
+ 10/18/26 17:11 jh      started coding
+*****************************************************************************/
+/*----------------------------- Include Files -----------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+#include <signal.h>
+#include "ES_Configure.h"
+#include "ES_Framework.h"
+#include "ES_ServiceHeaders.h"
+
+#if defined(ES_VIRTUAL_CLOCK)
+#error ES_PreemptBench needs the real clock
+#endif
+
+/*----------------------------- Module Defines ----------------------------*/
+// how long SPIService prints for: 5 lines of 24 characters at 115200 baud
+#define SPI_BUSY_US 10400
+// the period of the capture interrupt
+#define CAPTURE_PERIOD_US 1700
+// the number of MasterSM dispatches to measure
+#define NUM_SAMPLES 2000
+
+// as in SPIService.c
+#define QUERY_INTERVAL 20
+
+/*---------------------------- Module Functions ---------------------------*/
+static void CaptureISR( void );
+static void Spin( uint32_t Micros );
+static void Report( void );
+
+/*---------------------------- Module Variables ---------------------------*/
+static uint8_t SPIPriority;
+static uint8_t MasterPriority;
+
+static uint32_t NumSamples;
+static uint32_t MaxLatency;
+static uint64_t TotalLatency;
+static uint32_t NumSPIRuns;
+
+/*------------------------------ Module Code ------------------------------*/
+int main( void )
+{
+  struct itimerval Capture = { { 0, CAPTURE_PERIOD_US },
+                               { 0, CAPTURE_PERIOD_US } };
+  ES_Return_t ErrorType;
+
+  TERMIO_Init();
+#ifdef ES_PREEMPTIVE
+  printf( "MasterSM dispatch latency, preemptive\n" );
+#else
+  printf( "MasterSM dispatch latency, run to completion\n" );
+#endif
+  ErrorType = ES_Initialize( ES_Timer_RATE_1mS );
+  if ( ErrorType != Success ) {
+    printf( "ES_Initialize failed %d\n", ErrorType );
+    return 1;
+  }
+  _HW_AttachInterrupt( SIGALRM, CaptureISR );
+  setitimer( ITIMER_REAL, &Capture, NULL );
+  ErrorType = ES_Run();
+  printf( "ES_Run failed %d\n", ErrorType );
+  return 1;
+}
+
+/***************************************************************************
+ the stand-in services
+ ***************************************************************************/
+// the services that only take up their place in the priority order
+#define ES_BENCH_IDLE_SERVICE(Name) \
+  static uint8_t Name##Priority; \
+  bool Init##Name( uint8_t Priority ) \
+  { Name##Priority = Priority; return true; } \
+  bool Post##Name( ES_Event ThisEvent ) \
+  { return ES_PostToService( Name##Priority, ThisEvent ); } \
+  ES_Event Run##Name( ES_Event ThisEvent ) \
+  { ES_Event ReturnEvent = { .EventType = ES_NO_EVENT, .EventParam = 0 }; \
+    (void)ThisEvent; \
+    return ReturnEvent; }
+
+ES_BENCH_IDLE_SERVICE( LEDService )
+ES_BENCH_IDLE_SERVICE( HallEffectService )
+ES_BENCH_IDLE_SERVICE( DCMotorService )
+ES_BENCH_IDLE_SERVICE( UltrasonicTest )
+ES_BENCH_IDLE_SERVICE( COWSupplementService )
+ES_BENCH_IDLE_SERVICE( FlywheelTest )
+ES_BENCH_IDLE_SERVICE( ServoGateService )
+
+bool InitSPIService( uint8_t Priority )
+{
+  ES_Event ThisEvent = { .EventType = ES_INIT, .EventParam = 0 };
+
+  SPIPriority = Priority;
+  return ES_PostToService( SPIPriority, ThisEvent );
+}
+
+bool PostSPIService( ES_Event ThisEvent )
+{
+  return ES_PostToService( SPIPriority, ThisEvent );
+}
+
+// prints a response, then waits for the next transfer
+ES_Event RunSPIService( ES_Event ThisEvent )
+{
+  ES_Event ReturnEvent = { .EventType = ES_NO_EVENT, .EventParam = 0 };
+
+  if ( (ThisEvent.EventType == ES_INIT) ||
+       (ThisEvent.EventType == ES_TIMEOUT) ) {
+    Spin( SPI_BUSY_US );
+    NumSPIRuns++;
+    ES_Timer_InitTimer( TRANSFER_INTERVAL_TIMER, QUERY_INTERVAL );
+  }
+  return ReturnEvent;
+}
+
+bool InitMasterSM( uint8_t Priority )
+{
+  MasterPriority = Priority;
+  return true;
+}
+
+bool PostMasterSM( ES_Event ThisEvent )
+{
+  return ES_PostToService( MasterPriority, ThisEvent );
+}
+
+// the latency is measured at the top of the run function
+ES_Event RunMasterSM( ES_Event ThisEvent )
+{
+  ES_Event ReturnEvent = { .EventType = ES_NO_EVENT, .EventParam = 0 };
+  uint16_t Latency;
+
+  if ( ThisEvent.EventType == ES_MAG_FIELD ) {
+    Latency = (uint16_t)_HW_GetTimestamp() - ThisEvent.EventParam;
+    if ( Latency > MaxLatency )
+      MaxLatency = Latency;
+    TotalLatency += Latency;
+    if ( ++NumSamples == NUM_SAMPLES )
+      Report();
+  }
+  return ReturnEvent;
+}
+
+/***************************************************************************
+ private functions
+ ***************************************************************************/
+// the capture interrupt, the EventParam is the time it came in
+static void CaptureISR( void )
+{
+  ES_Event ThisEvent;
+
+  ThisEvent.EventType = ES_MAG_FIELD;
+  ThisEvent.EventParam = (uint16_t)_HW_GetTimestamp();
+  PostMasterSM( ThisEvent );
+}
+
+// holds the processor, as a blocking printf to the UART does
+static void Spin( uint32_t Micros )
+{
+  uint32_t Start = _HW_GetTimestamp();
+
+  while ( (uint32_t)(_HW_GetTimestamp() - Start) < Micros )
+    ;
+}
+
+static void Report( void )
+{
+  ES_QueueStats_t Stats;
+
+  ES_GetQueueStats( MasterPriority, &Stats );
+  printf( "%lu events, %lu dropped, %lu SPIService runs\n",
+          (unsigned long)NumSamples, (unsigned long)Stats.NumDropped,
+          (unsigned long)NumSPIRuns );
+  printf( "latency (uS): mean %lu max %lu\n",
+          (unsigned long)(TotalLatency / NumSamples),
+          (unsigned long)MaxLatency );
+  exit( 0 );
+}
+/*------------------------------- Footnotes -------------------------------*/
+/*------------------------------ End of file ------------------------------*/
@@ -0,0 +1,348 @@
+/****************************************************************************
+ Module
+     ES_ReplayRun.c
+ Description
+     Host program that records a run, dumps the log with ES_ReplayDump,
+     reads the dump back with ES_ReplayLoad and replays it, then checks that
+     the services saw the same posts and timeouts on the same ticks both
+     times
+ Notes
+     The services are stand-ins with the priorities of ES_SERVICE_LIST, and
+     each of them notes down every event it runs, with the tick it ran on.
+     The record run is a child process. A key interrupt, scheduled with
+     _HW_ScheduleInterrupt at uneven times, posts ES_NEW_KEY to MasterSM or
+     LEDService and starts the timer of MasterSM on every third key. After
+     NUM_KEYS keys the log is dumped into the log file. The replay run is a
+     second child that loads that file and has no key interrupt, so all of
+     its keys and ISR timer starts come from the replay. SPIService runs a
+     periodic timer in both, as the timeouts that no ISR started.
+     A replay is only good to the tick, the events that a tick brings are
+     replayed at its start, so the events of each tick are compared in
+     sorted order rather than the order they ran in.
+     Build it on the PC with the POSIX port, from the Tools directory:
+       gcc -std=gnu99 -O2 -DES_PORT_POSIX -DES_VIRTUAL_CLOCK
+           -DES_REPLAY_RECORDS=256 -I../Headers
+           -o ES_ReplayRun ES_ReplayRun.c ../Source/ES_Framework.c
+           ../Source/ES_Queue.c ../Source/ES_Timers.c
+           ../Source/ES_LookupTables.c ../Source/ES_PostList.c
+           ../Source/ES_CheckEvents.c ../Source/ES_DeferRecall.c
+           ../Source/ES_Mailbox.c ../Source/ES_Payload.c ../Source/ES_Trace.c
+           ../Source/ES_Replay.c ../Source/ES_ISRStats.c
+           ../Source/EventCheckers.c ../Source/ES_Port_POSIX.c -pthread
+     and run it with stdin from /dev/null, and the name of the log file to
+     leave the dump in if ES_ReplayRun.log will not do. It prints each check
+     and PASS or FAIL, and exits with 0 only if all of them passed.
+
+ History
+ When           Who     What/Why
+ -------------- ---     --------
+ 10/21/26 10:40 jh      started coding
+*****************************************************************************/
+/*----------------------------- Include Files -----------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "ES_Configure.h"
+#include "ES_Framework.h"
+#include "ES_ServiceHeaders.h"
+#include "ES_Replay.h"
+
+#if !defined(ES_VIRTUAL_CLOCK)
+#error ES_ReplayRun needs the virtual clock
+#endif
+#if ES_REPLAY_RECORDS == 0
+#error ES_ReplayRun needs -DES_REPLAY_RECORDS=<n>
+#endif
+
+/*----------------------------- Module Defines ----------------------------*/
+// the keys to record, each takes a capture & a post, and every third one a
+// timer start, so the log has to hold 2 1/3 records a key
+#define NUM_KEYS 100
+#if ES_REPLAY_RECORDS < (7 * NUM_KEYS + 2) / 3
+#error ES_ReplayRun needs a bigger ES_REPLAY_RECORDS
+#endif
+
+// the gaps between keys, from 1/2 to 9 1/2 ticks
+#define KEY_GAP_MIN_US 500
+#define KEY_GAP_SPAN_US 9000
+
+// the timer started by the key interrupt, TIMER3_RESP_FUNC posts to
+// MasterSM, and the ticks it is started for
+#define KEY_TIMER 3
+#define KEY_TIMER_TICKS 4
+// the periodic timer of SPIService, TIMER0_RESP_FUNC posts to it
+#define SPI_TIMER 0
+#define SPI_TIMER_PERIOD 25
+
+// a run that has gone this many ticks without all of its keys is stuck
+#define GIVE_UP_TICKS 10000
+
+#define DEFAULT_LOG "ES_ReplayRun.log"
+
+/*---------------------------- Module Functions ---------------------------*/
+// an event that a stand-in ran
+typedef struct {
+  uint16_t Tick;    // since ES_Initialize
+  uint8_t Type;
+  uint8_t Target;   // the priority of the service
+  uint16_t Param;
+} Seen_t;
+
+static ES_Event RunStandIn( uint8_t Priority, ES_Event ThisEvent );
+static void KeyISR( void );
+static uint32_t NextKeyGap( void );
+static bool RunChild( bool IsReplay );
+static uint32_t ReadSeen( FILE *pSeenFile, Seen_t *pSeen, uint32_t MaxSeen );
+static int CompareSeen( const void *pA, const void *pB );
+static void Check( bool Passed, const char *pWhat );
+static void Report( void );
+
+/*---------------------------- Module Variables ---------------------------*/
+// the log file that the record run dumps into & the replay run loads
+static const char *pLogName = DEFAULT_LOG;
+// what the stand-ins ran, one line per event, written by the child
+static FILE *pSeen;
+static FILE *pRecordSeen;
+static FILE *pReplaySeen;
+// ES_Timer_GetTime() after ES_Initialize, the ticks are counted from it
+static uint16_t StartTick;
+static uint32_t NumRunTicks;
+static uint16_t LastTick;
+static uint16_t NumKeysPosted;
+static uint16_t NumKeysSeen;
+static bool Replaying;
+// for the gaps between keys, the same every run
+static uint32_t GapSeed = 1;
+
+static uint16_t NumChecks;
+static uint16_t NumFailed;
+
+/*------------------------------ Module Code ------------------------------*/
+int main( int argc, char *argv[] )
+{
+  // the events seen by the two runs, sorted
+  static Seen_t Recorded[3 * NUM_KEYS];
+  static Seen_t Replayed[3 * NUM_KEYS];
+  uint32_t NumRecorded, NumReplayed, i;
+  uint32_t NumKeys = 0, NumTimeouts = 0;
+  uint32_t BadKeys = 0, BadTimeouts = 0;
+  bool SameEvent;
+
+  if ( argc > 1 )
+    pLogName = argv[1];
+  pRecordSeen = tmpfile();
+  pReplaySeen = tmpfile();
+  if ( (pRecordSeen == NULL) || (pReplaySeen == NULL) ) {
+    printf( "could not make the temporary files\n" );
+    return 1;
+  }
+  Check( RunChild( false ) == true,
+         "the record run took all of its keys & dumped the log" );
+  Check( RunChild( true ) == true,
+         "the replay run loaded the dump & saw every key" );
+  NumRecorded = ReadSeen( pRecordSeen, Recorded, 3 * NUM_KEYS );
+  NumReplayed = ReadSeen( pReplaySeen, Replayed, 3 * NUM_KEYS );
+  printf( "%lu events recorded, %lu replayed\n", (unsigned long)NumRecorded,
+          (unsigned long)NumReplayed );
+  Check( NumReplayed == NumRecorded, "the replay ran as many events" );
+  for ( i = 0; (i < NumRecorded) && (i < NumReplayed); i++ ) {
+    SameEvent = (CompareSeen( &Recorded[i], &Replayed[i] ) == 0);
+    if ( Recorded[i].Type == ES_NEW_KEY ) {
+      NumKeys++;
+      if ( SameEvent == false )
+        BadKeys++;
+    }else {
+      NumTimeouts++;
+      if ( SameEvent == false )
+        BadTimeouts++;
+    }
+    if ( (SameEvent == false) && (BadKeys + BadTimeouts == 1) )
+      printf( "first difference, event %lu: tick %u service %u event %u "
+              "param %u recorded, tick %u service %u event %u param %u "
+              "replayed\n", (unsigned long)i, Recorded[i].Tick,
+              Recorded[i].Target, Recorded[i].Type, Recorded[i].Param,
+              Replayed[i].Tick, Replayed[i].Target, Replayed[i].Type,
+              Replayed[i].Param );
+  }
+  printf( "%lu keys, %lu different; %lu timeouts, %lu different\n",
+          (unsigned long)NumKeys, (unsigned long)BadKeys,
+          (unsigned long)NumTimeouts, (unsigned long)BadTimeouts );
+  Check( (NumKeys == NUM_KEYS) && (BadKeys == 0),
+         "each key came to the same service on the same tick" );
+  Check( (NumTimeouts != 0) && (BadTimeouts == 0),
+         "each timeout came on the same tick, the ISR ones too" );
+  Report();
+  return 1;
+}
+
+/***************************************************************************
+ the stand-in services
+ ***************************************************************************/
+// every service in ES_SERVICE_LIST takes its ES_INIT, as the real ones do
+#define ES_REPLAY_SERVICE(Name, QueueSize) \
+  static uint8_t Name##Priority; \
+  bool Init##Name( uint8_t Priority ) \
+  { ES_Event ThisEvent = { .EventType = ES_INIT, .EventParam = 0 }; \
+    Name##Priority = Priority; \
+    return ES_PostToService( Name##Priority, ThisEvent ); } \
+  bool Post##Name( ES_Event ThisEvent ) \
+  { return ES_PostToService( Name##Priority, ThisEvent ); } \
+  ES_Event Run##Name( ES_Event ThisEvent ) \
+  { return RunStandIn( Name##Priority, ThisEvent ); }
+
+ES_SERVICE_LIST(ES_REPLAY_SERVICE)
+
+// notes down every event after ES_INIT, and ends the run after the last key
+static ES_Event RunStandIn( uint8_t Priority, ES_Event ThisEvent )
+{
+  ES_Event ReturnEvent = { .EventType = ES_NO_EVENT, .EventParam = 0 };
+  uint16_t Now = ES_Timer_GetTime();
+
+  NumRunTicks += (uint16_t)(Now - LastTick);
+  LastTick = Now;
+  if ( ThisEvent.EventType == ES_INIT ) {
+    if ( Priority == SPIServicePriority )
+      ES_Timer_StartPeriodic( SPI_TIMER, SPI_TIMER_PERIOD );
+    if ( (Priority == MasterSMPriority) && (Replaying == false) )
+      _HW_ScheduleInterrupt( KeyISR, NextKeyGap() );
+    return ReturnEvent;
+  }
+  fprintf( pSeen, "%u %u %u %u\n", (uint16_t)(Now - StartTick),
+           ThisEvent.EventType, Priority, ThisEvent.EventParam );
+  if ( ThisEvent.EventType == ES_NEW_KEY )
+    NumKeysSeen++;
+  if ( NumKeysSeen == NUM_KEYS ) {
+    fflush( pSeen );
+    if ( Replaying == false ) {
+      // the dump goes to the log file, as a console log on the Tiva would
+      fflush( stdout );
+      if ( freopen( pLogName, "w", stdout ) == NULL )
+        _exit( 1 );
+      ES_ReplayDump();
+      fflush( stdout );
+    }
+    _exit( 0 );
+  }
+  if ( NumRunTicks > GIVE_UP_TICKS ) {
+    fflush( pSeen );
+    _exit( 1 );
+  }
+  return ReturnEvent;
+}
+
+/***************************************************************************
+ private functions
+ ***************************************************************************/
+// the key interrupt of the record run, NUM_KEYS of them at uneven gaps
+static void KeyISR( void )
+{
+  ES_Event ThisEvent = { .EventType = ES_NEW_KEY, .EventParam = 0 };
+
+  NumKeysPosted++;
+  ThisEvent.EventParam = (uint16_t)ES_ReplayCapture( 'a' +
+                                                    NumKeysPosted % 26 );
+  if ( NumKeysPosted % 4 == 0 )
+    PostLEDService( ThisEvent );
+  else
+    PostMasterSM( ThisEvent );
+  if ( NumKeysPosted % 3 == 0 )
+    ES_Timer_InitTimer( KEY_TIMER, KEY_TIMER_TICKS );
+  if ( NumKeysPosted < NUM_KEYS )
+    _HW_ScheduleInterrupt( KeyISR, NextKeyGap() );
+}
+
+// a small linear congruential generator, so the gaps are the same each run
+static uint32_t NextKeyGap( void )
+{
+  GapSeed = GapSeed * 1103515245UL + 12345UL;
+  return KEY_GAP_MIN_US + (GapSeed >> 16) % KEY_GAP_SPAN_US;
+}
+
+// runs the record or the replay in a child process, true if it saw all of
+// its keys
+static bool RunChild( bool IsReplay )
+{
+  pid_t Child;
+  int Status;
+
+  fflush( stdout );
+  Child = fork();
+  if ( Child < 0 )
+    return false;
+  if ( Child == 0 ) {
+    Replaying = IsReplay;
+    pSeen = (IsReplay == true) ? pReplaySeen : pRecordSeen;
+    if ( (IsReplay == true) && (ES_ReplayLoad( pLogName ) == false) ) {
+      printf( "could not load %s\n", pLogName );
+      _exit( 1 );
+    }
+    if ( ES_Initialize( ES_Timer_RATE_1mS ) != Success )
+      _exit( 1 );
+    StartTick = ES_Timer_GetTime();
+    LastTick = StartTick;
+    ES_Run();
+    _exit( 1 );
+  }
+  if ( waitpid( Child, &Status, 0 ) != Child )
+    return false;
+  return WIFEXITED( Status ) && (WEXITSTATUS( Status ) == 0);
+}
+
+// reads back the events a run saw and sorts them, returns how many there
+// were
+static uint32_t ReadSeen( FILE *pSeenFile, Seen_t *pSeen, uint32_t MaxSeen )
+{
+  unsigned int Tick, Type, Target, Param;
+  uint32_t NumSeen = 0;
+
+  rewind( pSeenFile );
+  while ( (NumSeen < MaxSeen) &&
+          (fscanf( pSeenFile, "%u %u %u %u", &Tick, &Type, &Target,
+                   &Param ) == 4) ) {
+    pSeen[NumSeen].Tick = (uint16_t)Tick;
+    pSeen[NumSeen].Type = (uint8_t)Type;
+    pSeen[NumSeen].Target = (uint8_t)Target;
+    pSeen[NumSeen].Param = (uint16_t)Param;
+    NumSeen++;
+  }
+  qsort( pSeen, NumSeen, sizeof(Seen_t), CompareSeen );
+  return NumSeen;
+}
+
+// orders the events by tick, then by service, type & param
+static int CompareSeen( const void *pA, const void *pB )
+{
+  const Seen_t *pSeenA = pA;
+  const Seen_t *pSeenB = pB;
+
+  if ( pSeenA->Tick != pSeenB->Tick )
+    return (pSeenA->Tick < pSeenB->Tick) ? -1 : 1;
+  if ( pSeenA->Target != pSeenB->Target )
+    return (pSeenA->Target < pSeenB->Target) ? -1 : 1;
+  if ( pSeenA->Type != pSeenB->Type )
+    return (pSeenA->Type < pSeenB->Type) ? -1 : 1;
+  if ( pSeenA->Param != pSeenB->Param )
+    return (pSeenA->Param < pSeenB->Param) ? -1 : 1;
+  return 0;
+}
+
+static void Check( bool Passed, const char *pWhat )
+{
+  NumChecks++;
+  if ( Passed == false )
+    NumFailed++;
+  printf( "  %-6s %s\n", (Passed == true) ? "ok" : "FAILED", pWhat );
+}
+
+static void Report( void )
+{
+  if ( NumFailed == 0 ) {
+    printf( "PASS, %u checks\n", NumChecks );
+    exit( 0 );
+  }
+  printf( "FAIL, %u of %u checks\n", NumFailed, NumChecks );
+  exit( 1 );
+}
+/*------------------------------- Footnotes -------------------------------*/
+/*------------------------------ End of file ------------------------------*/
@@ -0,0 +1,152 @@
+/****************************************************************************
+ Module
+     ES_TraceDecode.c
+ Description
+     Host program that decodes the flight recorder dumps printed by
+     ES_TraceDump into a timeline, using the service and state machine names
+     from ES_Configure.h
+ Notes
+     build it on the PC against the same ES_Configure.h as the target, e.g.
+       gcc -std=gnu99 -I../Headers -o ES_TraceDecode ES_TraceDecode.c
+     and feed it a log of the console
+       ES_TraceDecode < console.log
+     Anything in the log outside of a dump is skipped. Event types are
+     printed as numbers, look them up in ES_EventTyp_t.
+
+ History
+ When           Who     What/Why
+ -------------- ---     --------
+ 10/17/26 22:30 jh      started coding
+*****************************************************************************/
+/*----------------------------- Include Files -----------------------------*/
+#include <stdio.h>
+#include <string.h>
+#include "ES_Configure.h"
+#include "ES_Trace.h"
+#include "ES_General.h"
+
+/*----------------------------- Module Defines ----------------------------*/
+#define MAX_LINE 128
+
+/*---------------------------- Module Functions ---------------------------*/
+static const char * ServiceName( uint8_t Service, char * pBuffer );
+static void PrintRecord( const ES_TraceRecord_t * pRecord, double Seconds,
+                         unsigned long Delta );
+
+/*---------------------------- Module Variables ---------------------------*/
+#define ES_SERVICE_NAME(Name, QueueSize) #Name,
+static const char * const ServiceNames[] = {
+  ES_SERVICE_LIST(ES_SERVICE_NAME)
+};
+
+#define ES_TRACE_MACHINE_NAME(Name) #Name,
+static const char * const MachineNames[] = {
+  ES_TRACE_MACHINES(ES_TRACE_MACHINE_NAME)
+};
+
+/*------------------------------ Module Code ------------------------------*/
+int main( void )
+{
+  char Line[MAX_LINE];
+  unsigned long Written, InDump, Time;
+  unsigned int Kind, Source, Target, State, EventType, EventParam;
+  ES_TraceRecord_t Record;
+  bool InTrace = false;
+  uint32_t LastTime = 0;
+  double Seconds = 0;
+  unsigned NumDumps = 0;
+  unsigned long NumRecords = 0;
+
+  while ( fgets( Line, sizeof(Line), stdin ) != NULL ) {
+    if ( sscanf( Line, "ES_TRACE BEGIN %lx %lx", &Written, &InDump ) == 2 ) {
+      printf( "dump %u: the last %lu of %lu records\n", ++NumDumps, InDump,
+              Written );
+      printf( "  time (s) delta (uS)  what\n" );
+      InTrace = true;
+      NumRecords = 0;
+      continue;
+    }
+    if ( InTrace != true )
+      continue;
+    if ( strncmp( Line, "ES_TRACE END", 12 ) == 0 ) {
+      printf( "\n" );
+      InTrace = false;
+      continue;
+    }
+    if ( sscanf( Line, "%lx %x %x %x %x %x %x", &Time, &Kind, &Source, &Target,
+                 &State, &EventType, &EventParam ) != 7 )
+      continue; // something else got printed in the middle of the dump
+    Record.Time = (uint32_t)Time;
+    Record.Kind = (uint8_t)Kind;
+    Record.Source = (uint8_t)Source;
+    Record.Target = (uint8_t)Target;
+    Record.State = (uint8_t)State;
+    Record.EventType = (uint16_t)EventType;
+    Record.EventParam = (uint16_t)EventParam;
+    // the times are uS that wrap every 71 minutes, so work in differences
+    if ( NumRecords == 0 ) {
+      Seconds = 0;
+      LastTime = Record.Time;
+    }
+    Seconds += (uint32_t)(Record.Time - LastTime) / 1e6;
+    PrintRecord( &Record, Seconds, (unsigned long)(Record.Time - LastTime) );
+    LastTime = Record.Time;
+    NumRecords++;
+  }
+  if ( InTrace == true )
+    printf( "(the dump was cut off)\n" );
+  return (NumDumps > 0) ? 0 : 1;
+}
+
+/***************************************************************************
+ private functions
+ ***************************************************************************/
+static const char * ServiceName( uint8_t Service, char * pBuffer )
+{
+  if ( Service == ES_TRACE_ISR )
+    return "ISR";
+  if ( Service == ES_TRACE_NO_SERVICE )
+    return "-";
+  if ( Service < ARRAY_SIZE(ServiceNames) )
+    return ServiceNames[Service];
+  sprintf( pBuffer, "service %u", Service );
+  return pBuffer;
+}
+
+static void PrintRecord( const ES_TraceRecord_t * pRecord, double Seconds,
+                         unsigned long Delta )
+{
+  char SourceBuffer[16], TargetBuffer[16];
+
+  printf( "%10.6f %10lu  ", Seconds, Delta );
+  switch ( pRecord->Kind ) {
+    case ES_TRACE_POST:
+    case ES_TRACE_DROP:
+      printf( "%-10s %s -> %s", (pRecord->Kind == ES_TRACE_POST) ?
+              "post" : "DROPPED", ServiceName( pRecord->Source, SourceBuffer ),
+              ServiceName( pRecord->Target, TargetBuffer ) );
+      break;
+    case ES_TRACE_DISPATCH:
+      printf( "%-10s %s", "run",
+              ServiceName( pRecord->Target, TargetBuffer ) );
+      break;
+    case ES_TRACE_TRANSITION:
+      if ( pRecord->Source < ARRAY_SIZE(MachineNames) )
+        printf( "%-10s %s", "state", MachineNames[pRecord->Source] );
+      else
+        printf( "%-10s machine %u", "state", pRecord->Source );
+      printf( " %u -> %u", pRecord->Target, pRecord->State );
+      break;
+    case ES_TRACE_FAILED_RUN:
+      printf( "%-10s %s", "FAILED", ServiceName( pRecord->Target,
+                                                  TargetBuffer ) );
+      break;
+    default:
+      printf( "kind %u?", pRecord->Kind );
+      break;
+  }
+  printf( "  event %u param %u (0x%04x)\n", pRecord->EventType,
+          pRecord->EventParam, pRecord->EventParam );
+}
+/*------------------------------- Footnotes -------------------------------*/
+/*------------------------------ End of file ------------------------------*/